@@ -71,8 +71,10 @@
 #include <lists/string_list.h>
 #include <retro_math.h>
 #include <retro_timers.h>
+#include <encodings/crc32.h>
 #include <encodings/utf.h>
 #include <time/rtime.h>
+#include <formats/rjson.h>
 
 #include <gfx/scaler/pixconv.h>
 #include <gfx/scaler/scaler.h>
@@ -98,10 +100,19 @@
 #include <streams/file_stream.h>
 #include <streams/interface_stream.h>
 #include <file/file_path.h>
+#ifdef HAVE_COMPRESSION
+#include <file/archive_file.h>
+#endif
+#ifdef HAVE_CHD
+#include <streams/chd_stream.h>
+#endif
 #include <retro_assert.h>
 #include <retro_miscellaneous.h>
 #include <queues/message_queue.h>
 #include <queues/task_queue.h>
+#ifdef HAVE_THREADS
+#include <queues/spsc_queue.h>
+#endif
 #include <lists/dir_list.h>
 #ifdef HAVE_NETWORKING
 #include <net/net_http.h>
@@ -165,6 +176,10 @@
 #include "menu/menu_shader.h"
 #endif
 
+#ifdef HAVE_SLANG
+#include "gfx/drivers_shader/glslang_util.h"
+#endif
+
 #ifdef HAVE_GFX_WIDGETS
 #include "gfx/gfx_widgets.h"
 #endif
@@ -180,7 +195,6 @@
 #include <encodings/base64.h>
 #include <formats/rbmp.h>
 #include <formats/rpng.h>
-#include <formats/rjson.h>
 #include "translation_defines.h"
 #endif
 
@@ -196,6 +210,7 @@
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
 #endif
 
 #if defined(HAVE_OPENGL)
@@ -4705,6 +4720,7 @@ bool menu_driver_ctl(enum rarch_menu_ctl_state state, void *data)
 
             gfx_animation_deinit(&p_rarch->anim);
             gfx_display_free();
+            gfx_thumbnail_cache_clear();
 
             menu_entries_settings_deinit(p_rarch);
             menu_entries_list_deinit(p_rarch);
@@ -7911,6 +7927,431 @@ static void retro_perf_log(void)
    log_counters(p_rarch->perf_counters_libretro, p_rarch->perf_ptr_libretro);
 }
 
+/* BENCHMARK */
+
+/* Sets up a --benchmark run: no video, audio or input device,
+ * no frame limit, and nothing written back to the configuration
+ * or save files. */
+static void KingStation_benchmark_init(struct rarch_state *p_rarch,
+      settings_t *settings)
+{
+   bool has_movie = false;
+
+#ifdef HAVE_BSV_MOVIE
+   has_movie      = p_rarch->bsv_movie_state.movie_start_playback;
+   if (has_movie)
+      p_rarch->bsv_movie_state.eof_exit = true;
+#endif
+
+   if (!p_rarch->runloop_max_frames && !has_movie)
+   {
+      RARCH_ERR("[Benchmark]: --benchmark needs --max-frames or --bsvplay.\n");
+      KingStation_fail(1, "KingStation_benchmark_init()");
+   }
+
+   configuration_set_string(settings, settings->arrays.video_driver, "null");
+   configuration_set_string(settings, settings->arrays.input_driver, "null");
+   configuration_set_bool(settings, settings->bools.audio_enable, false);
+   configuration_set_bool(settings, settings->bools.video_vsync, false);
+   configuration_set_bool(settings, settings->bools.audio_sync, false);
+   configuration_set_bool(settings,
+         settings->bools.auto_overrides_enable, false);
+   configuration_set_bool(settings,
+         settings->bools.config_save_on_exit, false);
+
+   p_rarch->rarch_is_sram_load_disabled = true;
+   p_rarch->rarch_is_sram_save_disabled = true;
+   p_rarch->runloop_perfcnt_enable      = true;
+   p_rarch->benchmark.count             = 0;
+   p_rarch->benchmark.frame_start       = 0;
+}
+
+/* Closes the previous frame, whatever ran since
+ * its core_run() is frontend time */
+static void KingStation_benchmark_frame_begin(
+      struct rarch_benchmark *bench, retro_time_t now)
+{
+   if (bench->count)
+      bench->frontend_usec[bench->count - 1] =
+         now - bench->frame_start - bench->core_usec[bench->count - 1];
+   else
+      bench->start_time = now;
+
+   bench->frame_start   = now;
+}
+
+static void KingStation_benchmark_frame_end(
+      struct rarch_benchmark *bench, retro_time_t core_start)
+{
+   retro_time_t core_time = cpu_features_get_time_usec() - core_start;
+
+   if (bench->count == bench->capacity)
+   {
+      size_t capacity          = bench->capacity ? bench->capacity * 2 : 4096;
+      retro_time_t *core_usec  = (retro_time_t*)realloc(bench->core_usec,
+            capacity * sizeof(*core_usec));
+      retro_time_t *front_usec = core_usec ? (retro_time_t*)realloc(
+            bench->frontend_usec, capacity * sizeof(*front_usec)) : NULL;
+
+      if (core_usec)
+         bench->core_usec     = core_usec;
+      if (!front_usec)
+         return;
+      bench->frontend_usec    = front_usec;
+      bench->capacity         = capacity;
+   }
+
+   /* The callbacks the core made are the frontend's */
+   bench->core_usec[bench->count]     = core_time - bench->callback_usec;
+   bench->frontend_usec[bench->count] = bench->callback_usec;
+   bench->count++;
+}
+
+static int KingStation_benchmark_cmp(const void *a, const void *b)
+{
+   retro_time_t x = *(const retro_time_t*)a;
+   retro_time_t y = *(const retro_time_t*)b;
+   return (x > y) - (x < y);
+}
+
+static void KingStation_benchmark_write_key(rjsonwriter_t *writer,
+      int indent, const char *key)
+{
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_spaces(writer, indent);
+   rjsonwriter_add_string(writer, key);
+   rjsonwriter_add_colon(writer);
+   rjsonwriter_add_space(writer);
+}
+
+/* Writes min, mean, nearest-rank percentiles and max of @samples,
+ * using @sorted as scratch space */
+static void KingStation_benchmark_write_stats(rjsonwriter_t *writer,
+      const char *key, const retro_time_t *samples,
+      retro_time_t *sorted, size_t count)
+{
+   size_t i;
+   static const unsigned percentiles[] = { 50, 90, 95, 99 };
+   retro_time_t total                  = 0;
+
+   memcpy(sorted, samples, count * sizeof(*sorted));
+   qsort(sorted, count, sizeof(*sorted), KingStation_benchmark_cmp);
+
+   for (i = 0; i < count; i++)
+      total += sorted[i];
+
+   KingStation_benchmark_write_key(writer, 2, key);
+   rjsonwriter_add_start_object(writer);
+   KingStation_benchmark_write_key(writer, 4, "min");
+   rjsonwriter_rawf(writer, BENCHMARK_U64_FMT,
+         (unsigned long long)sorted[0]);
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_key(writer, 4, "mean");
+   rjsonwriter_add_double(writer, (double)total / count);
+
+   for (i = 0; i < ARRAY_SIZE(percentiles); i++)
+   {
+      char name[8];
+      size_t rank = (percentiles[i] * count + 99) / 100;
+
+      snprintf(name, sizeof(name), "p%u", percentiles[i]);
+      rjsonwriter_add_comma(writer);
+      KingStation_benchmark_write_key(writer, 4, name);
+      rjsonwriter_rawf(writer, BENCHMARK_U64_FMT,
+            (unsigned long long)sorted[rank ? rank - 1 : 0]);
+   }
+
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_key(writer, 4, "max");
+   rjsonwriter_rawf(writer, BENCHMARK_U64_FMT,
+         (unsigned long long)sorted[count - 1]);
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_spaces(writer, 2);
+   rjsonwriter_add_end_object(writer);
+}
+
+static void KingStation_benchmark_write_counters(rjsonwriter_t *writer,
+      const char *key, struct retro_perf_counter **counters, int num)
+{
+   int i;
+   bool first = true;
+
+   KingStation_benchmark_write_key(writer, 4, key);
+   rjsonwriter_add_start_array(writer);
+
+   for (i = 0; i < num; i++)
+   {
+      if (!counters[i]->call_cnt)
+         continue;
+
+      if (!first)
+         rjsonwriter_add_comma(writer);
+      first = false;
+
+      rjsonwriter_add_newline(writer);
+      rjsonwriter_add_spaces(writer, 6);
+      rjsonwriter_add_start_object(writer);
+      rjsonwriter_add_string(writer, "ident");
+      rjsonwriter_add_colon(writer);
+      rjsonwriter_add_space(writer);
+      rjsonwriter_add_string(writer, counters[i]->ident);
+      rjsonwriter_add_comma(writer);
+      rjsonwriter_add_space(writer);
+      rjsonwriter_add_string(writer, "total");
+      rjsonwriter_add_colon(writer);
+      rjsonwriter_add_space(writer);
+      rjsonwriter_rawf(writer, BENCHMARK_U64_FMT,
+            (unsigned long long)counters[i]->total);
+      rjsonwriter_add_comma(writer);
+      rjsonwriter_add_space(writer);
+      rjsonwriter_add_string(writer, "calls");
+      rjsonwriter_add_colon(writer);
+      rjsonwriter_add_space(writer);
+      rjsonwriter_rawf(writer, BENCHMARK_U64_FMT,
+            (unsigned long long)counters[i]->call_cnt);
+      rjsonwriter_add_end_object(writer);
+   }
+
+   if (!first)
+   {
+      rjsonwriter_add_newline(writer);
+      rjsonwriter_add_spaces(writer, 4);
+   }
+   rjsonwriter_add_end_array(writer);
+}
+
+static void KingStation_benchmark_write_samples(rjsonwriter_t *writer,
+      const char *key, const retro_time_t *samples, size_t count)
+{
+   size_t i;
+
+   KingStation_benchmark_write_key(writer, 4, key);
+   rjsonwriter_add_start_array(writer);
+
+   for (i = 0; i < count; i++)
+   {
+      if (i)
+         rjsonwriter_add_comma(writer);
+      /* Keep lines short enough for diff tools */
+      if (!(i & 15))
+      {
+         rjsonwriter_add_newline(writer);
+         rjsonwriter_add_spaces(writer, 6);
+      }
+      rjsonwriter_rawf(writer, BENCHMARK_U64_FMT,
+            (unsigned long long)samples[i]);
+   }
+
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_spaces(writer, 4);
+   rjsonwriter_add_end_array(writer);
+}
+
+static bool KingStation_benchmark_state_crc(uint32_t *crc)
+{
+   retro_ctx_size_info_t info;
+   retro_ctx_serialize_info_t serial_info;
+   void *data                             = NULL;
+
+   core_serialize_size(&info);
+
+   if (!info.size || !(data = malloc(info.size)))
+      return false;
+
+   serial_info.data = data;
+   serial_info.size = info.size;
+
+   if (!core_serialize(&serial_info))
+   {
+      free(data);
+      return false;
+   }
+
+   *crc = encoding_crc32(0, (const uint8_t*)data, info.size);
+   free(data);
+   return true;
+}
+
+static bool KingStation_benchmark_write_report(struct rarch_state *p_rarch,
+      retro_time_t elapsed, bool has_crc, uint32_t crc)
+{
+   struct rarch_benchmark *bench = &p_rarch->benchmark;
+   struct retro_system_info *sys = &p_rarch->runloop_system.info;
+   retro_time_t *frame_usec      = NULL;
+   retro_time_t *sorted          = NULL;
+   rjsonwriter_t *writer         = NULL;
+   intfstream_t *file            = NULL;
+   bool ret                      = false;
+   size_t i;
+
+   if (     !(frame_usec = (retro_time_t*)malloc(
+                  bench->count * sizeof(*frame_usec)))
+         || !(sorted     = (retro_time_t*)malloc(
+                  bench->count * sizeof(*sorted))))
+      goto end;
+
+   for (i = 0; i < bench->count; i++)
+      frame_usec[i] = bench->core_usec[i] + bench->frontend_usec[i];
+
+   if (!(file = intfstream_open_file(bench->report_path,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+      goto end;
+
+   if (!(writer = rjsonwriter_open_stream(file)))
+      goto end;
+
+   rjsonwriter_add_start_object(writer);
+   KingStation_benchmark_write_key(writer, 2, "version");
+   rjsonwriter_add_string(writer, "1.0");
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_key(writer, 2, "core");
+   rjsonwriter_add_string(writer, sys->library_name);
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_key(writer, 2, "core_version");
+   rjsonwriter_add_string(writer, sys->library_version);
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_key(writer, 2, "content");
+   rjsonwriter_add_string(writer, path_get(RARCH_PATH_CONTENT));
+   rjsonwriter_add_comma(writer);
+#ifdef HAVE_BSV_MOVIE
+   KingStation_benchmark_write_key(writer, 2, "movie");
+   rjsonwriter_add_string(writer,
+         p_rarch->bsv_movie_state.movie_start_playback
+         ? p_rarch->bsv_movie_state.movie_start_path : "");
+   rjsonwriter_add_comma(writer);
+#endif
+   KingStation_benchmark_write_key(writer, 2, "frames");
+   rjsonwriter_rawf(writer, BENCHMARK_U64_FMT,
+         (unsigned long long)bench->count);
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_key(writer, 2, "elapsed_usec");
+   rjsonwriter_rawf(writer, BENCHMARK_U64_FMT, (unsigned long long)elapsed);
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_key(writer, 2, "fps");
+   rjsonwriter_add_double(writer, elapsed
+         ? bench->count * 1000000.0 / elapsed : 0.0);
+   rjsonwriter_add_comma(writer);
+
+   KingStation_benchmark_write_key(writer, 2, "state_crc");
+   if (has_crc)
+   {
+      char crc_str[16];
+      snprintf(crc_str, sizeof(crc_str), "%08x", crc);
+      rjsonwriter_add_string(writer, crc_str);
+   }
+   else
+      rjsonwriter_raw(writer, "null", 4);
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_key(writer, 2, "state_crc_match");
+   if (bench->expect_state_crc)
+      rjsonwriter_add_bool(writer,
+            has_crc && crc == bench->expected_state_crc);
+   else
+      rjsonwriter_raw(writer, "null", 4);
+   rjsonwriter_add_comma(writer);
+
+   KingStation_benchmark_write_stats(writer, "frame_usec",
+         frame_usec, sorted, bench->count);
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_stats(writer, "core_usec",
+         bench->core_usec, sorted, bench->count);
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_stats(writer, "frontend_usec",
+         bench->frontend_usec, sorted, bench->count);
+   rjsonwriter_add_comma(writer);
+
+   KingStation_benchmark_write_key(writer, 2, "perf_counters");
+   rjsonwriter_add_start_object(writer);
+   KingStation_benchmark_write_counters(writer, "frontend",
+         p_rarch->perf_counters_rarch, p_rarch->perf_ptr_rarch);
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_counters(writer, "libretro",
+         p_rarch->perf_counters_libretro, p_rarch->perf_ptr_libretro);
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_spaces(writer, 2);
+   rjsonwriter_add_end_object(writer);
+   rjsonwriter_add_comma(writer);
+
+   KingStation_benchmark_write_key(writer, 2, "per_frame");
+   rjsonwriter_add_start_object(writer);
+   KingStation_benchmark_write_samples(writer, "core_usec",
+         bench->core_usec, bench->count);
+   rjsonwriter_add_comma(writer);
+   KingStation_benchmark_write_samples(writer, "frontend_usec",
+         bench->frontend_usec, bench->count);
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_spaces(writer, 2);
+   rjsonwriter_add_end_object(writer);
+   rjsonwriter_add_newline(writer);
+   rjsonwriter_add_end_object(writer);
+   rjsonwriter_add_newline(writer);
+
+   ret = rjsonwriter_free(writer);
+
+end:
+   if (file)
+   {
+      intfstream_close(file);
+      free(file);
+   }
+   free(frame_usec);
+   free(sorted);
+   return ret;
+}
+
+/* Ends a --benchmark run, called once the last frame ran */
+static void KingStation_benchmark_finish(struct rarch_state *p_rarch)
+{
+   struct rarch_benchmark *bench = &p_rarch->benchmark;
+   retro_time_t now              = cpu_features_get_time_usec();
+   uint32_t crc                  = 0;
+   bool has_crc                  = false;
+   retro_time_t elapsed;
+
+   bench->enable                 = false;
+
+   if (!bench->count)
+   {
+      RARCH_ERR("[Benchmark]: No frames ran.\n");
+      bench->failed = true;
+      return;
+   }
+
+   /* Close the last frame */
+   KingStation_benchmark_frame_begin(bench, now);
+   elapsed = now - bench->start_time;
+
+   if (!(has_crc = KingStation_benchmark_state_crc(&crc)))
+      RARCH_WARN("[Benchmark]: Core does not support save states, "
+            "can not check the final state.\n");
+
+   if (bench->expect_state_crc && (!has_crc || crc != bench->expected_state_crc))
+   {
+      RARCH_ERR("[Benchmark]: Final state CRC is %08x, expected %08x.\n",
+            crc, bench->expected_state_crc);
+      bench->failed = true;
+   }
+
+   if (!KingStation_benchmark_write_report(p_rarch, elapsed, has_crc, crc))
+   {
+      RARCH_ERR("[Benchmark]: Could not write report to \"%s\".\n",
+            bench->report_path);
+      bench->failed = true;
+   }
+
+   RARCH_LOG("[Benchmark]: %u frames in %.3f s, %.1f fps, state CRC %08x.\n",
+         (unsigned)bench->count, elapsed / 1000000.0,
+         bench->count * 1000000.0 / elapsed, crc);
+
+   free(bench->core_usec);
+   free(bench->frontend_usec);
+   bench->core_usec     = NULL;
+   bench->frontend_usec = NULL;
+   bench->count         = 0;
+   bench->capacity      = 0;
+}
+
 struct retro_perf_counter **retro_get_perf_counter_rarch(void)
 {
    struct rarch_state *p_rarch = &rarch_st;
@@ -12406,6 +12847,12 @@ static bool command_event_init_core(
 
    p_rarch->current_core.retro_set_environment(rarch_environment_cb);
 
+   /* Have the content read while the core initializes. Only
+    * now that the core has set up its environment does the
+    * system info say how content_init() will load it */
+   content_prefetch(path_get(RARCH_PATH_CONTENT),
+         sys_info->info.need_fullpath);
+
 #ifdef HAVE_CONFIGFILE
    if (auto_remaps_enable)
       config_load_remap(dir_input_remapping, &p_rarch->runloop_system);
@@ -12988,6 +13435,7 @@ static void runahead_clear_variables(struct rarch_state *p_rarch)
    p_rarch->runahead_secondary_core_available = true;
    p_rarch->runahead_force_input_dirty        = true;
    p_rarch->runahead_last_frame_count         = 0;
+   p_rarch->runahead_state_count              = 0;
 }
 #endif
 
@@ -13401,7 +13849,11 @@ bool command_event(enum event_command cmd, void *data)
 #ifdef HAVE_REWIND
          {
             bool rewind_enable        = settings->bools.rewind_enable;
+            bool rewind_threaded      = settings->bools.rewind_threaded;
+            bool rewind_page_hashes   = settings->bools.rewind_page_hashes;
             size_t rewind_buf_size    = settings->sizes.rewind_buffer_size;
+            size_t rewind_tier2_size  = settings->sizes.rewind_tier2_buffer_size;
+            unsigned rewind_keyframes = settings->uints.rewind_keyframe_interval;
 #ifdef HAVE_CHEEVOS
             if (rcheevos_hardcore_active())
                return false;
@@ -13416,7 +13868,9 @@ bool command_event(enum event_command cmd, void *data)
 #endif
                {
                   state_manager_event_init(&p_rarch->rewind_st,
-                        (unsigned)rewind_buf_size);
+                        (unsigned)rewind_buf_size, rewind_threaded,
+                        rewind_page_hashes, rewind_tier2_size,
+                        rewind_keyframes);
                }
             }
          }
@@ -13593,6 +14047,7 @@ bool command_event(enum event_command cmd, void *data)
             playlist_config.capacity               = settings->uints.content_history_size;
             playlist_config.old_format             = settings->bools.playlist_use_old_format;
             playlist_config.compress               = settings->bools.playlist_compression;
+            playlist_config.binary                 = settings->bools.playlist_use_binary_format;
             playlist_config.fuzzy_archive_match    = settings->bools.playlist_fuzzy_archive_match;
             /* don't use relative paths for content, music, video, and image histories */
             playlist_config_set_base_content_directory(&playlist_config, NULL);
@@ -14827,6 +15282,16 @@ void main_exit(void *args)
    rarch_ctl(RARCH_CTL_STATE_FREE,  NULL);
    global_free(p_rarch);
    task_queue_deinit();
+#ifdef HAVE_THREADS
+   /* Tasks are done with the pool once the queue is gone */
+   if (p_rarch->thread_pool)
+      tpool_destroy(p_rarch->thread_pool);
+   p_rarch->thread_pool = NULL;
+#endif
+   task_image_decode_deinit();
+#ifdef HAVE_COMPRESSION
+   file_archive_cache_deinit();
+#endif
 
    if (p_rarch->configuration_settings)
       free(p_rarch->configuration_settings);
@@ -14967,7 +15432,8 @@ int rarch_main(int argc, char *argv[], void *data)
    main_exit(data);
 #endif
 
-   return 0;
+   /* Lets scripts tell a failed --benchmark run apart */
+   return p_rarch->benchmark.failed ? 1 : 0;
 }
 
 #if defined(EMSCRIPTEN)
@@ -17205,6 +17671,20 @@ static bool rarch_environment_cb(unsigned cmd, void *data)
          break;
       }
 
+      case RETRO_ENVIRONMENT_GET_AUDIO_SAMPLE_BATCH_FLOAT:
+      {
+         struct retro_audio_sample_batch_float_callback *cb =
+            (struct retro_audio_sample_batch_float_callback*)data;
+
+         RARCH_LOG("[Environ]: GET_AUDIO_SAMPLE_BATCH_FLOAT.\n");
+
+         if (!cb)
+            return false;
+
+         cb->callback = audio_driver_sample_batch_float;
+         break;
+      }
+
       case RETRO_ENVIRONMENT_SET_MINIMUM_AUDIO_LATENCY:
       {
          unsigned audio_latency_default = settings->uints.audio_latency;
@@ -18390,6 +18870,10 @@ static void secondary_core_destroy(struct rarch_state *p_rarch)
    if (!p_rarch || !p_rarch->secondary_lib_handle)
       return;
 
+#if defined(HAVE_DYNAMIC) && defined(HAVE_THREADS)
+   runahead_secondary_thread_free(p_rarch);
+#endif
+
    /* unload game from core */
    if (p_rarch->secondary_core.retro_unload_game)
       p_rarch->secondary_core.retro_unload_game();
@@ -18614,7 +19098,87 @@ static bool rarch_environment_secondary_core_hook(
       unsigned cmd, void *data)
 {
    struct rarch_state *p_rarch = &rarch_st;
-   bool                 result = rarch_environment_cb(cmd, data);
+   bool                 result = false;
+
+   /* The float batch callback always feeds the main instance,
+    * keep the secondary one on the s16 callbacks it was given. */
+   if (cmd == RETRO_ENVIRONMENT_GET_AUDIO_SAMPLE_BATCH_FLOAT)
+      return false;
+
+#if defined(HAVE_DYNAMIC) && defined(HAVE_THREADS)
+   /* Running on the run-ahead thread, next to the main core -
+    * answer queries from what runahead_secondary_thread_start()
+    * took on the main thread, and refuse everything else.
+    * Whatever the secondary instance would set, the main
+    * instance will set too once it gets there. */
+   if (p_rarch->runahead_secondary_thread.active)
+   {
+      runahead_secondary_thread_t *rst =
+         &p_rarch->runahead_secondary_thread;
+
+      switch (cmd)
+      {
+         case RETRO_ENVIRONMENT_GET_VARIABLE_UPDATE:
+            /* Pending updates keep run-ahead off the
+             * thread until they were reported */
+            *(bool*)data = false;
+            return true;
+         case RETRO_ENVIRONMENT_GET_AUDIO_VIDEO_ENABLE:
+            /* Video only, its audio goes nowhere */
+            *(int*)data  = 1;
+            return true;
+         case RETRO_ENVIRONMENT_GET_VARIABLE:
+            {
+               size_t i;
+               struct retro_variable *var = (struct retro_variable*)data;
+
+               if (!var)
+                  return true;
+
+               var->value = NULL;
+               for (i = 0; i < rst->vars_size; i++)
+               {
+                  if (string_is_equal(rst->vars[i].key, var->key))
+                  {
+                     var->value = rst->vars[i].value;
+                     break;
+                  }
+               }
+            }
+            return true;
+         case RETRO_ENVIRONMENT_GET_LOG_INTERFACE:
+            ((struct retro_log_callback*)data)->log = rarch_log_libretro;
+            return true;
+         case RETRO_ENVIRONMENT_GET_CAN_DUPE:
+            *(bool*)data = true;
+            return true;
+         case RETRO_ENVIRONMENT_GET_OVERSCAN:
+            *(bool*)data = rst->overscan;
+            return true;
+         case RETRO_ENVIRONMENT_GET_LANGUAGE:
+#ifdef HAVE_LANGEXTRA
+            *(unsigned*)data = rst->language;
+#endif
+            return true;
+         case RETRO_ENVIRONMENT_GET_INPUT_BITMASKS:
+            return true;
+         case RETRO_ENVIRONMENT_GET_SYSTEM_DIRECTORY:
+            *(const char**)data = rst->system_dir;
+            return true;
+         case RETRO_ENVIRONMENT_GET_SAVE_DIRECTORY:
+            *(const char**)data = rst->save_dir;
+            return true;
+         case RETRO_ENVIRONMENT_GET_CORE_ASSETS_DIRECTORY:
+            *(const char**)data = *rst->assets_dir
+               ? rst->assets_dir : NULL;
+            return true;
+         default:
+            return false;
+      }
+   }
+#endif
+
+   result                      = rarch_environment_cb(cmd, data);
 
    if (p_rarch->has_variable_update)
    {
@@ -27421,6 +27985,9 @@ static bool audio_driver_free_devices_list(struct rarch_state *p_rarch)
 
 static bool audio_driver_deinit(struct rarch_state *p_rarch)
 {
+#ifdef HAVE_THREADS
+   audio_driver_thread_free(p_rarch);
+#endif
 #ifdef HAVE_AUDIOMIXER
    audio_driver_mixer_deinit(p_rarch);
 #endif
@@ -27667,39 +28234,84 @@ static bool audio_driver_init_internal(
       audio_driver_start(p_rarch,
             false);
 
+#ifdef HAVE_THREADS
+   /* Falls back to mixing on the main thread on failure. */
+   if (
+            settings->bools.audio_threaded_mixing
+         && p_rarch->audio_driver_active
+         && !audio_cb_inited
+      )
+      audio_driver_thread_init(p_rarch, outsamples_max);
+#endif
+
    return true;
 
 error:
    return audio_driver_deinit(p_rarch);
 }
 
+static struct retro_perf_counter audio_perf_fast_path   = {0};
+static struct retro_perf_counter audio_perf_batch_float = {0};
+
+static void audio_driver_write(struct rarch_state *p_rarch,
+      const void *data, size_t size)
+{
+   if (p_rarch->current_audio->write(
+            p_rarch->audio_driver_context_audio_data, data, size) < 0)
+      p_rarch->audio_driver_active = false;
+}
+
 /**
- * audio_driver_flush:
- * @data                 : pointer to audio buffer.
- * @right                : amount of samples to write.
+ * audio_driver_is_identity:
+ *
+ * Returns: true if the pipeline would hand the samples to
+ * the driver unchanged - no gain, DSP, mixing or rate
+ * conversion. Rate control rules it out, as it nudges the
+ * ratio away from 1.0 on every flush.
+ **/
+static bool audio_driver_is_identity(struct rarch_state *p_rarch,
+      float audio_volume_gain, bool is_slowmotion)
+{
+   if (     audio_volume_gain != 1.0f
+         || is_slowmotion
+         || p_rarch->audio_driver_control
+         || p_rarch->audio_source_ratio_current != 1.0)
+      return false;
+#ifdef HAVE_DSP_FILTER
+   if (p_rarch->audio_driver_dsp)
+      return false;
+#endif
+#ifdef HAVE_AUDIOMIXER
+   if (p_rarch->audio_mixer_active)
+      return false;
+#endif
+   return true;
+}
+
+/**
+ * audio_driver_process_float:
+ * @data                 : pointer to float audio buffer, gain
+ *                         already applied.
+ * @samples              : amount of samples to write.
+ * @conv_buf             : scratch buffer for the final
+ *                         float -> s16 conversion.
  *
  * Writes audio samples to audio driver. Will first
  * perform DSP processing (if enabled) and resampling.
  **/
-static void audio_driver_flush(
+static void audio_driver_process_float(
       struct rarch_state *p_rarch,
       float slowmotion_ratio,
-      bool audio_fastforward_mute,
-      const int16_t *data, size_t samples,
-      bool is_slowmotion, bool is_fastmotion)
+      const float *data, size_t samples,
+      bool is_slowmotion,
+      int16_t *conv_buf)
 {
    struct resampler_data src_data;
-   float audio_volume_gain           = (p_rarch->audio_driver_mute_enable ||
-         (audio_fastforward_mute && is_fastmotion)) ?
-               0.0f : p_rarch->audio_driver_volume_gain;
 
    src_data.data_out                 = NULL;
    src_data.output_frames            = 0;
 
-   convert_s16_to_float(p_rarch->audio_driver_input_data, data, samples,
-         audio_volume_gain);
-
-   src_data.data_in                  = p_rarch->audio_driver_input_data;
+   src_data.data_in                  = data;
    src_data.input_frames             = samples >> 1;
 
 #ifdef HAVE_DSP_FILTER
@@ -27707,6 +28319,11 @@ static void audio_driver_flush(
    {
       struct retro_dsp_data dsp_data;
 
+      /* Filters may work in place, never on the core's buffer. */
+      if (data != p_rarch->audio_driver_input_data)
+         memcpy(p_rarch->audio_driver_input_data, data,
+               samples * sizeof(float));
+
       dsp_data.input                 = NULL;
       dsp_data.input_frames          = 0;
       dsp_data.output                = NULL;
@@ -27735,7 +28352,26 @@ static void audio_driver_flush(
       int      avail               =
          (int)p_rarch->current_audio->write_avail(
                p_rarch->audio_driver_context_audio_data);
-      int      delta_mid           = avail - half_size;
+      int      delta_mid;
+#ifdef HAVE_THREADS
+      /* With a mixing thread, what sits in the queue is
+       * latency too - aim for half of queue and driver
+       * buffer combined, in driver bytes. */
+      if (p_rarch->audio_driver_thread)
+      {
+         double scale              = p_rarch->audio_source_ratio_original
+            * (p_rarch->audio_driver_use_float
+                  ? sizeof(float) : sizeof(int16_t)) / sizeof(int16_t);
+         int queue_size            = (int)(
+               p_rarch->audio_driver_thread_queue.size * scale);
+         int queued                = (int)(spsc_queue_read_avail(
+                  &p_rarch->audio_driver_thread_queue) * scale);
+
+         half_size                += queue_size / 2;
+         avail                    += queue_size - queued;
+      }
+#endif
+      delta_mid                    = avail - half_size;
       double   direction           = (double)delta_mid / half_size;
       double   adjust              = 1.0 +
          p_rarch->audio_driver_rate_control_delta * direction;
@@ -27815,20 +28451,279 @@ static void audio_driver_flush(
          output_frames       *= sizeof(float);
       else
       {
-         convert_float_to_s16(p_rarch->audio_driver_output_samples_conv_buf,
+         convert_float_to_s16(conv_buf,
                (const float*)output_data, output_frames * 2);
 
-         output_data          = p_rarch->audio_driver_output_samples_conv_buf;
+         output_data          = conv_buf;
          output_frames       *= sizeof(int16_t);
       }
 
-      if (p_rarch->current_audio->write(
-               p_rarch->audio_driver_context_audio_data,
-               output_data, output_frames * 2) < 0)
-         p_rarch->audio_driver_active = false;
+      audio_driver_write(p_rarch, output_data, output_frames * 2);
    }
 }
 
+/**
+ * audio_driver_process:
+ * @data                 : pointer to audio buffer.
+ * @samples              : amount of samples to write.
+ * @conv_buf             : scratch buffer for the final
+ *                         float -> s16 conversion.
+ *
+ * Converts the core's s16 samples and runs them through
+ * audio_driver_process_float(), unless there is nothing to
+ * do to them - then they go to the driver as they are.
+ **/
+static void audio_driver_process(
+      struct rarch_state *p_rarch,
+      float slowmotion_ratio,
+      bool audio_fastforward_mute,
+      const int16_t *data, size_t samples,
+      bool is_slowmotion, bool is_fastmotion,
+      int16_t *conv_buf)
+{
+   float audio_volume_gain           = (p_rarch->audio_driver_mute_enable ||
+         (audio_fastforward_mute && is_fastmotion)) ?
+               0.0f : p_rarch->audio_driver_volume_gain;
+
+   if (audio_driver_is_identity(p_rarch, audio_volume_gain, is_slowmotion))
+   {
+      performance_counter_init(audio_perf_fast_path, "audio_fast_path");
+      performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+            audio_perf_fast_path);
+
+      if (p_rarch->audio_driver_use_float)
+      {
+         convert_s16_to_float(p_rarch->audio_driver_input_data, data,
+               samples, 1.0f);
+         audio_driver_write(p_rarch, p_rarch->audio_driver_input_data,
+               samples * sizeof(float));
+      }
+      else
+         audio_driver_write(p_rarch, data, samples * sizeof(int16_t));
+
+      performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+            audio_perf_fast_path);
+      return;
+   }
+
+   convert_s16_to_float(p_rarch->audio_driver_input_data, data, samples,
+         audio_volume_gain);
+
+   audio_driver_process_float(p_rarch, slowmotion_ratio,
+         p_rarch->audio_driver_input_data, samples,
+         is_slowmotion, conv_buf);
+}
+
+#ifdef HAVE_THREADS
+static void audio_driver_thread_loop(void *data)
+{
+   struct rarch_state *p_rarch = (struct rarch_state*)data;
+   settings_t *settings        = p_rarch->configuration_settings;
+   int16_t samples[AUDIO_CHUNK_SIZE_NONBLOCKING * 2];
+
+   for (;;)
+   {
+      size_t read;
+      bool alive;
+
+      slock_lock(p_rarch->audio_driver_thread_wake_lock);
+      while (p_rarch->audio_driver_thread_alive
+            && !spsc_queue_read_avail(&p_rarch->audio_driver_thread_queue))
+         scond_wait(p_rarch->audio_driver_thread_cond,
+               p_rarch->audio_driver_thread_wake_lock);
+      alive = p_rarch->audio_driver_thread_alive;
+      slock_unlock(p_rarch->audio_driver_thread_wake_lock);
+
+      if (!alive)
+         break;
+
+      slock_lock(p_rarch->audio_driver_thread_lock);
+      /* The producer only ever queues whole frames. */
+      read = spsc_queue_read(&p_rarch->audio_driver_thread_queue,
+            samples, sizeof(samples));
+      if (     read
+            && p_rarch->audio_driver_active
+            && p_rarch->audio_driver_output_samples_buf)
+         audio_driver_process(
+               p_rarch,
+               settings->floats.slowmotion_ratio,
+               settings->bools.audio_fastforward_mute,
+               samples, read / sizeof(int16_t),
+               p_rarch->runloop_slowmotion,
+               p_rarch->runloop_fastmotion,
+               p_rarch->audio_driver_thread_conv_buf);
+      slock_unlock(p_rarch->audio_driver_thread_lock);
+
+      slock_lock(p_rarch->audio_driver_thread_wake_lock);
+      scond_signal(p_rarch->audio_driver_thread_space_cond);
+      slock_unlock(p_rarch->audio_driver_thread_wake_lock);
+   }
+}
+
+/**
+ * audio_driver_thread_push:
+ * @data                 : pointer to audio buffer.
+ * @samples              : amount of samples to queue.
+ *
+ * Hands samples over to the mixing thread. With blocking
+ * audio this waits for room in the queue, so the driver
+ * still paces the core; otherwise whatever does not fit
+ * is dropped, as a nonblocking driver would.
+ **/
+static void audio_driver_thread_push(struct rarch_state *p_rarch,
+      const int16_t *data, size_t samples)
+{
+   const uint8_t *buf = (const uint8_t*)data;
+   size_t len         = (samples & ~(size_t)1) * sizeof(int16_t);
+   bool blocking      = p_rarch->audio_driver_chunk_size
+      != p_rarch->audio_driver_chunk_nonblock_size;
+
+   while (len)
+   {
+      size_t avail = spsc_queue_write_avail(
+            &p_rarch->audio_driver_thread_queue)
+         & ~(size_t)(2 * sizeof(int16_t) - 1);
+
+      if (avail)
+      {
+         size_t written = spsc_queue_write(
+               &p_rarch->audio_driver_thread_queue, buf,
+               MIN(avail, len));
+
+         buf += written;
+         len -= written;
+
+         slock_lock(p_rarch->audio_driver_thread_wake_lock);
+         scond_signal(p_rarch->audio_driver_thread_cond);
+         slock_unlock(p_rarch->audio_driver_thread_wake_lock);
+         continue;
+      }
+
+      if (!blocking)
+         break;
+
+      slock_lock(p_rarch->audio_driver_thread_wake_lock);
+      while (p_rarch->audio_driver_thread_alive
+            && spsc_queue_write_avail(
+               &p_rarch->audio_driver_thread_queue)
+            < 2 * sizeof(int16_t))
+         scond_wait(p_rarch->audio_driver_thread_space_cond,
+               p_rarch->audio_driver_thread_wake_lock);
+      slock_unlock(p_rarch->audio_driver_thread_wake_lock);
+
+      if (!p_rarch->audio_driver_thread_alive)
+         break;
+   }
+}
+
+static void audio_driver_thread_free(struct rarch_state *p_rarch)
+{
+   if (p_rarch->audio_driver_thread)
+   {
+      slock_lock(p_rarch->audio_driver_thread_wake_lock);
+      p_rarch->audio_driver_thread_alive = false;
+      scond_signal(p_rarch->audio_driver_thread_cond);
+      scond_signal(p_rarch->audio_driver_thread_space_cond);
+      slock_unlock(p_rarch->audio_driver_thread_wake_lock);
+
+      sthread_join(p_rarch->audio_driver_thread);
+   }
+
+   if (p_rarch->audio_driver_thread_lock)
+      slock_free(p_rarch->audio_driver_thread_lock);
+   if (p_rarch->audio_driver_thread_wake_lock)
+      slock_free(p_rarch->audio_driver_thread_wake_lock);
+   if (p_rarch->audio_driver_thread_cond)
+      scond_free(p_rarch->audio_driver_thread_cond);
+   if (p_rarch->audio_driver_thread_space_cond)
+      scond_free(p_rarch->audio_driver_thread_space_cond);
+   if (p_rarch->audio_driver_thread_conv_buf)
+      free(p_rarch->audio_driver_thread_conv_buf);
+   spsc_queue_deinitialize(&p_rarch->audio_driver_thread_queue);
+
+   p_rarch->audio_driver_thread            = NULL;
+   p_rarch->audio_driver_thread_lock       = NULL;
+   p_rarch->audio_driver_thread_wake_lock  = NULL;
+   p_rarch->audio_driver_thread_cond       = NULL;
+   p_rarch->audio_driver_thread_space_cond = NULL;
+   p_rarch->audio_driver_thread_conv_buf   = NULL;
+   p_rarch->audio_driver_thread_alive      = false;
+}
+
+static bool audio_driver_thread_init(struct rarch_state *p_rarch,
+      size_t outsamples_max)
+{
+   p_rarch->audio_driver_thread_conv_buf   = (int16_t*)
+      malloc(outsamples_max * sizeof(int16_t));
+   p_rarch->audio_driver_thread_lock       = slock_new();
+   p_rarch->audio_driver_thread_wake_lock  = slock_new();
+   p_rarch->audio_driver_thread_cond       = scond_new();
+   p_rarch->audio_driver_thread_space_cond = scond_new();
+
+   if (     !p_rarch->audio_driver_thread_conv_buf
+         || !p_rarch->audio_driver_thread_lock
+         || !p_rarch->audio_driver_thread_wake_lock
+         || !p_rarch->audio_driver_thread_cond
+         || !p_rarch->audio_driver_thread_space_cond
+         || !spsc_queue_initialize(&p_rarch->audio_driver_thread_queue,
+            AUDIO_CHUNK_SIZE_NONBLOCKING * 2 * sizeof(int16_t)))
+      goto error;
+
+   p_rarch->audio_driver_thread_alive      = true;
+   p_rarch->audio_driver_thread            = sthread_create(
+         audio_driver_thread_loop, p_rarch);
+
+   if (!p_rarch->audio_driver_thread)
+      goto error;
+
+   RARCH_LOG("[Audio]: Mixing on a separate thread.\n");
+   return true;
+
+error:
+   RARCH_ERR("[Audio]: Failed to start mixing thread.\n");
+   audio_driver_thread_free(p_rarch);
+   return false;
+}
+#endif
+
+/**
+ * audio_driver_flush:
+ * @data                 : pointer to audio buffer.
+ * @samples              : amount of samples to write.
+ *
+ * Passes audio samples on to audio_driver_process(),
+ * either directly or through the mixing thread.
+ **/
+static void audio_driver_flush(
+      struct rarch_state *p_rarch,
+      float slowmotion_ratio,
+      bool audio_fastforward_mute,
+      const int16_t *data, size_t samples,
+      bool is_slowmotion, bool is_fastmotion)
+{
+   retro_time_t start_time = 0;
+
+#ifdef HAVE_THREADS
+   if (p_rarch->audio_driver_thread)
+   {
+      audio_driver_thread_push(p_rarch, data, samples);
+      return;
+   }
+#endif
+   if (p_rarch->benchmark.enable)
+      start_time = cpu_features_get_time_usec();
+
+   audio_driver_process(p_rarch, slowmotion_ratio,
+         audio_fastforward_mute, data, samples,
+         is_slowmotion, is_fastmotion,
+         p_rarch->audio_driver_output_samples_conv_buf);
+
+   /* The benchmark counts this as frontend time */
+   if (p_rarch->benchmark.enable)
+      p_rarch->benchmark.callback_usec +=
+         cpu_features_get_time_usec() - start_time;
+}
+
 /**
  * audio_driver_sample:
  * @left                 : value of the left audio channel.
@@ -28036,13 +28931,147 @@ static size_t audio_driver_sample_batch_rewind(
 }
 #endif
 
+/**
+ * audio_driver_sample_batch_float:
+ * @data                 : pointer to float audio buffer.
+ * @frames               : amount of audio frames to push.
+ *
+ * Batched audio sample render callback function for cores
+ * producing float (RETRO_ENVIRONMENT_GET_AUDIO_SAMPLE_BATCH_FLOAT).
+ * The core keeps this one pointer for good, so unlike the s16
+ * callbacks it cannot be swapped out for rewind and netplay -
+ * those cases are routed from here.
+ *
+ * Returns: amount of frames sampled. Will be equal to @frames
+ * unless @frames exceeds (AUDIO_CHUNK_SIZE_NONBLOCKING / 2).
+ **/
+static size_t audio_driver_sample_batch_float(const float *data,
+      size_t frames)
+{
+   struct rarch_state *p_rarch = &rarch_st;
+   bool recording              = p_rarch->recording_data
+      && p_rarch->recording_driver
+      && p_rarch->recording_driver->push_audio;
+   size_t samples;
+   float audio_volume_gain;
+   int16_t s16_buf[AUDIO_CHUNK_SIZE_NONBLOCKING];
+
+   if (frames > (AUDIO_CHUNK_SIZE_NONBLOCKING >> 1))
+      frames = AUDIO_CHUNK_SIZE_NONBLOCKING >> 1;
+
+   if (p_rarch->audio_suspended)
+      return frames;
+
+#ifdef HAVE_NETWORKING
+   if (     p_rarch->netplay_data
+         && (netplay_should_skip(p_rarch->netplay_data)
+            || p_rarch->netplay_data->stall))
+      return frames;
+#endif
+
+   samples = frames << 1;
+
+#ifdef HAVE_REWIND
+   if (state_manager_frame_is_reversed())
+   {
+      convert_float_to_s16(s16_buf, data, samples);
+      return audio_driver_sample_batch_rewind(s16_buf, frames);
+   }
+#endif
+
+   performance_counter_init(audio_perf_batch_float, "audio_sample_batch_float");
+   performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+         audio_perf_batch_float);
+
+   /* Recording and the mixing thread only take s16. */
+   if (recording
+#ifdef HAVE_THREADS
+         || p_rarch->audio_driver_thread
+#endif
+      )
+      convert_float_to_s16(s16_buf, data, samples);
+
+   if (recording)
+   {
+      struct record_audio_data ffemu_data;
+
+      ffemu_data.data                    = s16_buf;
+      ffemu_data.frames                  = frames;
+
+      p_rarch->recording_driver->push_audio(
+            p_rarch->recording_data, &ffemu_data);
+   }
+
+   if (     p_rarch->runloop_paused
+         || !p_rarch->audio_driver_active
+         || !p_rarch->audio_driver_output_samples_buf)
+      goto end;
+
+#ifdef HAVE_THREADS
+   if (p_rarch->audio_driver_thread)
+   {
+      audio_driver_thread_push(p_rarch, s16_buf, samples);
+      goto end;
+   }
+#endif
+
+   audio_volume_gain           = (p_rarch->audio_driver_mute_enable ||
+         (p_rarch->configuration_settings->bools.audio_fastforward_mute
+          && p_rarch->runloop_fastmotion))
+      ? 0.0f : p_rarch->audio_driver_volume_gain;
+
+   if (audio_driver_is_identity(p_rarch, audio_volume_gain,
+            p_rarch->runloop_slowmotion))
+   {
+      performance_counter_init(audio_perf_fast_path, "audio_fast_path");
+      performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+            audio_perf_fast_path);
+
+      /* The core's buffer goes to the driver as it is. */
+      if (p_rarch->audio_driver_use_float)
+         audio_driver_write(p_rarch, data, samples * sizeof(float));
+      else
+      {
+         convert_float_to_s16(p_rarch->audio_driver_output_samples_conv_buf,
+               data, samples);
+         audio_driver_write(p_rarch,
+               p_rarch->audio_driver_output_samples_conv_buf,
+               samples * sizeof(int16_t));
+      }
+
+      performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+            audio_perf_fast_path);
+      goto end;
+   }
+
+   if (audio_volume_gain != 1.0f)
+   {
+      size_t i;
+      for (i = 0; i < samples; i++)
+         p_rarch->audio_driver_input_data[i] = data[i] * audio_volume_gain;
+      data = p_rarch->audio_driver_input_data;
+   }
+
+   audio_driver_process_float(p_rarch,
+         p_rarch->configuration_settings->floats.slowmotion_ratio,
+         data, samples, p_rarch->runloop_slowmotion,
+         p_rarch->audio_driver_output_samples_conv_buf);
+
+end:
+   performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+         audio_perf_batch_float);
+   return frames;
+}
+
 #ifdef HAVE_DSP_FILTER
 void audio_driver_dsp_filter_free(void)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_DRIVER_LOCK(p_rarch);
    if (p_rarch->audio_driver_dsp)
       retro_dsp_filter_free(p_rarch->audio_driver_dsp);
    p_rarch->audio_driver_dsp = NULL;
+   AUDIO_DRIVER_UNLOCK(p_rarch);
 }
 
 bool audio_driver_dsp_filter_init(const char *device)
@@ -28070,7 +29099,9 @@ bool audio_driver_dsp_filter_init(const char *device)
    if (!audio_driver_dsp)
       return false;
 
+   AUDIO_DRIVER_LOCK(p_rarch);
    p_rarch->audio_driver_dsp = audio_driver_dsp;
+   AUDIO_DRIVER_UNLOCK(p_rarch);
 
    return true;
 }
@@ -28298,7 +29329,12 @@ static void audio_mixer_play_stop_sequential_cb(
                if (p_rarch->audio_mixer_streams[i].state
                      == AUDIO_STREAM_STATE_STOPPED)
                {
-                  audio_driver_mixer_play_stream_sequential(i);
+                  /* Called from within audio_mixer_mix(), which
+                   * may be running with the audio lock held. */
+                  p_rarch->audio_mixer_streams[i].stop_cb =
+                     audio_mixer_play_stop_sequential_cb;
+                  audio_driver_mixer_play_stream_internal(p_rarch,
+                        i, AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL);
                   break;
                }
             }
@@ -28409,6 +29445,8 @@ bool audio_driver_mixer_add_stream(audio_mixer_stream_params_t *params)
       return false;
    }
 
+   AUDIO_DRIVER_LOCK(p_rarch);
+
    switch (params->state)
    {
       case AUDIO_STREAM_STATE_PLAYING_LOOPED:
@@ -28439,6 +29477,8 @@ bool audio_driver_mixer_add_stream(audio_mixer_stream_params_t *params)
    p_rarch->audio_mixer_streams[free_slot].volume      = params->volume;
    p_rarch->audio_mixer_streams[free_slot].stop_cb     = stop_cb;
 
+   AUDIO_DRIVER_UNLOCK(p_rarch);
+
    return true;
 }
 
@@ -28595,41 +29635,51 @@ end:
 void audio_driver_mixer_play_stream(unsigned i)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_DRIVER_LOCK(p_rarch);
    p_rarch->audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_cb;
    audio_driver_mixer_play_stream_internal(p_rarch,
          i, AUDIO_STREAM_STATE_PLAYING);
+   AUDIO_DRIVER_UNLOCK(p_rarch);
 }
 
 void audio_driver_mixer_play_menu_sound_looped(unsigned i)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_DRIVER_LOCK(p_rarch);
    p_rarch->audio_mixer_streams[i].stop_cb = audio_mixer_menu_stop_cb;
    audio_driver_mixer_play_stream_internal(p_rarch,
          i, AUDIO_STREAM_STATE_PLAYING_LOOPED);
+   AUDIO_DRIVER_UNLOCK(p_rarch);
 }
 
 void audio_driver_mixer_play_menu_sound(unsigned i)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_DRIVER_LOCK(p_rarch);
    p_rarch->audio_mixer_streams[i].stop_cb = audio_mixer_menu_stop_cb;
    audio_driver_mixer_play_stream_internal(p_rarch,
          i, AUDIO_STREAM_STATE_PLAYING);
+   AUDIO_DRIVER_UNLOCK(p_rarch);
 }
 
 void audio_driver_mixer_play_stream_looped(unsigned i)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_DRIVER_LOCK(p_rarch);
    p_rarch->audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_cb;
    audio_driver_mixer_play_stream_internal(p_rarch,
          i, AUDIO_STREAM_STATE_PLAYING_LOOPED);
+   AUDIO_DRIVER_UNLOCK(p_rarch);
 }
 
 void audio_driver_mixer_play_stream_sequential(unsigned i)
 {
    struct rarch_state *p_rarch = &rarch_st;
+   AUDIO_DRIVER_LOCK(p_rarch);
    p_rarch->audio_mixer_streams[i].stop_cb = audio_mixer_play_stop_sequential_cb;
    audio_driver_mixer_play_stream_internal(p_rarch,
          i, AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL);
+   AUDIO_DRIVER_UNLOCK(p_rarch);
 }
 
 float audio_driver_mixer_get_stream_volume(unsigned i)
@@ -28649,6 +29699,8 @@ void audio_driver_mixer_set_stream_volume(unsigned i, float vol)
    if (i >= AUDIO_MIXER_MAX_SYSTEM_STREAMS)
       return;
 
+   AUDIO_DRIVER_LOCK(p_rarch);
+
    p_rarch->audio_mixer_streams[i].volume = vol;
 
    voice                                  =
@@ -28656,15 +29708,14 @@ void audio_driver_mixer_set_stream_volume(unsigned i, float vol)
 
    if (voice)
       audio_mixer_voice_set_volume(voice, DB_TO_GAIN(vol));
+
+   AUDIO_DRIVER_UNLOCK(p_rarch);
 }
 
-void audio_driver_mixer_stop_stream(unsigned i)
+static void audio_driver_mixer_stop_stream_internal(
+      struct rarch_state *p_rarch, unsigned i)
 {
    bool set_state                         = false;
-   struct rarch_state *p_rarch            = &rarch_st;
-
-   if (i >= AUDIO_MIXER_MAX_SYSTEM_STREAMS)
-      return;
 
    switch (p_rarch->audio_mixer_streams[i].state)
    {
@@ -28689,6 +29740,18 @@ void audio_driver_mixer_stop_stream(unsigned i)
    }
 }
 
+void audio_driver_mixer_stop_stream(unsigned i)
+{
+   struct rarch_state *p_rarch            = &rarch_st;
+
+   if (i >= AUDIO_MIXER_MAX_SYSTEM_STREAMS)
+      return;
+
+   AUDIO_DRIVER_LOCK(p_rarch);
+   audio_driver_mixer_stop_stream_internal(p_rarch, i);
+   AUDIO_DRIVER_UNLOCK(p_rarch);
+}
+
 void audio_driver_mixer_remove_stream(unsigned i)
 {
    bool destroy                = false;
@@ -28697,12 +29760,14 @@ void audio_driver_mixer_remove_stream(unsigned i)
    if (i >= AUDIO_MIXER_MAX_SYSTEM_STREAMS)
       return;
 
+   AUDIO_DRIVER_LOCK(p_rarch);
+
    switch (p_rarch->audio_mixer_streams[i].state)
    {
       case AUDIO_STREAM_STATE_PLAYING:
       case AUDIO_STREAM_STATE_PLAYING_LOOPED:
       case AUDIO_STREAM_STATE_PLAYING_SEQUENTIAL:
-         audio_driver_mixer_stop_stream(i);
+         audio_driver_mixer_stop_stream_internal(p_rarch, i);
          destroy = true;
          break;
       case AUDIO_STREAM_STATE_STOPPED:
@@ -28728,6 +29793,8 @@ void audio_driver_mixer_remove_stream(unsigned i)
       p_rarch->audio_mixer_streams[i].voice   = NULL;
       p_rarch->audio_mixer_streams[i].name    = NULL;
    }
+
+   AUDIO_DRIVER_UNLOCK(p_rarch);
 }
 #endif
 
@@ -28809,11 +29876,18 @@ static INLINE bool audio_driver_alive(struct rarch_state *p_rarch)
 static bool audio_driver_start(struct rarch_state *p_rarch,
       bool is_shutdown)
 {
+   bool ret;
+
    if (!p_rarch->current_audio || !p_rarch->current_audio->start
          || !p_rarch->audio_driver_context_audio_data)
       goto error;
-   if (!p_rarch->current_audio->start(
-            p_rarch->audio_driver_context_audio_data, is_shutdown))
+
+   AUDIO_DRIVER_LOCK(p_rarch);
+   ret = p_rarch->current_audio->start(
+         p_rarch->audio_driver_context_audio_data, is_shutdown);
+   AUDIO_DRIVER_UNLOCK(p_rarch);
+
+   if (!ret)
       goto error;
 
    return true;
@@ -28827,14 +29901,27 @@ error:
 
 static bool audio_driver_stop(struct rarch_state *p_rarch)
 {
+   bool ret;
+
    if (     !p_rarch->current_audio 
          || !p_rarch->current_audio->stop
          || !p_rarch->audio_driver_context_audio_data
          || !audio_driver_alive(p_rarch)
       )
       return false;
-   return p_rarch->current_audio->stop(
+
+   AUDIO_DRIVER_LOCK(p_rarch);
+#ifdef HAVE_THREADS
+   /* Whatever is still queued for the mixing thread would
+    * otherwise come out as a stale burst on resume. */
+   if (p_rarch->audio_driver_thread)
+      spsc_queue_clear(&p_rarch->audio_driver_thread_queue);
+#endif
+   ret = p_rarch->current_audio->stop(
          p_rarch->audio_driver_context_audio_data);
+   AUDIO_DRIVER_UNLOCK(p_rarch);
+
+   return ret;
 }
 
 #ifdef HAVE_REWIND
@@ -29646,6 +30733,24 @@ static void video_driver_set_viewport_square_pixel(struct rarch_state *p_rarch)
    aspectratio_lut[ASPECT_RATIO_SQUARE].value = (float)aspect_x / aspect_y;
 }
 
+#ifdef HAVE_SLANG
+/* Points the slang compiler at <cache directory>/slang,
+ * or turns its cache off */
+static void video_driver_set_shader_cache(settings_t *settings)
+{
+   char dir[PATH_MAX_LENGTH];
+
+   dir[0] = '\0';
+
+   if (     settings->bools.video_shader_cache
+         && !string_is_empty(settings->paths.directory_cache))
+      fill_pathname_join(dir, settings->paths.directory_cache,
+            "slang", sizeof(dir));
+
+   glslang_set_cache_directory(dir);
+}
+#endif
+
 static bool video_driver_init_internal(bool *video_is_threaded)
 {
    video_info_t video;
@@ -29665,6 +30770,10 @@ static bool video_driver_init_internal(bool *video_is_threaded)
       video_driver_init_filter(video_driver_pix_fmt);
 #endif
 
+#ifdef HAVE_SLANG
+   video_driver_set_shader_cache(settings);
+#endif
+
    max_dim   = MAX(geom->max_width, geom->max_height);
    scale     = next_pow2(max_dim) / RARCH_SCALE_BASE;
    scale     = MAX(scale, 1);
@@ -31318,6 +32427,11 @@ static void video_driver_frame(const void *data, unsigned width,
    }
    else if (!video_info.crt_switch_resolution)
       p_rarch->video_driver_crt_switching_active = false;
+
+   /* The benchmark counts this as frontend time */
+   if (p_rarch->benchmark.enable)
+      p_rarch->benchmark.callback_usec +=
+         cpu_features_get_time_usec() - new_time;
 }
 
 void crt_switch_driver_reinit(void)
@@ -32421,9 +33535,13 @@ void driver_set_nonblock_state(void)
    }
 
    if (audio_driver_active && p_rarch->audio_driver_context_audio_data)
+   {
+      AUDIO_DRIVER_LOCK(p_rarch);
       p_rarch->current_audio->set_nonblock_state(
             p_rarch->audio_driver_context_audio_data,
             audio_sync ? enable : true);
+      AUDIO_DRIVER_UNLOCK(p_rarch);
+   }
 
    p_rarch->audio_driver_chunk_size = enable
       ? p_rarch->audio_driver_chunk_nonblock_size
@@ -32924,6 +34042,7 @@ static void *input_list_element_constructor(void)
    element->device             = 0;
    element->index              = 0;
    element->state              = (int16_t*)calloc(256, sizeof(int16_t));
+   element->queried            = (uint8_t*)calloc(256, sizeof(uint8_t));
    element->state_size         = 256;
 
    return ptr;
@@ -32939,6 +34058,10 @@ static void input_list_element_realloc(
             new_size * sizeof(int16_t));
       memset(&element->state[element->state_size], 0,
             (new_size - element->state_size) * sizeof(int16_t));
+      element->queried = (uint8_t*)realloc(element->queried,
+            new_size * sizeof(uint8_t));
+      memset(&element->queried[element->state_size], 0,
+            (new_size - element->state_size) * sizeof(uint8_t));
       element->state_size = new_size;
    }
 }
@@ -32961,6 +34084,7 @@ static void input_list_element_destructor(void* element_ptr)
       return;
 
    free(element->state);
+   free(element->queried);
    free(element_ptr);
 }
 
@@ -32987,7 +34111,8 @@ static void input_state_set_last(unsigned port, unsigned device,
       {
          if (id >= element->state_size)
             input_list_element_expand(element, id);
-         element->state[id] = value;
+         element->state[id]   = value;
+         element->queried[id] = 1;
          return;
       }
    }
@@ -32999,23 +34124,22 @@ static void input_state_set_last(unsigned port, unsigned device,
    element->index     = index;
    if (id >= element->state_size)
       input_list_element_expand(element, id);
-   element->state[id] = value;
+   element->state[id]   = value;
+   element->queried[id] = 1;
 }
 
-static int16_t input_state_get_last(unsigned port,
-      unsigned device, unsigned index, unsigned id)
+static int16_t input_state_list_get(const my_list *list,
+      unsigned port, unsigned device, unsigned index, unsigned id)
 {
    unsigned i;
-   struct rarch_state      *p_rarch = &rarch_st;
 
-   if (!p_rarch->input_state_list)
+   if (!list)
       return 0;
 
    /* find list item */
-   for (i = 0; i < (unsigned)p_rarch->input_state_list->size; i++)
+   for (i = 0; i < (unsigned)list->size; i++)
    {
-      input_list_element *element =
-         (input_list_element*)p_rarch->input_state_list->data[i];
+      input_list_element *element = (input_list_element*)list->data[i];
 
       if (  (element->port   == port)   &&
             (element->device == device) &&
@@ -33029,6 +34153,47 @@ static int16_t input_state_get_last(unsigned port,
    return 0;
 }
 
+static int16_t input_state_get_last(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   struct rarch_state      *p_rarch = &rarch_st;
+   return input_state_list_get(p_rarch->input_state_list,
+         port, device, index, id);
+}
+
+#if defined(HAVE_DYNAMIC) && defined(HAVE_THREADS)
+/* Makes 'dst' hold the same input as 'src' */
+static void input_state_list_copy(my_list **dst_p, const my_list *src)
+{
+   int i;
+
+   if (!*dst_p)
+      mylist_create(dst_p, 16,
+            input_list_element_constructor,
+            input_list_element_destructor);
+
+   mylist_resize(*dst_p, src ? src->size : 0, true);
+
+   for (i = 0; i < (*dst_p)->size; i++)
+   {
+      const input_list_element *from = (const input_list_element*)
+         src->data[i];
+      input_list_element *to         = (input_list_element*)
+         (*dst_p)->data[i];
+
+      if (to->state_size < from->state_size)
+         input_list_element_realloc(to, from->state_size);
+
+      to->port                       = from->port;
+      to->device                     = from->device;
+      to->index                      = from->index;
+      memcpy(to->state, from->state, from->state_size * sizeof(int16_t));
+      memset(to->state + from->state_size, 0,
+            (to->state_size - from->state_size) * sizeof(int16_t));
+   }
+}
+#endif
+
 static int16_t input_state_with_logging(unsigned port,
       unsigned device, unsigned index, unsigned id)
 {
@@ -33232,9 +34397,13 @@ static void runahead_add_hooks(struct rarch_state *p_rarch)
 
 /* Runahead Code */
 
+static struct retro_perf_counter runahead_perf_save = {0};
+static struct retro_perf_counter runahead_perf_load = {0};
+
 static void runahead_error(struct rarch_state *p_rarch)
 {
    p_rarch->runahead_available             = false;
+   p_rarch->runahead_state_count           = 0;
    mylist_destroy(&p_rarch->runahead_save_state_list);
    runahead_remove_hooks(p_rarch);
    p_rarch->runahead_save_state_size       = 0;
@@ -33267,7 +34436,7 @@ static bool runahead_create(struct rarch_state *p_rarch)
    return true;
 }
 
-static bool runahead_save_state(struct rarch_state *p_rarch)
+static bool runahead_save_state(struct rarch_state *p_rarch, int slot)
 {
    retro_ctx_serialize_info_t *serialize_info;
    bool okay                       = false;
@@ -33276,11 +34445,16 @@ static bool runahead_save_state(struct rarch_state *p_rarch)
       return false;
 
    serialize_info                  =
-      (retro_ctx_serialize_info_t*)p_rarch->runahead_save_state_list->data[0];
+      (retro_ctx_serialize_info_t*)p_rarch->runahead_save_state_list->data[slot];
 
+   performance_counter_init(runahead_perf_save, "runahead_save");
+   performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+         runahead_perf_save);
    p_rarch->request_fast_savestate = true;
    okay                            = core_serialize(serialize_info);
    p_rarch->request_fast_savestate = false;
+   performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+         runahead_perf_save);
 
    if (okay)
       return true;
@@ -33289,13 +34463,16 @@ static bool runahead_save_state(struct rarch_state *p_rarch)
    return false;
 }
 
-static bool runahead_load_state(struct rarch_state *p_rarch)
+static bool runahead_load_state(struct rarch_state *p_rarch, int slot)
 {
    bool okay                                  = false;
    retro_ctx_serialize_info_t *serialize_info = (retro_ctx_serialize_info_t*)
-      p_rarch->runahead_save_state_list->data[0];
+      p_rarch->runahead_save_state_list->data[slot];
    bool last_dirty                            = p_rarch->input_is_dirty;
 
+   performance_counter_init(runahead_perf_load, "runahead_load");
+   performance_counter_start_plus(p_rarch->runloop_perfcnt_enable,
+         runahead_perf_load);
    p_rarch->request_fast_savestate            = true;
    /* calling core_unserialize has side effects with
     * netplay (it triggers transmitting your save state)
@@ -33305,6 +34482,8 @@ static bool runahead_load_state(struct rarch_state *p_rarch)
 
    p_rarch->request_fast_savestate            = false;
    p_rarch->input_is_dirty                    = last_dirty;
+   performance_counter_stop_plus(p_rarch->runloop_perfcnt_enable,
+         runahead_perf_load);
 
    if (!okay)
       runahead_error(p_rarch);
@@ -33359,9 +34538,456 @@ static bool runahead_core_run_use_last_input(struct rarch_state *p_rarch)
    return true;
 }
 
+#if defined(HAVE_DYNAMIC) && defined(HAVE_THREADS)
+/* Callbacks of the secondary instance while on the thread */
+
+static void runahead_secondary_thread_frame(const void *data,
+      unsigned width, unsigned height, size_t pitch)
+{
+   runahead_secondary_thread_t *rst = &rarch_st.runahead_secondary_thread;
+   size_t size                      = height * pitch;
+
+   rst->frame_ready                 = true;
+   rst->frame_dupe                  = true;
+   rst->width                       = width;
+   rst->height                      = height;
+   rst->pitch                       = pitch;
+
+   if (!data || data == RETRO_HW_FRAME_BUFFER_VALID)
+      return;
+
+   if (size > rst->frame_size)
+   {
+      uint8_t *frame = (uint8_t*)realloc(rst->frame, size);
+      if (!frame)
+         return;
+      rst->frame      = frame;
+      rst->frame_size = size;
+   }
+
+   memcpy(rst->frame, data, size);
+   rst->frame_dupe                  = false;
+}
+
+static void runahead_secondary_thread_sample(int16_t left, int16_t right) { }
+
+static size_t runahead_secondary_thread_sample_batch(
+      const int16_t *data, size_t frames)
+{
+   return frames;
+}
+
+static int16_t runahead_secondary_thread_input_state(unsigned port,
+      unsigned device, unsigned index, unsigned id)
+{
+   return input_state_list_get(rarch_st.runahead_secondary_thread.input,
+         port, device, index, id);
+}
+
+static void runahead_secondary_thread_loop(void *data)
+{
+   struct rarch_state *p_rarch      = (struct rarch_state*)data;
+   runahead_secondary_thread_t *rst = &p_rarch->runahead_secondary_thread;
+
+   slock_lock(rst->lock);
+
+   for (;;)
+   {
+      retro_time_t start;
+
+      while (rst->alive && !rst->pending)
+         scond_wait(rst->cond, rst->lock);
+
+      if (!rst->alive)
+         break;
+
+      slock_unlock(rst->lock);
+
+      start         = cpu_features_get_time_usec();
+      p_rarch->secondary_core.retro_run();
+
+      slock_lock(rst->lock);
+      rst->run_usec += cpu_features_get_time_usec() - start;
+      rst->pending   = false;
+      scond_signal(rst->cond);
+   }
+
+   slock_unlock(rst->lock);
+}
+
+static void runahead_secondary_thread_free_vars(
+      runahead_secondary_thread_t *rst)
+{
+   size_t i;
+
+   for (i = 0; i < rst->vars_size; i++)
+   {
+      free(rst->vars[i].key);
+      free(rst->vars[i].value);
+   }
+   free(rst->vars);
+
+   rst->vars      = NULL;
+   rst->vars_size = 0;
+}
+
+/* Takes what the environment queries of the secondary instance
+ * are answered with while it runs on the thread. Core options
+ * are only copied again when the main instance's changed. */
+static void runahead_secondary_thread_snapshot(
+      struct rarch_state *p_rarch)
+{
+   size_t i;
+   runahead_secondary_thread_t *rst = &p_rarch->runahead_secondary_thread;
+   settings_t *settings             = p_rarch->configuration_settings;
+   core_option_manager_t *opts      = p_rarch->runloop_core_options;
+   const char *dir_system           = settings->paths.directory_system;
+   size_t opts_size                 = opts ? opts->size : 0;
+   bool same_vars                   = (opts_size == rst->vars_size);
+
+   for (i = 0; same_vars && i < opts_size; i++)
+   {
+      struct core_option *opt = &opts->opts[i];
+      same_vars               =
+            string_is_equal(opt->key, rst->vars[i].key)
+         && string_is_equal(opt->vals->elems[opt->index].data,
+               rst->vars[i].value);
+   }
+
+   if (!same_vars)
+   {
+      runahead_secondary_thread_free_vars(rst);
+
+      if (opts_size && (rst->vars = (runahead_secondary_var_t*)
+               calloc(opts_size, sizeof(*rst->vars))))
+      {
+         rst->vars_size = opts_size;
+
+         for (i = 0; i < opts_size; i++)
+         {
+            struct core_option *opt = &opts->opts[i];
+            const char *value       = opt->vals->elems[opt->index].data;
+
+            rst->vars[i].key        = opt->key ? strdup(opt->key) : NULL;
+            rst->vars[i].value      = value    ? strdup(value)    : NULL;
+         }
+      }
+   }
+
+   /* What rarch_environment_cb() would answer, without
+    * its logging and without setting the system dir */
+   if (     string_is_empty(dir_system)
+         || settings->bools.systemfiles_in_content_dir)
+      dir_system = dir_get_ptr(RARCH_DIR_SYSTEM);
+   strlcpy(rst->system_dir, dir_system ? dir_system : "",
+         sizeof(rst->system_dir));
+   strlcpy(rst->save_dir, p_rarch->current_savefile_dir,
+         sizeof(rst->save_dir));
+   strlcpy(rst->assets_dir, settings->paths.directory_core_assets,
+         sizeof(rst->assets_dir));
+   rst->overscan = !settings->bools.video_crop_overscan;
+#ifdef HAVE_LANGEXTRA
+   rst->language = *msg_hash_get_uint(MSG_HASH_USER_LANGUAGE);
+#endif
+}
+
+/* Logs how much of the secondary instance's run time was spent
+ * alongside the main instance since the last report */
+static void runahead_secondary_thread_report(
+      runahead_secondary_thread_t *rst)
+{
+   /* Whatever the main thread didn't spend waiting
+    * was run alongside the main instance */
+   if (rst->frames && rst->run_usec)
+      RARCH_LOG("[Run-Ahead]: Secondary instance thread ran %" PRIu64
+            " frames, %u%% of its run time overlapped the main instance.\n",
+            rst->frames,
+            rst->wait_usec < rst->run_usec
+            ? (unsigned)((rst->run_usec - rst->wait_usec) * 100
+               / rst->run_usec)
+            : 0);
+
+   rst->frames    = 0;
+   rst->run_usec  = 0;
+   rst->wait_usec = 0;
+}
+
+static bool runahead_secondary_thread_init(struct rarch_state *p_rarch)
+{
+   runahead_secondary_thread_t *rst = &p_rarch->runahead_secondary_thread;
+
+   if (rst->thread)
+      return true;
+
+   rst->lock   = slock_new();
+   rst->cond   = scond_new();
+   rst->alive  = true;
+
+   if (rst->lock && rst->cond)
+      rst->thread = sthread_create(runahead_secondary_thread_loop, p_rarch);
+
+   if (!rst->thread)
+   {
+      RARCH_ERR("[Run-Ahead]: Failed to start secondary instance thread.\n");
+      runahead_secondary_thread_free(p_rarch);
+      return false;
+   }
+
+   return true;
+}
+
+static void runahead_secondary_thread_free(struct rarch_state *p_rarch)
+{
+   runahead_secondary_thread_t *rst = &p_rarch->runahead_secondary_thread;
+
+   if (rst->thread)
+   {
+      slock_lock(rst->lock);
+      rst->alive = false;
+      scond_signal(rst->cond);
+      slock_unlock(rst->lock);
+      sthread_join(rst->thread);
+
+      runahead_secondary_thread_report(rst);
+   }
+
+   if (rst->cond)
+      scond_free(rst->cond);
+   if (rst->lock)
+      slock_free(rst->lock);
+   mylist_destroy(&rst->input);
+   runahead_secondary_thread_free_vars(rst);
+   free(rst->frame);
+
+   memset(rst, 0, sizeof(*rst));
+}
+
+/* Runs the next frame of the secondary instance on the thread,
+ * assuming the input stays what it was on the last frame. */
+static void runahead_secondary_thread_start(struct rarch_state *p_rarch)
+{
+   runahead_secondary_thread_t *rst = &p_rarch->runahead_secondary_thread;
+   struct retro_core_t *core        = &p_rarch->secondary_core;
+
+   input_state_list_copy(&rst->input, p_rarch->input_state_list);
+   runahead_secondary_thread_snapshot(p_rarch);
+   rst->frame_ready                 = false;
+
+   core->retro_set_video_refresh(runahead_secondary_thread_frame);
+   core->retro_set_audio_sample(runahead_secondary_thread_sample);
+   core->retro_set_audio_sample_batch(
+         runahead_secondary_thread_sample_batch);
+   core->retro_set_input_poll(secondary_core_input_poll_null);
+   core->retro_set_input_state(runahead_secondary_thread_input_state);
+
+   rst->active                      = true;
+
+   slock_lock(rst->lock);
+   rst->pending                     = true;
+   scond_signal(rst->cond);
+   slock_unlock(rst->lock);
+}
+
+static void runahead_secondary_thread_wait(struct rarch_state *p_rarch)
+{
+   runahead_secondary_thread_t *rst = &p_rarch->runahead_secondary_thread;
+   struct retro_callbacks *cbs      = &p_rarch->secondary_callbacks;
+   struct retro_core_t *core        = &p_rarch->secondary_core;
+   retro_time_t start               = cpu_features_get_time_usec();
+
+   slock_lock(rst->lock);
+   while (rst->pending)
+      scond_wait(rst->cond, rst->lock);
+   slock_unlock(rst->lock);
+
+   rst->wait_usec                  += cpu_features_get_time_usec() - start;
+   rst->active                      = false;
+
+   /* The run time of the secondary instance is only known here,
+    * report it every so often rather than only at the end */
+   if (++rst->frames >= RUNAHEAD_THREAD_REPORT_FRAMES)
+      runahead_secondary_thread_report(rst);
+
+   core->retro_set_video_refresh(cbs->frame_cb);
+   core->retro_set_audio_sample(cbs->sample_cb);
+   core->retro_set_audio_sample_batch(cbs->sample_batch_cb);
+   core->retro_set_input_poll(cbs->poll_cb);
+   core->retro_set_input_state(cbs->state_cb);
+}
+#endif
+
+/* Polls input and checks whether anything the core asked for
+ * differs from what it got last frame, without running it. */
+static bool runahead_input_changed(struct rarch_state *p_rarch)
+{
+   int i;
+   unsigned id;
+
+   input_driver_poll();
+
+   if (!p_rarch->input_state_list)
+      return true;
+
+   for (i = 0; i < p_rarch->input_state_list->size; i++)
+   {
+      input_list_element *element =
+         (input_list_element*)p_rarch->input_state_list->data[i];
+
+      for (id = 0; id < element->state_size; id++)
+      {
+         if (!element->queried[id])
+            continue;
+         if (input_state(element->port, element->device,
+                  element->index, id) != element->state[id])
+            return true;
+      }
+   }
+
+   return false;
+}
+
+static int runahead_state_slot(struct rarch_state *p_rarch, int frame)
+{
+   return (p_rarch->runahead_state_first + frame)
+      % p_rarch->runahead_save_state_list->size;
+}
+
+/* Drops the states of the multiple savestates mode. The core
+ * is still ahead then, so it goes back to the last real frame
+ * first. */
+static bool runahead_drop_states(struct rarch_state *p_rarch)
+{
+   int slot;
+
+   if (!p_rarch->runahead_state_count)
+      return true;
+
+   slot                                = runahead_state_slot(p_rarch, 0);
+   p_rarch->runahead_state_count       = 0;
+   p_rarch->runahead_force_input_dirty = true;
+
+   if (!runahead_load_state(p_rarch, slot))
+   {
+      runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+      return false;
+   }
+
+   mylist_resize(p_rarch->runahead_save_state_list, 1, true);
+   return true;
+}
+
+/* Runs the core on input runahead_input_changed() has
+ * already polled this frame */
+static void runahead_core_run_polled(struct rarch_state *p_rarch)
+{
+   struct retro_callbacks *cbs          = &p_rarch->retro_ctx;
+   retro_input_poll_t old_poll_function = cbs->poll_cb;
+
+   cbs->poll_cb                         = retro_input_poll_null;
+   p_rarch->current_core.retro_set_input_poll(cbs->poll_cb);
+
+   p_rarch->current_core.retro_run();
+
+   cbs->poll_cb                         = old_poll_function;
+   p_rarch->current_core.retro_set_input_poll(cbs->poll_cb);
+}
+
+/* Single instance run-ahead keeping one savestate per frame ahead.
+ * The core is left on the last frame shown rather than rolled back;
+ * as long as the input stays the same, the oldest state of the ring
+ * is what the next real frame would have produced, so only the one
+ * new frame at the front has to be emulated. */
+static bool runahead_run_multiple_states(
+      struct rarch_state *p_rarch, int runahead_count)
+{
+   int frame_number;
+   bool polled = false;
+
+   /* A reset or a loaded state - what the core holds now is real */
+   if (p_rarch->input_is_dirty)
+      p_rarch->runahead_state_count = 0;
+
+   if (p_rarch->runahead_state_count)
+   {
+      bool same_input = false;
+
+      if (     p_rarch->runahead_state_count == runahead_count + 1
+            && !p_rarch->runahead_force_input_dirty)
+      {
+         polled     = true;
+         same_input = !runahead_input_changed(p_rarch);
+      }
+
+      if (same_input)
+      {
+         int slot;
+
+         p_rarch->runahead_state_first =
+            runahead_state_slot(p_rarch, 1);
+         slot = runahead_state_slot(p_rarch, runahead_count);
+
+         runahead_core_run_use_last_input(p_rarch);
+
+         if (!runahead_save_state(p_rarch, slot))
+         {
+            runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+            return false;
+         }
+         return true;
+      }
+
+      /* Back to the last real frame to redo the rest */
+      if (!runahead_load_state(p_rarch,
+               runahead_state_slot(p_rarch, 0)))
+      {
+         runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         return false;
+      }
+   }
+
+   p_rarch->runahead_state_count = 0;
+   p_rarch->runahead_state_first = 0;
+   mylist_resize(p_rarch->runahead_save_state_list,
+         runahead_count + 1, true);
+
+   for (frame_number = 0; frame_number <= runahead_count; frame_number++)
+   {
+      bool last_frame      = frame_number == runahead_count;
+
+      if (!last_frame)
+      {
+         p_rarch->audio_suspended     = true;
+         p_rarch->video_driver_active = false;
+      }
+
+      if (frame_number != 0)
+         runahead_core_run_use_last_input(p_rarch);
+      else if (polled)
+         runahead_core_run_polled(p_rarch);
+      else
+         core_run();
+
+      if (!last_frame)
+      {
+         RUNAHEAD_RESUME_VIDEO();
+         p_rarch->audio_suspended     = false;
+      }
+
+      if (!runahead_save_state(p_rarch, frame_number))
+      {
+         runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         return false;
+      }
+   }
+
+   p_rarch->runahead_state_count = runahead_count + 1;
+   return true;
+}
+
 static void do_runahead(
       struct rarch_state *p_rarch,
-      int runahead_count, bool use_secondary)
+      int runahead_count, bool use_secondary, bool secondary_threaded,
+      bool multiple_states)
 {
    int frame_number        = 0;
    bool last_frame         = false;
@@ -33396,12 +35022,27 @@ static void do_runahead(
 
    p_rarch->runahead_last_frame_count     = frame_count;
 
-   if (     !use_secondary 
-         || !have_dynamic 
-         || !p_rarch->runahead_secondary_core_available)
+   use_secondary = use_secondary
+      && have_dynamic
+      && p_rarch->runahead_secondary_core_available;
+   /* Movie playback feeds input from a file, peeking at
+    * it would throw the movie off */
+   multiple_states = multiple_states
+      && !use_secondary
+      && !p_rarch->bsv_movie_state_handle;
+
+   /* Leaving the multiple savestates mode */
+   if (!multiple_states && !runahead_drop_states(p_rarch))
+      return;
+
+   if (multiple_states)
+   {
+      if (!runahead_run_multiple_states(p_rarch, runahead_count))
+         return;
+      p_rarch->input_is_dirty          = false;
+   }
+   else if (!use_secondary)
    {
-      /* TODO: multiple savestates for higher performance
-       * when not using secondary core */
       for (frame_number = 0; frame_number <= runahead_count; frame_number++)
       {
          last_frame      = frame_number == runahead_count;
@@ -33426,7 +35067,7 @@ static void do_runahead(
 
          if (frame_number == 0)
          {
-            if (!runahead_save_state(p_rarch))
+            if (!runahead_save_state(p_rarch, 0))
             {
                runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
                return;
@@ -33435,7 +35076,7 @@ static void do_runahead(
 
          if (last_frame)
          {
-            if (!runahead_load_state(p_rarch))
+            if (!runahead_load_state(p_rarch, 0))
             {
                runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_LOAD_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
                return;
@@ -33446,6 +35087,8 @@ static void do_runahead(
    else
    {
 #if HAVE_DYNAMIC
+      bool threaded                    = false;
+
       if (!secondary_core_ensure_exists(p_rarch))
       {
          secondary_core_destroy(p_rarch);
@@ -33454,17 +35097,40 @@ static void do_runahead(
          goto force_input_dirty;
       }
 
+#ifdef HAVE_THREADS
+      /* Unless a resync is already due, the secondary instance
+       * can run its next frame while the main one catches up.
+       * Hardware rendering has to stay on the main thread, and
+       * so do core option updates, which the secondary instance
+       * is only told about outside the thread. */
+      threaded = secondary_threaded
+         && !p_rarch->runahead_force_input_dirty
+         && !p_rarch->has_variable_update
+         && p_rarch->hw_render.context_type == RETRO_HW_CONTEXT_NONE
+         && runahead_secondary_thread_init(p_rarch);
+
+      if (threaded)
+         runahead_secondary_thread_start(p_rarch);
+#endif
+
       /* run main core with video suspended */
       p_rarch->video_driver_active     = false;
       core_run();
       RUNAHEAD_RESUME_VIDEO();
 
+#ifdef HAVE_THREADS
+      if (threaded)
+         runahead_secondary_thread_wait(p_rarch);
+#endif
+
       if (     p_rarch->input_is_dirty 
             || p_rarch->runahead_force_input_dirty)
       {
+         /* Anything run on the thread was a misprediction */
+         threaded                      = false;
          p_rarch->input_is_dirty       = false;
 
-         if (!runahead_save_state(p_rarch))
+         if (!runahead_save_state(p_rarch, 0))
          {
             runloop_msg_queue_push(msg_hash_to_str(MSG_RUNAHEAD_FAILED_TO_SAVE_STATE), 0, 3 * 60, true, NULL, MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
             return;
@@ -33487,17 +35153,33 @@ static void do_runahead(
             RUNAHEAD_RESUME_VIDEO();
          }
       }
-      p_rarch->audio_suspended           = true;
-      p_rarch->hard_disable_audio        = true;
-      RUNAHEAD_RUN_SECONDARY();
-      p_rarch->hard_disable_audio        = false;
-      p_rarch->audio_suspended           = false;
+
+#ifdef HAVE_THREADS
+      if (threaded)
+      {
+         runahead_secondary_thread_t *rst =
+            &p_rarch->runahead_secondary_thread;
+
+         if (rst->frame_ready)
+            video_driver_frame(rst->frame_dupe ? NULL : rst->frame,
+                  rst->width, rst->height, rst->pitch);
+      }
+      else
+#endif
+      {
+         p_rarch->audio_suspended        = true;
+         p_rarch->hard_disable_audio     = true;
+         RUNAHEAD_RUN_SECONDARY();
+         p_rarch->hard_disable_audio     = false;
+         p_rarch->audio_suspended        = false;
+      }
 #endif
    }
    p_rarch->runahead_force_input_dirty   = false;
    return;
 
 force_input_dirty:
+   runahead_drop_states(p_rarch);
    core_run();
    p_rarch->runahead_force_input_dirty   = true;
 }
@@ -33787,9 +35469,46 @@ static void KingStation_print_help(const char *arg0)
       strlcat(buf, "      --load-menu-on-error\n"
             "                        Open menu instead of quitting if specified core or content fails to load.\n", sizeof(buf));
       puts(buf);
+#ifdef HAVE_SLANG
+      puts("      --precompile-shaders DIR\n"
+            "                        Compiles the slang shaders in DIR into the shader cache, then exits.");
+#endif
+      puts("      --benchmark=FILE  Runs the content without video, audio or frame limit\n"
+            "                        until --max-frames or the end of the --bsvplay movie,\n"
+            "                        then writes a JSON report of the frame times to FILE.");
+      puts("      --benchmark-state-crc=CRC\n"
+            "                        Fails the benchmark unless the core state after\n"
+            "                        the last frame has this CRC32 (hexadecimal).");
    }
 }
 
+#ifdef HAVE_SLANG
+/* Fills the shader cache for --precompile-shaders.
+ * Returns the exit code. */
+static int KingStation_precompile_shaders(settings_t *settings,
+      const char *dir)
+{
+   unsigned num_shaders = 0;
+   unsigned num_failed  = 0;
+
+   frontend_driver_attach_console();
+   video_driver_set_shader_cache(settings);
+
+   if (!glslang_precompile_directory(dir, &num_shaders, &num_failed))
+   {
+      fprintf(stderr, "Can not precompile shaders in \"%s\", "
+            "check the directory, video_shader_cache and "
+            "cache_directory.\n", dir);
+      return 1;
+   }
+
+   printf("Compiled %u of %u shaders.\n",
+         num_shaders - num_failed, num_shaders);
+
+   return 0;
+}
+#endif
+
 /**
  * KingStation_parse_input_and_config:
  * @argc                 : Count of (commandline) arguments.
@@ -33866,6 +35585,11 @@ static void KingStation_parse_input_and_config(
       { "log-file",           1, NULL, RA_OPT_LOG_FILE },
       { "accessibility",      0, NULL, RA_OPT_ACCESSIBILITY},
       { "load-menu-on-error", 0, NULL, RA_OPT_LOAD_MENU_ON_ERROR },
+#ifdef HAVE_SLANG
+      { "precompile-shaders", 1, NULL, RA_OPT_PRECOMPILE_SHADERS },
+#endif
+      { "benchmark",          1, NULL, RA_OPT_BENCHMARK },
+      { "benchmark-state-crc", 1, NULL, RA_OPT_BENCHMARK_STATE_CRC },
       { NULL, 0, NULL, 0 }
    };
 
@@ -34391,12 +36115,30 @@ static void KingStation_parse_input_and_config(
                KingStation_print_features();
                exit(0);
 
+#ifdef HAVE_SLANG
+            case RA_OPT_PRECOMPILE_SHADERS:
+               exit(KingStation_precompile_shaders(
+                        p_rarch->configuration_settings, optarg));
+#endif
+
             case RA_OPT_EOF_EXIT:
 #ifdef HAVE_BSV_MOVIE
                p_rarch->bsv_movie_state.eof_exit = true;
 #endif
                break;
 
+            case RA_OPT_BENCHMARK:
+               p_rarch->benchmark.enable = true;
+               strlcpy(p_rarch->benchmark.report_path, optarg,
+                     sizeof(p_rarch->benchmark.report_path));
+               break;
+
+            case RA_OPT_BENCHMARK_STATE_CRC:
+               p_rarch->benchmark.expect_state_crc   = true;
+               p_rarch->benchmark.expected_state_crc =
+                  (uint32_t)strtoul(optarg, NULL, 16);
+               break;
+
             case RA_OPT_VERSION:
                KingStation_print_version();
                exit(0);
@@ -34504,6 +36246,9 @@ static void KingStation_parse_input_and_config(
    if (KingStation_override_setting_is_set(RARCH_OVERRIDE_SETTING_STATE_PATH, NULL) &&
          path_is_directory(global->name.savestate))
       dir_set(RARCH_DIR_SAVESTATE, global->name.savestate);
+
+   if (p_rarch->benchmark.enable)
+      KingStation_benchmark_init(p_rarch, p_rarch->configuration_settings);
 }
 
 static bool KingStation_validate_per_core_options(char *s,
@@ -34671,6 +36416,7 @@ bool KingStation_main_init(int argc, char *argv[])
 #endif
 
    KingStation_validate_cpu_features();
+   encoding_crc32_init_simd(cpu_features_get_extra());
    KingStation_init_task_queue();
 
    {
@@ -35252,13 +36998,61 @@ void KingStation_init_task_queue(void)
    struct rarch_state *p_rarch = &rarch_st;
    settings_t *settings        = p_rarch->configuration_settings;
    bool threaded_enable        = settings->bools.threaded_data_runloop_enable;
+   unsigned num_threads        = MAX(settings->uints.task_queue_threads, 1);
+   unsigned num_background     = MAX(
+         settings->uints.task_queue_background_threads, 1);
+   unsigned limits[TASK_PRIORITY_LAST];
+
+   /* Background tasks get their share, normal tasks the
+    * rest but one, which stays free for interactive
+    * tasks. Interactive tasks may use every one. */
+   limits[TASK_PRIORITY_INTERACTIVE] = 0;
+   limits[TASK_PRIORITY_BACKGROUND]  = num_background;
+   limits[TASK_PRIORITY_NORMAL]      = num_threads > num_background + 1
+      ? num_threads - num_background - 1 : 1;
 #else
    bool threaded_enable        = false;
 #endif
 
    task_queue_deinit();
+
+#ifdef HAVE_THREADS
+   if (!p_rarch->thread_pool)
+   {
+      p_rarch->thread_pool = tpool_create(
+            settings->uints.thread_pool_size);
+      if (p_rarch->thread_pool)
+         RARCH_LOG("[Threads]: Created pool of %u threads.\n",
+               (unsigned)tpool_get_num_threads(p_rarch->thread_pool));
+   }
+
+   /* Tasks run on the same pool */
+   task_queue_set_thread_pool(p_rarch->thread_pool);
+   task_image_decode_init();
+   task_queue_set_concurrency(num_threads, limits);
+#endif
    task_queue_init(threaded_enable, runloop_task_msg_queue_push);
+
+#ifdef HAVE_COMPRESSION
+   /* Scanning and loading look at the same archives
+    * over and over, remember their directories */
+   file_archive_cache_init(FILE_ARCHIVE_CACHE_DEFAULT_SIZE);
+#endif
+
+#ifdef HAVE_CHD
+   /* Applies to the CHD images opened from now on */
+   chdstream_set_cache(settings->uints.chd_cache_hunks,
+         settings->uints.chd_readahead_hunks);
+#endif
+}
+
+#ifdef HAVE_THREADS
+tpool_t *KingStation_get_thread_pool(void)
+{
+   struct rarch_state *p_rarch = &rarch_st;
+   return p_rarch->thread_pool;
 }
+#endif
 
 static void KingStation_core_options_intl_init(
       struct rarch_state *p_rarch,
@@ -36751,6 +38545,9 @@ static enum runloop_state runloop_check_state(
          }
 #endif
 
+         if (p_rarch->benchmark.enable)
+            KingStation_benchmark_finish(p_rarch);
+
          if (runloop_exec)
             runloop_exec = false;
 
@@ -37314,8 +39111,16 @@ static enum runloop_state runloop_check_state(
 #endif
       {
          if (rewinding)
+         {
+            /* Show how much further back we can go */
+            size_t _len = strlen(s);
+            snprintf(s + _len, sizeof(s) - _len, " (%.1fs)",
+                  state_manager_rewind_depth(&p_rarch->rewind_st,
+                     settings->uints.rewind_granularity,
+                     p_rarch->video_driver_av_info.timing.fps));
             runloop_msg_queue_push(s, 0, t, true, NULL,
                   MESSAGE_QUEUE_ICON_DEFAULT, MESSAGE_QUEUE_CATEGORY_INFO);
+         }
       }
    }
 #endif
@@ -37482,6 +39287,7 @@ int runloop_iterate(void)
    bool vrr_runloop_enable                      = settings->bools.vrr_runloop_enable;
    unsigned max_users                           = p_rarch->input_driver_max_users;
    retro_time_t current_time                    = cpu_features_get_time_usec();
+   retro_time_t core_start                      = 0;
    bool core_paused                             = p_rarch->runloop_paused || (settings->bools.menu_pause_libretro && p_rarch->menu_driver_alive);
 
 #ifdef HAVE_DISCORD
@@ -37501,7 +39307,8 @@ int runloop_iterate(void)
       retro_usec_t runloop_last_frame_time = p_rarch->runloop_frame_time_last;
       retro_time_t current                 = current_time;
       bool is_locked_fps                   = (p_rarch->runloop_paused
-            || p_rarch->input_driver_nonblock_state)
+            || p_rarch->input_driver_nonblock_state
+            || p_rarch->benchmark.enable)
             | !!p_rarch->recording_data;
       retro_time_t delta                   = (!runloop_last_frame_time || is_locked_fps)
          ? p_rarch->runloop_frame_time.reference
@@ -37602,6 +39409,9 @@ int runloop_iterate(void)
          break;
    }
 
+   if (p_rarch->benchmark.enable)
+      KingStation_benchmark_frame_begin(&p_rarch->benchmark, current_time);
+
 #ifdef HAVE_THREADS
    if (p_rarch->runloop_autosave)
       autosave_lock();
@@ -37671,9 +39481,16 @@ int runloop_iterate(void)
       }
    }
 
-   if ((video_frame_delay > 0) && !p_rarch->input_driver_nonblock_state)
+   if ((video_frame_delay > 0) && !p_rarch->input_driver_nonblock_state
+         && !p_rarch->benchmark.enable)
       retro_sleep(video_frame_delay);
 
+   if (p_rarch->benchmark.enable)
+   {
+      p_rarch->benchmark.callback_usec = 0;
+      core_start                       = cpu_features_get_time_usec();
+   }
+
    {
 #ifdef HAVE_RUNAHEAD
       unsigned run_ahead_num_frames = settings->uints.run_ahead_frames;
@@ -37687,12 +39504,23 @@ int runloop_iterate(void)
          do_runahead(
                p_rarch,
                run_ahead_num_frames,
-               settings->bools.run_ahead_secondary_instance);
+               settings->bools.run_ahead_secondary_instance,
+               settings->bools.run_ahead_secondary_threaded,
+               settings->bools.run_ahead_multiple_states);
       else
-#endif
+      {
+         /* The core may still be ahead of the last real frame */
+         runahead_drop_states(p_rarch);
          core_run();
+      }
+#else
+      core_run();
+#endif
    }
 
+   if (p_rarch->benchmark.enable)
+      KingStation_benchmark_frame_end(&p_rarch->benchmark, core_start);
+
    /* Increment runtime tick counter after each call to
     * core_run() or run_ahead() */
    p_rarch->libretro_core_runtime_usec += rarch_core_runtime_tick(
@@ -37748,8 +39576,9 @@ int runloop_iterate(void)
       autosave_unlock();
 #endif
 
-   /* Condition for max speed x0.0 when vrr_runloop is off to skip that part */
-   if (!(fastforward_ratio || vrr_runloop_enable))
+   /* Condition for max speed x0.0 when vrr_runloop is off to skip that part,
+    * benchmarks always run unthrottled */
+   if (p_rarch->benchmark.enable || !(fastforward_ratio || vrr_runloop_enable))
       return 0;
 
 end:
@@ -37766,8 +39595,12 @@ end:
             /* Nonblocking audio */
             if (p_rarch->audio_driver_active &&
                   p_rarch->audio_driver_context_audio_data)
+            {
+               AUDIO_DRIVER_LOCK(p_rarch);
                p_rarch->current_audio->set_nonblock_state(
                      p_rarch->audio_driver_context_audio_data, true);
+               AUDIO_DRIVER_UNLOCK(p_rarch);
+            }
             p_rarch->audio_driver_chunk_size =
                p_rarch->audio_driver_chunk_nonblock_size;
          }
@@ -37779,9 +39612,13 @@ end:
             /* Blocking audio */
             if (p_rarch->audio_driver_active &&
                   p_rarch->audio_driver_context_audio_data)
+            {
+               AUDIO_DRIVER_LOCK(p_rarch);
                p_rarch->current_audio->set_nonblock_state(
                      p_rarch->audio_driver_context_audio_data,
                      audio_sync ? false : true);
+               AUDIO_DRIVER_UNLOCK(p_rarch);
+            }
 
             p_rarch->audio_driver_chunk_size  =
                p_rarch->audio_driver_chunk_block_size;
@@ -37943,6 +39780,7 @@ void rarch_favorites_init(void)
    playlist_config.capacity            = COLLECTION_SIZE;
    playlist_config.old_format          = settings ? settings->bools.playlist_use_old_format : false;
    playlist_config.compress            = settings ? settings->bools.playlist_compression : false;
+   playlist_config.binary              = settings ? settings->bools.playlist_use_binary_format : false;
    playlist_config.fuzzy_archive_match = settings ? settings->bools.playlist_fuzzy_archive_match : false;
    playlist_config_set_base_content_directory(&playlist_config, NULL);
 
@@ -34,6 +34,9 @@
 #include <lists/string_list.h>
 #include <queues/task_queue.h>
 #include <queues/message_queue.h>
+#ifdef HAVE_THREADS
+#include <rthreads/tpool.h>
+#endif
 #ifdef HAVE_AUDIOMIXER
 #include <audio/audio_mixer.h>
 #endif
@@ -79,6 +82,34 @@ RETRO_BEGIN_DECLS
                                             * 3 - Late
                                             */
 
+#define RETRO_ENVIRONMENT_GET_AUDIO_SAMPLE_BATCH_FLOAT (5 | RETRO_ENVIRONMENT_KingStation_START_BLOCK)
+                                            /* struct retro_audio_sample_batch_float_callback * --
+                                            * Gets a batch callback taking interleaved stereo
+                                            * float samples in [-1.0, 1.0], for cores which mix
+                                            * in float anyway. It saves the core's conversion to
+                                            * s16 and the frontend's conversion back; when the
+                                            * audio driver takes float too and no resampling is
+                                            * needed, the buffer goes to the driver untouched.
+                                            *
+                                            * Same rules as retro_audio_sample_batch_t apply, and
+                                            * it replaces the other audio callbacks - a core must
+                                            * only use one of them. Returns false if the frontend
+                                            * cannot take float audio in this context.
+                                            *
+                                            * Frontend-private like the calls above; cores wanting it
+                                            * carry this define and the struct below themselves.
+                                            */
+
+/* Renders multiple audio frames in one go, as
+ * retro_audio_sample_batch_t, but with float samples.
+ * I.e. float buf[4] = { l, r, l, r }; would be 2 frames. */
+typedef size_t (RETRO_CALLCONV *retro_audio_sample_batch_float_t)(
+      const float *data, size_t frames);
+struct retro_audio_sample_batch_float_callback
+{
+   retro_audio_sample_batch_float_t callback;
+};
+
 enum rarch_ctl_state
 {
    RARCH_CTL_NONE = 0,
@@ -299,6 +330,7 @@ typedef struct content_state
 {
    char *pending_subsystem_roms[RARCH_MAX_SUBSYSTEM_ROMS];
    struct string_list *temporary_content;
+   void *prefetch;
 
    int pending_subsystem_rom_num;
    int pending_subsystem_id;
@@ -309,6 +341,7 @@ typedef struct content_state
    char pending_subsystem_ident[255];
    char pending_rom_crc_path[PATH_MAX_LENGTH];
    char companion_ui_db_name[PATH_MAX_LENGTH];
+   char prefetch_path[PATH_MAX_LENGTH];
 
    bool is_inited;
    bool core_does_not_need_content;
@@ -1980,6 +2013,12 @@ unsigned int KingStation_get_rotation(void);
 
 void KingStation_init_task_queue(void);
 
+#ifdef HAVE_THREADS
+/* Thread pool shared by the frontend, created along with
+ * the task queue. NULL if it could not be created. */
+tpool_t *KingStation_get_thread_pool(void);
+#endif
+
 bool input_key_pressed(int key, bool keyboard_pressed);
 
 bool input_mouse_grabbed(void);
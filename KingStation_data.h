@@ -164,6 +164,23 @@
 
 #define VIDEO_DRIVER_GET_HW_CONTEXT_INTERNAL() (&p_rarch->hw_render)
 
+#ifdef HAVE_THREADS
+#define AUDIO_DRIVER_LOCK(p_rarch) \
+   do { \
+      if ((p_rarch)->audio_driver_thread_lock) \
+         slock_lock((p_rarch)->audio_driver_thread_lock); \
+   } while (0)
+
+#define AUDIO_DRIVER_UNLOCK(p_rarch) \
+   do { \
+      if ((p_rarch)->audio_driver_thread_lock) \
+         slock_unlock((p_rarch)->audio_driver_thread_lock); \
+   } while (0)
+#else
+#define AUDIO_DRIVER_LOCK(p_rarch)     ((void)0)
+#define AUDIO_DRIVER_UNLOCK(p_rarch)   ((void)0)
+#endif
+
 #ifdef HAVE_THREADS
 #define RUNLOOP_MSG_QUEUE_LOCK() slock_lock(p_rarch->runloop_msg_queue_lock)
 #define RUNLOOP_MSG_QUEUE_UNLOCK() slock_unlock(p_rarch->runloop_msg_queue_lock)
@@ -201,6 +218,9 @@
       p_rarch->runahead_secondary_core_available = false
 #endif
 
+/* Frames between the overlap reports of the run-ahead thread */
+#define RUNAHEAD_THREAD_REPORT_FRAMES (60 * 60)
+
 #define RUNAHEAD_RESUME_VIDEO() \
    if (p_rarch->runahead_video_driver_is_active) \
       p_rarch->video_driver_active = true; \
@@ -391,8 +411,10 @@
 
 #ifdef _WIN32
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %I64u ticks, %I64u runs.\n"
+#define BENCHMARK_U64_FMT "%I64u"
 #else
 #define PERF_LOG_FMT "[PERF]: Avg (%s): %llu ticks, %llu runs.\n"
+#define BENCHMARK_U64_FMT "%llu"
 #endif
 
 #ifdef HAVE_MENU
@@ -1277,7 +1299,10 @@ enum
    RA_OPT_MAX_FRAMES_SCREENSHOT_PATH,
    RA_OPT_SET_SHADER,
    RA_OPT_ACCESSIBILITY,
-   RA_OPT_LOAD_MENU_ON_ERROR
+   RA_OPT_LOAD_MENU_ON_ERROR,
+   RA_OPT_PRECOMPILE_SHADERS,
+   RA_OPT_BENCHMARK,
+   RA_OPT_BENCHMARK_STATE_CRC
 };
 
 enum  runloop_state
@@ -1384,6 +1409,26 @@ struct bsv_movie
 };
 #endif
 
+/* Timings of a --benchmark run */
+struct rarch_benchmark
+{
+   /* Per frame, time spent in the core itself and
+    * in the frontend, callbacks included */
+   retro_time_t *core_usec;
+   retro_time_t *frontend_usec;
+   size_t count;
+   size_t capacity;
+   retro_time_t start_time;
+   retro_time_t frame_start;
+   /* Time spent in frontend callbacks during core_run() */
+   retro_time_t callback_usec;
+   char report_path[PATH_MAX_LENGTH];
+   uint32_t expected_state_crc;
+   bool expect_state_crc;
+   bool enable;
+   bool failed;
+};
+
 typedef struct video_pixel_scaler
 {
    struct scaler_ctx *scaler;
@@ -1430,6 +1475,8 @@ typedef struct input_remote_state
 typedef struct input_list_element_t
 {
    int16_t *state;
+   /* Which ids of 'state' the core has asked for */
+   uint8_t *queried;
    unsigned port;
    unsigned device;
    unsigned index;
@@ -1448,6 +1495,56 @@ typedef struct my_list_t
    int size;
 } my_list;
 
+#if defined(HAVE_RUNAHEAD) && defined(HAVE_DYNAMIC) && defined(HAVE_THREADS)
+/* A core option as the secondary instance sees it on the
+ * run-ahead thread */
+typedef struct runahead_secondary_var
+{
+   char *key;
+   char *value;
+} runahead_secondary_var_t;
+
+/* Runs the secondary run-ahead instance alongside the main one */
+typedef struct runahead_secondary_thread
+{
+   /* Time spent running the secondary instance on the
+    * thread, and waiting for it on the main thread,
+    * since the last report */
+   retro_time_t run_usec;
+   retro_time_t wait_usec;
+   uint64_t frames;
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   /* Copy of the last input, the logging hook
+    * keeps updating the original meanwhile */
+   my_list *input;
+   /* Last frame of the secondary instance, shown
+    * on the main thread once it is done */
+   uint8_t *frame;
+   size_t frame_size;
+   size_t pitch;
+   unsigned width;
+   unsigned height;
+   /* What the environment queries of the secondary instance
+    * are answered with on the thread, taken on the main
+    * thread before each run. The core options are copied
+    * again whenever the main instance's change. */
+   runahead_secondary_var_t *vars;
+   size_t vars_size;
+   char system_dir[PATH_MAX_LENGTH];
+   char save_dir[PATH_MAX_LENGTH];
+   char assets_dir[PATH_MAX_LENGTH];
+   unsigned language;
+   bool overscan;
+   bool frame_dupe;
+   bool frame_ready;
+   bool pending;
+   bool active;
+   bool alive;
+} runahead_secondary_thread_t;
+#endif
+
 #ifdef HAVE_OVERLAY
 typedef struct input_overlay_state
 {
@@ -1716,6 +1813,7 @@ struct rarch_state
    retro_time_t libretro_core_runtime_usec;
    retro_time_t video_driver_frame_time_samples[
       MEASURE_FRAME_TIME_SAMPLES_COUNT];
+   struct rarch_benchmark benchmark;            /* retro_time_t alignment */
    struct global              g_extern;         /* retro_time_t alignment */
 #ifdef HAVE_MENU
    menu_input_t menu_input_state;               /* retro_time_t alignment */
@@ -1748,6 +1846,10 @@ struct rarch_state
 #if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
    struct retro_core_t secondary_core;          /* uint64_t alignment */
 #endif
+#if defined(HAVE_DYNAMIC) && defined(HAVE_THREADS)
+   runahead_secondary_thread_t runahead_secondary_thread;
+                                                /* uint64_t alignment */
+#endif
 #endif
 
    uint64_t audio_driver_free_samples_count;
@@ -1794,6 +1896,24 @@ struct rarch_state
    slock_t *runloop_msg_queue_lock;
    slock_t *display_lock;
    slock_t *context_lock;
+
+   /* Worker threads shared by image decoding, content
+    * scanning and the software video filters */
+   tpool_t *thread_pool;
+
+   /* Mixing thread (audio_threaded_mixing). The core pushes
+    * raw samples into the queue; the thread holds
+    * 'audio_driver_thread_lock' while it resamples, mixes
+    * and writes them, so anything else touching the DSP,
+    * the mixer or the driver takes it too. The wake lock
+    * only protects the two condition variables. */
+   sthread_t *audio_driver_thread;
+   slock_t *audio_driver_thread_lock;
+   slock_t *audio_driver_thread_wake_lock;
+   scond_t *audio_driver_thread_cond;
+   scond_t *audio_driver_thread_space_cond;
+   int16_t *audio_driver_thread_conv_buf;
+   spsc_queue_t audio_driver_thread_queue;
 #endif
 
    const camera_driver_t *camera_driver;
@@ -2010,6 +2130,11 @@ struct rarch_state
 #if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
    int port_map[MAX_USERS];
 #endif
+   /* Ring of run-ahead states for the multiple savestates mode -
+    * index of the oldest (last real frame), and how many of
+    * them are valid. */
+   int runahead_state_first;
+   int runahead_state_count;
 #endif
 
 #if defined(HAVE_ACCESSIBILITY) && defined(HAVE_TRANSLATE)
@@ -2295,6 +2420,9 @@ struct rarch_state
    bool audio_driver_use_float;
 
    bool audio_suspended;
+#ifdef HAVE_THREADS
+   bool audio_driver_thread_alive;
+#endif
 
 #ifdef HAVE_RUNAHEAD
    bool has_variable_update;
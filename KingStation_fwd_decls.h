@@ -62,6 +62,9 @@ static void rarch_init_core_options(
 #if defined(HAVE_DYNAMIC) || defined(HAVE_DYLIB)
 static bool secondary_core_create(struct rarch_state *p_rarch);
 #endif
+#if defined(HAVE_DYNAMIC) && defined(HAVE_THREADS)
+static void runahead_secondary_thread_free(struct rarch_state *p_rarch);
+#endif
 static int16_t input_state_get_last(unsigned port,
       unsigned device, unsigned index, unsigned id);
 #endif
@@ -90,8 +93,20 @@ static void ui_companion_driver_init_first(
       struct rarch_state *p_rarch);
 
 static bool audio_driver_stop(struct rarch_state *p_rarch);
+static size_t audio_driver_sample_batch_float(const float *data,
+      size_t frames);
 static bool audio_driver_start(struct rarch_state *p_rarch,
       bool is_shutdown);
+#ifdef HAVE_THREADS
+static bool audio_driver_thread_init(struct rarch_state *p_rarch,
+      size_t outsamples_max);
+static void audio_driver_thread_free(struct rarch_state *p_rarch);
+#endif
+#ifdef HAVE_AUDIOMIXER
+static void audio_driver_mixer_play_stream_internal(
+      struct rarch_state *p_rarch,
+      unsigned i, unsigned type);
+#endif
 
 static bool recording_init(settings_t *settings,
       struct rarch_state *p_rarch);
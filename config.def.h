@@ -753,6 +753,11 @@ static const float message_bgcolor_opacity = 1.0f;
 /* Watch shader files for changes and auto-apply as necessary. */
 #define DEFAULT_VIDEO_SHADER_WATCH_FILES false
 
+/* Keep slang shaders compiled to SPIR-V, and the Vulkan
+ * pipeline cache, in the cache directory, so presets
+ * load without recompiling. */
+#define DEFAULT_VIDEO_SHADER_CACHE true
+
 /* Initialise file browser with last used directory
  * when selecting shader presets/passes via the menu */
 #define DEFAULT_VIDEO_SHADER_REMEMBER_LAST_DIR true
@@ -895,6 +900,12 @@ static const bool audio_enable_menu_bgm    = false;
 #define DEFAULT_RATE_CONTROL false
 #endif
 
+/* Resample, mix and write audio on a separate thread
+ * instead of inside the core's audio callbacks. Unlike
+ * the threaded audio driver wrapper this works with any
+ * driver, at the cost of up to ~40ms of extra queueing. */
+#define DEFAULT_AUDIO_THREADED_MIXING false
+
 /* Rate control delta. Defines how much rate_control
  * is allowed to adjust input rate. */
 #define DEFAULT_RATE_CONTROL_DELTA  0.010
@@ -961,6 +972,24 @@ static const bool audio_enable_menu_bgm    = false;
 /* How many frames to rewind at a time. */
 #define DEFAULT_REWIND_GRANULARITY 1
 
+/* Moves rewind delta compression to a worker thread.
+ * The main thread then only serializes the core state. */
+#define DEFAULT_REWIND_THREADED false
+
+/* Skips unchanged 4KB pages of the savestate by comparing
+ * page hashes before the full rewind delta scan. */
+#define DEFAULT_REWIND_PAGE_HASHES false
+
+/* Size of the second rewind tier, which keeps entries that aged
+ * out of the rewind buffer recompressed in the background.
+ * 0 disables it. */
+#define DEFAULT_REWIND_TIER2_BUFFER_SIZE 0
+
+/* Every how many rewind entries the second tier keeps a full
+ * state, so it can thin out older entries instead of dropping
+ * them. 0 disables keyframes. */
+#define DEFAULT_REWIND_KEYFRAME_INTERVAL 300
+
 /* Pause gameplay when gameplay loses focus. */
 #ifdef EMSCRIPTEN
 #define DEFAULT_PAUSE_NONACTIVE false
@@ -1069,9 +1098,19 @@ static const bool savestate_thumbnail_enable = false;
 /* When using the Run Ahead feature, use a secondary instance of the core. */
 #define DEFAULT_RUN_AHEAD_SECONDARY_INSTANCE true
 
+/* Run the secondary instance on its own thread, next to the main
+ * instance. Only for software rendered cores. */
+#define DEFAULT_RUN_AHEAD_SECONDARY_THREADED false
+
 /* Hide warning messages when using the Run Ahead feature. */
 #define DEFAULT_RUN_AHEAD_HIDE_WARNINGS false
 
+/* Without a secondary instance, keep a savestate for every frame
+ * run ahead and skip the rollback while input stays the same.
+ * Costs one savestate buffer per frame and relies on the core
+ * being deterministic. */
+#define DEFAULT_RUN_AHEAD_MULTIPLE_STATES false
+
 /* Enable stdin/network command interface. */
 static const bool network_cmd_enable = false;
 static const uint16_t network_cmd_port = 55355;
@@ -1118,6 +1157,12 @@ static const int default_content_favorites_size = 200;
 /* When creating/updating playlists, compress written data */
 #define DEFAULT_PLAYLIST_COMPRESSION false
 
+/* When creating/updating playlists, write the binary
+ * format (string table + fixed size records) instead
+ * of JSON. Entries are decoded on demand when loaded,
+ * and single entry updates are patched in place */
+#define DEFAULT_PLAYLIST_USE_BINARY_FORMAT false
+
 #ifdef HAVE_MENU
 /* Specify when to display 'core name' inline on playlist entries */
 #define DEFAULT_PLAYLIST_SHOW_INLINE_CORE_NAME PLAYLIST_INLINE_CORE_DISPLAY_HIST_FAV
@@ -1133,6 +1178,34 @@ static const int default_content_favorites_size = 200;
 
 #define DEFAULT_SCAN_WITHOUT_CORE_MATCH false
 
+/* Number of files read, hashed and identified at once in
+ * the thread pool while scanning content. 0 uses every
+ * thread of the pool. */
+#define DEFAULT_SCAN_THREADS 0
+
+/* Number of threads in the pool shared by the task queue,
+ * image decoding, content scanning and the software video
+ * filters.
+ * 0 uses one per CPU core the process may run on. */
+#define DEFAULT_THREAD_POOL_SIZE 0
+
+/* Number of tasks run at once on the thread pool when
+ * threaded_data_runloop_enable is set. With three or
+ * more, one slot is kept free for tasks the menu is
+ * waiting on, such as thumbnail loads. */
+#define DEFAULT_TASK_QUEUE_THREADS 3
+
+/* How many of those may run long jobs, such as content
+ * scans and core updates, at the same time. */
+#define DEFAULT_TASK_QUEUE_BACKGROUND_THREADS 1
+
+/* Decompressed hunks kept per open CHD image (about 19 KB
+ * each for CDs), and how many of them are decompressed
+ * ahead on another thread while a track is read in order,
+ * as the content scanner does. */
+#define DEFAULT_CHD_CACHE_HUNKS 16
+#define DEFAULT_CHD_READAHEAD_HUNKS 4
+
 #ifdef __WINRT__
 /* Be paranoid about WinRT file I/O performance, and leave this disabled by
  * default */
@@ -1239,6 +1312,16 @@ static const unsigned menu_left_thumbnails_default = 0;
 
 static const unsigned gfx_thumbnail_upscale_threshold = 0;
 
+/* Memory in MB used to keep recently shown thumbnails
+ * decoded, so they do not have to be loaded again when
+ * scrolled back into view. 0 disables the cache */
+#define DEFAULT_GFX_THUMBNAIL_CACHE_SIZE 64
+
+/* Keep a copy of every decoded (and upscaled) thumbnail
+ * in the cache directory, which loads much faster than
+ * the source image */
+#define DEFAULT_GFX_THUMBNAIL_DISK_CACHE true
+
 #ifdef HAVE_MENU
 #define DEFAULT_MENU_TIMEDATE_STYLE          MENU_TIMEDATE_STYLE_DDMM_HM
 #define DEFAULT_MENU_TIMEDATE_DATE_SEPARATOR MENU_TIMEDATE_DATE_SEPARATOR_HYPHEN
@@ -1455,15 +1455,20 @@ static struct config_bool_setting *populate_settings_bool(
    SETTING_BOOL("ui_menubar_enable",             &settings->bools.ui_menubar_enable, true, DEFAULT_UI_MENUBAR_ENABLE, false);
    SETTING_BOOL("suspend_screensaver_enable",    &settings->bools.ui_suspend_screensaver_enable, true, true, false);
    SETTING_BOOL("rewind_enable",                 &settings->bools.rewind_enable, true, DEFAULT_REWIND_ENABLE, false);
+   SETTING_BOOL("rewind_threaded",               &settings->bools.rewind_threaded, true, DEFAULT_REWIND_THREADED, false);
+   SETTING_BOOL("rewind_page_hashes",            &settings->bools.rewind_page_hashes, true, DEFAULT_REWIND_PAGE_HASHES, false);
    SETTING_BOOL("vrr_runloop_enable",            &settings->bools.vrr_runloop_enable, true, DEFAULT_VRR_RUNLOOP_ENABLE, false);
    SETTING_BOOL("apply_cheats_after_toggle",     &settings->bools.apply_cheats_after_toggle, true, DEFAULT_APPLY_CHEATS_AFTER_TOGGLE, false);
    SETTING_BOOL("apply_cheats_after_load",       &settings->bools.apply_cheats_after_load, true, DEFAULT_APPLY_CHEATS_AFTER_LOAD, false);
    SETTING_BOOL("run_ahead_enabled",             &settings->bools.run_ahead_enabled, true, false, false);
    SETTING_BOOL("run_ahead_secondary_instance",  &settings->bools.run_ahead_secondary_instance, true, DEFAULT_RUN_AHEAD_SECONDARY_INSTANCE, false);
    SETTING_BOOL("run_ahead_hide_warnings",       &settings->bools.run_ahead_hide_warnings, true, DEFAULT_RUN_AHEAD_HIDE_WARNINGS, false);
+   SETTING_BOOL("run_ahead_secondary_threaded",  &settings->bools.run_ahead_secondary_threaded, true, DEFAULT_RUN_AHEAD_SECONDARY_THREADED, false);
+   SETTING_BOOL("run_ahead_multiple_states",     &settings->bools.run_ahead_multiple_states, true, DEFAULT_RUN_AHEAD_MULTIPLE_STATES, false);
    SETTING_BOOL("audio_sync",                    &settings->bools.audio_sync, true, DEFAULT_AUDIO_SYNC, false);
    SETTING_BOOL("video_shader_enable",           &settings->bools.video_shader_enable, true, DEFAULT_SHADER_ENABLE, false);
    SETTING_BOOL("video_shader_watch_files",      &settings->bools.video_shader_watch_files, true, DEFAULT_VIDEO_SHADER_WATCH_FILES, false);
+   SETTING_BOOL("video_shader_cache",            &settings->bools.video_shader_cache, true, DEFAULT_VIDEO_SHADER_CACHE, false);
    SETTING_BOOL("video_shader_remember_last_dir", &settings->bools.video_shader_remember_last_dir, true, DEFAULT_VIDEO_SHADER_REMEMBER_LAST_DIR, false);
    SETTING_BOOL("video_shader_preset_save_reference_enable",   &settings->bools.video_shader_preset_save_reference_enable, true, DEFAULT_VIDEO_SHADER_PRESET_SAVE_REFERENCE_ENABLE, false);
 
@@ -1647,6 +1652,7 @@ static struct config_bool_setting *populate_settings_bool(
    SETTING_BOOL("menu_show_online_updater",      &settings->bools.menu_show_online_updater, true, menu_show_online_updater, false);
    SETTING_BOOL("menu_show_core_updater",        &settings->bools.menu_show_core_updater, true, menu_show_core_updater, false);
    SETTING_BOOL("menu_show_legacy_thumbnail_updater", &settings->bools.menu_show_legacy_thumbnail_updater, true, menu_show_legacy_thumbnail_updater, false);
+   SETTING_BOOL("menu_thumbnail_disk_cache",     &settings->bools.gfx_thumbnail_disk_cache, true, DEFAULT_GFX_THUMBNAIL_DISK_CACHE, false);
    SETTING_BOOL("filter_by_current_core",        &settings->bools.filter_by_current_core, true, DEFAULT_FILTER_BY_CURRENT_CORE, false);
    SETTING_BOOL("rgui_show_start_screen",        &settings->bools.menu_show_start_screen, false, false /* TODO */, false);
    SETTING_BOOL("menu_navigation_wraparound_enable", &settings->bools.menu_navigation_wraparound_enable, true, true, false);
@@ -1739,6 +1745,7 @@ static struct config_bool_setting *populate_settings_bool(
 #endif
    SETTING_BOOL("input_sensors_enable",         &settings->bools.input_sensors_enable, true, DEFAULT_INPUT_SENSORS_ENABLE, false);
    SETTING_BOOL("audio_rate_control",           &settings->bools.audio_rate_control, true, DEFAULT_RATE_CONTROL, false);
+   SETTING_BOOL("audio_threaded_mixing",        &settings->bools.audio_threaded_mixing, true, DEFAULT_AUDIO_THREADED_MIXING, false);
 #ifdef HAVE_WASAPI
    SETTING_BOOL("audio_wasapi_exclusive_mode",  &settings->bools.audio_wasapi_exclusive_mode, true, DEFAULT_WASAPI_EXCLUSIVE_MODE, false);
    SETTING_BOOL("audio_wasapi_float_format",    &settings->bools.audio_wasapi_float_format, true, DEFAULT_WASAPI_FLOAT_FORMAT, false);
@@ -1761,6 +1768,7 @@ static struct config_bool_setting *populate_settings_bool(
 
    SETTING_BOOL("playlist_use_old_format",       &settings->bools.playlist_use_old_format, true, DEFAULT_PLAYLIST_USE_OLD_FORMAT, false);
    SETTING_BOOL("playlist_compression",          &settings->bools.playlist_compression, true, DEFAULT_PLAYLIST_COMPRESSION, false);
+   SETTING_BOOL("playlist_use_binary_format",    &settings->bools.playlist_use_binary_format, true, DEFAULT_PLAYLIST_USE_BINARY_FORMAT, false);
    SETTING_BOOL("content_runtime_log",           &settings->bools.content_runtime_log, true, DEFAULT_CONTENT_RUNTIME_LOG, false);
    SETTING_BOOL("content_runtime_log_aggregate", &settings->bools.content_runtime_log_aggregate, true, DEFAULT_CONTENT_RUNTIME_LOG_AGGREGATE, false);
    SETTING_BOOL("playlist_show_sublabels",       &settings->bools.playlist_show_sublabels, true, DEFAULT_PLAYLIST_SHOW_SUBLABELS, false);
@@ -1892,6 +1900,7 @@ static struct config_uint_setting *populate_settings_uint(
    SETTING_UINT("input_block_timeout",           &settings->uints.input_block_timeout, true, 1, false);
 #endif
    SETTING_UINT("rewind_granularity",           &settings->uints.rewind_granularity, true, DEFAULT_REWIND_GRANULARITY, false);
+   SETTING_UINT("rewind_keyframe_interval",     &settings->uints.rewind_keyframe_interval, true, DEFAULT_REWIND_KEYFRAME_INTERVAL, false);
    SETTING_UINT("rewind_buffer_size_step",      &settings->uints.rewind_buffer_size_step, true, DEFAULT_REWIND_BUFFER_SIZE_STEP, false);
    SETTING_UINT("autosave_interval",            &settings->uints.autosave_interval,  true, DEFAULT_AUTOSAVE_INTERVAL, false);
    SETTING_UINT("savestate_max_keep",           &settings->uints.savestate_max_keep, true, DEFAULT_SAVESTATE_MAX_KEEP, false);
@@ -1922,6 +1931,7 @@ static struct config_uint_setting *populate_settings_uint(
    SETTING_UINT("menu_thumbnails",              &settings->uints.gfx_thumbnails, true, gfx_thumbnails_default, false);
    SETTING_UINT("menu_left_thumbnails",         &settings->uints.menu_left_thumbnails, true, menu_left_thumbnails_default, false);
    SETTING_UINT("menu_thumbnail_upscale_threshold", &settings->uints.gfx_thumbnail_upscale_threshold, true, gfx_thumbnail_upscale_threshold, false);
+   SETTING_UINT("menu_thumbnail_cache_size",    &settings->uints.gfx_thumbnail_cache_size, true, DEFAULT_GFX_THUMBNAIL_CACHE_SIZE, false);
    SETTING_UINT("menu_timedate_style",          &settings->uints.menu_timedate_style, true, DEFAULT_MENU_TIMEDATE_STYLE, false);
    SETTING_UINT("menu_timedate_date_separator", &settings->uints.menu_timedate_date_separator, true, DEFAULT_MENU_TIMEDATE_DATE_SEPARATOR, false);
    SETTING_UINT("menu_ticker_type",             &settings->uints.menu_ticker_type, true, DEFAULT_MENU_TICKER_TYPE, false);
@@ -1975,6 +1985,12 @@ static struct config_uint_setting *populate_settings_uint(
    SETTING_UINT("custom_viewport_x",            (unsigned*)&settings->video_viewport_custom.x, false, 0 /* TODO */, false);
    SETTING_UINT("custom_viewport_y",            (unsigned*)&settings->video_viewport_custom.y, false, 0 /* TODO */, false);
    SETTING_UINT("content_history_size",         &settings->uints.content_history_size,   true, default_content_history_size, false);
+   SETTING_UINT("scan_threads",                 &settings->uints.scan_threads,           true, DEFAULT_SCAN_THREADS, false);
+   SETTING_UINT("thread_pool_size",             &settings->uints.thread_pool_size,       true, DEFAULT_THREAD_POOL_SIZE, false);
+   SETTING_UINT("task_queue_threads",           &settings->uints.task_queue_threads,     true, DEFAULT_TASK_QUEUE_THREADS, false);
+   SETTING_UINT("task_queue_background_threads", &settings->uints.task_queue_background_threads, true, DEFAULT_TASK_QUEUE_BACKGROUND_THREADS, false);
+   SETTING_UINT("chd_cache_hunks",              &settings->uints.chd_cache_hunks,        true, DEFAULT_CHD_CACHE_HUNKS, false);
+   SETTING_UINT("chd_readahead_hunks",          &settings->uints.chd_readahead_hunks,    true, DEFAULT_CHD_READAHEAD_HUNKS, false);
    SETTING_UINT("video_hard_sync_frames",       &settings->uints.video_hard_sync_frames, true, DEFAULT_HARD_SYNC_FRAMES, false);
    SETTING_UINT("video_frame_delay",            &settings->uints.video_frame_delay,      true, DEFAULT_FRAME_DELAY, false);
    SETTING_UINT("video_max_swapchain_images",   &settings->uints.video_max_swapchain_images, true, DEFAULT_MAX_SWAPCHAIN_IMAGES, false);
@@ -2067,6 +2083,7 @@ static struct config_size_setting *populate_settings_size(
       return NULL;
 
    SETTING_SIZE("rewind_buffer_size",           &settings->sizes.rewind_buffer_size, true, DEFAULT_REWIND_BUFFER_SIZE, false);
+   SETTING_SIZE("rewind_tier2_buffer_size",     &settings->sizes.rewind_tier2_buffer_size, true, DEFAULT_REWIND_TIER2_BUFFER_SIZE, false);
 
    *size = count;
 
@@ -3099,7 +3116,8 @@ static bool config_load_file(global_t *global,
        * file contains rewind_buffer_size = "100",
        * then that ultimately gets interpreted as
        * 100MB, so ensure the internal values represent that.*/
-      if (string_is_equal(size_settings[i].ident, "rewind_buffer_size"))
+      if (     string_is_equal(size_settings[i].ident, "rewind_buffer_size")
+            || string_is_equal(size_settings[i].ident, "rewind_tier2_buffer_size"))
          if (*size_settings[i].ptr < 10000)
             *size_settings[i].ptr  = *size_settings[i].ptr * 1024 * 1024;
    }
@@ -82,6 +82,7 @@ typedef struct settings
    {
       size_t placeholder;
       size_t rewind_buffer_size;
+      size_t rewind_tier2_buffer_size;
    } sizes;
 
    video_viewport_t video_viewport_custom; /* int alignment */
@@ -166,9 +167,16 @@ typedef struct settings
       unsigned bundle_assets_extract_version_current;
       unsigned bundle_assets_extract_last_version;
       unsigned content_history_size;
+      unsigned scan_threads;
+      unsigned thread_pool_size;
+      unsigned task_queue_threads;
+      unsigned task_queue_background_threads;
+      unsigned chd_cache_hunks;
+      unsigned chd_readahead_hunks;
       unsigned frontend_log_level;
       unsigned libretro_log_level;
       unsigned rewind_granularity;
+      unsigned rewind_keyframe_interval;
       unsigned rewind_buffer_size_step;
       unsigned autosave_interval;
       unsigned savestate_max_keep;
@@ -221,6 +229,7 @@ typedef struct settings
       unsigned gfx_thumbnails;
       unsigned menu_left_thumbnails;
       unsigned gfx_thumbnail_upscale_threshold;
+      unsigned gfx_thumbnail_cache_size;
       unsigned menu_rgui_thumbnail_downscaler;
       unsigned menu_rgui_thumbnail_delay;
       unsigned menu_rgui_color_theme;
@@ -474,6 +483,7 @@ typedef struct settings
       bool video_scale_integer;
       bool video_shader_enable;
       bool video_shader_watch_files;
+      bool video_shader_cache;
       bool video_shader_remember_last_dir;
       bool video_shader_preset_save_reference_enable;
       bool video_threaded;
@@ -508,6 +518,7 @@ typedef struct settings
       bool audio_enable_menu_bgm;
       bool audio_sync;
       bool audio_rate_control;
+      bool audio_threaded_mixing;
       bool audio_wasapi_exclusive_mode;
       bool audio_wasapi_float_format;
       bool audio_fastforward_mute;
@@ -591,6 +602,7 @@ typedef struct settings
       bool menu_show_rewind;
       bool menu_show_overlays;
       bool menu_show_legacy_thumbnail_updater;
+      bool gfx_thumbnail_disk_cache;
 #ifdef HAVE_VIDEO_LAYOUT
       bool menu_show_video_layout;
 #endif
@@ -740,12 +752,16 @@ typedef struct settings
       bool history_list_enable;
       bool playlist_entry_rename;
       bool rewind_enable;
+      bool rewind_threaded;
+      bool rewind_page_hashes;
       bool vrr_runloop_enable;
       bool apply_cheats_after_toggle;
       bool apply_cheats_after_load;
       bool run_ahead_enabled;
       bool run_ahead_secondary_instance;
+      bool run_ahead_secondary_threaded;
       bool run_ahead_hide_warnings;
+      bool run_ahead_multiple_states;
       bool pause_nonactive;
       bool block_sram_overwrite;
       bool savestate_auto_index;
@@ -794,6 +810,7 @@ typedef struct settings
       bool sustained_performance_mode;
       bool playlist_use_old_format;
       bool playlist_compression;
+      bool playlist_use_binary_format;
       bool content_runtime_log;
       bool content_runtime_log_aggregate;
 
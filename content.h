@@ -74,6 +74,10 @@ uint32_t content_get_crc(void);
 
 void content_deinit(void);
 
+/* Starts reading the content file in the background, so that
+ * it is ready by the time content_init() loads it. */
+void content_prefetch(const char *path, bool need_fullpath);
+
 /* Initializes and loads a content file for the currently
  * selected libretro core. */
 bool content_init(void);
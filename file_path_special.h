@@ -32,6 +32,7 @@ RETRO_BEGIN_DECLS
 #define FILE_PATH_BUILTIN          "builtin"
 #define FILE_PATH_DETECT           "DETECT"
 #define FILE_PATH_LUTRO_PLAYLIST   "Lutro.lpl"
+#define FILE_PATH_SCAN_CACHE       "content_scan_cache.txt"
 #define FILE_PATH_NUL              "nul"
 #define FILE_PATH_CGP_EXTENSION ".cgp"
 #define FILE_PATH_GLSLP_EXTENSION ".glslp"
@@ -19,12 +19,15 @@
 #include <string.h>
 
 #include <compat/strl.h>
+#include <file/file_path.h>
+#include <streams/file_stream.h>
 #include <gfx/scaler/scaler.h>
 #include <gfx/video_frame.h>
 #include <formats/image.h>
 #include <retro_inline.h>
 #include <retro_miscellaneous.h>
 #include <retro_math.h>
+#include <retro_endianness.h>
 #include <retro_assert.h>
 #include <string/stdstring.h>
 #include <libretro.h>
@@ -866,6 +869,138 @@ static void vulkan_init_resources(vk_t *vk)
    vulkan_init_command_buffers(vk);
 }
 
+/* Gets the file the pipeline cache is kept in between
+ * runs, one per GPU. Returns false if it is not kept. */
+static bool vulkan_pipeline_cache_path(vk_t *vk, char *s, size_t len)
+{
+   char name[64];
+   char dir[PATH_MAX_LENGTH];
+   settings_t *settings = config_get_ptr();
+
+   if (     !settings
+         || !settings->bools.video_shader_cache
+         || string_is_empty(settings->paths.directory_cache))
+      return false;
+
+   snprintf(name, sizeof(name), "pipelines_%04x_%04x.bin",
+         (unsigned)vk->context->gpu_properties.vendorID,
+         (unsigned)vk->context->gpu_properties.deviceID);
+
+   fill_pathname_join(dir, settings->paths.directory_cache,
+         "vulkan", sizeof(dir));
+   fill_pathname_join(s, dir, name, len);
+
+   return true;
+}
+
+/* Checks the header every pipeline cache starts with against
+ * the GPU, a driver update changes its pipelineCacheUUID. */
+static bool vulkan_pipeline_cache_is_valid(vk_t *vk,
+      const uint8_t *data, size_t size)
+{
+   const VkPhysicalDeviceProperties *props =
+      &vk->context->gpu_properties;
+   uint32_t header[4];
+
+   if (size < sizeof(header) + VK_UUID_SIZE)
+      return false;
+
+   memcpy(header, data, sizeof(header));
+
+   /* Length, version, vendor ID and device ID
+    * followed by the UUID, all little endian */
+   return   retro_le_to_cpu32(header[0]) >= sizeof(header) + VK_UUID_SIZE
+         && retro_le_to_cpu32(header[1]) == VK_PIPELINE_CACHE_HEADER_VERSION_ONE
+         && retro_le_to_cpu32(header[2]) == props->vendorID
+         && retro_le_to_cpu32(header[3]) == props->deviceID
+         && !memcmp(data + sizeof(header), props->pipelineCacheUUID,
+               VK_UUID_SIZE);
+}
+
+/* Writes the pipeline cache out, so the next run
+ * does not have to build the same pipelines again */
+static void vulkan_pipeline_cache_save(vk_t *vk)
+{
+   char path[PATH_MAX_LENGTH];
+   char tmp[PATH_MAX_LENGTH];
+   char dir[PATH_MAX_LENGTH];
+   size_t size = 0;
+   void *data  = NULL;
+
+   if (     !vk->context
+         || vk->pipelines.cache == VK_NULL_HANDLE
+         || !vulkan_pipeline_cache_path(vk, path, sizeof(path)))
+      return;
+
+   if (     vkGetPipelineCacheData(vk->context->device,
+               vk->pipelines.cache, &size, NULL) != VK_SUCCESS
+         || !size
+         || !(data = malloc(size)))
+      return;
+
+   if (vkGetPipelineCacheData(vk->context->device,
+            vk->pipelines.cache, &size, data) == VK_SUCCESS)
+   {
+      fill_pathname_basedir(dir, path, sizeof(dir));
+      if (!path_is_directory(dir))
+         path_mkdir(dir);
+
+      /* Written aside first, so a half written file
+       * never has the final name */
+      strlcpy(tmp, path, sizeof(tmp));
+      strlcat(tmp, ".tmp", sizeof(tmp));
+
+      if (     !filestream_write_file(tmp, data, size)
+            || filestream_rename(tmp, path) != 0)
+      {
+         filestream_delete(tmp);
+         RARCH_WARN("[Vulkan]: Could not save pipeline cache to \"%s\".\n",
+               path);
+      }
+   }
+
+   free(data);
+}
+
+static void vulkan_init_pipeline_cache(vk_t *vk)
+{
+   char path[PATH_MAX_LENGTH];
+   void *data                      = NULL;
+   int64_t size                    = 0;
+   VkPipelineCacheCreateInfo cache = {
+      VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
+
+   if (     vulkan_pipeline_cache_path(vk, path, sizeof(path))
+         && path_is_valid(path)
+         && filestream_read_file(path, &data, &size))
+   {
+      if (vulkan_pipeline_cache_is_valid(vk,
+               (const uint8_t*)data, (size_t)size))
+      {
+         cache.initialDataSize = (size_t)size;
+         cache.pInitialData    = data;
+      }
+      else
+         RARCH_LOG("[Vulkan]: Pipeline cache is for another GPU or driver, "
+               "starting over.\n");
+   }
+
+   if (     vkCreatePipelineCache(vk->context->device,
+               &cache, NULL, &vk->pipelines.cache) != VK_SUCCESS
+         && cache.pInitialData)
+   {
+      /* The driver refused the data after all */
+      cache.initialDataSize = 0;
+      cache.pInitialData    = NULL;
+      vkCreatePipelineCache(vk->context->device,
+            &cache, NULL, &vk->pipelines.cache);
+   }
+   else if (cache.pInitialData)
+      RARCH_LOG("[Vulkan]: Loaded pipeline cache from \"%s\".\n", path);
+
+   free(data);
+}
+
 static void vulkan_init_static_resources(vk_t *vk)
 {
    unsigned i;
@@ -873,17 +1008,12 @@ static void vulkan_init_static_resources(vk_t *vk)
    VkCommandPoolCreateInfo pool_info = {
       VK_STRUCTURE_TYPE_COMMAND_POOL_CREATE_INFO };
 
-   /* Create the pipeline cache. */
-   VkPipelineCacheCreateInfo cache   = {
-      VK_STRUCTURE_TYPE_PIPELINE_CACHE_CREATE_INFO };
-
    pool_info.flags = VK_COMMAND_POOL_CREATE_RESET_COMMAND_BUFFER_BIT;
 
    if (!vk->context)
       return;
 
-   vkCreatePipelineCache(vk->context->device,
-         &cache, NULL, &vk->pipelines.cache);
+   vulkan_init_pipeline_cache(vk);
 
    pool_info.queueFamilyIndex = vk->context->graphics_queue_index;
 
@@ -901,6 +1031,7 @@ static void vulkan_init_static_resources(vk_t *vk)
 static void vulkan_deinit_static_resources(vk_t *vk)
 {
    unsigned i;
+   vulkan_pipeline_cache_save(vk);
    vkDestroyPipelineCache(vk->context->device,
          vk->pipelines.cache, NULL);
    vulkan_destroy_texture(
@@ -1431,6 +1562,10 @@ static bool vulkan_set_shader(void *data,
       return false;
    }
 
+   /* Keep the pipelines of the new preset,
+    * in case we do not get to shut down cleanly */
+   vulkan_pipeline_cache_save(vk);
+
    return true;
 }
 
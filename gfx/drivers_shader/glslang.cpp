@@ -457,3 +457,14 @@ bool glslang::compile_spirv(const string &source, Stage stage,
    GlslangToSpv(*program.getIntermediate(language), *spirv);
    return true;
 }
+
+const char *glslang::compiler_version()
+{
+   /* Bump the last number when compile_spirv() changes
+    * the way it compiles shaders */
+   static const string version = string(GetGlslVersionString())
+      + " " + to_string(GLSLANG_MINOR_VERSION)
+      + " " + to_string(GetSpirvGeneratorVersion())
+      + " 1";
+   return version.c_str();
+}
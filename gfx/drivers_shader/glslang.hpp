@@ -18,6 +18,10 @@ namespace glslang
     };
 
     bool compile_spirv(const std::string &source, Stage stage, std::vector<uint32_t> *spirv);
+
+    /* Identifies the compiler and the options compile_spirv()
+     * uses, SPIR-V built by another one may differ. */
+    const char *compiler_version();
 }
 
 #endif
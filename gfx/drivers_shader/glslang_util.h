@@ -133,6 +133,18 @@ void glslang_build_vec4(float *data, unsigned width, unsigned height);
 
 unsigned glslang_num_miplevels(unsigned width, unsigned height);
 
+/* Sets the directory compiled shader stages are kept in,
+ * so a shader only goes through glslang again when its
+ * source or the compiler changes. NULL or an empty string
+ * turns the cache off. */
+void glslang_set_cache_directory(const char *dir);
+
+/* Compiles every .slang file below 'dir' into the cache.
+ * Returns false if there is no cache or no shader
+ * compiler, or 'dir' can not be read. */
+bool glslang_precompile_directory(const char *dir,
+      unsigned *num_shaders, unsigned *num_failed);
+
 RETRO_END_DECLS
 
 #endif
@@ -19,8 +19,11 @@
 #include <algorithm>
 
 #include <retro_miscellaneous.h>
+#include <compat/strl.h>
+#include <encodings/crc32.h>
 #include <file/file_path.h>
 #include <file/config_file.h>
+#include <lists/dir_list.h>
 #include <streams/file_stream.h>
 #include <string/stdstring.h>
 
@@ -35,6 +38,149 @@
 #endif
 #include "../../verbosity.h"
 
+#define GLSLANG_CACHE_MAGIC 0x5650534bu /* "KSPV" */
+
+/* Header of a cached stage, followed by 'words' of SPIR-V */
+struct glslang_cache_header
+{
+   uint32_t magic;
+   uint32_t stage;
+   uint32_t source_size;
+   uint32_t source_crc;
+   uint32_t words;
+};
+
+static char glslang_cache_dir[PATH_MAX_LENGTH];
+
+void glslang_set_cache_directory(const char *dir)
+{
+   if (dir)
+      strlcpy(glslang_cache_dir, dir, sizeof(glslang_cache_dir));
+   else
+      glslang_cache_dir[0] = '\0';
+}
+
+#if defined(HAVE_GLSLANG)
+/* Files are named after a hash of the compiler, the stage
+ * and the stage source with every #include resolved. The
+ * header repeats the size and CRC of the source to catch
+ * the odd hash collision. */
+static bool glslang_cache_path(const std::string &source,
+      glslang::Stage stage, char *s, size_t len)
+{
+   char name[32];
+   uint64_t hash       = 0xcbf29ce484222325ULL;
+   const char *version = glslang::compiler_version();
+   size_t i;
+
+   if (!*glslang_cache_dir)
+      return false;
+
+   /* FNV-1a */
+   for (i = 0; version[i]; i++)
+      hash = (hash ^ (uint8_t)version[i]) * 0x100000001b3ULL;
+   hash    = (hash ^ (uint8_t)stage) * 0x100000001b3ULL;
+   for (i = 0; i < source.size(); i++)
+      hash = (hash ^ (uint8_t)source[i]) * 0x100000001b3ULL;
+
+   snprintf(name, sizeof(name), "%08x%08x.spv",
+         (unsigned)(hash >> 32), (unsigned)hash);
+   fill_pathname_join(s, glslang_cache_dir, name, len);
+
+   return true;
+}
+
+static bool glslang_cache_load(const std::string &source,
+      glslang::Stage stage, std::vector<uint32_t> *spirv)
+{
+   char path[PATH_MAX_LENGTH];
+   struct glslang_cache_header header;
+   void *buf   = NULL;
+   int64_t len = 0;
+   bool ret    = false;
+
+   if (!glslang_cache_path(source, stage, path, sizeof(path)))
+      return false;
+
+   if (!path_is_valid(path) || !filestream_read_file(path, &buf, &len))
+      return false;
+
+   if ((size_t)len < sizeof(header))
+      goto end;
+
+   memcpy(&header, buf, sizeof(header));
+
+   if (     header.magic       != GLSLANG_CACHE_MAGIC
+         || header.stage       != (uint32_t)stage
+         || header.source_size != source.size()
+         || header.source_crc  != encoding_crc32(0,
+               (const uint8_t*)source.data(), source.size())
+         || (size_t)len != sizeof(header) + header.words * sizeof(uint32_t))
+      goto end;
+
+   spirv->resize(header.words);
+   memcpy(spirv->data(), (const uint8_t*)buf + sizeof(header),
+         header.words * sizeof(uint32_t));
+   ret = true;
+
+end:
+   free(buf);
+   return ret;
+}
+
+static void glslang_cache_store(const std::string &source,
+      glslang::Stage stage, const std::vector<uint32_t> &spirv)
+{
+   char path[PATH_MAX_LENGTH];
+   char tmp[PATH_MAX_LENGTH];
+   struct glslang_cache_header header;
+   std::vector<uint8_t> data;
+
+   if (!glslang_cache_path(source, stage, path, sizeof(path)))
+      return;
+
+   if (!path_is_directory(glslang_cache_dir))
+      path_mkdir(glslang_cache_dir);
+
+   header.magic       = GLSLANG_CACHE_MAGIC;
+   header.stage       = (uint32_t)stage;
+   header.source_size = (uint32_t)source.size();
+   header.source_crc  = encoding_crc32(0,
+         (const uint8_t*)source.data(), source.size());
+   header.words       = (uint32_t)spirv.size();
+
+   data.resize(sizeof(header) + spirv.size() * sizeof(uint32_t));
+   memcpy(data.data(), &header, sizeof(header));
+   memcpy(data.data() + sizeof(header), spirv.data(),
+         spirv.size() * sizeof(uint32_t));
+
+   /* Written aside first, so a half written file
+    * never has the final name */
+   strlcpy(tmp, path, sizeof(tmp));
+   strlcat(tmp, ".tmp", sizeof(tmp));
+
+   if (     !filestream_write_file(tmp, data.data(), data.size())
+         || filestream_rename(tmp, path) != 0)
+   {
+      filestream_delete(tmp);
+      RARCH_WARN("[slang]: Could not cache SPIR-V in \"%s\".\n", path);
+   }
+}
+
+static bool glslang_compile_stage(const std::string &source,
+      glslang::Stage stage, std::vector<uint32_t> *spirv)
+{
+   if (glslang_cache_load(source, stage, spirv))
+      return true;
+
+   if (!glslang::compile_spirv(source, stage, spirv))
+      return false;
+
+   glslang_cache_store(source, stage, *spirv);
+   return true;
+}
+#endif
+
 static std::string build_stage_source(
       const struct string_list *lines, const char *stage)
 {
@@ -233,14 +379,14 @@ bool glslang_compile_shader(const char *shader_path, glslang_output *output)
    if (!glslang_parse_meta(&lines, &output->meta))
       goto error;
 
-   if (!glslang::compile_spirv(build_stage_source(&lines, "vertex"),
+   if (!glslang_compile_stage(build_stage_source(&lines, "vertex"),
             glslang::StageVertex, &output->vertex))
    {
       RARCH_ERR("Failed to compile vertex shader stage.\n");
       goto error;
    }
 
-   if (!glslang::compile_spirv(build_stage_source(&lines, "fragment"),
+   if (!glslang_compile_stage(build_stage_source(&lines, "fragment"),
             glslang::StageFragment, &output->fragment))
    {
       RARCH_ERR("Failed to compile fragment shader stage.\n");
@@ -257,3 +403,36 @@ error:
 
    return false;
 }
+
+bool glslang_precompile_directory(const char *dir,
+      unsigned *num_shaders, unsigned *num_failed)
+{
+#if defined(HAVE_GLSLANG)
+   size_t i;
+   struct string_list *list = NULL;
+
+   *num_shaders = 0;
+   *num_failed  = 0;
+
+   if (!*glslang_cache_dir)
+      return false;
+
+   if (!(list = dir_list_new(dir, "slang", false, false, false, true)))
+      return false;
+
+   for (i = 0; i < list->size; i++)
+   {
+      glslang_output output;
+
+      (*num_shaders)++;
+      if (!glslang_compile_shader(list->elems[i].data, &output))
+         (*num_failed)++;
+   }
+
+   string_list_free(list);
+
+   return true;
+#else
+   return false;
+#endif
+}
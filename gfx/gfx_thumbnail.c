@@ -27,6 +27,7 @@
 #include <features/features_cpu.h>
 #include <file/file_path.h>
 #include <string/stdstring.h>
+#include <array/rhmap.h>
 
 #include "gfx_display.h"
 #include "gfx_animation.h"
@@ -44,8 +45,19 @@ typedef struct
 {
    uint64_t list_id;
    gfx_thumbnail_t *thumbnail;
+   char *cache_key;
+   size_t cache_budget;
 } gfx_thumbnail_tag_t;
 
+struct gfx_thumbnail_cache_entry
+{
+   struct texture_image image;
+   struct gfx_thumbnail_cache_entry *prev;
+   struct gfx_thumbnail_cache_entry *next;
+   char *key;
+   size_t bytes;
+};
+
 /* Setters */
 
 /* When streaming thumbnails, sets time in ms that an
@@ -82,6 +94,184 @@ void gfx_thumbnail_set_fade_missing(bool fade_missing)
    p_gfx_thumb->fade_missing = fade_missing;
 }
 
+/* Cache */
+
+/* Returns a key that identifies the decoded form of the
+ * image file at 'path', or NULL if the file does not exist.
+ * The file size and modification time are part of the key,
+ * so a changed file is loaded again */
+static char *gfx_thumbnail_cache_key(const char *path,
+      unsigned upscale_threshold, bool supports_rgba)
+{
+   char key[PATH_MAX_LENGTH + 64];
+   int64_t size  = 0;
+   int64_t mtime = 0;
+
+   if (!path_get_size_mtime(path, &size, &mtime))
+      return NULL;
+
+   snprintf(key, sizeof(key), "%s|%08x%08x|%08x%08x|%u|%d", path,
+         (unsigned)((uint64_t)size  >> 32), (unsigned)size,
+         (unsigned)((uint64_t)mtime >> 32), (unsigned)mtime,
+         upscale_threshold, supports_rgba ? 1 : 0);
+
+   return strdup(key);
+}
+
+/* Gets the file the decoded image is kept in on disk,
+ * below 'cache_dir'
+ * > Returns false if 'cache_dir' is empty, i.e. the
+ *   disk cache is disabled */
+static bool gfx_thumbnail_cache_disk_path(const char *key,
+      const char *cache_dir, char *s, size_t len)
+{
+   char name[32];
+   char dir[PATH_MAX_LENGTH];
+   uint64_t hash        = 0xcbf29ce484222325ULL;
+   const char *c;
+
+   if (string_is_empty(cache_dir))
+      return false;
+
+   /* FNV-1a; the image task checks that the file
+    * it finds is for the right source image */
+   for (c = key; *c; c++)
+      hash = (hash ^ (uint8_t)*c) * 0x100000001b3ULL;
+
+   snprintf(name, sizeof(name), "%08x%08x.kstc",
+         (unsigned)(hash >> 32), (unsigned)hash);
+
+   fill_pathname_join(dir, cache_dir, "thumbnails", sizeof(dir));
+   fill_pathname_join(s, dir, name, len);
+
+   return true;
+}
+
+static void gfx_thumbnail_cache_unlink(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      struct gfx_thumbnail_cache_entry *entry)
+{
+   if (entry->prev)
+      entry->prev->next       = entry->next;
+   else
+      p_gfx_thumb->cache_head = entry->next;
+
+   if (entry->next)
+      entry->next->prev       = entry->prev;
+   else
+      p_gfx_thumb->cache_tail = entry->prev;
+
+   entry->prev = NULL;
+   entry->next = NULL;
+}
+
+static void gfx_thumbnail_cache_link_head(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      struct gfx_thumbnail_cache_entry *entry)
+{
+   entry->prev = NULL;
+   entry->next = p_gfx_thumb->cache_head;
+
+   if (p_gfx_thumb->cache_head)
+      p_gfx_thumb->cache_head->prev = entry;
+   else
+      p_gfx_thumb->cache_tail       = entry;
+
+   p_gfx_thumb->cache_head = entry;
+}
+
+static void gfx_thumbnail_cache_remove(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      struct gfx_thumbnail_cache_entry *entry)
+{
+   gfx_thumbnail_cache_unlink(p_gfx_thumb, entry);
+   (void)RHMAP_DEL_STR(p_gfx_thumb->cache_map, entry->key);
+
+   p_gfx_thumb->cache_bytes -= entry->bytes;
+
+   image_texture_free(&entry->image);
+   free(entry->key);
+   free(entry);
+}
+
+/* Returns the cached image for 'key' and marks it as
+ * most recently used, or NULL */
+static struct texture_image *gfx_thumbnail_cache_get(
+      gfx_thumbnail_state_t *p_gfx_thumb, const char *key)
+{
+   struct gfx_thumbnail_cache_entry *entry = NULL;
+
+   if (!p_gfx_thumb->cache_map)
+      return NULL;
+
+   entry = RHMAP_GET_STR(p_gfx_thumb->cache_map, key);
+
+   /* The map is keyed by a 32 bit hash of the key */
+   if (!entry || !string_is_equal(entry->key, key))
+      return NULL;
+
+   if (entry != p_gfx_thumb->cache_head)
+   {
+      gfx_thumbnail_cache_unlink(p_gfx_thumb, entry);
+      gfx_thumbnail_cache_link_head(p_gfx_thumb, entry);
+   }
+
+   return &entry->image;
+}
+
+/* Adds 'img' to the cache, evicting the least recently
+ * used images until it fits 'budget' bytes
+ * > On success, the cache owns 'key' and the pixels
+ *   of 'img' */
+static bool gfx_thumbnail_cache_put(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      char *key, struct texture_image *img, size_t budget)
+{
+   struct gfx_thumbnail_cache_entry *entry = NULL;
+   size_t bytes                            = (size_t)img->width
+      * img->height * sizeof(uint32_t);
+
+   /* Also drops a different image that shares the hash */
+   if (p_gfx_thumb->cache_map)
+   {
+      entry = RHMAP_GET_STR(p_gfx_thumb->cache_map, key);
+      if (entry)
+         gfx_thumbnail_cache_remove(p_gfx_thumb, entry);
+   }
+
+   while (     p_gfx_thumb->cache_tail
+         && (p_gfx_thumb->cache_bytes + bytes > budget))
+      gfx_thumbnail_cache_remove(p_gfx_thumb, p_gfx_thumb->cache_tail);
+
+   if (bytes > budget)
+      return false;
+
+   entry = (struct gfx_thumbnail_cache_entry*)malloc(sizeof(*entry));
+   if (!entry)
+      return false;
+
+   entry->image  = *img;
+   entry->key    = key;
+   entry->bytes  = bytes;
+
+   RHMAP_SET_STR(p_gfx_thumb->cache_map, key, entry);
+   gfx_thumbnail_cache_link_head(p_gfx_thumb, entry);
+   p_gfx_thumb->cache_bytes += bytes;
+
+   return true;
+}
+
+void gfx_thumbnail_cache_clear(void)
+{
+   gfx_thumbnail_state_t *p_gfx_thumb = gfx_thumb_get_ptr();
+
+   while (p_gfx_thumb->cache_head)
+      gfx_thumbnail_cache_remove(p_gfx_thumb, p_gfx_thumb->cache_head);
+
+   RHMAP_FREE(p_gfx_thumb->cache_map);
+   p_gfx_thumb->cache_bytes = 0;
+}
+
 /* Callbacks */
 
 /* Fade animation callback - simply resets thumbnail
@@ -143,11 +333,23 @@ static void gfx_thumbnail_handle_upload(
    struct texture_image *img          = (struct texture_image*)task_data;
    gfx_thumbnail_tag_t *thumbnail_tag = (gfx_thumbnail_tag_t*)user_data;
    bool fade_enabled                  = false;
+   bool cached                        = false;
 
    /* Sanity check */
    if (!thumbnail_tag)
       goto end;
 
+   /* Keep the decoded image, even if it is no longer
+    * wanted right now */
+   if (     thumbnail_tag->cache_key
+         && img && img->pixels && (img->width > 0) && (img->height > 0)
+         && gfx_thumbnail_cache_put(p_gfx_thumb,
+            thumbnail_tag->cache_key, img, thumbnail_tag->cache_budget))
+   {
+      thumbnail_tag->cache_key = NULL;
+      cached                   = true;
+   }
+
    /* Ensure that we are operating on the correct
     * thumbnail... */
    if (thumbnail_tag->list_id != p_gfx_thumb->list_id)
@@ -194,7 +396,8 @@ end:
    /* Clean up */
    if (img)
    {
-      image_texture_free(img);
+      if (!cached)
+         image_texture_free(img);
       free(img);
    }
 
@@ -205,6 +408,72 @@ end:
          gfx_thumbnail_init_fade(p_gfx_thumb,
                thumbnail_tag->thumbnail);
 
+      if (thumbnail_tag->cache_key)
+         free(thumbnail_tag->cache_key);
+      free(thumbnail_tag);
+   }
+}
+
+/* Loads the image file at 'path' into 'thumbnail'
+ * > Images in the memory cache are uploaded right
+ *   away, anything else is loaded by a task
+ * > Takes ownership of 'cache_key' */
+static void gfx_thumbnail_load(
+      gfx_thumbnail_state_t *p_gfx_thumb,
+      const char *path, char *cache_key,
+      gfx_thumbnail_t *thumbnail,
+      unsigned gfx_thumbnail_upscale_threshold,
+      unsigned gfx_thumbnail_cache_size,
+      const char *gfx_thumbnail_cache_dir)
+{
+   char cache_path[PATH_MAX_LENGTH];
+   gfx_thumbnail_tag_t *thumbnail_tag = NULL;
+   struct texture_image *img          =
+      gfx_thumbnail_cache_get(p_gfx_thumb, cache_key);
+
+   if (img)
+   {
+      if (video_driver_texture_load(
+               img, TEXTURE_FILTER_MIPMAP_LINEAR,
+               &thumbnail->texture))
+      {
+         thumbnail->width  = img->width;
+         thumbnail->height = img->height;
+         thumbnail->status = GFX_THUMBNAIL_STATUS_AVAILABLE;
+      }
+
+      free(cache_key);
+      return;
+   }
+
+   thumbnail_tag = (gfx_thumbnail_tag_t*)malloc(sizeof(gfx_thumbnail_tag_t));
+
+   if (!thumbnail_tag)
+   {
+      free(cache_key);
+      return;
+   }
+
+   /* Configure user data */
+   thumbnail_tag->thumbnail    = thumbnail;
+   thumbnail_tag->list_id      = p_gfx_thumb->list_id;
+   thumbnail_tag->cache_key    = cache_key;
+   thumbnail_tag->cache_budget = (size_t)gfx_thumbnail_cache_size << 20;
+
+   if (!gfx_thumbnail_cache_disk_path(cache_key, gfx_thumbnail_cache_dir,
+            cache_path, sizeof(cache_path)))
+      cache_path[0] = '\0';
+
+   /* Would like to cancel any existing image load tasks
+    * here, but can't see how to do it... */
+   if (task_push_image_load_cached(
+         path, cache_path, video_driver_supports_rgba(),
+         gfx_thumbnail_upscale_threshold,
+         gfx_thumbnail_handle_upload, thumbnail_tag))
+      thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+   else
+   {
+      free(thumbnail_tag->cache_key);
       free(thumbnail_tag);
    }
 }
@@ -240,10 +509,13 @@ void gfx_thumbnail_request(
       gfx_thumbnail_path_data_t *path_data, enum gfx_thumbnail_id thumbnail_id,
       playlist_t *playlist, size_t idx, gfx_thumbnail_t *thumbnail,
       unsigned gfx_thumbnail_upscale_threshold,
+      unsigned gfx_thumbnail_cache_size,
+      const char *gfx_thumbnail_cache_dir,
       bool network_on_demand_thumbnails
       )
 {
    const char *thumbnail_path         = NULL;
+   char *cache_key                    = NULL;
    bool has_thumbnail                 = false;
    gfx_thumbnail_state_t *p_gfx_thumb = NULL;
    p_gfx_thumb                        = NULL;
@@ -266,25 +538,15 @@ void gfx_thumbnail_request(
    /* Load thumbnail, if required */
    if (has_thumbnail)
    {
-      if (path_is_valid(thumbnail_path))
-      {
-         gfx_thumbnail_tag_t *thumbnail_tag =
-               (gfx_thumbnail_tag_t*)malloc(sizeof(gfx_thumbnail_tag_t));
-
-         if (!thumbnail_tag)
-            goto end;
-
-         /* Configure user data */
-         thumbnail_tag->thumbnail = thumbnail;
-         thumbnail_tag->list_id   = p_gfx_thumb->list_id;
-
-         /* Would like to cancel any existing image load tasks
-          * here, but can't see how to do it... */
-         if (task_push_image_load(
-               thumbnail_path, video_driver_supports_rgba(),
+      /* Only succeeds if the file exists */
+      if ((cache_key = gfx_thumbnail_cache_key(thumbnail_path,
                gfx_thumbnail_upscale_threshold,
-               gfx_thumbnail_handle_upload, thumbnail_tag))
-            thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+               video_driver_supports_rgba())))
+      {
+         gfx_thumbnail_load(p_gfx_thumb, thumbnail_path, cache_key,
+               thumbnail, gfx_thumbnail_upscale_threshold,
+               gfx_thumbnail_cache_size, gfx_thumbnail_cache_dir);
+         goto end;
       }
 #ifdef HAVE_NETWORKING
       /* Handle on demand thumbnail downloads */
@@ -347,11 +609,13 @@ end:
  * once the image load is complete */
 void gfx_thumbnail_request_file(
       const char *file_path, gfx_thumbnail_t *thumbnail,
-      unsigned gfx_thumbnail_upscale_threshold
+      unsigned gfx_thumbnail_upscale_threshold,
+      unsigned gfx_thumbnail_cache_size,
+      const char *gfx_thumbnail_cache_dir
       )
 {
    gfx_thumbnail_state_t *p_gfx_thumb = gfx_thumb_get_ptr();
-   gfx_thumbnail_tag_t *thumbnail_tag = NULL;
+   char *cache_key                    = NULL;
 
    if (!thumbnail)
       return;
@@ -365,26 +629,23 @@ void gfx_thumbnail_request_file(
    if (string_is_empty(file_path))
       return;
 
-   if (!path_is_valid(file_path))
-      return;
-
-   /* Load thumbnail */
-   thumbnail_tag = (gfx_thumbnail_tag_t*)malloc(sizeof(gfx_thumbnail_tag_t));
+   /* Only succeeds if the file exists */
+   cache_key = gfx_thumbnail_cache_key(file_path,
+         gfx_thumbnail_upscale_threshold,
+         video_driver_supports_rgba());
 
-   if (!thumbnail_tag)
+   if (!cache_key)
       return;
 
-   /* Configure user data */
-   thumbnail_tag->thumbnail = thumbnail;
-   thumbnail_tag->list_id   = p_gfx_thumb->list_id;
+   /* Load thumbnail */
+   gfx_thumbnail_load(p_gfx_thumb, file_path, cache_key,
+         thumbnail, gfx_thumbnail_upscale_threshold,
+         gfx_thumbnail_cache_size, gfx_thumbnail_cache_dir);
 
-   /* Would like to cancel any existing image load tasks
-    * here, but can't see how to do it... */
-   if (task_push_image_load(
-         file_path, video_driver_supports_rgba(),
-         gfx_thumbnail_upscale_threshold,
-         gfx_thumbnail_handle_upload, thumbnail_tag))
-      thumbnail->status = GFX_THUMBNAIL_STATUS_PENDING;
+   /* Loaded from the cache, fade in as if it
+    * had gone through gfx_thumbnail_handle_upload() */
+   if (thumbnail->status == GFX_THUMBNAIL_STATUS_AVAILABLE)
+      gfx_thumbnail_init_fade(p_gfx_thumb, thumbnail);
 }
 
 /* Resets (and free()s the current texture of) the
@@ -433,6 +694,8 @@ void gfx_thumbnail_process_stream(
       gfx_thumbnail_path_data_t *path_data, enum gfx_thumbnail_id thumbnail_id,
       playlist_t *playlist, size_t idx, gfx_thumbnail_t *thumbnail, bool on_screen,
       unsigned gfx_thumbnail_upscale_threshold,
+      unsigned gfx_thumbnail_cache_size,
+      const char *gfx_thumbnail_cache_dir,
       bool network_on_demand_thumbnails
       )
 {
@@ -471,6 +734,8 @@ void gfx_thumbnail_process_stream(
             gfx_thumbnail_request(
                   path_data, thumbnail_id, playlist, idx, thumbnail,
                   gfx_thumbnail_upscale_threshold,
+                  gfx_thumbnail_cache_size,
+                  gfx_thumbnail_cache_dir,
                   network_on_demand_thumbnails
                   );
          }
@@ -508,6 +773,8 @@ void gfx_thumbnail_process_streams(
       gfx_thumbnail_t *right_thumbnail, gfx_thumbnail_t *left_thumbnail,
       bool on_screen,
       unsigned gfx_thumbnail_upscale_threshold,
+      unsigned gfx_thumbnail_cache_size,
+      const char *gfx_thumbnail_cache_dir,
       bool network_on_demand_thumbnails
       )
 {
@@ -577,12 +844,16 @@ void gfx_thumbnail_process_streams(
                gfx_thumbnail_request(
                      path_data, GFX_THUMBNAIL_RIGHT, playlist, idx, right_thumbnail,
                      gfx_thumbnail_upscale_threshold,
+                     gfx_thumbnail_cache_size,
+                     gfx_thumbnail_cache_dir,
                      network_on_demand_thumbnails);
 
             if (request_left)
                gfx_thumbnail_request(
                      path_data, GFX_THUMBNAIL_LEFT, playlist, idx, left_thumbnail,
                      gfx_thumbnail_upscale_threshold,
+                     gfx_thumbnail_cache_size,
+                     gfx_thumbnail_cache_dir,
                      network_on_demand_thumbnails);
          }
       }
@@ -94,8 +94,18 @@ typedef struct
 
 /* Structure containing all gfx_thumbnail
  * variables */
+struct gfx_thumbnail_cache_entry;
+
 struct gfx_thumbnail_state
 {
+   /* Recently decoded images, most recently used first.
+    * Loading a thumbnail found here only uploads it.
+    * Indexed by cache key through cache_map */
+   struct gfx_thumbnail_cache_entry *cache_head;
+   struct gfx_thumbnail_cache_entry *cache_tail;
+   struct gfx_thumbnail_cache_entry **cache_map;
+   size_t cache_bytes;
+
    /* Due to the asynchronous nature of thumbnail
     * loading, it is quite possible to trigger a load
     * then navigate to a different menu list before
@@ -165,11 +175,17 @@ void gfx_thumbnail_cancel_pending_requests(void);
  *         and gfx_thumbnail_set_content*()
  * NOTE 2: 'playlist' and 'idx' are only required here for
  *         on-demand thumbnail download support
- *         (an annoyance...) */ 
+ *         (an annoyance...)
+ * NOTE 3: Up to 'gfx_thumbnail_cache_size' MB of decoded
+ *         images are kept in memory, and a copy of each
+ *         below 'gfx_thumbnail_cache_dir' unless it is
+ *         NULL or empty */ 
 void gfx_thumbnail_request(
       gfx_thumbnail_path_data_t *path_data, enum gfx_thumbnail_id thumbnail_id,
       playlist_t *playlist, size_t idx, gfx_thumbnail_t *thumbnail,
       unsigned gfx_thumbnail_upscale_threshold,
+      unsigned gfx_thumbnail_cache_size,
+      const char *gfx_thumbnail_cache_dir,
       bool network_on_demand_thumbnails
       );
 
@@ -183,7 +199,9 @@ void gfx_thumbnail_request(
  * once the image load is complete */
 void gfx_thumbnail_request_file(
       const char *file_path, gfx_thumbnail_t *thumbnail,
-      unsigned gfx_thumbnail_upscale_threshold);
+      unsigned gfx_thumbnail_upscale_threshold,
+      unsigned gfx_thumbnail_cache_size,
+      const char *gfx_thumbnail_cache_dir);
 
 /* Resets (and free()s the current texture of) the
  * specified thumbnail */
@@ -207,6 +225,8 @@ void gfx_thumbnail_process_stream(
       gfx_thumbnail_path_data_t *path_data, enum gfx_thumbnail_id thumbnail_id,
       playlist_t *playlist, size_t idx, gfx_thumbnail_t *thumbnail, bool on_screen,
       unsigned gfx_thumbnail_upscale_threshold,
+      unsigned gfx_thumbnail_cache_size,
+      const char *gfx_thumbnail_cache_dir,
       bool network_on_demand_thumbnails
       );
 
@@ -228,6 +248,8 @@ void gfx_thumbnail_process_streams(
       gfx_thumbnail_t *right_thumbnail, gfx_thumbnail_t *left_thumbnail,
       bool on_screen,
       unsigned gfx_thumbnail_upscale_threshold,
+      unsigned gfx_thumbnail_cache_size,
+      const char *gfx_thumbnail_cache_dir,
       bool network_on_demand_thumbnails
       );
 
@@ -260,6 +282,9 @@ void gfx_thumbnail_draw(
       float alpha, float scale_factor,
       gfx_thumbnail_shadow_t *shadow);
 
+/* Frees all images held by the thumbnail cache */
+void gfx_thumbnail_cache_clear(void);
+
 gfx_thumbnail_state_t *gfx_thumb_get_ptr(void);
 
 RETRO_END_DECLS
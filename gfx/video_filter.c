@@ -32,6 +32,9 @@
 #include "../dynamic.h"
 #include "../performance_counters.h"
 #include "../verbosity.h"
+#ifdef HAVE_THREADS
+#include "../KingStation.h"
+#endif
 #include "video_filter.h"
 #include "video_filters/softfilter.h"
 
@@ -61,47 +64,24 @@ struct rarch_softfilter
 
 #ifdef HAVE_THREADS
    struct filter_thread_data *thread_data;
+   tpool_group_t *group;
 #endif
 };
 
 #ifdef HAVE_THREADS
-#include <rthreads/rthreads.h>
-
 struct filter_thread_data
 {
-   sthread_t *thread;
    const struct softfilter_work_packet *packet;
-   scond_t *cond;
-   slock_t *lock;
    void *userdata;
-   bool die;
-   bool done;
 };
 
-static void filter_thread_loop(void *data)
+/* Runs one work packet in the frontend thread pool */
+static void filter_thread_job(void *data)
 {
    struct filter_thread_data *thr = (struct filter_thread_data*)data;
 
-   for (;;)
-   {
-      bool die;
-      slock_lock(thr->lock);
-      while (thr->done && !thr->die)
-         scond_wait(thr->cond, thr->lock);
-      die = thr->die;
-      slock_unlock(thr->lock);
-
-      if (die)
-         break;
-
-      if (thr->packet && thr->packet->work)
-         thr->packet->work(thr->userdata, thr->packet->thread_data);
-
-      slock_lock(thr->lock);
-      thr->done = true;
-      scond_signal(thr->cond);
-      slock_unlock(thr->lock);
-   }
+   if (thr->packet && thr->packet->work)
+      thr->packet->work(thr->userdata, thr->packet->thread_data);
 }
 #endif
 
@@ -208,11 +188,20 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
    filt->max_width = max_width;
    filt->max_height = max_height;
 
+   if (threads == RARCH_SOFTFILTER_THREADS_AUTO)
+   {
+      threads = cpu_features_get_core_amount();
+#ifdef HAVE_THREADS
+      /* One packet per thread that can work on it */
+      if (KingStation_get_thread_pool())
+         threads = (unsigned)tpool_get_num_threads(
+               KingStation_get_thread_pool());
+#endif
+   }
+
    filt->impl_data = filt->impl->create(
          &softfilter_config, input_fmt, input_fmt, max_width, max_height,
-         threads != RARCH_SOFTFILTER_THREADS_AUTO ? threads :
-         cpu_features_get_core_amount(), cpu_features,
-         &userdata);
+         threads, cpu_features, &userdata);
    if (!filt->impl_data)
    {
       RARCH_ERR("Failed to create softfilter state.\n");
@@ -247,20 +236,12 @@ static bool create_softfilter_graph(rarch_softfilter_t *filt,
 
       for (i = 0; i < threads; i++)
       {
+         filt->thread_data[i].packet   = &filt->packets[i];
          filt->thread_data[i].userdata = filt->impl_data;
-         filt->thread_data[i].done     = true;
-
-         filt->thread_data[i].lock     = slock_new();
-         if (!filt->thread_data[i].lock)
-            return false;
-         filt->thread_data[i].cond     = scond_new();
-         if (!filt->thread_data[i].cond)
-            return false;
-         filt->thread_data[i].thread   = sthread_create(
-               filter_thread_loop, &filt->thread_data[i]);
-         if (!filt->thread_data[i].thread)
-            return false;
       }
+
+      if (!(filt->group = tpool_group_new()))
+         return false;
    }
 #endif
 
@@ -499,24 +480,9 @@ void rarch_softfilter_free(rarch_softfilter_t *filt)
 #endif
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
-   {
-      for (i = 0; i < filt->threads; i++)
-      {
-         if (!&filt->thread_data[i])
-            continue;
-         if (!filt->thread_data[i].thread)
-            continue;
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].die = true;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-         sthread_join(filt->thread_data[i].thread);
-         slock_free(filt->thread_data[i].lock);
-         scond_free(filt->thread_data[i].cond);
-      }
-      free(filt->thread_data);
-   }
+   if (filt->group)
+      tpool_group_free(filt->group);
+   free(filt->thread_data);
 #endif
 
    if (filt->conf)
@@ -562,33 +528,21 @@ void rarch_softfilter_process(rarch_softfilter_t *filt,
             output, output_stride, input, width, height, input_stride);
 
 #ifdef HAVE_THREADS
-   if (filt->threads > 1)
+   if (filt->group)
    {
-      /* Fire off workers */
-      for (i = 0; i < filt->threads; i++)
-      {
-#if 0
-         RARCH_LOG("Firing off filter thread %u ...\n", i);
-#endif
-         filt->thread_data[i].packet = &filt->packets[i];
-         slock_lock(filt->thread_data[i].lock);
-         filt->thread_data[i].done = false;
-         scond_signal(filt->thread_data[i].cond);
-         slock_unlock(filt->thread_data[i].lock);
-      }
+      tpool_t *pool = KingStation_get_thread_pool();
 
-      /* Wait for workers */
-      for (i = 0; i < filt->threads; i++)
+      if (pool)
       {
-#if 0
-         RARCH_LOG("Waiting for filter thread %u ...\n", i);
-#endif
-         slock_lock(filt->thread_data[i].lock);
-         while (!filt->thread_data[i].done)
-            scond_wait(filt->thread_data[i].cond, filt->thread_data[i].lock);
-         slock_unlock(filt->thread_data[i].lock);
+         /* The wait runs the packets no worker got to yet */
+         for (i = 0; i < filt->threads; i++)
+            if (!tpool_group_add_work(pool, filt->group,
+                     filter_thread_job, &filt->thread_data[i]))
+               filter_thread_job(&filt->thread_data[i]);
+
+         tpool_group_wait(pool, filt->group);
+         return;
       }
-      return;
    }
 #endif
 
@@ -832,6 +832,7 @@ INPUT (HID)
 FIFO BUFFER
 ============================================================ */
 #include "../libretro-common/queues/fifo_queue.c"
+#include "../libretro-common/queues/spsc_queue.c"
 
 /*============================================================
 AUDIO RESAMPLER
@@ -1090,6 +1091,9 @@ FILE
 #if defined(__linux__)
 #include "../libretro-common/file/nbio/nbio_linux.c"
 #endif
+#if defined(HAVE_IO_URING)
+#include "../libretro-common/file/nbio/nbio_uring.c"
+#endif
 #if defined(HAVE_MMAP) && defined(BSD)
 #include "../libretro-common/file/nbio/nbio_unixmmap.c"
 #endif
@@ -1284,6 +1288,7 @@ THREAD
 #endif
 
 #include "../libretro-common/rthreads/rthreads.c"
+#include "../libretro-common/rthreads/tpool.c"
 #include "../gfx/video_thread_wrapper.c"
 #include "../audio/audio_thread_wrapper.c"
 #endif
@@ -1561,6 +1566,9 @@ XML
 #include "../libretro-db/rmsgpack_dom.c"
 #include "../libretro-db/query.c"
 #include "../database_info.c"
+#if defined(_WIN32) && !defined(_XBOX)
+#include "../libretro-common/memmap/memmap.c"
+#endif
 #endif
 
 #if defined(HAVE_BUILTINMINIUPNPC)
@@ -798,6 +798,37 @@ uint64_t cpu_features_get(void)
    return cpu;
 }
 
+uint64_t cpu_features_get_extra(void)
+{
+   uint64_t cpu        = 0;
+#if defined(__MACH__)
+   size_t len          = sizeof(size_t);
+   if (sysctlbyname("hw.optional.armv8_crc32", NULL, &len, NULL, 0) == 0)
+      cpu |= CPU_FEATURES_CRC32;
+#elif defined(CPU_X86) && !defined(_XBOX1)
+   int flags[4];
+
+   x86_cpuid(0, flags);
+   if (flags[0] < 1)
+      return 0;
+
+   x86_cpuid(1, flags);
+
+   /* PCLMULQDQ, the kernels using it need SSE2 as well */
+   if ((flags[2] & (1 << 1)) && (flags[3] & (1 << 26)))
+      cpu |= CPU_FEATURES_PCLMUL;
+#elif defined(__linux__)
+   if (check_arm_cpu_feature("crc32"))
+      cpu |= CPU_FEATURES_CRC32;
+#endif
+
+#if defined(__ARM_FEATURE_CRC32)
+   cpu |= CPU_FEATURES_CRC32;
+#endif
+
+   return cpu;
+}
+
 void cpu_features_get_model_name(char *name, int len)
 {
 #if defined(CPU_X86) && !defined(__MACH__)
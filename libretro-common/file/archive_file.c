@@ -32,6 +32,10 @@
 #include <lists/string_list.h>
 #include <string/stdstring.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 #ifdef HAVE_MMAP
 #include <fcntl.h>
 #include <errno.h>
@@ -40,6 +44,49 @@
 #include <sys/stat.h>
 #endif
 
+/* Bytes skipped at a time when seeking forward in a member */
+#define ARCHIVE_STREAM_SKIP_SIZE 0x4000
+
+/* Members of an archive, in the order its backend lists them */
+typedef struct file_archive_dir
+{
+   char *path;
+   const struct file_archive_file_backend *backend;
+   struct file_archive_entry *entries;
+   size_t count;
+   size_t capacity;
+   int64_t size;
+   int64_t mtime;
+   unsigned last_use;
+   /* Users of the directory, it is freed by the last one
+    * once it is no longer in the cache */
+   unsigned refs;
+   bool cached;
+} file_archive_dir_t;
+
+struct file_archive_stream
+{
+   file_archive_dir_t *dir;
+   const struct file_archive_entry *entry;
+   /* Backend reader, NULL if the member was extracted to @data */
+   void *member;
+   uint8_t *data;
+   /* Bytes the reader has returned */
+   int64_t pos;
+   /* Bytes the caller has read or seeked to */
+   int64_t offset;
+};
+
+static struct
+{
+   file_archive_dir_t **dirs;
+   unsigned size;
+   unsigned use_count;
+#ifdef HAVE_THREADS
+   slock_t *lock;
+#endif
+} archive_cache;
+
 static int file_archive_get_file_list_cb(
       const char *path,
       const char *valid_exts,
@@ -368,6 +415,246 @@ int file_archive_parse_file_progress(file_archive_transfer_t *state)
    return (int)((state->step_current * 100) / (state->step_total));
 }
 
+static void file_archive_dir_free(file_archive_dir_t *dir)
+{
+   size_t i;
+
+   for (i = 0; i < dir->count; i++)
+      free(dir->entries[i].name);
+   free(dir->entries);
+   free(dir->path);
+   free(dir);
+}
+
+static int file_archive_dir_cb(const char *name, const char *valid_exts,
+      const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
+      uint32_t crc32, struct archive_extract_userdata *userdata)
+{
+   file_archive_dir_t *dir = (file_archive_dir_t*)userdata->cb_data;
+   struct file_archive_entry *entry;
+
+   /* Directories of 7z files come without a name */
+   if (string_is_empty(name))
+      return 1;
+
+   if (dir->count == dir->capacity)
+   {
+      size_t capacity                    = dir->capacity ? dir->capacity * 2 : 16;
+      struct file_archive_entry *entries = (struct file_archive_entry*)
+         realloc(dir->entries, capacity * sizeof(*entries));
+
+      if (!entries)
+         return 0;
+
+      dir->entries  = entries;
+      dir->capacity = capacity;
+   }
+
+   entry          = &dir->entries[dir->count];
+   entry->name    = strdup(name);
+   entry->cdata   = cdata;
+   entry->cmode   = cmode;
+   entry->csize   = csize;
+   entry->size    = size;
+   entry->crc32   = crc32;
+
+   if (!entry->name)
+      return 0;
+
+   dir->count++;
+   return 1;
+}
+
+/* Parses the directory of the archive at @path, without a member. */
+static file_archive_dir_t *file_archive_dir_read(const char *path,
+      int64_t size, int64_t mtime)
+{
+   struct archive_extract_userdata userdata = {0};
+   file_archive_dir_t *dir                  = (file_archive_dir_t*)
+      calloc(1, sizeof(*dir));
+
+   if (!dir)
+      return NULL;
+
+   dir->path         = strdup(path);
+   dir->backend      = file_archive_get_file_backend(path);
+   dir->size         = size;
+   dir->mtime        = mtime;
+   dir->refs         = 1;
+   userdata.cb_data  = dir;
+
+   if (     !dir->path
+         || !dir->backend
+         || !file_archive_walk(path, NULL, file_archive_dir_cb, &userdata))
+   {
+      file_archive_dir_free(dir);
+      return NULL;
+   }
+
+   return dir;
+}
+
+/**
+ * file_archive_dir_get:
+ * @path                        : archive path, with or without a member.
+ *
+ * Gets the directory of an archive from the cache, or parses it.
+ * Release it with file_archive_dir_put().
+ **/
+static file_archive_dir_t *file_archive_dir_get(const char *path)
+{
+   unsigned i;
+   char archive_path[PATH_MAX_LENGTH];
+   char *delim                   = NULL;
+   int64_t size                  = 0;
+   int64_t mtime                 = 0;
+   file_archive_dir_t *dir       = NULL;
+   unsigned oldest               = 0;
+
+   strlcpy(archive_path, path, sizeof(archive_path));
+   if ((delim = (char*)path_get_archive_delim(archive_path)))
+      *delim = '\0';
+
+   if (!archive_cache.size || !path_get_size_mtime(archive_path, &size, &mtime))
+      return file_archive_dir_read(archive_path, size, mtime);
+
+#ifdef HAVE_THREADS
+   slock_lock(archive_cache.lock);
+#endif
+
+   for (i = 0; i < archive_cache.size; i++)
+   {
+      file_archive_dir_t *cached = archive_cache.dirs[i];
+
+      if (!cached)
+      {
+         oldest = i;
+         break;
+      }
+
+      if (     cached->size  == size
+            && cached->mtime == mtime
+            && string_is_equal(cached->path, archive_path))
+      {
+         dir = cached;
+         break;
+      }
+
+      if (     archive_cache.dirs[oldest]
+            && cached->last_use < archive_cache.dirs[oldest]->last_use)
+         oldest = i;
+   }
+
+   if (dir)
+   {
+      dir->refs++;
+      dir->last_use = ++archive_cache.use_count;
+   }
+
+#ifdef HAVE_THREADS
+   slock_unlock(archive_cache.lock);
+#endif
+
+   if (dir)
+      return dir;
+
+   /* Parsed unlocked, so two threads may parse the same
+    * archive; both copies are valid, the older one ages out */
+   if (!(dir = file_archive_dir_read(archive_path, size, mtime)))
+      return NULL;
+
+#ifdef HAVE_THREADS
+   slock_lock(archive_cache.lock);
+#endif
+
+   if (archive_cache.size)
+   {
+      file_archive_dir_t *evicted = archive_cache.dirs[oldest];
+
+      if (evicted)
+      {
+         evicted->cached = false;
+         if (!evicted->refs)
+            file_archive_dir_free(evicted);
+      }
+
+      dir->cached                = true;
+      dir->last_use              = ++archive_cache.use_count;
+      archive_cache.dirs[oldest] = dir;
+   }
+
+#ifdef HAVE_THREADS
+   slock_unlock(archive_cache.lock);
+#endif
+
+   return dir;
+}
+
+static void file_archive_dir_put(file_archive_dir_t *dir)
+{
+   bool unused;
+
+   if (!dir)
+      return;
+
+#ifdef HAVE_THREADS
+   if (archive_cache.lock)
+      slock_lock(archive_cache.lock);
+#endif
+   unused = !--dir->refs && !dir->cached;
+#ifdef HAVE_THREADS
+   if (archive_cache.lock)
+      slock_unlock(archive_cache.lock);
+#endif
+
+   if (unused)
+      file_archive_dir_free(dir);
+}
+
+void file_archive_cache_init(unsigned size)
+{
+   if (archive_cache.size || !size)
+      return;
+
+#ifdef HAVE_THREADS
+   if (!(archive_cache.lock = slock_new()))
+      return;
+#endif
+
+   archive_cache.dirs = (file_archive_dir_t**)calloc(size,
+         sizeof(*archive_cache.dirs));
+   if (archive_cache.dirs)
+      archive_cache.size = size;
+}
+
+void file_archive_cache_deinit(void)
+{
+   unsigned i;
+
+   for (i = 0; i < archive_cache.size; i++)
+   {
+      file_archive_dir_t *dir = archive_cache.dirs[i];
+
+      if (!dir)
+         continue;
+
+      /* Still in use, the last user frees it */
+      dir->cached = false;
+      if (!dir->refs)
+         file_archive_dir_free(dir);
+   }
+
+   free(archive_cache.dirs);
+   archive_cache.dirs = NULL;
+   archive_cache.size = 0;
+
+#ifdef HAVE_THREADS
+   if (archive_cache.lock)
+      slock_free(archive_cache.lock);
+   archive_cache.lock = NULL;
+#endif
+}
+
 /**
  * file_archive_extract_file:
  * @archive_path                    : filename path to archive.
@@ -438,6 +725,35 @@ end:
    return ret;
 }
 
+/* Passes every member of the archive at @path to
+ * file_archive_get_file_list_cb(), like walking it would. */
+static bool file_archive_dir_list(const char *path, const char *valid_exts,
+      struct archive_extract_userdata *userdata)
+{
+   size_t i;
+   file_archive_dir_t *dir = file_archive_dir_get(path);
+
+   if (!dir)
+      return false;
+
+   for (i = 0; i < dir->count; i++)
+   {
+      const struct file_archive_entry *entry = &dir->entries[i];
+
+      strlcpy(userdata->current_file_path, entry->name,
+            sizeof(userdata->current_file_path));
+      userdata->crc = entry->crc32;
+
+      if (!file_archive_get_file_list_cb(entry->name, valid_exts,
+               entry->cdata, entry->cmode, entry->csize, entry->size,
+               entry->crc32, userdata))
+         break;
+   }
+
+   file_archive_dir_put(dir);
+   return true;
+}
+
 /* Warning: 'list' must zero initialised before
  * calling this function, otherwise memory leaks/
  * undefined behaviour will occur */
@@ -463,10 +779,7 @@ bool file_archive_get_file_list_noalloc(struct string_list *list,
    userdata.transfer                        = NULL;
    userdata.dec                             = NULL;
 
-   if (!file_archive_walk(path, valid_exts,
-            file_archive_get_file_list_cb, &userdata))
-      return false;
-   return true;
+   return file_archive_dir_list(path, valid_exts, &userdata);
 }
 
 /**
@@ -495,8 +808,7 @@ struct string_list *file_archive_get_file_list(const char *path,
 
    if (!userdata.list)
       return NULL;
-   if (!file_archive_walk(path, valid_exts,
-         file_archive_get_file_list_cb, &userdata))
+   if (!file_archive_dir_list(path, valid_exts, &userdata))
    {
       string_list_free(userdata.list);
       return NULL;
@@ -577,6 +889,98 @@ error:
    return NULL;
 }
 
+/* Decompresses the first member whose name contains @needle,
+ * to @optional_filename or a new buffer in @buf, as it is read.
+ * Returns the size read to @buf, 0 when writing to a file or -1. */
+static int64_t file_archive_member_read(const char *path,
+      const char *needle, void **buf, const char *optional_filename)
+{
+   size_t i;
+   uint8_t *data                          = NULL;
+   RFILE *out                             = NULL;
+   void *member                           = NULL;
+   int64_t total                          = 0;
+   uint32_t crc                           = 0;
+   const struct file_archive_entry *entry = NULL;
+   file_archive_dir_t *dir                = file_archive_dir_get(path);
+
+   if (!dir)
+      return -1;
+
+   for (i = 0; i < dir->count && !entry; i++)
+   {
+      const char *name = dir->entries[i].name;
+      char last_char   = name[strlen(name) - 1];
+
+      /* Ignore directories. */
+      if (last_char != '/' && last_char != '\\' && strstr(name, needle))
+         entry = &dir->entries[i];
+   }
+
+   if (!entry || !(member = dir->backend->member_open(dir->path, entry)))
+      goto error;
+
+   if (optional_filename)
+   {
+      if (!(out = filestream_open(optional_filename,
+                  RETRO_VFS_FILE_ACCESS_WRITE,
+                  RETRO_VFS_FILE_ACCESS_HINT_NONE)))
+         goto error;
+      data = (uint8_t*)malloc(ARCHIVE_STREAM_SKIP_SIZE);
+   }
+   else
+      data = (uint8_t*)malloc((size_t)entry->size + 1);
+
+   if (!data)
+      goto error;
+
+   while (total < entry->size)
+   {
+      uint8_t *dst  = out ? data : data + total;
+      int64_t count = out
+         ? MIN(entry->size - total, ARCHIVE_STREAM_SKIP_SIZE)
+         : entry->size - total;
+      int64_t ret   = dir->backend->member_read(member, dst, count);
+
+      if (ret <= 0)
+         goto error;
+      if (out && filestream_write(out, dst, ret) != ret)
+         goto error;
+
+      crc    = dir->backend->stream_crc_calculate(crc, dst, (size_t)ret);
+      total += ret;
+   }
+
+   if (crc != entry->crc32)
+      goto error;
+
+   dir->backend->member_close(member);
+   file_archive_dir_put(dir);
+
+   if (out)
+   {
+      free(data);
+      return filestream_close(out) == 0 ? 0 : -1;
+   }
+
+   /* Callers may treat the data as a string */
+   data[total] = '\0';
+   *buf        = data;
+   return total;
+
+error:
+   if (out)
+   {
+      filestream_close(out);
+      filestream_delete(optional_filename);
+   }
+   if (member)
+      dir->backend->member_close(member);
+   free(data);
+   file_archive_dir_put(dir);
+   return -1;
+}
+
 /* Generic compressed file loader.
  * Extracts to buf, unless optional_filename != 0
  * Then extracts to optional_filename and leaves buf alone.
@@ -617,8 +1021,12 @@ int file_archive_compressed_read(
    }
 
    backend = file_archive_get_file_backend(str_list->elems[0].data);
-   *length = backend->compressed_file_read(str_list->elems[0].data,
-         str_list->elems[1].data, buf, optional_filename);
+   if (backend && backend->member_open)
+      *length = file_archive_member_read(str_list->elems[0].data,
+            str_list->elems[1].data, buf, optional_filename);
+   else
+      *length = backend->compressed_file_read(str_list->elems[0].data,
+            str_list->elems[1].data, buf, optional_filename);
 
    string_list_free(str_list);
 
@@ -690,64 +1098,204 @@ const struct file_archive_file_backend* file_archive_get_file_backend(const char
  **/
 uint32_t file_archive_get_file_crc32(const char *path)
 {
-   file_archive_transfer_t state;
-   struct archive_extract_userdata userdata        = {0};
-   bool returnerr                                  = false;
-   const char *archive_path                        = NULL;
-   bool contains_compressed = path_contains_compressed_file(path);
+   size_t i;
+   uint32_t crc                  = 0;
+   const char *member            = NULL;
+   file_archive_dir_t *dir       = file_archive_dir_get(path);
 
-   if (contains_compressed)
-   {
-      archive_path = path_get_archive_delim(path);
+   if (!dir)
+      return 0;
 
+   if (path_contains_compressed_file(path))
+   {
       /* move pointer right after the delimiter to give us the path */
-      if (archive_path)
-         archive_path += 1;
+      if ((member = path_get_archive_delim(path)))
+         member += 1;
    }
 
-   state.type              = ARCHIVE_TRANSFER_INIT;
-   state.archive_file      = NULL;
-#ifdef HAVE_MMAP
-   state.archive_mmap_fd   = 0;
-   state.archive_mmap_data = NULL;
-#endif
-   state.archive_size      = 0;
-   state.context           = NULL;
-   state.step_total        = 0;
-   state.step_current      = 0;
-   state.backend           = NULL;
+   for (i = 0; i < dir->count; i++)
+   {
+      /* If no path specified within archive, use the first file. */
+      if (!member || string_is_equal(dir->entries[i].name, member))
+      {
+         crc = dir->entries[i].crc32;
+         break;
+      }
+   }
 
-   /* Initialize and open archive first.
-      Sets next state type to ITERATE. */
-   file_archive_parse_file_iterate(&state,
-            &returnerr, path, NULL, NULL,
-            &userdata);
+   file_archive_dir_put(dir);
 
-   for (;;)
-   {
-      /* Now find the first file in the archive. */
-      if (state.type == ARCHIVE_TRANSFER_ITERATE)
-         file_archive_parse_file_iterate(&state,
-                  &returnerr, path, NULL, NULL,
-                  &userdata);
+   return crc;
+}
 
-      /* If no path specified within archive, stop after
-       * finding the first file.
-       */
-      if (!contains_compressed)
-         break;
+static bool file_archive_stream_rewind_member(file_archive_stream_t *stream)
+{
+   const struct file_archive_file_backend *backend = stream->dir->backend;
+
+   if (stream->member)
+      backend->member_close(stream->member);
+
+   stream->pos    = 0;
+   stream->member = backend->member_open(stream->dir->path, stream->entry);
+
+   return stream->member != NULL;
+}
+
+file_archive_stream_t *file_archive_stream_open(const char *path)
+{
+   size_t i;
+   const char *member            = path_get_archive_delim(path);
+   file_archive_dir_t *dir       = NULL;
+   file_archive_stream_t *stream = NULL;
+
+   if (!member || string_is_empty(member + 1))
+      return NULL;
+   member++;
+
+   if (!(dir = file_archive_dir_get(path)))
+      return NULL;
 
-      /* Stop when the right file in the archive is found. */
-      if (archive_path)
+   if (!(stream = (file_archive_stream_t*)calloc(1, sizeof(*stream))))
+      goto error;
+
+   stream->dir = dir;
+
+   for (i = 0; i < dir->count && !stream->entry; i++)
+      if (string_is_equal(dir->entries[i].name, member))
+         stream->entry = &dir->entries[i];
+   for (i = 0; i < dir->count && !stream->entry; i++)
+      if (string_is_equal_noncase(dir->entries[i].name, member))
+         stream->entry = &dir->entries[i];
+
+   if (!stream->entry)
+      goto error;
+
+   if (dir->backend->member_open)
+   {
+      if (!file_archive_stream_rewind_member(stream))
+         goto error;
+   }
+   else
+   {
+      /* Solid archives have to be decompressed from the
+       * start of the block anyway, extract the member */
+      void *data     = NULL;
+      int64_t length = dir->backend->compressed_file_read(dir->path,
+            stream->entry->name, &data, NULL);
+
+      if (length != (int64_t)stream->entry->size)
       {
-         if (string_is_equal(userdata.current_file_path, archive_path))
-            break;
+         free(data);
+         goto error;
       }
-      else
+
+      stream->data = (uint8_t*)data;
+   }
+
+   return stream;
+
+error:
+   free(stream);
+   file_archive_dir_put(dir);
+   return NULL;
+}
+
+int64_t file_archive_stream_read(file_archive_stream_t *stream,
+      void *data, int64_t len)
+{
+   int64_t ret;
+   int64_t size = stream->entry->size;
+
+   if (len <= 0 || stream->offset >= size)
+      return 0;
+   if (len > size - stream->offset)
+      len = size - stream->offset;
+
+   if (stream->data)
+   {
+      memcpy(data, stream->data + stream->offset, (size_t)len);
+      stream->offset += len;
+      return len;
+   }
+
+   /* Seeks are applied here, so seeking back and forth
+    * without reading costs nothing */
+   if (stream->offset < stream->pos)
+      if (!file_archive_stream_rewind_member(stream))
+         return -1;
+
+   while (stream->pos < stream->offset)
+   {
+      uint8_t skip[ARCHIVE_STREAM_SKIP_SIZE];
+      int64_t count = MIN(stream->offset - stream->pos, (int64_t)sizeof(skip));
+
+      if ((ret = stream->dir->backend->member_read(
+                  stream->member, skip, count)) <= 0)
+         return -1;
+      stream->pos += ret;
+   }
+
+   if ((ret = stream->dir->backend->member_read(
+               stream->member, data, len)) < 0)
+      return -1;
+
+   stream->pos    += ret;
+   stream->offset += ret;
+
+   return ret;
+}
+
+int64_t file_archive_stream_seek(file_archive_stream_t *stream,
+      int64_t offset, int whence)
+{
+   int64_t new_offset;
+
+   switch (whence)
+   {
+      case SEEK_SET:
+         new_offset = offset;
+         break;
+      case SEEK_CUR:
+         new_offset = stream->offset + offset;
          break;
+      case SEEK_END:
+         new_offset = stream->entry->size + offset;
+         break;
+      default:
+         return -1;
    }
 
-   file_archive_parse_file_iterate_stop(&state);
+   if (new_offset < 0)
+      return -1;
+
+   stream->offset = new_offset;
+
+   return 0;
+}
+
+int64_t file_archive_stream_tell(file_archive_stream_t *stream)
+{
+   return stream->offset;
+}
+
+int64_t file_archive_stream_get_size(file_archive_stream_t *stream)
+{
+   return stream->entry->size;
+}
+
+uint32_t file_archive_stream_get_crc32(file_archive_stream_t *stream)
+{
+   return stream->entry->crc32;
+}
+
+void file_archive_stream_close(file_archive_stream_t *stream)
+{
+   if (!stream)
+      return;
 
-   return userdata.crc;
+   if (stream->member)
+      stream->dir->backend->member_close(stream->member);
+   free(stream->data);
+   file_archive_dir_put(stream->dir);
+   free(stream);
 }
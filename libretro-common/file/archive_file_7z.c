@@ -519,5 +519,8 @@ const struct file_archive_file_backend sevenzip_backend = {
    sevenzip_stream_decompress_data_to_file_iterate,
    sevenzip_stream_crc32_calculate,
    sevenzip_file_read,
+   NULL,
+   NULL,
+   NULL,
    "7z"
 };
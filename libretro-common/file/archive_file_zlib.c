@@ -41,12 +41,35 @@
 #define END_OF_CENTRAL_DIR_SIGNATURE 0x06054b50
 #endif
 
+/* Compressed bytes read from the archive at a time
+ * when inflating a member */
+#define ZIP_MEMBER_BUFFER_SIZE 0x10000
+
 enum file_archive_compression_mode
 {
    ZIP_MODE_STORED   = 0,
    ZIP_MODE_DEFLATED = 8
 };
 
+typedef struct
+{
+   RFILE *file;
+   /* NULL for stored members */
+   void *stream;
+   uint32_t cmode;
+   uint32_t csize;
+   uint32_t size;
+   /* Compressed bytes read so far */
+   uint32_t cread;
+   /* Decompressed bytes returned so far */
+   uint32_t written;
+   /* Compressed bytes in buf, and how many of them inflate took */
+   uint32_t in_len;
+   uint32_t in_pos;
+   bool done;
+   uint8_t buf[ZIP_MEMBER_BUFFER_SIZE];
+} zip_member_t;
+
 typedef struct
 {
    struct file_archive_transfer *state;
@@ -510,6 +533,132 @@ static int zip_parse_file_iterate_step(void *context,
    return 1;
 }
 
+static void zip_member_close(void *data)
+{
+   zip_member_t *member = (zip_member_t*)data;
+
+   if (!member)
+      return;
+
+   if (member->stream)
+      zlib_inflate_backend.stream_free(member->stream);
+   if (member->file)
+      filestream_close(member->file);
+   free(member);
+}
+
+static void *zip_member_open(const char *path,
+      const struct file_archive_entry *entry)
+{
+   uint8_t local_header[4];
+   int64_t offset       = (int64_t)(size_t)entry->cdata;
+   zip_member_t *member = NULL;
+
+   if (     entry->cmode != ZIP_MODE_STORED
+         && entry->cmode != ZIP_MODE_DEFLATED)
+      return NULL;
+
+   member = (zip_member_t*)calloc(1, sizeof(*member));
+   if (!member)
+      return NULL;
+
+   member->cmode = entry->cmode;
+   member->csize = entry->csize;
+   member->size  = entry->size;
+   member->file  = filestream_open(path,
+         RETRO_VFS_FILE_ACCESS_READ,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!member->file)
+      goto error;
+
+   /* Skip the local header, its name and
+    * extra field may differ from the directory */
+   filestream_seek(member->file, offset + 26, RETRO_VFS_SEEK_POSITION_START);
+   if (filestream_read(member->file, local_header, 4) != 4)
+      goto error;
+
+   offset += 30 + read_le(local_header, 2) + read_le(local_header + 2, 2);
+   filestream_seek(member->file, offset, RETRO_VFS_SEEK_POSITION_START);
+
+   if (member->cmode == ZIP_MODE_DEFLATED)
+   {
+      member->stream = zlib_inflate_backend.stream_new();
+      if (!member->stream)
+         goto error;
+
+      if (zlib_inflate_backend.define)
+         zlib_inflate_backend.define(member->stream, "window_bits", (uint32_t)-MAX_WBITS);
+   }
+
+   return member;
+
+error:
+   zip_member_close(member);
+   return NULL;
+}
+
+static int64_t zip_member_read(void *data, void *s, int64_t len)
+{
+   zip_member_t *member = (zip_member_t*)data;
+   uint8_t *out         = (uint8_t*)s;
+   int64_t total        = 0;
+
+   if (len > member->size - member->written)
+      len = member->size - member->written;
+
+   if (member->cmode == ZIP_MODE_STORED)
+   {
+      total = filestream_read(member->file, out, len);
+      if (total > 0)
+         member->written += (uint32_t)total;
+      return total;
+   }
+
+   while (total < len && !member->done)
+   {
+      uint32_t rd, wn;
+      bool ok;
+      enum trans_stream_error terror = TRANS_STREAM_ERROR_NONE;
+
+      if (member->in_pos == member->in_len)
+      {
+         int64_t count = MIN(member->csize - member->cread,
+               sizeof(member->buf));
+
+         /* The data ended before the stream did */
+         if (count <= 0)
+            return -1;
+
+         if (filestream_read(member->file, member->buf, count) != count)
+            return -1;
+
+         member->cread += (uint32_t)count;
+         member->in_len = (uint32_t)count;
+         member->in_pos = 0;
+      }
+
+      zlib_inflate_backend.set_in(member->stream,
+            member->buf + member->in_pos, member->in_len - member->in_pos);
+      zlib_inflate_backend.set_out(member->stream,
+            out + total, (uint32_t)MIN(len - total, 0x7fffffff));
+
+      ok = zlib_inflate_backend.trans(member->stream, false,
+            &rd, &wn, &terror);
+
+      if (!ok && terror != TRANS_STREAM_ERROR_BUFFER_FULL)
+         return -1;
+
+      member->in_pos  += rd;
+      member->written += wn;
+      total           += wn;
+
+      if (ok && terror == TRANS_STREAM_ERROR_NONE)
+         member->done  = true;
+   }
+
+   return total;
+}
+
 static void zip_parse_file_free(void *context)
 {
    zip_context_t *zip_context = (zip_context_t *)context;
@@ -525,5 +674,8 @@ const struct file_archive_file_backend zlib_backend = {
    zlib_stream_decompress_data_to_file_iterate,
    zlib_stream_crc32_calculate,
    zip_file_read,
+   zip_member_open,
+   zip_member_read,
+   zip_member_close,
    "zlib"
 };
@@ -31,6 +31,7 @@
 #include <orbisFile.h>
 #endif
 #include <retro_miscellaneous.h>
+#include <array/rhmap.h>
 #include <compat/strl.h>
 #include <compat/posix_string.h>
 #include <compat/fopen_utf8.h>
@@ -140,6 +141,111 @@ static struct config_entry_list* config_file_merge_sort_linked_list(
    return result;
 }
 
+/* Adds 'entry' to the hash index. Entries sharing a
+ * key hash are chained in the order they are added,
+ * which must be list order so that lookups return
+ * the same entry a walk of the list would. */
+static void config_file_index_add(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   uint32_t hash;
+   ptrdiff_t idx;
+   struct config_entry_list *chain = NULL;
+
+   entry->hash_next = NULL;
+
+   if (!entry->key)
+      return;
+
+   hash = hash_string(entry->key);
+   idx  = RHMAP_IDX(conf->entries_map, hash);
+
+   if (idx < 0)
+   {
+      RHMAP_SET(conf->entries_map, hash, entry);
+      return;
+   }
+
+   for (chain = conf->entries_map[idx]; chain->hash_next;
+         chain = chain->hash_next);
+   chain->hash_next = entry;
+}
+
+/* Drops 'entry' from the hash index before its key
+ * is freed. The next entry sharing its hash (e.g. the
+ * same key from an #include) takes its place. */
+static void config_file_index_remove(config_file_t *conf,
+      struct config_entry_list *entry)
+{
+   struct config_entry_list *chain = NULL;
+   uint32_t hash                   = hash_string(entry->key);
+   ptrdiff_t idx                   = RHMAP_IDX(conf->entries_map, hash);
+
+   if (idx < 0)
+      return;
+
+   chain = conf->entries_map[idx];
+
+   if (chain == entry)
+   {
+      if (entry->hash_next)
+         conf->entries_map[idx] = entry->hash_next;
+      else
+         (void)RHMAP_DEL(conf->entries_map, hash);
+   }
+   else
+   {
+      for (; chain->hash_next; chain = chain->hash_next)
+      {
+         if (chain->hash_next == entry)
+         {
+            chain->hash_next = entry->hash_next;
+            break;
+         }
+      }
+   }
+
+   entry->hash_next = NULL;
+}
+
+/* Rebuilds the hash index and tail after the list
+ * has been reordered (prepended to or sorted). */
+static void config_file_index_rebuild(config_file_t *conf)
+{
+   struct config_entry_list *entry = NULL;
+
+   RHMAP_CLEAR(conf->entries_map);
+   conf->tail = NULL;
+
+   for (entry = conf->entries; entry; entry = entry->next)
+   {
+      config_file_index_add(conf, entry);
+      conf->tail = entry;
+   }
+}
+
+static struct config_entry_list *config_file_index_find(
+      const config_file_t *conf, const char *key)
+{
+   struct config_entry_list *entry = NULL;
+   ptrdiff_t idx                   = -1;
+
+   if (!key)
+      return NULL;
+
+   idx = RHMAP_IDX_STR(conf->entries_map, key);
+   if (idx < 0)
+      return NULL;
+
+   for (entry = conf->entries_map[idx]; entry; entry = entry->hash_next)
+   {
+      if (string_is_equal(key, entry->key))
+         return entry;
+   }
+
+   return NULL;
+}
+
 /* Searches input string for a comment ('#') entry
  * > If first character is '#', then entire line is
  *   a comment and may correspond to a directive
@@ -283,6 +389,7 @@ static void config_file_add_child_list(config_file_t *parent, config_file_t *chi
       while (list)
       {
          list->readonly = true;
+         config_file_index_add(parent, list);
          list           = list->next;
       }
       head->next        = child->entries;
@@ -293,6 +400,7 @@ static void config_file_add_child_list(config_file_t *parent, config_file_t *chi
       while (list)
       {
          list->readonly = true;
+         config_file_index_add(parent, list);
          list           = list->next;
       }
       parent->entries   = child->entries;
@@ -404,6 +512,7 @@ static int config_file_load_internal(
       list->key       = NULL;
       list->value     = NULL;
       list->next      = NULL;
+      list->hash_next = NULL;
 
       line            = filestream_getline(file);
 
@@ -423,6 +532,7 @@ static int config_file_load_internal(
             conf->entries    = list;
 
          conf->tail = list;
+         config_file_index_add(conf, list);
 
          if (cb && list->key && list->value)
             cb->config_file_new_entry_cb(list->key, list->value) ;
@@ -614,6 +724,7 @@ static int config_file_from_string_internal(
       list->key       = NULL;
       list->value     = NULL;
       list->next      = NULL;
+      list->hash_next = NULL;
 
       /* Parse current line */
       if (
@@ -626,6 +737,7 @@ static int config_file_from_string_internal(
             conf->entries    = list;
 
          conf->tail          = list;
+         config_file_index_add(conf, list);
       }
 
       if (list != conf->tail)
@@ -698,6 +810,8 @@ bool config_file_deinitialize(config_file_t *conf)
          free(hold);
    }
 
+   RHMAP_FREE(conf->entries_map);
+
    if (conf->reference)
       free(conf->reference);
 
@@ -724,6 +838,9 @@ bool config_append_file(config_file_t *conf, const char *path)
       new_conf->tail->next = conf->entries;
       conf->entries        = new_conf->entries; /* Pilfer. */
       new_conf->entries    = NULL;
+
+      /* The new entries take precedence */
+      config_file_index_rebuild(conf);
    }
 
    config_file_free(new_conf);
@@ -819,6 +936,7 @@ void config_file_initialize(struct config_file *conf)
    conf->entries                  = NULL;
    conf->tail                     = NULL;
    conf->last                     = NULL;
+   conf->entries_map              = NULL;
    conf->reference                = NULL;
    conf->includes                 = NULL;
    conf->include_depth            = 0;
@@ -835,37 +953,10 @@ config_file_t *config_file_new_alloc(void)
    return conf;
 }
 
-static struct config_entry_list *config_get_entry_internal(
-      const config_file_t *conf,
-      const char *key, struct config_entry_list **prev)
-{
-   struct config_entry_list *entry    = NULL;
-   struct config_entry_list *previous = prev ? *prev : NULL;
-
-   for (entry = conf->entries; entry; entry = entry->next)
-   {
-      if (string_is_equal(key, entry->key))
-         return entry;
-
-      previous = entry;
-   }
-
-   if (prev)
-      *prev = previous;
-
-   return NULL;
-}
-
 struct config_entry_list *config_get_entry(
       const config_file_t *conf, const char *key)
 {
-   struct config_entry_list *entry    = NULL;
-   for (entry = conf->entries; entry; entry = entry->next)
-   {
-      if (string_is_equal(key, entry->key))
-         return entry;
-   }
-   return NULL;
+   return config_file_index_find(conf, key);
 }
 
 
@@ -1079,23 +1170,14 @@ bool config_get_bool(config_file_t *conf, const char *key, bool *in)
 
 void config_set_string(config_file_t *conf, const char *key, const char *val)
 {
-   struct config_entry_list *last  = NULL;
    struct config_entry_list *entry = NULL;
 
    if (!conf || !key || !val)
       return;
 
-   last                            = conf->entries;
-
-   if (conf->guaranteed_no_duplicates)
+   if (!conf->guaranteed_no_duplicates)
    {
-      if (conf->last)
-         last                      = conf->last;
-   }
-   else
-   {
-      entry                        = config_get_entry_internal(
-            conf, key, &last);
+      entry                        = config_file_index_find(conf, key);
       if (entry)
       {
          /* An entry corresponding to 'key' already exists
@@ -1131,30 +1213,33 @@ void config_set_string(config_file_t *conf, const char *key, const char *val)
    entry->key       = strdup(key);
    entry->value     = strdup(val);
    entry->next      = NULL;
+   entry->hash_next = NULL;
    conf->modified   = true;
 
-   if (last)
-      last->next    = entry;
+   if (conf->tail)
+      conf->tail->next = entry;
    else
-      conf->entries = entry;
+      conf->entries    = entry;
 
+   conf->tail       = entry;
    conf->last       = entry;
+   config_file_index_add(conf, entry);
 }
 
 void config_unset(config_file_t *conf, const char *key)
 {
-   struct config_entry_list *last  = NULL;
    struct config_entry_list *entry = NULL;
 
    if (!conf || !key)
       return;
 
-   last  = conf->entries;
-   entry = config_get_entry_internal(conf, key, &last);
+   entry = config_file_index_find(conf, key);
 
    if (!entry)
       return;
 
+   config_file_index_remove(conf, entry);
+
    if (entry->key)
       free(entry->key);
 
@@ -1302,6 +1387,7 @@ void config_file_dump_orbis(config_file_t *conf, int fd)
          (struct config_entry_list*)conf->entries,
          config_file_sort_compare_func);
    conf->entries = list;
+   config_file_index_rebuild(conf);
 
    while (list)
    {
@@ -1344,13 +1430,18 @@ void config_file_dump(config_file_t *conf, FILE *file, bool sort)
    }
 
    if (sort)
-      list = config_file_merge_sort_linked_list(
+   {
+      list          = config_file_merge_sort_linked_list(
             (struct config_entry_list*)conf->entries,
             config_file_sort_compare_func);
-   else
-      list = (struct config_entry_list*)conf->entries;
+      conf->entries = list;
 
-   conf->entries = list;
+      /* Sorting is not stable, which one of several
+       * duplicate keys comes first may have changed */
+      config_file_index_rebuild(conf);
+   }
+   else
+      list          = (struct config_entry_list*)conf->entries;
 
    while (list)
    {
@@ -1374,16 +1465,7 @@ void config_file_dump(config_file_t *conf, FILE *file, bool sort)
 
 bool config_entry_exists(config_file_t *conf, const char *entry)
 {
-   struct config_entry_list *list = conf->entries;
-
-   while (list)
-   {
-      if (string_is_equal(entry, list->key))
-         return true;
-      list = list->next;
-   }
-
-   return false;
+   return config_file_index_find(conf, entry) != NULL;
 }
 
 bool config_get_entry_list_head(config_file_t *conf,
@@ -40,6 +40,7 @@
 
 #ifdef _WIN32
 #include <direct.h>
+#include <encodings/utf.h>
 #else
 #include <unistd.h> /* stat() is defined here */
 #endif
@@ -100,6 +101,56 @@ int32_t path_get_size(const char *path)
    return -1;
 }
 
+bool path_get_size_mtime(const char *path, int64_t *size, int64_t *mtime)
+{
+#if defined(VITA) || defined(PSP) || defined(ORBIS)
+   return false;
+#elif defined(_WIN32)
+   struct _stat64 buf;
+   int ret                   = -1;
+#if defined(LEGACY_WIN32)
+   char *path_local          = NULL;
+#else
+   wchar_t *path_wide        = NULL;
+#endif
+
+   if (!path || !*path)
+      return false;
+
+#if defined(LEGACY_WIN32)
+   path_local                = utf8_to_local_string_alloc(path);
+   if (path_local)
+   {
+      ret                    = _stat64(path_local, &buf);
+      free(path_local);
+   }
+#else
+   path_wide                 = utf8_to_utf16_string_alloc(path);
+   if (path_wide)
+   {
+      ret                    = _wstat64(path_wide, &buf);
+      free(path_wide);
+   }
+#endif
+
+   if (ret != 0)
+      return false;
+
+   *size                     = (int64_t)buf.st_size;
+   *mtime                    = (int64_t)buf.st_mtime;
+   return true;
+#else
+   struct stat buf;
+
+   if (!path || !*path || stat(path, &buf) < 0)
+      return false;
+
+   *size                     = (int64_t)buf.st_size;
+   *mtime                    = (int64_t)buf.st_mtime;
+   return true;
+#endif
+}
+
 /**
  * path_mkdir:
  * @dir                : directory
@@ -28,6 +28,9 @@
 #endif
 
 #include <file/nbio.h>
+#if defined(HAVE_IO_URING)
+#include <file/nbio_uring.h>
+#endif
 
 extern nbio_intf_t nbio_linux;
 extern nbio_intf_t nbio_mmap_unix;
@@ -36,6 +39,9 @@ extern nbio_intf_t nbio_mmap_win32;
 extern nbio_intf_t nbio_orbis;
 #endif
 extern nbio_intf_t nbio_stdio;
+#if defined(HAVE_IO_URING)
+extern nbio_intf_t nbio_uring;
+#endif
 
 #ifndef _XBOX
 #if defined(_WIN32)
@@ -69,6 +75,14 @@ static nbio_intf_t *internal_nbio = &nbio_stdio;
 
 void *nbio_open(const char * filename, unsigned mode)
 {
+#if defined(HAVE_IO_URING)
+   /* io_uring can be missing or blocked at runtime, so it is
+    * picked on open, before any handle exists. Only the first
+    * call probes, and files may be opened on several task
+    * threads at once */
+   if (nbio_uring_available())
+      internal_nbio = &nbio_uring;
+#endif
    return internal_nbio->open(filename, mode);
 }
 
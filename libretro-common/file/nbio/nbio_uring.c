@@ -0,0 +1,748 @@
+/* Copyright  (C) 2010-2020 The KingStation team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (nbio_uring.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <file/nbio.h>
+#include <file/nbio_uring.h>
+
+#if defined(__linux__) && defined(__has_include) && defined(HAVE_THREADS)
+#if __has_include(<linux/io_uring.h>)
+#define NBIO_HAVE_URING
+#endif
+#endif
+
+#ifdef NBIO_HAVE_URING
+#ifndef _GNU_SOURCE
+#define _GNU_SOURCE
+#endif
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+
+#include <unistd.h>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <linux/io_uring.h>
+
+#include <rthreads/rthreads.h>
+
+/* IORING_OP_READ and IORING_OP_WRITE came with this feature
+ * flag, older kernels only have the vectored versions */
+#ifndef IORING_FEAT_RW_CUR_POS
+#undef NBIO_HAVE_URING
+#endif
+#endif
+
+#ifdef NBIO_HAVE_URING
+
+/* Same number on every architecture but alpha */
+#ifndef __NR_io_uring_setup
+#define __NR_io_uring_setup 425
+#endif
+#ifndef __NR_io_uring_enter
+#define __NR_io_uring_enter 426
+#endif
+
+#define NBIO_URING_ENTRIES 256
+
+/* Largest single transfer, the kernel caps them a bit below 2 GB */
+#define NBIO_URING_CHUNK   (1 << 30)
+
+/* The kernel copies cached data while still in io_uring_enter().
+ * Past this size that is handed to its worker threads instead,
+ * so submitting a large file does not block the caller. */
+#define NBIO_URING_ASYNC   (1 << 20)
+
+/* One ring is shared by every handle, so that the kernel gets
+ * all pending requests in one io_uring_enter(). It also completes
+ * them on its own; nothing here spins or starts threads.
+ *
+ * Only one thread at a time sleeps in the kernel. The others wait
+ * on nbio_uring_cond, and nobody else reaps the completion queue
+ * meanwhile: the sleeper could otherwise miss the completion it
+ * waits for. */
+struct nbio_uring_ring
+{
+   unsigned *sq_head;
+   unsigned *sq_tail;
+   unsigned *sq_mask;
+   unsigned *sq_array;
+   unsigned *cq_head;
+   unsigned *cq_tail;
+   unsigned *cq_mask;
+   struct io_uring_sqe *sqes;
+   struct io_uring_cqe *cqes;
+   void *sq_map;
+   void *cq_map;
+   size_t sq_map_size;
+   size_t cq_map_size;
+   size_t sqes_size;
+   unsigned sq_entries;
+   unsigned cq_entries;
+   unsigned queued;   /* in the submission queue, not yet entered */
+   unsigned inflight; /* entered, not yet reaped */
+   unsigned refs;
+   int fd;
+   bool waiting;
+};
+
+static struct nbio_uring_ring nbio_uring_ring;
+/* Created by nbio_uring_locks_init() */
+static slock_t *nbio_uring_lock        = NULL;
+static scond_t *nbio_uring_cond        = NULL;
+static int nbio_uring_state            = -1;
+
+static int io_uring_setup(unsigned entries, struct io_uring_params *p)
+{
+   return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static int io_uring_enter(int fd, unsigned to_submit,
+      unsigned min_complete, unsigned flags)
+{
+   return (int)syscall(__NR_io_uring_enter, fd, to_submit,
+         min_complete, flags, NULL, 0);
+}
+
+static void nbio_uring_teardown(struct nbio_uring_ring *ring)
+{
+   if (ring->sqes && ring->sqes != MAP_FAILED)
+      munmap(ring->sqes, ring->sqes_size);
+   if (ring->cq_map && ring->cq_map != MAP_FAILED
+         && ring->cq_map != ring->sq_map)
+      munmap(ring->cq_map, ring->cq_map_size);
+   if (ring->sq_map && ring->sq_map != MAP_FAILED)
+      munmap(ring->sq_map, ring->sq_map_size);
+   if (ring->fd >= 0)
+      close(ring->fd);
+
+   memset(ring, 0, sizeof(*ring));
+   ring->fd = -1;
+}
+
+static bool nbio_uring_setup(struct nbio_uring_ring *ring)
+{
+   struct io_uring_params p;
+   bool single_map = false;
+
+   memset(ring, 0, sizeof(*ring));
+   memset(&p, 0, sizeof(p));
+
+   ring->fd = io_uring_setup(NBIO_URING_ENTRIES, &p);
+   if (ring->fd < 0)
+   {
+      ring->fd = -1;
+      return false;
+   }
+
+   /* Plain read and write, and completions are never dropped */
+   if (     !(p.features & IORING_FEAT_RW_CUR_POS)
+         || !(p.features & IORING_FEAT_NODROP))
+      goto error;
+
+   ring->sq_map_size = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+   ring->cq_map_size = p.cq_off.cqes
+      + p.cq_entries * sizeof(struct io_uring_cqe);
+   ring->sqes_size   = p.sq_entries * sizeof(struct io_uring_sqe);
+
+#ifdef IORING_FEAT_SINGLE_MMAP
+   if (p.features & IORING_FEAT_SINGLE_MMAP)
+   {
+      single_map = true;
+      if (ring->cq_map_size > ring->sq_map_size)
+         ring->sq_map_size = ring->cq_map_size;
+      ring->cq_map_size = ring->sq_map_size;
+   }
+#endif
+
+   ring->sq_map = mmap(NULL, ring->sq_map_size, PROT_READ | PROT_WRITE,
+         MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_SQ_RING);
+   if (ring->sq_map == MAP_FAILED)
+      goto error;
+
+   if (single_map)
+      ring->cq_map = ring->sq_map;
+   else
+   {
+      ring->cq_map = mmap(NULL, ring->cq_map_size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, ring->fd, IORING_OFF_CQ_RING);
+      if (ring->cq_map == MAP_FAILED)
+         goto error;
+   }
+
+   ring->sqes = (struct io_uring_sqe*)mmap(NULL, ring->sqes_size,
+         PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE,
+         ring->fd, IORING_OFF_SQES);
+   if (ring->sqes == MAP_FAILED)
+      goto error;
+
+   ring->sq_head    = (unsigned*)((char*)ring->sq_map + p.sq_off.head);
+   ring->sq_tail    = (unsigned*)((char*)ring->sq_map + p.sq_off.tail);
+   ring->sq_mask    = (unsigned*)((char*)ring->sq_map + p.sq_off.ring_mask);
+   ring->sq_array   = (unsigned*)((char*)ring->sq_map + p.sq_off.array);
+   ring->cq_head    = (unsigned*)((char*)ring->cq_map + p.cq_off.head);
+   ring->cq_tail    = (unsigned*)((char*)ring->cq_map + p.cq_off.tail);
+   ring->cq_mask    = (unsigned*)((char*)ring->cq_map + p.cq_off.ring_mask);
+   ring->cqes       = (struct io_uring_cqe*)
+      ((char*)ring->cq_map + p.cq_off.cqes);
+   ring->sq_entries = p.sq_entries;
+   ring->cq_entries = p.cq_entries;
+
+   return true;
+
+error:
+   nbio_uring_teardown(ring);
+   return false;
+}
+
+/* Everything below expects nbio_uring_lock to be held. */
+
+/* Hands the queued requests to the kernel. If it refuses them
+ * outright, they fail with its error instead of staying busy. */
+static void nbio_uring_flush(struct nbio_uring_ring *ring)
+{
+   while (ring->queued)
+   {
+      unsigned i;
+      unsigned tail;
+      int ret = io_uring_enter(ring->fd, ring->queued, 0, 0);
+
+      if (ret > 0)
+      {
+         ring->queued   -= ret;
+         ring->inflight += ret;
+         continue;
+      }
+
+      if (ret == 0 || errno == EINTR)
+         continue;
+      /* Out of memory for now, try again on the next poll */
+      if (errno == EAGAIN || errno == EBUSY)
+         return;
+
+      tail = *ring->sq_tail;
+      for (i = tail - ring->queued; i != tail; i++)
+      {
+         struct nbio_uring_op *op = (struct nbio_uring_op*)(uintptr_t)
+            ring->sqes[ring->sq_array[i & *ring->sq_mask]].user_data;
+         if (!op)
+            continue;
+         op->error = -errno;
+         op->busy  = false;
+      }
+      __atomic_store_n(ring->sq_tail, tail - ring->queued, __ATOMIC_RELEASE);
+      ring->queued = 0;
+   }
+}
+
+static struct io_uring_sqe *nbio_uring_get_sqe(struct nbio_uring_ring *ring)
+{
+   unsigned tail;
+   unsigned index;
+   struct io_uring_sqe *sqe;
+
+   if (ring->queued == ring->sq_entries)
+   {
+      nbio_uring_flush(ring);
+      if (ring->queued == ring->sq_entries)
+         return NULL;
+   }
+
+   tail                  = *ring->sq_tail;
+   index                 = tail & *ring->sq_mask;
+   sqe                   = &ring->sqes[index];
+   memset(sqe, 0, sizeof(*sqe));
+   ring->sq_array[index] = index;
+
+   return sqe;
+}
+
+static void nbio_uring_push_sqe(struct nbio_uring_ring *ring)
+{
+   __atomic_store_n(ring->sq_tail, *ring->sq_tail + 1, __ATOMIC_RELEASE);
+   ring->queued++;
+}
+
+/* Queues the next chunk of @op */
+static bool nbio_uring_queue(struct nbio_uring_ring *ring,
+      struct nbio_uring_op *op)
+{
+   size_t left              = op->len - op->done;
+   struct io_uring_sqe *sqe = nbio_uring_get_sqe(ring);
+
+   if (!sqe)
+      return false;
+
+   sqe->opcode    = op->write ? IORING_OP_WRITE : IORING_OP_READ;
+   sqe->fd        = op->fd;
+   sqe->off       = op->offset + op->done;
+   sqe->addr      = (uint64_t)(uintptr_t)((char*)op->buf + op->done);
+   sqe->len       = (unsigned)(left > NBIO_URING_CHUNK
+         ? NBIO_URING_CHUNK : left);
+   sqe->user_data = (uint64_t)(uintptr_t)op;
+#ifdef IOSQE_ASYNC
+   if (sqe->len >= NBIO_URING_ASYNC)
+      sqe->flags  = IOSQE_ASYNC;
+#endif
+   nbio_uring_push_sqe(ring);
+
+   return true;
+}
+
+static void nbio_uring_complete(struct nbio_uring_ring *ring,
+      struct nbio_uring_op *op, int res)
+{
+   if (res > 0)
+   {
+      op->done += res;
+      if (op->done < op->len && !op->canceled)
+      {
+         /* Short transfer, carry on where it stopped */
+         if (nbio_uring_queue(ring, op))
+            return;
+         op->error = -EAGAIN;
+      }
+   }
+   else if ((res == -EAGAIN || res == -EINTR) && !op->canceled)
+   {
+      if (nbio_uring_queue(ring, op))
+         return;
+      op->error = res;
+   }
+   else if (res < 0)
+      op->error = res;
+   else if (op->write)
+      op->error = -EIO;
+
+   /* A read that hits the end early means the file shrank */
+   if (!op->write && !op->error)
+      op->len = op->done;
+
+   op->busy = false;
+}
+
+static void nbio_uring_reap(struct nbio_uring_ring *ring)
+{
+   unsigned head = *ring->cq_head;
+   unsigned tail = __atomic_load_n(ring->cq_tail, __ATOMIC_ACQUIRE);
+
+   for (; head != tail; head++)
+   {
+      struct io_uring_cqe *cqe = &ring->cqes[head & *ring->cq_mask];
+      struct nbio_uring_op *op = (struct nbio_uring_op*)(uintptr_t)
+         cqe->user_data;
+      int res                  = cqe->res;
+
+      ring->inflight--;
+
+      /* Cancel requests carry no operation */
+      if (op)
+         nbio_uring_complete(ring, op, res);
+   }
+
+   __atomic_store_n(ring->cq_head, head, __ATOMIC_RELEASE);
+}
+
+/* Creates the lock and condition on first use. They have no
+ * static initializer, and the first files may be opened on
+ * several threads at once: whichever thread publishes its
+ * lock first wins, the others free theirs. */
+static bool nbio_uring_locks_init(void)
+{
+   slock_t *lock = __atomic_load_n(&nbio_uring_lock, __ATOMIC_ACQUIRE);
+   scond_t *cond = __atomic_load_n(&nbio_uring_cond, __ATOMIC_ACQUIRE);
+
+   if (!lock)
+   {
+      slock_t *fresh = slock_new();
+
+      if (!fresh)
+         return false;
+      if (!__atomic_compare_exchange_n(&nbio_uring_lock, &lock, fresh,
+               false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+         slock_free(fresh);
+   }
+
+   if (!cond)
+   {
+      scond_t *fresh = scond_new();
+
+      if (!fresh)
+         return false;
+      if (!__atomic_compare_exchange_n(&nbio_uring_cond, &cond, fresh,
+               false, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE))
+         scond_free(fresh);
+   }
+
+   return true;
+}
+
+bool nbio_uring_available(void)
+{
+   int state;
+
+   if (!nbio_uring_locks_init())
+      return false;
+
+   slock_lock(nbio_uring_lock);
+   if (nbio_uring_state < 0)
+   {
+      if (nbio_uring_ring.refs)
+         nbio_uring_state = 1;
+      else
+      {
+         struct nbio_uring_ring probe;
+         nbio_uring_state = nbio_uring_setup(&probe) ? 1 : 0;
+         if (nbio_uring_state)
+            nbio_uring_teardown(&probe);
+      }
+   }
+   state = nbio_uring_state;
+   slock_unlock(nbio_uring_lock);
+
+   return state == 1;
+}
+
+bool nbio_uring_acquire(void)
+{
+   bool ret = true;
+
+   if (!nbio_uring_locks_init())
+      return false;
+
+   slock_lock(nbio_uring_lock);
+   if (!nbio_uring_ring.refs && !nbio_uring_setup(&nbio_uring_ring))
+      ret = false;
+   else
+      nbio_uring_ring.refs++;
+   slock_unlock(nbio_uring_lock);
+
+   return ret;
+}
+
+void nbio_uring_release(void)
+{
+   slock_lock(nbio_uring_lock);
+   if (nbio_uring_ring.refs && --nbio_uring_ring.refs == 0)
+      nbio_uring_teardown(&nbio_uring_ring);
+   slock_unlock(nbio_uring_lock);
+}
+
+bool nbio_uring_submit(struct nbio_uring_op *op)
+{
+   struct nbio_uring_ring *ring = &nbio_uring_ring;
+   bool ret                     = false;
+
+   op->done     = 0;
+   op->error    = 0;
+   op->canceled = false;
+
+   if (!op->len)
+   {
+      op->busy = false;
+      return true;
+   }
+
+   slock_lock(nbio_uring_lock);
+   /* Leave room in the completion queue for every request,
+    * including the ones reaping may queue */
+   if (     ring->refs
+         && ring->queued + ring->inflight < ring->cq_entries)
+   {
+      op->busy = true;
+      ret      = nbio_uring_queue(ring, op);
+      if (!ret)
+         op->busy = false;
+   }
+   slock_unlock(nbio_uring_lock);
+
+   return ret;
+}
+
+bool nbio_uring_poll(struct nbio_uring_op *op, bool wait)
+{
+   bool ret;
+   struct nbio_uring_ring *ring = &nbio_uring_ring;
+
+   slock_lock(nbio_uring_lock);
+   for (;;)
+   {
+      nbio_uring_flush(ring);
+      if (!ring->waiting)
+         nbio_uring_reap(ring);
+
+      if (!op->busy || !wait)
+         break;
+
+      if (ring->waiting)
+         scond_wait(nbio_uring_cond, nbio_uring_lock);
+      /* Nothing in the kernel means the flush above failed
+       * for now, try it again */
+      else if (ring->inflight)
+      {
+         ring->waiting = true;
+         slock_unlock(nbio_uring_lock);
+
+         io_uring_enter(ring->fd, 0, 1, IORING_ENTER_GETEVENTS);
+
+         slock_lock(nbio_uring_lock);
+         ring->waiting = false;
+         scond_broadcast(nbio_uring_cond);
+      }
+   }
+   ret = !op->busy;
+   slock_unlock(nbio_uring_lock);
+
+   return ret;
+}
+
+void nbio_uring_cancel(struct nbio_uring_op *op)
+{
+   struct nbio_uring_ring *ring = &nbio_uring_ring;
+
+   slock_lock(nbio_uring_lock);
+   if (op->busy)
+   {
+      struct io_uring_sqe *sqe = NULL;
+
+      op->canceled = true;
+
+      /* The request has to reach the kernel to be found */
+      nbio_uring_flush(ring);
+
+      if (op->busy && (sqe = nbio_uring_get_sqe(ring)))
+      {
+         sqe->opcode = IORING_OP_ASYNC_CANCEL;
+         sqe->fd     = -1;
+         sqe->addr   = (uint64_t)(uintptr_t)op;
+         nbio_uring_push_sqe(ring);
+      }
+   }
+   slock_unlock(nbio_uring_lock);
+
+   nbio_uring_poll(op, true);
+}
+
+struct nbio_uring_t
+{
+   struct nbio_uring_op op;
+   void* ptr;
+   size_t len;
+   unsigned mode;
+   int fd;
+};
+
+/* Used when the ring is full, does the same I/O synchronously */
+static void nbio_uring_begin_sync(struct nbio_uring_t *handle)
+{
+   struct nbio_uring_op *op = &handle->op;
+
+   while (op->done < op->len)
+   {
+      ssize_t ret = op->write
+         ? pwrite(op->fd, (char*)op->buf + op->done,
+               op->len - op->done, op->done)
+         : pread(op->fd, (char*)op->buf + op->done,
+               op->len - op->done, op->done);
+
+      if (ret < 0 && errno == EINTR)
+         continue;
+      if (ret <= 0)
+         break;
+      op->done += ret;
+   }
+
+   op->busy = false;
+}
+
+static void nbio_uring_begin_op(struct nbio_uring_t *handle, bool write)
+{
+   struct nbio_uring_op *op = &handle->op;
+
+   if (op->busy)
+      abort();
+
+   op->buf    = handle->ptr;
+   op->len    = handle->len;
+   op->offset = 0;
+   op->fd     = handle->fd;
+   op->write  = write;
+
+   if (!nbio_uring_submit(op))
+      nbio_uring_begin_sync(handle);
+}
+
+static void *nbio_uring_open(const char * filename, unsigned mode)
+{
+   static const int o_flags[]  =   { O_RDONLY, O_RDWR|O_CREAT|O_TRUNC, O_RDWR, O_RDONLY, O_RDWR|O_CREAT|O_TRUNC };
+
+   struct stat st;
+   struct nbio_uring_t* handle = NULL;
+   int fd                      = open(filename, o_flags[mode]|O_CLOEXEC, 0644);
+   if (fd < 0)
+      return NULL;
+
+   if (fstat(fd, &st) != 0 || !nbio_uring_acquire())
+   {
+      close(fd);
+      return NULL;
+   }
+
+   handle         = (struct nbio_uring_t*)calloc(1, sizeof(*handle));
+   if (!handle)
+      goto error;
+
+   handle->fd     = fd;
+   handle->mode   = mode;
+   handle->len    = (size_t)st.st_size;
+   if (handle->len)
+   {
+      handle->ptr = malloc(handle->len);
+      if (!handle->ptr)
+         goto error;
+   }
+
+   return handle;
+
+error:
+   free(handle);
+   nbio_uring_release();
+   close(fd);
+   return NULL;
+}
+
+static void nbio_uring_begin_read(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (handle)
+      nbio_uring_begin_op(handle, false);
+}
+
+static void nbio_uring_begin_write(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (handle)
+      nbio_uring_begin_op(handle, true);
+}
+
+static bool nbio_uring_iterate(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return false;
+   if (handle->op.busy)
+   {
+      bool wait = handle->mode == BIO_READ || handle->mode == BIO_WRITE;
+      if (!nbio_uring_poll(&handle->op, wait))
+         return false;
+      /* Hand out what was read, not uninitialized memory */
+      if (!handle->op.write && handle->op.done < handle->len)
+         handle->len = handle->op.done;
+   }
+   return true;
+}
+
+static void nbio_uring_resize(void *data, size_t len)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+
+   /* Same rules as the other implementations */
+   if (len < handle->len || handle->op.busy)
+      abort();
+
+   if (ftruncate(handle->fd, len) != 0)
+      abort();
+
+   handle->ptr = realloc(handle->ptr, len);
+   handle->len = len;
+}
+
+static void *nbio_uring_get_ptr(void *data, size_t* len)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return NULL;
+   if (len)
+      *len = handle->len;
+   if (!handle->op.busy)
+      return handle->ptr;
+   return NULL;
+}
+
+static void nbio_uring_cancel_op(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (handle && handle->op.busy)
+      nbio_uring_cancel(&handle->op);
+}
+
+static void nbio_uring_free(void *data)
+{
+   struct nbio_uring_t* handle = (struct nbio_uring_t*)data;
+   if (!handle)
+      return;
+
+   /* The kernel must be done with the buffer */
+   if (handle->op.busy)
+      nbio_uring_cancel(&handle->op);
+
+   nbio_uring_release();
+   close(handle->fd);
+   free(handle->ptr);
+   free(handle);
+}
+
+nbio_intf_t nbio_uring = {
+   nbio_uring_open,
+   nbio_uring_begin_read,
+   nbio_uring_begin_write,
+   nbio_uring_iterate,
+   nbio_uring_resize,
+   nbio_uring_get_ptr,
+   nbio_uring_cancel_op,
+   nbio_uring_free,
+   "nbio_uring",
+};
+#else
+bool nbio_uring_available(void) { return false; }
+bool nbio_uring_acquire(void) { return false; }
+void nbio_uring_release(void) { }
+bool nbio_uring_submit(struct nbio_uring_op *op) { return false; }
+bool nbio_uring_poll(struct nbio_uring_op *op, bool wait) { return true; }
+void nbio_uring_cancel(struct nbio_uring_op *op) { }
+
+nbio_intf_t nbio_uring = {
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   NULL,
+   "nbio_uring",
+};
+
+#endif
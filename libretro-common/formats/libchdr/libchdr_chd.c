@@ -61,6 +61,11 @@
 
 #include <retro_inline.h>
 #include <streams/file_stream.h>
+#include <features/features_cpu.h>
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
 
 #define TRUE 1
 #define FALSE 0
@@ -93,6 +98,8 @@
 
 #define NO_MATCH					(~0)
 
+#define PRECACHE_BATCH_HUNKS		16			/* hunks a precache worker takes at a time */
+
 #ifdef WANT_RAW_DATA_SECTOR
 const uint8_t s_cd_sync_header[12] = { 0x00,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0xff,0x00 };
 #endif
@@ -229,6 +236,8 @@ struct _chd_file
 	UINT32					maxhunk;		/* maximum hunk accessed */
 #endif
    UINT8 *              file_cache; /* cache of underlying file */
+	UINT8 *					hunk_cache;		/* every hunk, decompressed */
+	UINT8					is_clone;		/* map, header and caches belong to another handle */
 };
 
 /***************************************************************************
@@ -252,6 +261,11 @@ static chd_error hunk_read_into_cache(chd_file *chd, UINT32 hunknum);
 #endif
 static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *dest);
 
+/* internal codec management */
+static void *codec_data(chd_file *chd, UINT32 compression);
+static void codecs_init(chd_file *chd);
+static void codecs_free(chd_file *chd);
+
 /* internal map access */
 static chd_error map_read(chd_file *chd);
 
@@ -864,15 +878,6 @@ chd_error chd_open_file(RFILE *file, int mode, chd_file *parent, chd_file **chd)
 			}
 		if (intfnum == ARRAY_SIZE(codec_interfaces))
 			EARLY_EXIT(err = CHDERR_UNSUPPORTED_FORMAT);
-
-#ifdef HAVE_ZLIB
-		/* initialize the codec */
-		if (newchd->codecintf[0]->init != NULL)
-      {
-         err = (*newchd->codecintf[0]->init)(&newchd->zlib_codec_data, newchd->header.hunkbytes);
-         (void)err;
-      }
-#endif
 	}
 	else
 	{
@@ -883,56 +888,14 @@ chd_error chd_open_file(RFILE *file, int mode, chd_file *parent, chd_file **chd)
 			for (i = 0 ; i < ARRAY_SIZE(codec_interfaces) ; i++)
 			{
 				if (codec_interfaces[i].compression == newchd->header.compression[decompnum])
-				{
 					newchd->codecintf[decompnum] = &codec_interfaces[i];
-					if (newchd->codecintf[decompnum] == NULL && newchd->header.compression[decompnum] != 0)
-                    {
-						err = CHDERR_UNSUPPORTED_FORMAT;
-                        (void)err;
-                    }
-
-					/* initialize the codec */
-					if (newchd->codecintf[decompnum]->init != NULL)
-					{
-						void* codec = NULL;
-						switch (newchd->header.compression[decompnum])
-						{
-                     case CHD_CODEC_ZLIB:
-#ifdef HAVE_ZLIB
-								codec = &newchd->zlib_codec_data;
-#endif
-								break;
-
-							case CHD_CODEC_CD_ZLIB:
-#ifdef HAVE_ZLIB
-								codec = &newchd->cdzl_codec_data;
-#endif
-								break;
-
-							case CHD_CODEC_CD_LZMA:
-#ifdef HAVE_7ZIP
-								codec = &newchd->cdlz_codec_data;
-#endif
-								break;
-
-							case CHD_CODEC_CD_FLAC:
-#ifdef HAVE_FLAC
-								codec = &newchd->cdfl_codec_data;
-#endif
-								break;
-						}
-						if (codec != NULL)
-                        {
-							err = (*newchd->codecintf[decompnum]->init)(codec, newchd->header.hunkbytes);
-                            (void)err;
-                        }
-					}
-
-				}
 			}
 		}
 	}
 
+	/* initialize the codecs */
+	codecs_init(newchd);
+
 #if 0
 	/* HACK */
 	if (err != CHDERR_NONE)
@@ -981,6 +944,231 @@ chd_error chd_precache(chd_file *chd)
 }
 
 
+/*-------------------------------------------------
+    chd_clone - open a second handle on a CHD
+    that can decompress on another thread
+-------------------------------------------------*/
+
+chd_error chd_clone(chd_file *chd, chd_file **clone)
+{
+	chd_file *newchd;
+	const char *path;
+
+	if (chd == NULL || chd->cookie != COOKIE_VALUE || clone == NULL)
+		return CHDERR_INVALID_PARAMETER;
+
+	/* reading a parent is not safe from two threads */
+	if (chd->parent != NULL)
+		return CHDERR_NOT_SUPPORTED;
+
+	newchd = (chd_file *)malloc(sizeof(*newchd));
+	if (newchd == NULL)
+		return CHDERR_OUT_OF_MEMORY;
+	memset(newchd, 0, sizeof(*newchd));
+
+	/* share everything that is only read after opening */
+	newchd->cookie     = COOKIE_VALUE;
+	newchd->header     = chd->header;
+	newchd->map        = chd->map;
+	newchd->file_cache = chd->file_cache;
+	newchd->hunk_cache = chd->hunk_cache;
+	newchd->is_clone   = TRUE;
+	memcpy(newchd->codecintf, chd->codecintf, sizeof(newchd->codecintf));
+
+	/* the file position is not, reopen it unless it is in memory */
+	if (newchd->file_cache || newchd->hunk_cache)
+		newchd->file = chd->file;
+	else
+	{
+		path = filestream_get_path(chd->file);
+		if (path != NULL)
+			newchd->file = filestream_open(path,
+					RETRO_VFS_FILE_ACCESS_READ,
+					RETRO_VFS_FILE_ACCESS_HINT_NONE);
+		if (newchd->file == NULL)
+		{
+			free(newchd);
+			return CHDERR_FILE_NOT_FOUND;
+		}
+		newchd->owns_file = TRUE;
+	}
+
+	newchd->compressed = (UINT8 *)malloc(newchd->header.hunkbytes);
+	if (newchd->compressed == NULL)
+	{
+		chd_close(newchd);
+		return CHDERR_OUT_OF_MEMORY;
+	}
+
+	codecs_init(newchd);
+
+	*clone = newchd;
+	return CHDERR_NONE;
+}
+
+/*-------------------------------------------------
+    chd_precache_hunks - decompress every hunk
+    into memory, on several threads
+-------------------------------------------------*/
+
+typedef struct _precache_state precache_state;
+struct _precache_state
+{
+	UINT8 *		dest;		/* decompressed hunks */
+	UINT32		next;		/* next hunk nobody took yet */
+	chd_error	err;		/* first error any worker hit */
+#ifdef HAVE_THREADS
+	slock_t *	lock;
+#endif
+};
+
+typedef struct _precache_worker precache_worker;
+struct _precache_worker
+{
+	precache_state *	state;
+	chd_file *			chd;		/* handle of this worker */
+#ifdef HAVE_THREADS
+	sthread_t *			thread;
+#endif
+};
+
+static void precache_worker_run(void *data)
+{
+	precache_worker *worker = (precache_worker *)data;
+	precache_state *state   = worker->state;
+	chd_file *chd           = worker->chd;
+	UINT32 total            = chd->header.totalhunks;
+
+	for (;;)
+	{
+		UINT32 hunknum, end;
+		chd_error err = CHDERR_NONE;
+
+#ifdef HAVE_THREADS
+		slock_lock(state->lock);
+#endif
+		hunknum      = state->next;
+		end          = MIN(hunknum + PRECACHE_BATCH_HUNKS, total);
+		state->next  = end;
+		if (state->err != CHDERR_NONE)
+			hunknum   = end = total;
+#ifdef HAVE_THREADS
+		slock_unlock(state->lock);
+#endif
+
+		if (hunknum >= total)
+			break;
+
+		for (; hunknum < end && err == CHDERR_NONE; hunknum++)
+			err = hunk_read_into_memory(chd, hunknum,
+					state->dest + (size_t)hunknum * chd->header.hunkbytes);
+
+		if (err != CHDERR_NONE)
+		{
+#ifdef HAVE_THREADS
+			slock_lock(state->lock);
+#endif
+			state->err = err;
+#ifdef HAVE_THREADS
+			slock_unlock(state->lock);
+#endif
+		}
+	}
+}
+
+chd_error chd_precache_hunks(chd_file *chd, unsigned num_threads)
+{
+	unsigned i;
+	UINT64 size;
+	chd_error err;
+	precache_state state;
+	precache_worker *workers;
+
+	if (chd == NULL || chd->cookie != COOKIE_VALUE || chd->is_clone)
+		return CHDERR_INVALID_PARAMETER;
+
+	if (chd->hunk_cache)
+		return CHDERR_NONE;
+
+	/* the workers all read from the file in memory */
+	err = chd_precache(chd);
+	if (err != CHDERR_NONE)
+		return err;
+
+	size = (UINT64)chd->header.totalhunks * chd->header.hunkbytes;
+	if (size == 0 || size != (size_t)size)
+		return CHDERR_OUT_OF_MEMORY;
+
+	if (num_threads == 0)
+		num_threads = cpu_features_get_core_amount();
+	if (num_threads > chd->header.totalhunks / PRECACHE_BATCH_HUNKS)
+		num_threads = chd->header.totalhunks / PRECACHE_BATCH_HUNKS;
+	if (num_threads == 0 || chd->parent != NULL)
+		num_threads = 1;
+#ifndef HAVE_THREADS
+	num_threads = 1;
+#endif
+
+	memset(&state, 0, sizeof(state));
+	state.dest = (UINT8 *)malloc((size_t)size);
+	state.err  = CHDERR_NONE;
+	workers    = (precache_worker *)calloc(num_threads, sizeof(*workers));
+	if (state.dest == NULL || workers == NULL)
+	{
+		free(state.dest);
+		free(workers);
+		return CHDERR_OUT_OF_MEMORY;
+	}
+
+	/* this thread is the first worker, the others get clones */
+	workers[0].state = &state;
+	workers[0].chd   = chd;
+
+#ifdef HAVE_THREADS
+	if (num_threads > 1)
+		state.lock = slock_new();
+
+	for (i = 1; i < num_threads && state.lock != NULL; i++)
+	{
+		workers[i].state = &state;
+		if (chd_clone(chd, &workers[i].chd) != CHDERR_NONE)
+			break;
+		workers[i].thread = sthread_create(precache_worker_run, &workers[i]);
+		if (workers[i].thread == NULL)
+			break;
+	}
+#endif
+
+	precache_worker_run(&workers[0]);
+
+#ifdef HAVE_THREADS
+	for (i = 1; i < num_threads; i++)
+	{
+		if (workers[i].thread != NULL)
+			sthread_join(workers[i].thread);
+		if (workers[i].chd != NULL)
+			chd_close(workers[i].chd);
+	}
+
+	if (state.lock != NULL)
+		slock_free(state.lock);
+#endif
+
+	free(workers);
+
+	if (state.err != CHDERR_NONE)
+	{
+		free(state.dest);
+		return state.err;
+	}
+
+	/* the compressed data is not needed anymore */
+	free(chd->file_cache);
+	chd->file_cache = NULL;
+	chd->hunk_cache = state.dest;
+	return CHDERR_NONE;
+}
+
 /*-------------------------------------------------
     chd_open - open a CHD file by
     filename
@@ -1037,58 +1225,12 @@ void chd_close(chd_file *chd)
 	if (chd == NULL || chd->cookie != COOKIE_VALUE)
 		return;
 
-	/* deinit the codec */
-	if (chd->header.version < 5)
-	{
-#ifdef HAVE_ZLIB
-		if (chd->codecintf[0] != NULL && chd->codecintf[0]->free != NULL)
-			(*chd->codecintf[0]->free)(&chd->zlib_codec_data);
-#endif
-	}
-	else
-	{
-		int i;
-		/* Free the codecs */
-		for (i = 0 ; i < 4 ; i++)
-      {
-         void* codec = NULL;
-         if (!chd->codecintf[i])
-            continue;
-
-         switch (chd->codecintf[i]->compression)
-         {
-            case CHD_CODEC_CD_LZMA:
-#ifdef HAVE_7ZIP
-               codec = &chd->cdlz_codec_data;
-#endif
-               break;
-
-            case CHD_CODEC_ZLIB:
-#ifdef HAVE_ZLIB
-               codec = &chd->zlib_codec_data;
-#endif
-               break;
+	/* deinit the codecs */
+	codecs_free(chd);
 
-            case CHD_CODEC_CD_ZLIB:
-#ifdef HAVE_ZLIB
-               codec = &chd->cdzl_codec_data;
-#endif
-               break;
-
-            case CHD_CODEC_CD_FLAC:
-#ifdef HAVE_FLAC
-               codec = &chd->cdfl_codec_data;
-#endif
-               break;
-         }
-         if (codec)
-            (*chd->codecintf[i]->free)(codec);
-      }
-
-		/* Free the raw map */
-		if (chd->header.rawmap != NULL)
-			free(chd->header.rawmap);
-	}
+	/* free the raw map */
+	if (chd->header.rawmap != NULL && !chd->is_clone)
+		free(chd->header.rawmap);
 
 	/* free the compressed data buffer */
 	if (chd->compressed != NULL)
@@ -1103,7 +1245,7 @@ void chd_close(chd_file *chd)
 #endif
 
 	/* free the hunk map */
-	if (chd->map != NULL)
+	if (chd->map != NULL && !chd->is_clone)
 		free(chd->map);
 
 	/* close the file */
@@ -1114,8 +1256,13 @@ void chd_close(chd_file *chd)
 	if (PRINTF_MAX_HUNK) printf("Max hunk = %d/%d\n", chd->maxhunk, chd->header.totalhunks);
 #endif
 
-   if (chd->file_cache)
-      free(chd->file_cache);
+	if (!chd->is_clone)
+	{
+		if (chd->file_cache)
+			free(chd->file_cache);
+		if (chd->hunk_cache)
+			free(chd->hunk_cache);
+	}
 
 	/* free our memory */
 	free(chd);
@@ -1610,6 +1757,13 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 	if (dest == NULL)
 		return CHDERR_INVALID_PARAMETER;
 
+	/* everything was decompressed up front */
+	if (chd->hunk_cache)
+	{
+		memcpy(dest, chd->hunk_cache + (size_t)hunknum * chd->header.hunkbytes, chd->header.hunkbytes);
+		return CHDERR_NONE;
+	}
+
 	if (chd->header.version < 5)
 	{
 		map_entry *entry = &chd->map[hunknum];
@@ -1719,32 +1873,7 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
                return CHDERR_READ_ERROR;
             if (!chd->codecintf[rawmap[0]])
                return CHDERR_UNSUPPORTED_FORMAT;
-				switch (chd->codecintf[rawmap[0]]->compression)
-				{
-					case CHD_CODEC_CD_LZMA:
-#ifdef HAVE_7ZIP
-						codec = &chd->cdlz_codec_data;
-#endif
-						break;
-
-               case CHD_CODEC_ZLIB:
-#ifdef HAVE_ZLIB
-                  codec = &chd->zlib_codec_data;
-#endif
-                  break;
-
-					case CHD_CODEC_CD_ZLIB:
-#ifdef HAVE_ZLIB
-						codec = &chd->cdzl_codec_data;
-#endif
-						break;
-
-					case CHD_CODEC_CD_FLAC:
-#ifdef HAVE_FLAC
-						codec = &chd->cdfl_codec_data;
-#endif
-						break;
-				}
+				codec = codec_data(chd, chd->codecintf[rawmap[0]]->compression);
 				if (codec==NULL)
 					return CHDERR_CODEC_ERROR;
 				err = (*chd->codecintf[rawmap[0]]->decompress)(codec, compressed_bytes, blocklen, dest, chd->header.hunkbytes);
@@ -1785,6 +1914,87 @@ static chd_error hunk_read_into_memory(chd_file *chd, UINT32 hunknum, UINT8 *des
 	return CHDERR_DECOMPRESSION_ERROR;
 }
 
+/***************************************************************************
+    INTERNAL CODEC MANAGEMENT
+***************************************************************************/
+
+/*-------------------------------------------------
+    codec_data - return the state of the codec
+    for the given compression type, or NULL
+-------------------------------------------------*/
+
+static void *codec_data(chd_file *chd, UINT32 compression)
+{
+	switch (compression)
+	{
+#ifdef HAVE_ZLIB
+		case CHDCOMPRESSION_ZLIB:
+		case CHDCOMPRESSION_ZLIB_PLUS:
+		case CHD_CODEC_ZLIB:
+			return &chd->zlib_codec_data;
+
+		case CHD_CODEC_CD_ZLIB:
+			return &chd->cdzl_codec_data;
+#endif
+
+#ifdef HAVE_7ZIP
+		case CHD_CODEC_CD_LZMA:
+			return &chd->cdlz_codec_data;
+#endif
+
+#ifdef HAVE_FLAC
+		case CHD_CODEC_CD_FLAC:
+			return &chd->cdfl_codec_data;
+#endif
+	}
+
+	return NULL;
+}
+
+/*-------------------------------------------------
+    codecs_init - initialize the codecs found
+    in the header
+-------------------------------------------------*/
+
+static void codecs_init(chd_file *chd)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(chd->codecintf); i++)
+	{
+		void *codec;
+
+		if (chd->codecintf[i] == NULL || chd->codecintf[i]->init == NULL)
+			continue;
+
+		codec = codec_data(chd, chd->codecintf[i]->compression);
+		if (codec != NULL)
+			(*chd->codecintf[i]->init)(codec, chd->header.hunkbytes);
+	}
+}
+
+/*-------------------------------------------------
+    codecs_free - free the codecs found in the
+    header
+-------------------------------------------------*/
+
+static void codecs_free(chd_file *chd)
+{
+	int i;
+
+	for (i = 0; i < ARRAY_SIZE(chd->codecintf); i++)
+	{
+		void *codec;
+
+		if (chd->codecintf[i] == NULL || chd->codecintf[i]->free == NULL)
+			continue;
+
+		codec = codec_data(chd, chd->codecintf[i]->compression);
+		if (codec != NULL)
+			(*chd->codecintf[i]->free)(codec);
+	}
+}
+
 /***************************************************************************
     INTERNAL MAP ACCESS
 ***************************************************************************/
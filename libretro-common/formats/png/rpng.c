@@ -39,6 +39,16 @@
 
 #include "rpng_internal.h"
 
+#if defined(__SSE2__)
+#define RPNG_SIMD
+#define RPNG_SIMD_SSE2
+#include <emmintrin.h>
+#elif (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(__ARM_BIG_ENDIAN) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define RPNG_SIMD
+#define RPNG_SIMD_NEON
+#include <arm_neon.h>
+#endif
+
 enum png_ihdr_color_type
 {
    PNG_IHDR_COLOR_GRAY       = 0,
@@ -413,6 +423,491 @@ static void png_reverse_filter_copy_line_plt(uint32_t *data,
    }
 }
 
+/* Reverse filters
+ * > Each one writes the unfiltered line to 'out'. 'prev' is
+ *   the previous unfiltered line, all zeroes for the first one.
+ * > The SIMD versions of Sub, Average and Paeth work one pixel
+ *   at a time, so they only handle 3 and 4 byte pixels */
+
+static void png_unfilter_sub(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+   for (i = 0; i < bpp; i++)
+      out[i] = in[i];
+   for (i = bpp; i < pitch; i++)
+      out[i] = out[i - bpp] + in[i];
+}
+
+static void png_unfilter_up(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i;
+
+   for (i = 0; i < pitch; i++)
+      out[i] = prev[i] + in[i];
+}
+
+static void png_unfilter_avg(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+   for (i = 0; i < bpp; i++)
+      out[i] = (prev[i] >> 1) + in[i];
+   for (i = bpp; i < pitch; i++)
+      out[i] = ((out[i - bpp] + prev[i]) >> 1) + in[i];
+}
+
+static void png_unfilter_paeth(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+
+   for (i = 0; i < bpp; i++)
+      out[i] = paeth(0, prev[i], 0) + in[i];
+   for (i = bpp; i < pitch; i++)
+      out[i] = paeth(out[i - bpp], prev[i], prev[i - bpp]) + in[i];
+}
+
+#if defined(RPNG_SIMD_SSE2)
+static INLINE __m128i png_sse2_load_px(const uint8_t *p, unsigned bpp)
+{
+   uint32_t v = 0;
+   memcpy(&v, p, bpp);
+   return _mm_cvtsi32_si128((int)v);
+}
+
+static INLINE void png_sse2_store_px(uint8_t *p, __m128i v, unsigned bpp)
+{
+   uint32_t x = (uint32_t)_mm_cvtsi128_si32(v);
+   memcpy(p, &x, bpp);
+}
+
+/* All pixels but the last one are moved 4 bytes at a time,
+ * the byte past a 3 byte pixel is overwritten right after */
+static INLINE void png_unfilter_sub_sse2(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i a = _mm_setzero_si128();
+
+   for (i = 0; i + bpp < pitch; i += bpp)
+   {
+      a = _mm_add_epi8(a, png_sse2_load_px(in + i, 4));
+      png_sse2_store_px(out + i, a, 4);
+   }
+
+   a = _mm_add_epi8(a, png_sse2_load_px(in + i, bpp));
+   png_sse2_store_px(out + i, a, bpp);
+}
+
+static void png_unfilter_up_simd(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i;
+
+   for (i = 0; i + 16 <= pitch; i += 16)
+      _mm_storeu_si128((__m128i*)(out + i), _mm_add_epi8(
+               _mm_loadu_si128((const __m128i*)(in   + i)),
+               _mm_loadu_si128((const __m128i*)(prev + i))));
+
+   png_unfilter_up(out + i, in + i, prev + i, pitch - i);
+}
+
+static INLINE __m128i png_sse2_avg_px(__m128i a, __m128i b, __m128i x)
+{
+   /* _mm_avg_epu8() rounds up, PNG rounds down */
+   __m128i avg = _mm_sub_epi8(_mm_avg_epu8(a, b),
+         _mm_and_si128(_mm_xor_si128(a, b), _mm_set1_epi8(1)));
+   return _mm_add_epi8(avg, x);
+}
+
+static INLINE void png_unfilter_avg_sse2(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i a = _mm_setzero_si128();
+
+   for (i = 0; i + bpp < pitch; i += bpp)
+   {
+      a = png_sse2_avg_px(a, png_sse2_load_px(prev + i, 4),
+            png_sse2_load_px(in + i, 4));
+      png_sse2_store_px(out + i, a, 4);
+   }
+
+   a = png_sse2_avg_px(a, png_sse2_load_px(prev + i, bpp),
+         png_sse2_load_px(in + i, bpp));
+   png_sse2_store_px(out + i, a, bpp);
+}
+
+/* Same predictor choice as paeth(), on 16 bit lanes
+ * > Returns the unfiltered pixel, 'b' is unpacked for
+ *   use as the next 'c' */
+static INLINE __m128i png_sse2_paeth_px(__m128i a, __m128i *b,
+      __m128i c, __m128i x)
+{
+   __m128i pa, pb, pc, smallest, nearest;
+   const __m128i zero = _mm_setzero_si128();
+
+   *b       = _mm_unpacklo_epi8(*b, zero);
+
+   /* p = a + b - c, so |p - a| = |b - c| and so on */
+   pa       = _mm_sub_epi16(*b, c);
+   pb       = _mm_sub_epi16(a, c);
+   pc       = _mm_add_epi16(pa, pb);
+
+   pa       = _mm_max_epi16(pa, _mm_sub_epi16(zero, pa));
+   pb       = _mm_max_epi16(pb, _mm_sub_epi16(zero, pb));
+   pc       = _mm_max_epi16(pc, _mm_sub_epi16(zero, pc));
+
+   smallest = _mm_min_epi16(pc, _mm_min_epi16(pa, pb));
+
+   nearest  = _mm_cmpeq_epi16(smallest, pb);
+   nearest  = _mm_or_si128(_mm_and_si128(nearest, *b),
+         _mm_andnot_si128(nearest, c));
+   pa       = _mm_cmpeq_epi16(smallest, pa);
+   nearest  = _mm_or_si128(_mm_and_si128(pa, a),
+         _mm_andnot_si128(pa, nearest));
+
+   return _mm_add_epi8(_mm_packus_epi16(nearest, nearest), x);
+}
+
+static INLINE void png_unfilter_paeth_sse2(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   __m128i px;
+   __m128i b;
+   const __m128i zero = _mm_setzero_si128();
+   __m128i a          = zero;
+   __m128i c          = zero;
+
+   for (i = 0; i + bpp < pitch; i += bpp)
+   {
+      b  = png_sse2_load_px(prev + i, 4);
+      px = png_sse2_paeth_px(a, &b, c, png_sse2_load_px(in + i, 4));
+      png_sse2_store_px(out + i, px, 4);
+
+      a  = _mm_unpacklo_epi8(px, zero);
+      c  = b;
+   }
+
+   b  = png_sse2_load_px(prev + i, bpp);
+   px = png_sse2_paeth_px(a, &b, c, png_sse2_load_px(in + i, bpp));
+   png_sse2_store_px(out + i, px, bpp);
+}
+
+/* Constant pixel sizes let the compiler turn the
+ * per pixel memcpy() into plain loads and stores */
+static void png_unfilter_sub_simd(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   if (bpp == 4)
+      png_unfilter_sub_sse2(out, in, pitch, 4);
+   else
+      png_unfilter_sub_sse2(out, in, pitch, 3);
+}
+
+static void png_unfilter_avg_simd(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   if (bpp == 4)
+      png_unfilter_avg_sse2(out, in, prev, pitch, 4);
+   else
+      png_unfilter_avg_sse2(out, in, prev, pitch, 3);
+}
+
+static void png_unfilter_paeth_simd(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   if (bpp == 4)
+      png_unfilter_paeth_sse2(out, in, prev, pitch, 4);
+   else
+      png_unfilter_paeth_sse2(out, in, prev, pitch, 3);
+}
+
+/* RGBA bytes to 0xAARRGGBB, four pixels at a time */
+static void png_copy_line_rgba8_simd(uint32_t *data,
+      const uint8_t *decoded, unsigned width)
+{
+   unsigned i;
+   const __m128i ag = _mm_set1_epi32(0xff00ff00);
+   const __m128i lo = _mm_set1_epi32(0x000000ff);
+
+   for (i = 0; i + 4 <= width; i += 4)
+   {
+      __m128i v = _mm_loadu_si128((const __m128i*)(decoded + i * 4));
+
+      v = _mm_or_si128(_mm_or_si128(
+               _mm_and_si128(v, ag),
+               _mm_and_si128(_mm_srli_epi32(v, 16), lo)),
+            _mm_slli_epi32(_mm_and_si128(v, lo), 16));
+      _mm_storeu_si128((__m128i*)(data + i), v);
+   }
+
+   png_reverse_filter_copy_line_rgba(data + i, decoded + i * 4,
+         width - i, 8);
+}
+
+/* RGB bytes to 0xFFRRGGBB, four pixels at a time */
+static void png_copy_line_rgb8_simd(uint32_t *data,
+      const uint8_t *decoded, unsigned width)
+{
+   unsigned i;
+   const __m128i a  = _mm_set1_epi32(0xff000000);
+   const __m128i g  = _mm_set1_epi32(0x0000ff00);
+   const __m128i lo = _mm_set1_epi32(0x000000ff);
+
+   /* Each load reads 16 bytes for 12 bytes of pixels */
+   for (i = 0; i + 6 <= width; i += 4)
+   {
+      __m128i v  = _mm_loadu_si128((const __m128i*)(decoded + i * 3));
+      __m128i p0 = _mm_unpacklo_epi32(v, _mm_srli_si128(v, 3));
+      __m128i p1 = _mm_unpacklo_epi32(_mm_srli_si128(v, 6),
+            _mm_srli_si128(v, 9));
+
+      v = _mm_unpacklo_epi64(p0, p1);
+      v = _mm_or_si128(_mm_or_si128(a, _mm_and_si128(v, g)),
+            _mm_or_si128(
+               _mm_and_si128(_mm_srli_epi32(v, 16), lo),
+               _mm_slli_epi32(_mm_and_si128(v, lo), 16)));
+      _mm_storeu_si128((__m128i*)(data + i), v);
+   }
+
+   png_reverse_filter_copy_line_rgb(data + i, decoded + i * 3,
+         width - i, 8);
+}
+#elif defined(RPNG_SIMD_NEON)
+static INLINE uint8x8_t png_neon_load_px(const uint8_t *p, unsigned bpp)
+{
+   uint32_t v = 0;
+   memcpy(&v, p, bpp);
+   return vreinterpret_u8_u32(vdup_n_u32(v));
+}
+
+static INLINE void png_neon_store_px(uint8_t *p, uint8x8_t v, unsigned bpp)
+{
+   uint32_t x = vget_lane_u32(vreinterpret_u32_u8(v), 0);
+   memcpy(p, &x, bpp);
+}
+
+/* All pixels but the last one are moved 4 bytes at a time,
+ * the byte past a 3 byte pixel is overwritten right after */
+static INLINE void png_unfilter_sub_neon(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   for (i = 0; i + bpp < pitch; i += bpp)
+   {
+      a = vadd_u8(a, png_neon_load_px(in + i, 4));
+      png_neon_store_px(out + i, a, 4);
+   }
+
+   a = vadd_u8(a, png_neon_load_px(in + i, bpp));
+   png_neon_store_px(out + i, a, bpp);
+}
+
+static void png_unfilter_up_simd(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch)
+{
+   unsigned i;
+
+   for (i = 0; i + 16 <= pitch; i += 16)
+      vst1q_u8(out + i, vaddq_u8(vld1q_u8(in + i), vld1q_u8(prev + i)));
+
+   png_unfilter_up(out + i, in + i, prev + i, pitch - i);
+}
+
+static INLINE void png_unfilter_avg_neon(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t a = vdup_n_u8(0);
+
+   /* vhadd rounds down, as PNG does */
+   for (i = 0; i + bpp < pitch; i += bpp)
+   {
+      a = vadd_u8(vhadd_u8(a, png_neon_load_px(prev + i, 4)),
+            png_neon_load_px(in + i, 4));
+      png_neon_store_px(out + i, a, 4);
+   }
+
+   a = vadd_u8(vhadd_u8(a, png_neon_load_px(prev + i, bpp)),
+         png_neon_load_px(in + i, bpp));
+   png_neon_store_px(out + i, a, bpp);
+}
+
+/* Same predictor choice as paeth(), on 16 bit lanes */
+static INLINE uint8x8_t png_neon_paeth_px(uint8x8_t a, uint8x8_t b,
+      uint8x8_t c, uint8x8_t x)
+{
+   uint16x8_t use_a, use_b;
+   uint8x8_t nearest;
+   /* p = a + b - c, so |p - a| = |b - c| and so on */
+   int16x8_t pa  = vreinterpretq_s16_u16(vsubl_u8(b, c));
+   int16x8_t pb  = vreinterpretq_s16_u16(vsubl_u8(a, c));
+   int16x8_t pc  = vabsq_s16(vaddq_s16(pa, pb));
+
+   pa            = vabsq_s16(pa);
+   pb            = vabsq_s16(pb);
+
+   use_a         = vandq_u16(vcleq_s16(pa, pb), vcleq_s16(pa, pc));
+   use_b         = vcleq_s16(pb, pc);
+
+   nearest       = vbsl_u8(vmovn_u16(use_a), a,
+         vbsl_u8(vmovn_u16(use_b), b, c));
+
+   return vadd_u8(nearest, x);
+}
+
+static INLINE void png_unfilter_paeth_neon(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   unsigned i;
+   uint8x8_t b;
+   uint8x8_t a = vdup_n_u8(0);
+   uint8x8_t c = vdup_n_u8(0);
+
+   for (i = 0; i + bpp < pitch; i += bpp)
+   {
+      b = png_neon_load_px(prev + i, 4);
+      a = png_neon_paeth_px(a, b, c, png_neon_load_px(in + i, 4));
+      png_neon_store_px(out + i, a, 4);
+      c = b;
+   }
+
+   b = png_neon_load_px(prev + i, bpp);
+   a = png_neon_paeth_px(a, b, c, png_neon_load_px(in + i, bpp));
+   png_neon_store_px(out + i, a, bpp);
+}
+
+static void png_unfilter_sub_simd(uint8_t *out, const uint8_t *in,
+      unsigned pitch, unsigned bpp)
+{
+   if (bpp == 4)
+      png_unfilter_sub_neon(out, in, pitch, 4);
+   else
+      png_unfilter_sub_neon(out, in, pitch, 3);
+}
+
+static void png_unfilter_avg_simd(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   if (bpp == 4)
+      png_unfilter_avg_neon(out, in, prev, pitch, 4);
+   else
+      png_unfilter_avg_neon(out, in, prev, pitch, 3);
+}
+
+static void png_unfilter_paeth_simd(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp)
+{
+   if (bpp == 4)
+      png_unfilter_paeth_neon(out, in, prev, pitch, 4);
+   else
+      png_unfilter_paeth_neon(out, in, prev, pitch, 3);
+}
+
+/* RGBA bytes to 0xAARRGGBB, sixteen pixels at a time */
+static void png_copy_line_rgba8_simd(uint32_t *data,
+      const uint8_t *decoded, unsigned width)
+{
+   unsigned i;
+
+   for (i = 0; i + 16 <= width; i += 16)
+   {
+      uint8x16x4_t v = vld4q_u8(decoded + i * 4);
+      uint8x16_t r   = v.val[0];
+
+      v.val[0]       = v.val[2];
+      v.val[2]       = r;
+      vst4q_u8((uint8_t*)(data + i), v);
+   }
+
+   png_reverse_filter_copy_line_rgba(data + i, decoded + i * 4,
+         width - i, 8);
+}
+
+/* RGB bytes to 0xFFRRGGBB, sixteen pixels at a time */
+static void png_copy_line_rgb8_simd(uint32_t *data,
+      const uint8_t *decoded, unsigned width)
+{
+   unsigned i;
+
+   for (i = 0; i + 16 <= width; i += 16)
+   {
+      uint8x16x3_t v = vld3q_u8(decoded + i * 3);
+      uint8x16x4_t o;
+
+      o.val[0]       = v.val[2];
+      o.val[1]       = v.val[1];
+      o.val[2]       = v.val[0];
+      o.val[3]       = vdupq_n_u8(0xff);
+      vst4q_u8((uint8_t*)(data + i), o);
+   }
+
+   png_reverse_filter_copy_line_rgb(data + i, decoded + i * 3,
+         width - i, 8);
+}
+#endif
+
+/* Unfilters one line, returns false on an unknown filter type */
+static bool png_reverse_filter_line(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp, unsigned filter)
+{
+   switch (filter)
+   {
+      case PNG_FILTER_NONE:
+         memcpy(out, in, pitch);
+         break;
+      case PNG_FILTER_SUB:
+#ifdef RPNG_SIMD
+         if (bpp == 3 || bpp == 4)
+         {
+            png_unfilter_sub_simd(out, in, pitch, bpp);
+            break;
+         }
+#endif
+         png_unfilter_sub(out, in, pitch, bpp);
+         break;
+      case PNG_FILTER_UP:
+#ifdef RPNG_SIMD
+         png_unfilter_up_simd(out, in, prev, pitch);
+#else
+         png_unfilter_up(out, in, prev, pitch);
+#endif
+         break;
+      case PNG_FILTER_AVERAGE:
+#ifdef RPNG_SIMD
+         if (bpp == 3 || bpp == 4)
+         {
+            png_unfilter_avg_simd(out, in, prev, pitch, bpp);
+            break;
+         }
+#endif
+         png_unfilter_avg(out, in, prev, pitch, bpp);
+         break;
+      case PNG_FILTER_PAETH:
+#ifdef RPNG_SIMD
+         if (bpp == 3 || bpp == 4)
+         {
+            png_unfilter_paeth_simd(out, in, prev, pitch, bpp);
+            break;
+         }
+#endif
+         png_unfilter_paeth(out, in, prev, pitch, bpp);
+         break;
+      default:
+         return false;
+   }
+
+   return true;
+}
+
 static void png_pass_geom(const struct png_ihdr *ihdr,
       unsigned width, unsigned height,
       unsigned *bpp_out, unsigned *pitch_out, size_t *pass_size)
@@ -558,46 +1053,12 @@ error:
 static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *ihdr,
       struct rpng_process *pngp, unsigned filter)
 {
-   unsigned i;
-
-   switch (filter)
-   {
-      case PNG_FILTER_NONE:
-         memcpy(pngp->decoded_scanline, pngp->inflate_buf, pngp->pitch);
-         break;
-      case PNG_FILTER_SUB:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->decoded_scanline[i - pngp->bpp] + pngp->inflate_buf[i];
-         break;
-      case PNG_FILTER_UP:
-         for (i = 0; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = pngp->prev_scanline[i] + pngp->inflate_buf[i];
-         break;
-      case PNG_FILTER_AVERAGE:
-         for (i = 0; i < pngp->bpp; i++)
-         {
-            uint8_t avg = pngp->prev_scanline[i] >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-         {
-            uint8_t avg = (pngp->decoded_scanline[i - pngp->bpp] + pngp->prev_scanline[i]) >> 1;
-            pngp->decoded_scanline[i] = avg + pngp->inflate_buf[i];
-         }
-         break;
-      case PNG_FILTER_PAETH:
-         for (i = 0; i < pngp->bpp; i++)
-            pngp->decoded_scanline[i] = paeth(0, pngp->prev_scanline[i], 0) + pngp->inflate_buf[i];
-         for (i = pngp->bpp; i < pngp->pitch; i++)
-            pngp->decoded_scanline[i] = paeth(pngp->decoded_scanline[i - pngp->bpp],
-                  pngp->prev_scanline[i], pngp->prev_scanline[i - pngp->bpp]) + pngp->inflate_buf[i];
-         break;
+   uint8_t *tmp = NULL;
 
-      default:
-         return IMAGE_PROCESS_ERROR_END;
-   }
+   if (!png_reverse_filter_line(pngp->decoded_scanline,
+            pngp->inflate_buf, pngp->prev_scanline,
+            pngp->pitch, pngp->bpp, filter))
+      return IMAGE_PROCESS_ERROR_END;
 
    switch (ihdr->color_type)
    {
@@ -605,6 +1066,13 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
          png_reverse_filter_copy_line_bw(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
          break;
       case PNG_IHDR_COLOR_RGB:
+#ifdef RPNG_SIMD
+         if (ihdr->depth == 8)
+         {
+            png_copy_line_rgb8_simd(data, pngp->decoded_scanline, ihdr->width);
+            break;
+         }
+#endif
          png_reverse_filter_copy_line_rgb(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
          break;
       case PNG_IHDR_COLOR_PLT:
@@ -616,11 +1084,21 @@ static int png_reverse_filter_copy_line(uint32_t *data, const struct png_ihdr *i
                ihdr->depth);
          break;
       case PNG_IHDR_COLOR_RGBA:
+#ifdef RPNG_SIMD
+         if (ihdr->depth == 8)
+         {
+            png_copy_line_rgba8_simd(data, pngp->decoded_scanline, ihdr->width);
+            break;
+         }
+#endif
          png_reverse_filter_copy_line_rgba(data, pngp->decoded_scanline, ihdr->width, ihdr->depth);
          break;
    }
 
-   memcpy(pngp->prev_scanline, pngp->decoded_scanline, pngp->pitch);
+   /* This line is the previous one for the next line */
+   tmp                    = pngp->prev_scanline;
+   pngp->prev_scanline    = pngp->decoded_scanline;
+   pngp->decoded_scanline = tmp;
 
    return IMAGE_PROCESS_NEXT;
 }
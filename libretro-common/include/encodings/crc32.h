@@ -30,6 +30,7 @@
 
 RETRO_BEGIN_DECLS
 
+void encoding_crc32_init_simd(uint64_t cpu_features);
 uint32_t encoding_crc32(uint32_t crc, const uint8_t *buf, size_t len);
 uint32_t file_crc32(uint32_t crc, const char *path);
 
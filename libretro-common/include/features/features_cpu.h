@@ -59,6 +59,20 @@ retro_time_t cpu_features_get_time_usec(void);
  **/
 uint64_t cpu_features_get(void);
 
+/* CPU features with no RETRO_SIMD_* flag in libretro.h, only
+ * meant for libretro-common and the frontend */
+#define CPU_FEATURES_PCLMUL (1 << 0) /* PCLMULQDQ and SSE2 */
+#define CPU_FEATURES_CRC32  (1 << 1) /* ARMv8 CRC32 instructions */
+
+/**
+ * cpu_features_get_extra:
+ *
+ * Gets the CPU features libretro.h has no flag for.
+ *
+ * Returns: bitmask of CPU_FEATURES_* available.
+ **/
+uint64_t cpu_features_get_extra(void);
+
 /**
  * cpu_features_get_core_amount:
  *
@@ -104,6 +104,24 @@ struct archive_extract_userdata
    bool list_only;
 };
 
+/* Archive directories the frontend remembers,
+ * see file_archive_cache_init() */
+#define FILE_ARCHIVE_CACHE_DEFAULT_SIZE 8
+
+/* A member of an archive, as its directory describes it */
+struct file_archive_entry
+{
+   char *name;
+   /* Where the backend finds the member, see file_archive_file_cb */
+   const uint8_t *cdata;
+   uint32_t csize;
+   uint32_t size;
+   uint32_t crc32;
+   unsigned cmode;
+};
+
+typedef struct file_archive_stream file_archive_stream_t;
+
 /* Returns true when parsing should continue. False to stop. */
 typedef int (*file_archive_file_cb)(const char *name, const char *valid_exts,
       const uint8_t *cdata, unsigned cmode, uint32_t csize, uint32_t size,
@@ -132,6 +150,14 @@ struct file_archive_file_backend
    uint32_t (*stream_crc_calculate)(uint32_t, const uint8_t *, size_t);
    int64_t (*compressed_file_read)(const char *path, const char *needle, void **buf,
          const char *optional_outfile);
+
+   /* (Optional) Reads a member as it is decompressed,
+    * instead of extracting all of it first */
+   void *   (*member_open)(const char *path,
+         const struct file_archive_entry *entry);
+   int64_t  (*member_read)(void *member, void *data, int64_t len);
+   void     (*member_close)(void *member);
+
    const char *ident;
 };
 
@@ -204,6 +230,50 @@ const struct file_archive_file_backend* file_archive_get_file_backend(const char
  **/
 uint32_t file_archive_get_file_crc32(const char *path);
 
+/**
+ * file_archive_cache_init:
+ * @size                         : number of archives to remember.
+ *
+ * Remembers the directories of the last @size archives that were
+ * listed or read from, so listing an archive and then looking up
+ * each of its members parses the archive only once. An archive
+ * whose size or modification time changes is parsed again.
+ *
+ * Without calling this, every call parses the archive.
+ **/
+void file_archive_cache_init(unsigned size);
+
+void file_archive_cache_deinit(void);
+
+/**
+ * file_archive_stream_open:
+ * @path                         : archive path with the member after
+ *                                 the delimiter, archive.zip#member.
+ *
+ * Opens a member of an archive for reading. Members of ZIP files are
+ * inflated as they are read, other members are extracted to memory.
+ * Seeking backwards starts decompressing over.
+ *
+ * Returns: the stream, or NULL if the member was not found.
+ **/
+file_archive_stream_t *file_archive_stream_open(const char *path);
+
+int64_t file_archive_stream_read(file_archive_stream_t *stream,
+      void *data, int64_t len);
+
+/* @whence is SEEK_SET, SEEK_CUR or SEEK_END.
+ * Returns 0 on success, -1 on error. */
+int64_t file_archive_stream_seek(file_archive_stream_t *stream,
+      int64_t offset, int whence);
+
+int64_t file_archive_stream_tell(file_archive_stream_t *stream);
+
+int64_t file_archive_stream_get_size(file_archive_stream_t *stream);
+
+uint32_t file_archive_stream_get_crc32(file_archive_stream_t *stream);
+
+void file_archive_stream_close(file_archive_stream_t *stream);
+
 extern const struct file_archive_file_backend zlib_backend;
 extern const struct file_archive_file_backend sevenzip_backend;
 
@@ -58,6 +58,10 @@ struct config_file
    struct config_entry_list *entries;
    struct config_entry_list *tail;
    struct config_entry_list *last;
+   /* Hash index into 'entries', see array/rhmap.h.
+    * Maps each key hash to the first entry with it,
+    * the others follow through 'hash_next'. */
+   struct config_entry_list **entries_map;
    struct config_include_list *includes;
    unsigned include_depth;
    bool guaranteed_no_duplicates;
@@ -126,6 +130,8 @@ struct config_entry_list
    char *key;
    char *value;
    struct config_entry_list *next;
+   /* Next entry in the list with the same key hash */
+   struct config_entry_list *hash_next;
    /* If we got this from an #include,
     * do not allow overwrite. */
    bool readonly;
@@ -530,6 +530,20 @@ bool path_is_valid(const char *path);
 
 int32_t path_get_size(const char *path);
 
+/**
+ * path_get_size_mtime:
+ * @path               : path
+ * @size               : returns the size of the file in bytes
+ * @mtime              : returns the last modification time
+ *
+ * Unlike path_get_size(), works on files larger than 2 GiB.
+ * Bypasses the VFS interface, which has no modification times.
+ *
+ * Returns: true (1) on success, false (0) if the file cannot be
+ * stat'ed or the platform does not report modification times.
+ */
+bool path_get_size_mtime(const char *path, int64_t *size, int64_t *mtime);
+
 bool is_path_accessible_using_standard_io(const char *path);
 
 RETRO_END_DECLS
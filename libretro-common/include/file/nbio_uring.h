@@ -0,0 +1,86 @@
+/* Copyright  (C) 2010-2020 The KingStation team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (nbio_uring.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_NBIO_URING_H
+#define __LIBRETRO_SDK_NBIO_URING_H
+
+#include <stddef.h>
+#include <stdint.h>
+#include <boolean.h>
+
+#include <retro_common_api.h>
+
+RETRO_BEGIN_DECLS
+
+/* One read or write of a whole buffer through the shared io_uring
+ * instance. The caller owns the structure and must keep it alive
+ * until the operation is no longer busy. */
+struct nbio_uring_op
+{
+   void *buf;
+   size_t len;
+   size_t done;
+   uint64_t offset;
+   int fd;
+   int error;   /* negative errno, or 0 */
+   bool write;
+   bool busy;
+   bool canceled;
+};
+
+/*
+ * Returns true if the kernel supports io_uring and it
+ * is not blocked, e.g. by a seccomp filter.
+ */
+bool nbio_uring_available(void);
+
+/*
+ * Takes a reference to the shared ring, creating it on first use.
+ * Every successful call must be matched by nbio_uring_release().
+ */
+bool nbio_uring_acquire(void);
+
+void nbio_uring_release(void);
+
+/*
+ * Queues @op, which must not be busy. Submissions are batched:
+ * queued operations are handed to the kernel together on the next
+ * nbio_uring_poll() on any operation. Returns false if the ring
+ * is full, the caller should then do the I/O itself.
+ */
+bool nbio_uring_submit(struct nbio_uring_op *op);
+
+/*
+ * Collects finished operations. Returns true once @op is no longer
+ * busy. If @wait is set, sleeps in the kernel until it is.
+ */
+bool nbio_uring_poll(struct nbio_uring_op *op, bool wait);
+
+/*
+ * Asks the kernel to stop @op and waits until it is no longer busy.
+ * Data already transferred stays transferred.
+ */
+void nbio_uring_cancel(struct nbio_uring_op *op);
+
+RETRO_END_DECLS
+
+#endif
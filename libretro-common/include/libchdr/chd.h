@@ -356,6 +356,15 @@ chd_error chd_open(const char *filename, int mode, chd_file *parent, chd_file **
 /* precache underlying file */
 chd_error chd_precache(chd_file *chd);
 
+/* decompress every hunk into memory on num_threads threads, 0 for one per core;
+   holds the whole image decompressed, so it is left to cores that keep a disc
+   open and is not used by chdstream */
+chd_error chd_precache_hunks(chd_file *chd, unsigned num_threads);
+
+/* open a second handle sharing the map, with its own codecs and file position,
+   so hunks can be read on another thread; close it before the original */
+chd_error chd_clone(chd_file *chd, chd_file **clone);
+
 /* close a CHD file */
 void chd_close(chd_file *chd);
 
@@ -0,0 +1,80 @@
+/* Copyright  (C) 2010-2020 The KingStation team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_queue.h).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#ifndef __LIBRETRO_SDK_SPSC_QUEUE_H
+#define __LIBRETRO_SDK_SPSC_QUEUE_H
+
+#include <stdint.h>
+#include <stddef.h>
+
+#include <retro_common_api.h>
+#include <boolean.h>
+
+RETRO_BEGIN_DECLS
+
+/* Lock-free ring buffer for exactly one producer and one consumer
+ * thread. The producer only ever moves 'write', the consumer only
+ * ever moves 'read'; both are free-running byte counts, so the
+ * buffer can be filled up completely. Anything else is up to the
+ * caller - waking up the other side has to be done separately. */
+struct spsc_queue
+{
+   uint8_t *buffer;
+   size_t size;
+   size_t mask;
+   size_t read;
+   size_t write;
+};
+
+typedef struct spsc_queue spsc_queue_t;
+
+/**
+ * spsc_queue_initialize:
+ * @queue              : queue to set up
+ * @size               : capacity in bytes, rounded up to a power of two
+ *
+ * Returns: true on success, false if out of memory.
+ **/
+bool spsc_queue_initialize(spsc_queue_t *queue, size_t size);
+
+void spsc_queue_deinitialize(spsc_queue_t *queue);
+
+/* Either side may ask; the answer is only a lower bound
+ * for its own operation, as the other side keeps going. */
+size_t spsc_queue_read_avail(spsc_queue_t *queue);
+
+size_t spsc_queue_write_avail(spsc_queue_t *queue);
+
+/* Producer only. Returns how many bytes fit, which may be less
+ * than @len when the queue is (almost) full. */
+size_t spsc_queue_write(spsc_queue_t *queue, const void *data, size_t len);
+
+/* Consumer only. Returns how many bytes were read,
+ * which may be less than @len. */
+size_t spsc_queue_read(spsc_queue_t *queue, void *data, size_t len);
+
+/* Consumer only. Drops everything queued so far. */
+void spsc_queue_clear(spsc_queue_t *queue);
+
+RETRO_END_DECLS
+
+#endif
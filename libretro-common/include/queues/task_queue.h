@@ -28,6 +28,7 @@
 #include <boolean.h>
 
 #include <retro_common.h>
+#include <rthreads/tpool.h>
 #include <retro_common_api.h>
 
 #include <libretro.h>
@@ -44,6 +45,20 @@ enum task_type
    TASK_TYPE_BLOCKING
 };
 
+/* Which tasks the threaded queue runs first. Within
+ * a priority, tasks take turns. */
+enum task_priority
+{
+   /* Something on screen is waiting for the task,
+    * e.g. a thumbnail */
+   TASK_PRIORITY_INTERACTIVE = 0,
+   TASK_PRIORITY_NORMAL,
+   /* Long jobs nobody is waiting for,
+    * e.g. scanning content or updating cores */
+   TASK_PRIORITY_BACKGROUND,
+   TASK_PRIORITY_LAST
+};
+
 typedef struct retro_task retro_task_t;
 typedef void (*retro_task_callback_t)(retro_task_t *task,
       void *task_data,
@@ -107,6 +122,8 @@ struct retro_task
    /* don't touch this. */
    retro_task_t *next;
 
+   enum task_priority priority;
+
    /* -1 = unmetered/indeterminate, 0-100 = current progress percentage */
    int8_t progress;
 
@@ -130,6 +147,17 @@ struct retro_task
 
    /* if true no OSD messages will be displayed. */
    bool mute;
+
+   /* if true the threaded task queue may run this task
+    * while other tasks with the same handler that set it
+    * too are running, see task_queue_set_concurrency().
+    * Set it when the handler keeps all of its state in
+    * the task. */
+   bool reentrant;
+
+   /* don't touch this, set while a worker
+    * thread runs the handler. */
+   bool running;
 };
 
 typedef struct task_finder_data
@@ -244,6 +272,31 @@ void task_queue_reset(void);
  * the moment will stay on hold */
 void task_queue_deinit(void);
 
+/* Sets how many tasks the threaded task queue runs at
+ * once on its thread pool, and how many tasks of each
+ * priority may run at once. A limit of 0 means no limit
+ * other than 'num_workers', 'limits' may be NULL for none.
+ *
+ * Two tasks with the same handler never run at the same
+ * time, so handlers need no more locking than they did
+ * with a single worker, unless both tasks are marked
+ * 'reentrant'.
+ *
+ * Takes effect the next time the threaded queue
+ * is initialized. Defaults to one task at a time. */
+void task_queue_set_concurrency(unsigned num_workers,
+      const unsigned *limits);
+
+/* Sets the thread pool the threaded task queue runs tasks
+ * on, so they share the threads with the rest of the
+ * program's work. The pool must outlive the queue. With no
+ * pool the queue creates one of its own, with a thread per
+ * task that may run at once.
+ *
+ * Takes effect the next time the threaded queue
+ * is initialized. */
+void task_queue_set_thread_pool(tpool_t *pool);
+
 /* Initializes the task system.
  * This initializes the task system
  * and chooses an appropriate
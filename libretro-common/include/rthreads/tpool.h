@@ -40,6 +40,9 @@ RETRO_BEGIN_DECLS
 struct tpool;
 typedef struct tpool tpool_t;
 
+struct tpool_group;
+typedef struct tpool_group tpool_group_t;
+
 /** 
  * (*thread_func_t):
  * @arg           : Argument.
@@ -51,9 +54,10 @@ typedef void (*thread_func_t)(void *arg);
 /**
  * tpool_create:
  * @num           : Number of threads the pool should have.
- *                  If 0 defaults to 2.
+ *                  If 0 defaults to tpool_get_default_size().
  *
- * Create a thread pool.
+ * Create a thread pool. Every thread has its own queue of work
+ * and takes work from the others when its own queue is empty.
  * 
  * Returns: pool.
  */
@@ -91,6 +95,82 @@ bool tpool_add_work(tpool_t *tp, thread_func_t func, void *arg);
  */
 void tpool_wait(tpool_t *tp);
 
+/**
+ * tpool_get_default_size:
+ *
+ * Returns: number of CPU cores the process is allowed to run on.
+ **/
+size_t tpool_get_default_size(void);
+
+/**
+ * tpool_get_num_threads:
+ * @tp         : Thread pool.
+ *
+ * Returns: number of threads in the pool.
+ **/
+size_t tpool_get_num_threads(tpool_t *tp);
+
+/**
+ * tpool_group_new:
+ *
+ * Creates a group to track a batch of work added to a pool,
+ * so it can be waited for without waiting for the rest of
+ * the work in the pool.
+ *
+ * Returns: group, or NULL on allocation failure.
+ **/
+tpool_group_t *tpool_group_new(void);
+
+/**
+ * tpool_group_free:
+ * @group      : Group.
+ *
+ * Frees a group. No work of the group may be outstanding.
+ **/
+void tpool_group_free(tpool_group_t *group);
+
+/**
+ * tpool_group_add_work:
+ * @tp         : Thread pool.
+ * @group      : Group the work belongs to, or NULL.
+ * @func       : Function the pool should call.
+ * @arg        : Argument to pass to func.
+ *
+ * Adds work to a thread pool as part of @group.
+ *
+ * Returns: true if work was added, otherwise false.
+ **/
+bool tpool_group_add_work(tpool_t *tp, tpool_group_t *group,
+      thread_func_t func, void *arg);
+
+/**
+ * tpool_group_add_work_last:
+ * @tp         : Thread pool.
+ * @group      : Group the work belongs to, or NULL.
+ * @func       : Function the pool should call.
+ * @arg        : Argument to pass to func.
+ *
+ * Like tpool_group_add_work(), but work added from within the
+ * pool goes behind the work the thread already has queued
+ * instead of in front of it. Work that keeps adding itself
+ * back this way does not starve the rest.
+ *
+ * Returns: true if work was added, otherwise false.
+ **/
+bool tpool_group_add_work_last(tpool_t *tp, tpool_group_t *group,
+      thread_func_t func, void *arg);
+
+/**
+ * tpool_group_wait:
+ * @tp         : Thread pool.
+ * @group      : Group.
+ *
+ * Waits for all work of @group to be completed. The calling
+ * thread runs work of the group that no worker has started
+ * yet, so this may also be called from within work of the pool.
+ **/
+void tpool_group_wait(tpool_t *tp, tpool_group_t *group);
+
 RETRO_END_DECLS
 
 #endif
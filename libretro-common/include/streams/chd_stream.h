@@ -39,6 +39,22 @@ typedef struct chdstream chdstream_t;
 /* Primary (largest) data track, used for CRC identification purposes */
 #define CHDSTREAM_TRACK_PRIMARY (-3)
 
+/* Decompressed hunks kept per stream, and how many of them
+ * are decompressed ahead on another thread while reading
+ * sequentially */
+#define CHDSTREAM_DEFAULT_CACHE_HUNKS     16
+#define CHDSTREAM_DEFAULT_READAHEAD_HUNKS 4
+
+/**
+ * chdstream_set_cache:
+ * @cache_hunks       : Decompressed hunks to keep per stream, at least 2.
+ * @readahead_hunks   : Hunks to decompress ahead of sequential reads,
+ *                      0 to do it all on the reading thread.
+ *
+ * Applies to streams opened afterwards.
+ **/
+void chdstream_set_cache(unsigned cache_hunks, unsigned readahead_hunks);
+
 chdstream_t *chdstream_open(const char *path, int32_t track);
 
 void chdstream_close(chdstream_t *stream);
@@ -77,6 +77,10 @@ int filestream_close(RFILE *stream);
 
 int64_t filestream_read_file(const char *path, void **buf, int64_t *len);
 
+void *filestream_read_file_async_begin(const char *path);
+
+int64_t filestream_read_file_async_end(void *data, void **buf, int64_t *len);
+
 char* filestream_gets(RFILE *stream, char *s, size_t len);
 
 int filestream_getc(RFILE *stream);
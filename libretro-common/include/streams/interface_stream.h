@@ -37,7 +37,8 @@ enum intfstream_type
    INTFSTREAM_FILE = 0,
    INTFSTREAM_MEMORY,
    INTFSTREAM_CHD,
-   INTFSTREAM_RZIP
+   INTFSTREAM_RZIP,
+   INTFSTREAM_ARCHIVE
 };
 
 typedef struct intfstream_internal intfstream_internal_t, intfstream_t;
@@ -125,6 +126,11 @@ intfstream_t *intfstream_open_chd_track(const char *path,
 intfstream_t *intfstream_open_rzip_file(const char *path,
       unsigned mode);
 
+/* Opens a member of an archive, archive.zip#member,
+ * decompressing it as it is read. */
+intfstream_t *intfstream_open_archive_member(const char *path,
+      unsigned mode, unsigned hints);
+
 RETRO_END_DECLS
 
 #endif
@@ -31,6 +31,8 @@
 
 RETRO_BEGIN_DECLS
 
+typedef struct libretro_vfs_implementation_read_async libretro_vfs_implementation_read_async;
+
 libretro_vfs_implementation_file *retro_vfs_file_open_impl(const char *path, unsigned mode, unsigned hints);
 
 int retro_vfs_file_close_impl(libretro_vfs_implementation_file *stream);
@@ -57,6 +59,17 @@ int retro_vfs_file_rename_impl(const char *old_path, const char *new_path);
 
 const char *retro_vfs_file_get_path_impl(libretro_vfs_implementation_file *stream);
 
+/* Starts reading the whole file at @path in the background.
+ * Returns NULL if that is not possible here, the file then
+ * has to be read the usual way. */
+libretro_vfs_implementation_read_async *retro_vfs_file_read_async_begin_impl(const char *path);
+
+/* Waits for @async to finish and frees it. Returns 1 on success,
+ * with @buf set to the contents, followed by a NUL byte and to be
+ * freed by the caller, and @len to their size. A NULL @buf cancels
+ * the read instead. */
+int64_t retro_vfs_file_read_async_end_impl(libretro_vfs_implementation_read_async *async, void **buf, int64_t *len);
+
 int retro_vfs_stat_impl(const char *path, int32_t *size);
 
 int retro_vfs_mkdir_impl(const char *dir);
@@ -0,0 +1,163 @@
+/* Copyright  (C) 2010-2020 The KingStation team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (spsc_queue.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+#include <stdlib.h>
+#include <string.h>
+
+#include <retro_inline.h>
+
+#include <queues/spsc_queue.h>
+
+#if defined(_MSC_VER) && !defined(__clang__)
+#include <intrin.h>
+#endif
+
+/* The index owned by the other side has to be read with acquire
+ * semantics, and our own published with release semantics, so the
+ * data copied in or out is visible before the index moves. */
+#if defined(__clang__) || (defined(__GNUC__) && (__GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 7)))
+#define SPSC_LOAD_ACQUIRE(ptr)       __atomic_load_n((ptr), __ATOMIC_ACQUIRE)
+#define SPSC_STORE_RELEASE(ptr, val) __atomic_store_n((ptr), (val), __ATOMIC_RELEASE)
+#else
+static INLINE void spsc_queue_barrier(void)
+{
+#if defined(_MSC_VER)
+#if defined(_M_ARM) || defined(_M_ARM64)
+   __dmb(0xB); /* ISH */
+#else
+   /* x86 keeps stores and loads in order by itself */
+   _ReadWriteBarrier();
+#endif
+#elif defined(__GNUC__)
+   __sync_synchronize();
+#endif
+}
+
+static INLINE size_t spsc_queue_load_acquire(const size_t *ptr)
+{
+   size_t val = *(const volatile size_t*)ptr;
+   spsc_queue_barrier();
+   return val;
+}
+
+static INLINE void spsc_queue_store_release(size_t *ptr, size_t val)
+{
+   spsc_queue_barrier();
+   *(volatile size_t*)ptr = val;
+}
+
+#define SPSC_LOAD_ACQUIRE(ptr)       spsc_queue_load_acquire(ptr)
+#define SPSC_STORE_RELEASE(ptr, val) spsc_queue_store_release((ptr), (val))
+#endif
+
+bool spsc_queue_initialize(spsc_queue_t *queue, size_t size)
+{
+   size_t capacity = 1;
+
+   if (!queue || !size)
+      return false;
+
+   while (capacity < size)
+      capacity <<= 1;
+
+   queue->buffer   = (uint8_t*)calloc(1, capacity);
+   if (!queue->buffer)
+      return false;
+
+   queue->size     = capacity;
+   queue->mask     = capacity - 1;
+   queue->read     = 0;
+   queue->write    = 0;
+
+   return true;
+}
+
+void spsc_queue_deinitialize(spsc_queue_t *queue)
+{
+   if (!queue)
+      return;
+
+   free(queue->buffer);
+   queue->buffer   = NULL;
+   queue->size     = 0;
+   queue->mask     = 0;
+   queue->read     = 0;
+   queue->write    = 0;
+}
+
+size_t spsc_queue_read_avail(spsc_queue_t *queue)
+{
+   return SPSC_LOAD_ACQUIRE(&queue->write)
+      - SPSC_LOAD_ACQUIRE(&queue->read);
+}
+
+size_t spsc_queue_write_avail(spsc_queue_t *queue)
+{
+   return queue->size - spsc_queue_read_avail(queue);
+}
+
+size_t spsc_queue_write(spsc_queue_t *queue, const void *data, size_t len)
+{
+   size_t first;
+   size_t write = queue->write;
+   size_t avail = queue->size - (write - SPSC_LOAD_ACQUIRE(&queue->read));
+   size_t pos   = write & queue->mask;
+
+   if (len > avail)
+      len       = avail;
+
+   first        = queue->size - pos;
+   if (first > len)
+      first     = len;
+
+   memcpy(queue->buffer + pos, data, first);
+   memcpy(queue->buffer, (const uint8_t*)data + first, len - first);
+
+   SPSC_STORE_RELEASE(&queue->write, write + len);
+   return len;
+}
+
+size_t spsc_queue_read(spsc_queue_t *queue, void *data, size_t len)
+{
+   size_t first;
+   size_t read  = queue->read;
+   size_t avail = SPSC_LOAD_ACQUIRE(&queue->write) - read;
+   size_t pos   = read & queue->mask;
+
+   if (len > avail)
+      len       = avail;
+
+   first        = queue->size - pos;
+   if (first > len)
+      first     = len;
+
+   memcpy(data, queue->buffer + pos, first);
+   memcpy((uint8_t*)data + first, queue->buffer, len - first);
+
+   SPSC_STORE_RELEASE(&queue->read, read + len);
+   return len;
+}
+
+void spsc_queue_clear(spsc_queue_t *queue)
+{
+   SPSC_STORE_RELEASE(&queue->read, SPSC_LOAD_ACQUIRE(&queue->write));
+}
@@ -30,6 +30,7 @@
 
 #ifdef HAVE_THREADS
 #include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
 #define SLOCK_LOCK(x) slock_lock(x)
 #define SLOCK_UNLOCK(x) slock_unlock(x)
 #else
@@ -70,10 +71,26 @@ static slock_t *running_lock                = NULL;
 static slock_t *finished_lock               = NULL;
 static slock_t *property_lock               = NULL;
 static slock_t *queue_lock                  = NULL;
-static scond_t *worker_cond                 = NULL;
-static sthread_t *worker_thread             = NULL;
+static tpool_t *worker_pool                 = NULL;
+static tpool_group_t *worker_group          = NULL;
+static bool worker_pool_owned               = false;
 static bool worker_continue                 = true; 
 /* use running_lock when touching it */
+
+/* Work queued on the pool that has not started yet, and
+ * work queued or running, guarded by running_lock */
+static unsigned worker_queued               = 0;
+static unsigned worker_busy                 = 0;
+
+/* Tasks of each priority the workers are running,
+ * guarded by running_lock */
+static unsigned worker_running[TASK_PRIORITY_LAST];
+
+/* See task_queue_set_concurrency() and
+ * task_queue_set_thread_pool() */
+static unsigned worker_max                  = 1;
+static unsigned worker_limits[TASK_PRIORITY_LAST];
+static tpool_t *worker_pool_shared          = NULL;
 #endif
 
 static void task_queue_msg_push(retro_task_t *task,
@@ -322,6 +339,7 @@ static struct retro_task_impl impl_regular = {
 };
 
 #ifdef HAVE_THREADS
+static void threaded_worker_dispatch(void);
 
 /* 'queue_lock' must be held for the duration of this function */
 static void task_queue_remove(task_queue_t *queue, retro_task_t *task)
@@ -371,8 +389,8 @@ static void retro_task_threaded_push_running(retro_task_t *task)
    slock_lock(running_lock);
    slock_lock(queue_lock);
    task_queue_put(&tasks_running, task);
-   scond_signal(worker_cond);
    slock_unlock(queue_lock);
+   threaded_worker_dispatch();
    slock_unlock(running_lock);
 }
 
@@ -400,6 +418,8 @@ static void retro_task_threaded_gather(void)
 
    slock_lock(property_lock);
    slock_lock(running_lock);
+   /* Delayed tasks that are due by now */
+   threaded_worker_dispatch();
    for (task = tasks_running.front; task; task = task->next)
       task_queue_push_progress(task);
 
@@ -467,121 +487,208 @@ static void retro_task_threaded_retrieve(task_retriever_data_t *data)
    slock_unlock(running_lock);
 }
 
-static void threaded_worker(void *userdata)
+/* Whether 'task' may start now: it is not running, its
+ * priority is below its limit and no other task with the
+ * same handler is running, unless both are reentrant.
+ * 'running_lock' must be held. */
+static bool threaded_worker_can_start(retro_task_t *task)
 {
-   (void)userdata;
+   retro_task_t *other = NULL;
 
-   for (;;)
-   {
-      retro_task_t *task  = NULL;
-      bool       finished = false;
+   if (task->running)
+      return false;
 
-      if (!worker_continue)
-         break; /* should we keep running until all tasks finished? */
+   if (     worker_limits[task->priority]
+         && worker_running[task->priority] >= worker_limits[task->priority])
+      return false;
 
-      slock_lock(running_lock);
+   for (other = tasks_running.front; other; other = other->next)
+      if (     other->running
+            && other->handler == task->handler
+            && !(other->reentrant && task->reentrant))
+         return false;
 
-      /* Get first task to run */
-      task = tasks_running.front;
-      if (!task)
-      {
-         scond_wait(worker_cond, running_lock);
-         slock_unlock(running_lock);
-         continue;
-      }
+   return true;
+}
+
+/* Picks the task a worker should run next: the first one
+ * of the most urgent priority that is due and may start.
+ * Counts the tasks that are due and may start in 'ready'
+ * if it is not NULL. 'running_lock' must be held. */
+static retro_task_t *threaded_worker_pick(unsigned *ready)
+{
+   retro_task_t *task = NULL;
+   retro_task_t *best = NULL;
+   retro_time_t now   = 0;
 
+   if (ready)
+      *ready          = 0;
+
+   for (task = tasks_running.front; task; task = task->next)
+   {
       if (task->when)
       {
-         retro_time_t now   = cpu_features_get_time_usec();
-         retro_time_t delay = task->when - now - 500; /* allow half a millisecond for context switching */
-         if (delay > 0)
-         {
-            scond_wait_timeout(worker_cond, running_lock, delay);
-            slock_unlock(running_lock);
-            continue;
-         }
+         if (!now)
+            now = cpu_features_get_time_usec();
+
+         /* allow half a millisecond for context switching;
+          * the queue is sorted by 'when', the rest of it
+          * is due even later */
+         if (task->when - now - 500 > 0)
+            break;
       }
 
+      if (!threaded_worker_can_start(task))
+         continue;
+
+      if (ready)
+         (*ready)++;
+
+      if (!best || task->priority < best->priority)
+         best = task;
+   }
+
+   return best;
+}
+
+static void threaded_worker(void *userdata);
+
+/* Queues work on the pool for the tasks that may start now,
+ * at most 'worker_max' at a time. Tasks that are not due yet
+ * are queued by a later call, which comes after every task
+ * run and from task_queue_check().
+ * 'running_lock' must be held. */
+static void threaded_worker_dispatch(void)
+{
+   unsigned ready = 0;
+
+   if (!worker_continue || !worker_pool || !worker_group)
+      return;
+
+   threaded_worker_pick(&ready);
+
+   while (worker_queued < ready && worker_busy < worker_max)
+   {
+      /* Behind the work already queued, so tasks waiting
+       * for work of their own on the pool let it run */
+      if (!tpool_group_add_work_last(worker_pool, worker_group,
+               threaded_worker, NULL))
+         break;
+
+      worker_queued++;
+      worker_busy++;
+   }
+}
+
+/* Runs the handler of one task once, on the pool */
+static void threaded_worker(void *userdata)
+{
+   retro_task_t *task = NULL;
+   bool finished      = false;
+
+   (void)userdata;
+
+   slock_lock(running_lock);
+
+   worker_queued--;
+
+   if (!worker_continue || !(task = threaded_worker_pick(NULL)))
+   {
+      worker_busy--;
       slock_unlock(running_lock);
+      return;
+   }
 
-      task->handler(task);
+   task->running = true;
+   worker_running[task->priority]++;
 
-      slock_lock(property_lock);
-      finished = task->finished;
-      slock_unlock(property_lock);
+   slock_unlock(running_lock);
 
-      /* Update queue */
-      if (!finished)
-      {
-         /* Move the task to the back of the queue */
-         /* mimics retro_task_threaded_push_running, 
-          * but also includes a task_queue_remove */
-         slock_lock(running_lock);
-         slock_lock(queue_lock);
-
-         /* do nothing if only item in queue */
-         if (task->next) 
-         {
-            task_queue_remove(&tasks_running, task);
-            task_queue_put(&tasks_running, task);
-            scond_signal(worker_cond);
-         }
-         slock_unlock(queue_lock);
-         slock_unlock(running_lock);
-      }
-      else
-      {
-         /* Remove task from running queue */
-         slock_lock(running_lock);
-         slock_lock(queue_lock);
-         task_queue_remove(&tasks_running, task);
-         slock_unlock(queue_lock);
-         slock_unlock(running_lock);
-
-         /* Add task to finished queue */
-         slock_lock(finished_lock);
-         task_queue_put(&tasks_finished, task);
-         slock_unlock(finished_lock);
-      }
+   task->handler(task);
+
+   slock_lock(property_lock);
+   finished = task->finished;
+   slock_unlock(property_lock);
+
+   slock_lock(running_lock);
+   slock_lock(queue_lock);
+
+   task->running = false;
+   worker_running[task->priority]--;
+   worker_busy--;
+
+   /* Move the task to the back of the queue, so the
+    * other tasks of its priority get their turn */
+   task_queue_remove(&tasks_running, task);
+   if (!finished)
+      task_queue_put(&tasks_running, task);
+
+   slock_unlock(queue_lock);
+
+   if (finished)
+   {
+      /* Add task to finished queue */
+      slock_lock(finished_lock);
+      task_queue_put(&tasks_finished, task);
+      slock_unlock(finished_lock);
    }
+
+   /* Its handler and its priority may be free again */
+   threaded_worker_dispatch();
+
+   slock_unlock(running_lock);
 }
 
 static void retro_task_threaded_init(void)
 {
+   unsigned i;
+
    running_lock    = slock_new();
    finished_lock   = slock_new();
    property_lock   = slock_new();
    queue_lock      = slock_new();
-   worker_cond     = scond_new();
 
    slock_lock(running_lock);
    worker_continue = true;
+   worker_queued   = 0;
+   worker_busy     = 0;
+   for (i = 0; i < TASK_PRIORITY_LAST; i++)
+      worker_running[i] = 0;
    slock_unlock(running_lock);
 
-   worker_thread   = sthread_create(threaded_worker, NULL);
+   /* Without a pool to share, the queue gets its own */
+   worker_pool       = worker_pool_shared;
+   worker_pool_owned = !worker_pool;
+   if (worker_pool_owned)
+      worker_pool    = tpool_create(worker_max);
+   worker_group      = tpool_group_new();
 }
 
 static void retro_task_threaded_deinit(void)
 {
    slock_lock(running_lock);
    worker_continue = false;
-   scond_signal(worker_cond);
    slock_unlock(running_lock);
 
-   sthread_join(worker_thread);
+   /* Work that has not started yet returns right away */
+   if (worker_pool && worker_group)
+      tpool_group_wait(worker_pool, worker_group);
+   tpool_group_free(worker_group);
+   if (worker_pool_owned)
+      tpool_destroy(worker_pool);
 
-   scond_free(worker_cond);
    slock_free(running_lock);
    slock_free(finished_lock);
    slock_free(property_lock);
    slock_free(queue_lock);
 
-   worker_thread   = NULL;
-   worker_cond     = NULL;
-   running_lock    = NULL;
-   finished_lock   = NULL;
-   property_lock   = NULL;
-   queue_lock      = NULL;
+   worker_pool       = NULL;
+   worker_group      = NULL;
+   worker_pool_owned = false;
+   running_lock      = NULL;
+   finished_lock     = NULL;
+   property_lock     = NULL;
+   queue_lock        = NULL;
 }
 
 static struct retro_task_impl impl_threaded = {
@@ -627,6 +734,28 @@ void task_queue_init(bool threaded, retro_task_queue_msg_t msg_push)
    impl_current->init();
 }
 
+void task_queue_set_concurrency(unsigned num_workers,
+      const unsigned *limits)
+{
+#ifdef HAVE_THREADS
+   unsigned i;
+
+   worker_max            = num_workers ? num_workers : 1;
+
+   for (i = 0; i < TASK_PRIORITY_LAST; i++)
+      worker_limits[i]   = limits ? limits[i] : 0;
+#endif
+}
+
+void task_queue_set_thread_pool(tpool_t *pool)
+{
+#ifdef HAVE_THREADS
+   worker_pool_shared = pool;
+#else
+   (void)pool;
+#endif
+}
+
 void task_queue_set_threaded(void)
 {
    task_threaded_enable = true;
@@ -900,6 +1029,7 @@ retro_task_t *task_init(void)
    task->finished          = false;
    task->cancelled         = false;
    task->mute              = false;
+   task->reentrant         = false;
    task->task_data         = NULL;
    task->user_data         = NULL;
    task->state             = NULL;
@@ -913,6 +1043,8 @@ retro_task_t *task_init(void)
    task->alternative_look  = false;
    task->next              = NULL;
    task->when              = 0;
+   task->priority          = TASK_PRIORITY_NORMAL;
+   task->running           = false;
 
    return task;
 }
@@ -25,225 +25,439 @@
  * THE SOFTWARE
  */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+#define _GNU_SOURCE /* sched_getaffinity() */
+#endif
+
 #include <stdlib.h>
+#include <string.h>
 #include <boolean.h>
 
+#if defined(__linux__)
+#include <sched.h>
+#endif
+
+#include <features/features_cpu.h>
 #include <rthreads/rthreads.h>
 #include <rthreads/tpool.h>
 
-/* Work object which will sit in a queue
- * waiting for the pool to process it.
+/* Every worker owns a deque of work. The worker takes work
+ * from the back of its own deque, newest first, and when that
+ * is empty steals the oldest work from the front of the others.
+ * Work added from outside the pool is spread over the deques.
  *
- * It is a singly linked list acting as a FIFO queue. */
+ * The counters that decide whether there is anything left to
+ * do, and the groups, are guarded by the pool lock. Each deque
+ * has its own lock, so workers taking work from their own deque
+ * do not contend with each other. */
+
+/* Work object which will sit in a deque
+ * waiting for the pool to process it. */
 struct tpool_work
 {
-   thread_func_t      func;  /* Function to be called. */
-   void              *arg;   /* Data to be passed to func. */
-   struct tpool_work *next;  /* Next work item in the queue. */
+   thread_func_t  func;  /* Function to be called. */
+   void          *arg;   /* Data to be passed to func. */
+   tpool_group_t *group; /* Group the work belongs to, or NULL. */
 };
 typedef struct tpool_work tpool_work_t;
 
+/* Ring buffer of work, 'head' is the oldest entry. */
+struct tpool_deque
+{
+   tpool_work_t *items;
+   slock_t      *lock;
+   size_t        cap;
+   size_t        head;
+   size_t        count;
+};
+
+struct tpool_worker
+{
+   struct tpool_deque deque;
+   tpool_t           *pool;
+   sthread_t         *thread;
+};
+
+struct tpool_group
+{
+   size_t queued;  /* Work of the group waiting in a deque. */
+   size_t running; /* Work of the group being processed. */
+};
+
 struct tpool
 {
-   tpool_work_t    *work_first;   /* First work item in the work queue. */
-   tpool_work_t    *work_last;    /* Last work item in the work queue. */
-   slock_t         *work_mutex;   /* Mutex protecting inserting and removing work from the work queue. */
-   scond_t         *work_cond;    /* Conditional to signal when there is work to process. */
-   scond_t         *working_cond; /* Conditional to signal when there is no work processing.
-                                       This will also signal when there are no threads running. */
-   size_t           working_cnt;  /* The number of threads processing work (Not waiting for work). */
-   size_t           thread_cnt;   /* Total number of threads within the pool. */
-   bool             stop;         /* Marker to tell the work threads to exit. */
+   struct tpool_worker *workers;
+   slock_t             *lock;         /* Guards everything below and all groups. */
+   scond_t             *work_cond;    /* Signaled when work is added or the pool stops. */
+   scond_t             *done_cond;    /* Signaled when work completes. */
+   size_t               queued;       /* Work waiting in a deque. */
+   size_t               working_cnt;  /* Work being processed. */
+   size_t               thread_cnt;   /* Total number of threads within the pool. */
+   size_t               next_deque;   /* Deque for the next work added from outside. */
+   bool                 stop;         /* Marker to tell the work threads to exit. */
 };
 
-static tpool_work_t *tpool_work_create(thread_func_t func, void *arg)
+static bool tpool_deque_reserve(struct tpool_deque *dq)
 {
-   tpool_work_t *work;
+   if (dq->count == dq->cap)
+   {
+      size_t i;
+      size_t cap           = dq->cap ? dq->cap * 2 : 16;
+      tpool_work_t *items  = (tpool_work_t*)malloc(cap * sizeof(*items));
 
-   if (!func)
-      return NULL;
+      if (!items)
+         return false;
 
-   work       = (tpool_work_t*)calloc(1, sizeof(*work));
-   work->func = func;
-   work->arg  = arg;
-   work->next = NULL;
-   return work;
+      for (i = 0; i < dq->count; i++)
+         items[i] = dq->items[(dq->head + i) % dq->cap];
+
+      free(dq->items);
+      dq->items = items;
+      dq->cap   = cap;
+      dq->head  = 0;
+   }
+
+   return true;
 }
 
-static void tpool_work_destroy(tpool_work_t *work)
+static bool tpool_deque_push(struct tpool_deque *dq, const tpool_work_t *work)
 {
-   if (work)
-      free(work);
+   if (!tpool_deque_reserve(dq))
+      return false;
+
+   dq->items[(dq->head + dq->count) % dq->cap] = *work;
+   dq->count++;
+
+   return true;
 }
 
-/* Pull the first work item out of the queue. */
-static tpool_work_t *tpool_work_get(tpool_t *tp)
+/* Behind all other work, for the owner of the deque. */
+static bool tpool_deque_push_front(struct tpool_deque *dq,
+      const tpool_work_t *work)
 {
-   tpool_work_t *work;
+   if (!tpool_deque_reserve(dq))
+      return false;
 
-   if (!tp)
-      return NULL;
+   dq->head            = (dq->head + dq->cap - 1) % dq->cap;
+   dq->items[dq->head] = *work;
+   dq->count++;
 
-   work = tp->work_first;
-   if (!work)
-      return NULL;
+   return true;
+}
+
+/* Newest work, for the owner of the deque. */
+static bool tpool_deque_pop_back(struct tpool_deque *dq, tpool_work_t *work)
+{
+   if (!dq->count)
+      return false;
+
+   dq->count--;
+   *work = dq->items[(dq->head + dq->count) % dq->cap];
+
+   return true;
+}
 
-   if (!work->next)
+/* Oldest work, for other threads. */
+static bool tpool_deque_pop_front(struct tpool_deque *dq, tpool_work_t *work)
+{
+   if (!dq->count)
+      return false;
+
+   *work    = dq->items[dq->head];
+   dq->head = (dq->head + 1) % dq->cap;
+   dq->count--;
+
+   return true;
+}
+
+/* Oldest work of @group. */
+static bool tpool_deque_pop_group(struct tpool_deque *dq,
+      tpool_group_t *group, tpool_work_t *work)
+{
+   size_t i;
+
+   for (i = 0; i < dq->count; i++)
    {
-      tp->work_first = NULL;
-      tp->work_last  = NULL;
+      if (dq->items[(dq->head + i) % dq->cap].group != group)
+         continue;
+
+      *work = dq->items[(dq->head + i) % dq->cap];
+
+      /* Close the gap */
+      for (; i + 1 < dq->count; i++)
+         dq->items[(dq->head + i) % dq->cap] =
+            dq->items[(dq->head + i + 1) % dq->cap];
+      dq->count--;
+
+      return true;
    }
-   else
-      tp->work_first = work->next;
 
-   return work;
+   return false;
+}
+
+/* Returns the worker running on the calling thread, or NULL. */
+static struct tpool_worker *tpool_current_worker(tpool_t *tp)
+{
+   size_t i;
+
+   for (i = 0; i < tp->thread_cnt; i++)
+      if (tp->workers[i].thread && sthread_isself(tp->workers[i].thread))
+         return &tp->workers[i];
+
+   return NULL;
+}
+
+/* Marks @work as taken out of its deque. */
+static void tpool_work_taken(tpool_t *tp, const tpool_work_t *work)
+{
+   slock_lock(tp->lock);
+   tp->queued--;
+   tp->working_cnt++;
+   if (work->group)
+   {
+      work->group->queued--;
+      work->group->running++;
+   }
+   slock_unlock(tp->lock);
+}
+
+static void tpool_work_run(tpool_t *tp, const tpool_work_t *work)
+{
+   work->func(work->arg);
+
+   slock_lock(tp->lock);
+   tp->working_cnt--;
+   if (work->group)
+      work->group->running--;
+   scond_broadcast(tp->done_cond);
+   slock_unlock(tp->lock);
+}
+
+/* Takes work from the deque of @self, or failing that
+ * steals it from another worker, starting with the next one. */
+static bool tpool_work_get(tpool_t *tp, struct tpool_worker *self,
+      tpool_work_t *work)
+{
+   size_t i;
+   size_t first = self ? (size_t)(self - tp->workers) : 0;
+   bool found   = false;
+
+   if (self)
+   {
+      slock_lock(self->deque.lock);
+      found = tpool_deque_pop_back(&self->deque, work);
+      slock_unlock(self->deque.lock);
+   }
+
+   for (i = 1; !found && i <= tp->thread_cnt; i++)
+   {
+      struct tpool_deque *dq = &tp->workers[(first + i) % tp->thread_cnt].deque;
+
+      slock_lock(dq->lock);
+      found = tpool_deque_pop_front(dq, work);
+      slock_unlock(dq->lock);
+   }
+
+   if (found)
+      tpool_work_taken(tp, work);
+
+   return found;
 }
 
 static void tpool_worker(void *arg)
 {
-   tpool_work_t *work = NULL;
-   tpool_t      *tp   = (tpool_t*)arg;
+   struct tpool_worker *self = (struct tpool_worker*)arg;
+   tpool_t *tp               = self->pool;
 
    for (;;)
    {
-      slock_lock(tp->work_mutex);
-      /* Keep running until told to stop. */
-      if (tp->stop)
-         break;
+      tpool_work_t work;
+      bool stop;
 
-      /* If there is no work in the queue wait in the conditional until
-       * there is work to take. */
-      if (!tp->work_first)
-         scond_wait(tp->work_cond, tp->work_mutex);
-
-      /* Try to pull work from the queue. */
-      work = tpool_work_get(tp);
-      tp->working_cnt++;
-      slock_unlock(tp->work_mutex);
-
-      /* Call the work function and let it process.
-       *
-       * work can legitimately be NULL. Since multiple threads from the pool
-       * will wake when there is work, a thread might not get any work. 1
-       * piece of work and 2 threads, both will wake but with 1 only work 1
-       * will get the work and the other won't.
-       *
-       * working_cnt has been increment and work could be NULL. While it's
-       * not true there is work processing the thread is considered working
-       * because it's not waiting in the conditional. Pedantic but...
-       */
-      if (work)
+      if (tpool_work_get(tp, self, &work))
       {
-         work->func(work->arg);
-         tpool_work_destroy(work);
+         tpool_work_run(tp, &work);
+         continue;
       }
 
-      slock_lock(tp->work_mutex);
-      tp->working_cnt--;
-      /* Since we're in a lock no work can be added or removed form the queue.
-       * Also, the working_cnt can't be changed (except the thread holding the lock).
-       * At this point if there isn't any work processing and if there is no work
-       * signal this is the case. */
-      if (!tp->stop && tp->working_cnt == 0 && !tp->work_first)
-         scond_signal(tp->working_cond);
-      slock_unlock(tp->work_mutex);
+      slock_lock(tp->lock);
+      /* Work is counted before it is pushed, a worker that
+       * found nothing above but sees it here tries again. */
+      while (!tp->stop && !tp->queued)
+         scond_wait(tp->work_cond, tp->lock);
+      stop = tp->stop;
+      slock_unlock(tp->lock);
+
+      /* Keep running until told to stop. */
+      if (stop)
+         break;
    }
+}
+
+size_t tpool_get_default_size(void)
+{
+#if defined(__linux__) && defined(CPU_COUNT)
+   /* Only the cores this process may run on */
+   cpu_set_t set;
+
+   if (sched_getaffinity(0, sizeof(set), &set) == 0 && CPU_COUNT(&set) > 0)
+      return (size_t)CPU_COUNT(&set);
+#endif
 
-   tp->thread_cnt--;
-   if (tp->thread_cnt == 0)
-      scond_signal(tp->working_cond);
-   slock_unlock(tp->work_mutex);
+   return cpu_features_get_core_amount();
 }
 
 tpool_t *tpool_create(size_t num)
 {
-   tpool_t   *tp;
-   sthread_t *thread;
-   size_t     i;
+   size_t i;
+   tpool_t *tp = NULL;
 
    if (num == 0)
-      num = 2;
+      num = tpool_get_default_size();
+   if (num == 0)
+      num = 1;
+
+   if (!(tp = (tpool_t*)calloc(1, sizeof(*tp))))
+      return NULL;
 
-   tp               = (tpool_t*)calloc(1, sizeof(*tp));
-   tp->thread_cnt   = num;
+   tp->lock      = slock_new();
+   tp->work_cond = scond_new();
+   tp->done_cond = scond_new();
+   tp->workers   = (struct tpool_worker*)calloc(num,
+         sizeof(*tp->workers));
 
-   tp->work_mutex   = slock_new();
-   tp->work_cond    = scond_new();
-   tp->working_cond = scond_new();
+   if (!tp->lock || !tp->work_cond || !tp->done_cond || !tp->workers)
+      goto error;
 
-   tp->work_first   = NULL;
-   tp->work_last    = NULL;
+   tp->thread_cnt = num;
 
-   /* Create the requested number of thread and detach them. */
    for (i = 0; i < num; i++)
    {
-      thread = sthread_create(tpool_worker, tp);
-      sthread_detach(thread);
+      tp->workers[i].pool = tp;
+      if (!(tp->workers[i].deque.lock = slock_new()))
+         goto error;
    }
 
+   for (i = 0; i < num; i++)
+      if (!(tp->workers[i].thread = sthread_create(tpool_worker,
+                  &tp->workers[i])))
+         goto error;
+
    return tp;
+
+error:
+   tpool_destroy(tp);
+   return NULL;
 }
 
 void tpool_destroy(tpool_t *tp)
 {
-   tpool_work_t *work;
-   tpool_work_t *work2;
+   size_t i;
 
    if (!tp)
       return;
 
-   /* Take all work out of the queue and destroy it. */
-   slock_lock(tp->work_mutex);
-   work = tp->work_first;
-   while (work)
+   /* Tell the worker threads to stop, outstanding
+    * work is discarded with the deques. */
+   if (tp->lock)
    {
-      work2 = work->next;
-      tpool_work_destroy(work);
-      work = work2;
+      slock_lock(tp->lock);
+      tp->stop = true;
+      if (tp->work_cond)
+         scond_broadcast(tp->work_cond);
+      slock_unlock(tp->lock);
    }
 
-   /* Tell the worker threads to stop. */
-   tp->stop = true;
-   scond_broadcast(tp->work_cond);
-   slock_unlock(tp->work_mutex);
+   if (tp->workers)
+   {
+      for (i = 0; i < tp->thread_cnt; i++)
+         if (tp->workers[i].thread)
+            sthread_join(tp->workers[i].thread);
 
-   /* Wait for all threads to stop. */
-   tpool_wait(tp);
+      for (i = 0; i < tp->thread_cnt; i++)
+      {
+         if (tp->workers[i].deque.lock)
+            slock_free(tp->workers[i].deque.lock);
+         free(tp->workers[i].deque.items);
+      }
 
-   slock_free(tp->work_mutex);
-   scond_free(tp->work_cond);
-   scond_free(tp->working_cond);
+      free(tp->workers);
+   }
+
+   if (tp->lock)
+      slock_free(tp->lock);
+   if (tp->work_cond)
+      scond_free(tp->work_cond);
+   if (tp->done_cond)
+      scond_free(tp->done_cond);
 
    free(tp);
 }
 
-bool tpool_add_work(tpool_t *tp, thread_func_t func, void *arg)
+size_t tpool_get_num_threads(tpool_t *tp)
 {
-   tpool_work_t *work;
+   return tp ? tp->thread_cnt : 0;
+}
 
-   if (!tp)
-      return false;
+static bool tpool_push_work(tpool_t *tp, tpool_group_t *group,
+      thread_func_t func, void *arg, bool last)
+{
+   tpool_work_t work;
+   struct tpool_worker *self;
+   struct tpool_deque *dq;
+   bool pushed;
 
-   work = tpool_work_create(func, arg);
-   if (!work)
+   if (!tp || !func)
       return false;
 
-   slock_lock(tp->work_mutex);
-   if (!tp->work_first)
-   {
-      tp->work_first      = work;
-      tp->work_last       = tp->work_first;
-   }
+   work.func  = func;
+   work.arg   = arg;
+   work.group = group;
+
+   /* Workers keep what they add to themselves, it is
+    * stolen if another worker runs out of work. */
+   self = tpool_current_worker(tp);
+
+   slock_lock(tp->lock);
+
+   dq = self ? &self->deque
+      : &tp->workers[tp->next_deque++ % tp->thread_cnt].deque;
+
+   slock_lock(dq->lock);
+   if (last && self)
+      pushed = tpool_deque_push_front(dq, &work);
    else
+      pushed = tpool_deque_push(dq, &work);
+   slock_unlock(dq->lock);
+
+   if (pushed)
    {
-      tp->work_last->next = work;
-      tp->work_last       = work;
+      tp->queued++;
+      if (group)
+         group->queued++;
+      scond_signal(tp->work_cond);
    }
 
-   scond_broadcast(tp->work_cond);
-   slock_unlock(tp->work_mutex);
+   slock_unlock(tp->lock);
 
-   return true;
+   return pushed;
+}
+
+bool tpool_group_add_work(tpool_t *tp, tpool_group_t *group,
+      thread_func_t func, void *arg)
+{
+   return tpool_push_work(tp, group, func, arg, false);
+}
+
+bool tpool_group_add_work_last(tpool_t *tp, tpool_group_t *group,
+      thread_func_t func, void *arg)
+{
+   return tpool_push_work(tp, group, func, arg, true);
+}
+
+bool tpool_add_work(tpool_t *tp, thread_func_t func, void *arg)
+{
+   return tpool_group_add_work(tp, NULL, func, arg);
 }
 
 void tpool_wait(tpool_t *tp)
@@ -251,18 +465,60 @@ void tpool_wait(tpool_t *tp)
    if (!tp)
       return;
 
-   slock_lock(tp->work_mutex);
+   slock_lock(tp->lock);
+   while (!tp->stop && (tp->queued || tp->working_cnt))
+      scond_wait(tp->done_cond, tp->lock);
+   slock_unlock(tp->lock);
+}
+
+tpool_group_t *tpool_group_new(void)
+{
+   return (tpool_group_t*)calloc(1, sizeof(tpool_group_t));
+}
+
+void tpool_group_free(tpool_group_t *group)
+{
+   free(group);
+}
+
+void tpool_group_wait(tpool_t *tp, tpool_group_t *group)
+{
+   if (!tp || !group)
+      return;
 
    for (;;)
    {
-      /* working_cond is dual use. It signals when we're not stopping but the
-       * working_cnt is 0 indicating there isn't any work processing. If we
-       * are stopping it will trigger when there aren't any threads running. */
-      if ((!tp->stop && tp->working_cnt != 0) || (tp->stop && tp->thread_cnt != 0))
-         scond_wait(tp->working_cond, tp->work_mutex);
-      else
+      size_t i;
+      tpool_work_t work;
+      bool found = false;
+
+      /* Run the work of the group that is still waiting,
+       * instead of waiting for a worker to get to it. */
+      for (i = 0; !found && i < tp->thread_cnt; i++)
+      {
+         struct tpool_deque *dq = &tp->workers[i].deque;
+
+         slock_lock(dq->lock);
+         found = tpool_deque_pop_group(dq, group, &work);
+         slock_unlock(dq->lock);
+      }
+
+      if (found)
+      {
+         tpool_work_taken(tp, &work);
+         tpool_work_run(tp, &work);
+         continue;
+      }
+
+      slock_lock(tp->lock);
+      if (!group->queued && !group->running)
+      {
+         slock_unlock(tp->lock);
          break;
+      }
+      /* The rest runs on other threads */
+      if (!group->queued)
+         scond_wait(tp->done_cond, tp->lock);
+      slock_unlock(tp->lock);
    }
-
-   slock_unlock(tp->work_mutex);
 }
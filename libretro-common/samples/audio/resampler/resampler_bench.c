@@ -0,0 +1,278 @@
+/* Copyright  (C) 2010-2020 The KingStation team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (resampler_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Runs a sine through the sinc resampler at every quality level,
+ * once per kernel the CPU can run, and reports the cost per output
+ * frame and the SNR of the result.
+ *
+ * Usage: resampler_bench [in_rate out_rate [seconds [tone_hz]]]
+ *
+ * Defaults to 48000 -> 192000 Hz, 5 seconds, 997 Hz. The SNR is
+ * measured against the best fitting sine of the same frequency,
+ * so the filter delay and passband gain do not count as noise.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <math.h>
+
+#include <audio/audio_resampler.h>
+#include <features/features_cpu.h>
+
+#ifndef M_PI
+#define M_PI 3.14159265358979323846
+#endif
+
+/* Same chunking as the frontend uses when audio is blocking. */
+#define BENCH_CHUNK_FRAMES 512
+
+/* Skip the filter warmup at the start before measuring. */
+#define BENCH_SKIP_FRAMES  8192
+
+struct bench_kernel
+{
+   const char *ident;
+   resampler_simd_mask_t mask;
+   resampler_simd_mask_t required;
+};
+
+static const char *bench_quality_names[] = {
+   "dontcare", "lowest", "lower", "normal", "higher", "highest"
+};
+
+/* Least-squares fit of a*sin + b*cos at @omega to the left
+ * channel; returns the residual energy. */
+static double bench_fit(const float *out, size_t frames,
+      double omega, double *signal)
+{
+   size_t i;
+   double s, c, ds, dc;
+   double ss = 0.0, sc = 0.0, cc = 0.0, ys = 0.0, yc = 0.0;
+   double det, a, b;
+   double noise = 0.0;
+
+   *signal = 0.0;
+
+   /* Rotate instead of calling sin()/cos() per sample,
+    * this runs a few dozen times per measurement. */
+   ds = sin(omega);
+   dc = cos(omega);
+
+   s  = sin(omega * BENCH_SKIP_FRAMES);
+   c  = cos(omega * BENCH_SKIP_FRAMES);
+   for (i = BENCH_SKIP_FRAMES; i < frames; i++)
+   {
+      double y  = out[i * 2];
+      double t  = s * dc + c * ds;
+      ss       += s * s;
+      sc       += s * c;
+      cc       += c * c;
+      ys       += y * s;
+      yc       += y * c;
+      c         = c * dc - s * ds;
+      s         = t;
+   }
+
+   det = ss * cc - sc * sc;
+   a   = (ys * cc - yc * sc) / det;
+   b   = (yc * ss - ys * sc) / det;
+
+   s   = sin(omega * BENCH_SKIP_FRAMES);
+   c   = cos(omega * BENCH_SKIP_FRAMES);
+   for (i = BENCH_SKIP_FRAMES; i < frames; i++)
+   {
+      double fit = a * s + b * c;
+      double err = out[i * 2] - fit;
+      double t   = s * dc + c * ds;
+      *signal   += fit * fit;
+      noise     += err * err;
+      c          = c * dc - s * ds;
+      s          = t;
+   }
+
+   return noise;
+}
+
+/* The resampler steps through its phase table in integer
+ * increments, so the output frequency is slightly off the
+ * nominal one. Search around it for the best fit. */
+static double bench_snr(const float *out, size_t frames, double omega)
+{
+   unsigned i;
+   double signal, noise;
+   const double golden = 0.6180339887498949;
+   double lo           = omega * (1.0 - 2e-5);
+   double hi           = omega * (1.0 + 2e-5);
+   double x1           = hi - golden * (hi - lo);
+   double x2           = lo + golden * (hi - lo);
+   double f1, f2;
+
+   if (frames <= BENCH_SKIP_FRAMES * 2)
+      return 0.0;
+
+   f1 = bench_fit(out, frames, x1, &signal);
+   f2 = bench_fit(out, frames, x2, &signal);
+
+   for (i = 0; i < 40; i++)
+   {
+      if (f1 < f2)
+      {
+         hi = x2;
+         x2 = x1;
+         f2 = f1;
+         x1 = hi - golden * (hi - lo);
+         f1 = bench_fit(out, frames, x1, &signal);
+      }
+      else
+      {
+         lo = x1;
+         x1 = x2;
+         f1 = f2;
+         x2 = lo + golden * (hi - lo);
+         f2 = bench_fit(out, frames, x2, &signal);
+      }
+   }
+
+   noise = bench_fit(out, frames, (lo + hi) * 0.5, &signal);
+
+   if (noise <= 0.0)
+      return 999.0;
+   return 10.0 * log10(signal / noise);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned k, q;
+   size_t i;
+   resampler_simd_mask_t cpu   = (resampler_simd_mask_t)cpu_features_get();
+   static const struct bench_kernel kernels[] = {
+      { "c",    0,                                          0 },
+      { "sse",  RESAMPLER_SIMD_SSE,                         RESAMPLER_SIMD_SSE },
+      { "avx",  RESAMPLER_SIMD_SSE | RESAMPLER_SIMD_AVX,    RESAMPLER_SIMD_AVX },
+      { "avx2", RESAMPLER_SIMD_SSE | RESAMPLER_SIMD_AVX
+                   | RESAMPLER_SIMD_AVX2,                   RESAMPLER_SIMD_AVX2 },
+      { "neon", RESAMPLER_SIMD_NEON,                        RESAMPLER_SIMD_NEON },
+   };
+   double in_rate              = argc > 2 ? atof(argv[1]) : 48000.0;
+   double out_rate             = argc > 2 ? atof(argv[2]) : 192000.0;
+   double seconds              = argc > 3 ? atof(argv[3]) : 5.0;
+   double tone                 = argc > 4 ? atof(argv[4]) : 997.0;
+   double ratio                = out_rate / in_rate;
+   size_t in_frames            = (size_t)(in_rate * seconds);
+   size_t max_out              = (size_t)(in_frames * ratio) + BENCH_CHUNK_FRAMES * (size_t)(ratio + 2.0);
+   float *input                = NULL;
+   float *output               = NULL;
+
+   if (in_rate <= 0.0 || out_rate <= 0.0 || in_frames < BENCH_CHUNK_FRAMES)
+   {
+      fprintf(stderr, "Usage: %s [in_rate out_rate [seconds [tone_hz]]]\n",
+            argv[0]);
+      return 1;
+   }
+
+   input  = (float*)malloc(in_frames * 2 * sizeof(float));
+   output = (float*)malloc(max_out * 2 * sizeof(float));
+
+   if (!input || !output)
+      return 1;
+
+   for (i = 0; i < in_frames; i++)
+      input[i * 2] = input[i * 2 + 1] =
+         (float)(0.5 * sin(2.0 * M_PI * tone * i / in_rate));
+
+   printf("%.0f -> %.0f Hz, %.1f s of a %.0f Hz tone\n",
+         in_rate, out_rate, seconds, tone);
+   printf("%-8s %-6s %12s %10s\n", "quality", "kernel", "ns/frame", "SNR dB");
+
+   for (q = RESAMPLER_QUALITY_LOWEST; q <= RESAMPLER_QUALITY_HIGHEST; q++)
+   {
+      resampler_process_t done[sizeof(kernels) / sizeof(kernels[0])];
+      unsigned num_done = 0;
+
+      for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+      {
+         unsigned d;
+         retro_time_t start, elapsed;
+         size_t pos      = 0;
+         size_t out_pos  = 0;
+         void *re        = NULL;
+
+         if ((cpu & kernels[k].required) != kernels[k].required)
+            continue;
+
+         re = sinc_resampler.init(NULL, ratio,
+               (enum resampler_quality)q, kernels[k].mask);
+         if (!re)
+         {
+            fprintf(stderr, "Could not create %s resampler.\n",
+                  bench_quality_names[q]);
+            return 1;
+         }
+
+         /* A mask the kernel was not built for falls back to
+          * another one; do not time the same code twice. */
+         for (d = 0; d < num_done; d++)
+            if (done[d] == sinc_resampler.process)
+               break;
+         if (d < num_done)
+         {
+            sinc_resampler.free(re);
+            continue;
+         }
+         done[num_done++] = sinc_resampler.process;
+
+         start = cpu_features_get_time_usec();
+
+         while (pos < in_frames)
+         {
+            struct resampler_data data;
+
+            data.data_in       = input + pos * 2;
+            data.data_out      = output + out_pos * 2;
+            data.input_frames  = in_frames - pos < BENCH_CHUNK_FRAMES
+               ? in_frames - pos : BENCH_CHUNK_FRAMES;
+            data.output_frames = 0;
+            data.ratio         = ratio;
+
+            sinc_resampler.process(re, &data);
+
+            pos               += data.input_frames;
+            out_pos           += data.output_frames;
+         }
+
+         elapsed = cpu_features_get_time_usec() - start;
+
+         printf("%-8s %-6s %12.2f %10.1f\n",
+               bench_quality_names[q], kernels[k].ident,
+               out_pos ? 1000.0 * elapsed / out_pos : 0.0,
+               bench_snr(output, out_pos, 2.0 * M_PI * tone / out_rate));
+
+         sinc_resampler.free(re);
+      }
+   }
+
+   free(input);
+   free(output);
+
+   return 0;
+}
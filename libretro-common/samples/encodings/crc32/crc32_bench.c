@@ -0,0 +1,208 @@
+/* Copyright  (C) 2010-2020 The KingStation team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (crc32_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Checks every CRC32 kernel the CPU can run against the bytewise
+ * reference, then reports the throughput of each one over buffer
+ * sizes from 64 B to 64 MB.
+ *
+ * Usage: crc32_bench [max_mb]
+ *
+ * The kernels are static, so the implementation is included here
+ * instead of being linked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+
+#include "../../../encodings/encoding_crc32.c"
+
+/* Bytes hashed per size and kernel, so small sizes run long
+ * enough to time. */
+#define BENCH_TOTAL_BYTES (256 * 1024 * 1024)
+
+typedef uint32_t (*bench_kernel_t)(uint32_t crc,
+      const uint8_t *buf, size_t len);
+
+struct bench_kernel
+{
+   const char *ident;
+   bench_kernel_t process;
+   int available;
+};
+
+static uint32_t bench_bytewise(uint32_t crc, const uint8_t *buf, size_t len)
+{
+   while (len--)
+      crc = crc32_table[0][(crc ^ (*buf++)) & 0xff] ^ (crc >> 8);
+   return crc;
+}
+
+#ifdef CRC32_HAVE_PCLMUL
+/* Same split as encoding_crc32() */
+static uint32_t bench_pclmul(uint32_t crc, const uint8_t *buf, size_t len)
+{
+   if (len >= 64)
+   {
+      size_t folded = len & ~(size_t)15;
+      crc           = crc32_pclmul(crc, buf, folded);
+      buf          += folded;
+      len          -= folded;
+   }
+   return crc32_slice8(crc, buf, len);
+}
+#endif
+
+int main(int argc, char *argv[])
+{
+   unsigned k;
+   size_t size, i;
+   size_t max_size            = (size_t)(argc > 1 ? atoi(argv[1]) : 64)
+      * 1024 * 1024;
+   uint8_t *buf               = NULL;
+   uint64_t cpu               = cpu_features_get_extra();
+   struct bench_kernel kernels[] = {
+      { "bytewise", bench_bytewise, 1 },
+      { "slice8",   crc32_slice8,   1 },
+#ifdef CRC32_HAVE_PCLMUL
+      { "pclmul",   bench_pclmul,   (cpu & CPU_FEATURES_PCLMUL) != 0 },
+#endif
+#ifdef CRC32_HAVE_ARMV8
+      { "armv8",    crc32_armv8,    (cpu & CPU_FEATURES_CRC32) != 0 },
+#endif
+   };
+   unsigned num_kernels = sizeof(kernels) / sizeof(kernels[0]);
+
+   if (max_size < 64)
+   {
+      fprintf(stderr, "Usage: %s [max_mb]\n", argv[0]);
+      return 1;
+   }
+
+   /* Spare bytes to test misaligned starts */
+   buf = (uint8_t*)malloc(max_size + 16);
+   if (!buf)
+      return 1;
+
+   srand(1);
+   for (i = 0; i < max_size + 16; i++)
+      buf[i] = (uint8_t)rand();
+
+   /* Every length up to a few blocks, at every alignment,
+    * chained onto a previous CRC */
+   for (k = 1; k < num_kernels; k++)
+   {
+      size_t len, offset;
+
+      if (!kernels[k].available)
+         continue;
+
+      for (offset = 0; offset < 16; offset++)
+      {
+         for (len = 0; len < 1024; len++)
+         {
+            uint32_t seed = (uint32_t)(len * 2654435761u);
+            uint32_t want = bench_bytewise(seed, buf + offset, len);
+            uint32_t got  = kernels[k].process(seed, buf + offset, len);
+
+            if (want != got)
+            {
+               fprintf(stderr, "%s: mismatch at length %u, offset %u: "
+                     "%08x != %08x\n", kernels[k].ident, (unsigned)len,
+                     (unsigned)offset, got, want);
+               return 1;
+            }
+         }
+      }
+
+      if (   bench_bytewise(0, buf, max_size)
+          != kernels[k].process(0, buf, max_size))
+      {
+         fprintf(stderr, "%s: mismatch over %u bytes\n",
+               kernels[k].ident, (unsigned)max_size);
+         return 1;
+      }
+   }
+
+   /* Known answer for the public function */
+   encoding_crc32_init_simd(cpu);
+   if (encoding_crc32(0, (const uint8_t*)"123456789", 9) != 0xcbf43926)
+   {
+      fprintf(stderr, "encoding_crc32: wrong check value\n");
+      return 1;
+   }
+
+   printf("%-10s", "size");
+   for (k = 0; k < num_kernels; k++)
+      if (kernels[k].available)
+         printf(" %10s", kernels[k].ident);
+   printf("   (MB/s)\n");
+
+   for (size = 64; size <= max_size; size *= 4)
+   {
+      char label[16];
+      size_t iters = BENCH_TOTAL_BYTES / size;
+
+      if (iters < 4)
+         iters = 4;
+
+      if (size >= 1024 * 1024)
+         snprintf(label, sizeof(label), "%u MB", (unsigned)(size >> 20));
+      else if (size >= 1024)
+         snprintf(label, sizeof(label), "%u KB", (unsigned)(size >> 10));
+      else
+         snprintf(label, sizeof(label), "%u B", (unsigned)size);
+      printf("%-10s", label);
+
+      for (k = 0; k < num_kernels; k++)
+      {
+         retro_time_t start, elapsed;
+         uint32_t crc  = 0;
+         size_t n      = iters;
+
+         if (!kernels[k].available)
+            continue;
+
+         /* The table kernel is slow, keep it to a few seconds */
+         if (k == 0 && n > 16)
+            n /= 8;
+
+         start   = cpu_features_get_time_usec();
+         for (i = 0; i < n; i++)
+            crc  = kernels[k].process(crc, buf, size);
+         elapsed = cpu_features_get_time_usec() - start;
+
+         /* Keeps the loop from being optimized out */
+         buf[0] ^= (uint8_t)crc;
+
+         printf(" %10.1f", elapsed
+               ? (double)size * n / elapsed : 0.0);
+      }
+      printf("\n");
+   }
+
+   free(buf);
+
+   return 0;
+}
@@ -0,0 +1,250 @@
+/* Copyright  (C) 2010-2020 The KingStation team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (config_file_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Writes a retroarch.cfg sized config file plus an #include'd
+ * override, then times loading it and the get/set/unset calls
+ * the frontend makes on it. Every lookup is checked against a
+ * plain walk of the entry list, which is what config_get_entry()
+ * used to do, and that walk is timed as well for comparison.
+ *
+ * Usage: config_file_bench [keys [rounds]]
+ *
+ * Defaults to 2000 keys, 20 rounds.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <file/config_file.h>
+#include <features/features_cpu.h>
+
+#define BENCH_CFG      "config_file_bench.cfg"
+#define BENCH_OVERRIDE "config_file_bench_override.cfg"
+
+static const char *bench_prefixes[] = {
+   "video_", "audio_", "input_player1_", "input_player2_",
+   "menu_", "netplay_", "savestate_", "content_", "log_"
+};
+
+static void bench_key(char *s, size_t len, unsigned i)
+{
+   snprintf(s, len, "%s%s_%u",
+         bench_prefixes[i % (sizeof(bench_prefixes) / sizeof(bench_prefixes[0]))],
+         (i & 1) ? "enable" : "path", i);
+}
+
+static bool bench_write_files(unsigned keys)
+{
+   unsigned i;
+   char key[64];
+   FILE *base     = fopen(BENCH_CFG, "w");
+   FILE *override = fopen(BENCH_OVERRIDE, "w");
+
+   if (!base || !override)
+   {
+      if (base)
+         fclose(base);
+      if (override)
+         fclose(override);
+      return false;
+   }
+
+   /* Every 16th key is overridden; the base file has it too,
+    * further down, so lookups must return the first one. */
+   for (i = 0; i < keys; i += 16)
+   {
+      bench_key(key, sizeof(key), i);
+      fprintf(override, "%s = \"override_%u\"\n", key, i);
+   }
+
+   fprintf(base, "# Generated by config_file_bench\n");
+   fprintf(base, "#include \"%s\"\n", BENCH_OVERRIDE);
+   for (i = 0; i < keys; i++)
+   {
+      bench_key(key, sizeof(key), i);
+      if (i & 1)
+         fprintf(base, "%s = \"%s\"\n", key, (i & 2) ? "true" : "false");
+      else
+         fprintf(base, "%s = \"/home/user/.config/retroarch/%u\"\n", key, i);
+   }
+
+   fclose(base);
+   fclose(override);
+   return true;
+}
+
+static const char *bench_walk(config_file_t *conf, const char *key)
+{
+   struct config_file_entry entry;
+
+   if (!config_get_entry_list_head(conf, &entry))
+      return NULL;
+
+   do
+   {
+      if (entry.key && !strcmp(entry.key, key))
+         return entry.value;
+   } while (config_get_entry_list_next(&entry));
+
+   return NULL;
+}
+
+static bool bench_check(config_file_t *conf, unsigned keys)
+{
+   unsigned i;
+   char key[64];
+
+   for (i = 0; i < keys + 64; i++)
+   {
+      struct config_entry_list *entry = NULL;
+      const char *walked              = NULL;
+
+      bench_key(key, sizeof(key), i);
+      entry  = config_get_entry(conf, key);
+      walked = bench_walk(conf, key);
+
+      if ((entry ? entry->value : NULL) != walked)
+      {
+         fprintf(stderr, "Mismatch for %s\n", key);
+         return false;
+      }
+   }
+
+   return true;
+}
+
+static void bench_report(const char *name, retro_time_t elapsed,
+      unsigned ops)
+{
+   printf("%-14s %12.1f %12.1f\n", name,
+         elapsed / 1000.0, ops ? 1000.0 * elapsed / ops : 0.0);
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i, r;
+   char key[64];
+   retro_time_t start;
+   retro_time_t t_load   = 0;
+   retro_time_t t_get    = 0;
+   retro_time_t t_walk   = 0;
+   retro_time_t t_set    = 0;
+   retro_time_t t_unset  = 0;
+   retro_time_t t_append = 0;
+   unsigned keys         = argc > 1 ? (unsigned)atoi(argv[1]) : 2000;
+   unsigned rounds       = argc > 2 ? (unsigned)atoi(argv[2]) : 20;
+   int ret               = 0;
+
+   if (!keys || !rounds)
+   {
+      fprintf(stderr, "Usage: %s [keys [rounds]]\n", argv[0]);
+      return 1;
+   }
+
+   if (!bench_write_files(keys))
+   {
+      fprintf(stderr, "Could not write %s.\n", BENCH_CFG);
+      return 1;
+   }
+
+   for (r = 0; r < rounds; r++)
+   {
+      bool b;
+      config_file_t *conf = NULL;
+
+      start  = cpu_features_get_time_usec();
+      conf   = config_file_new(BENCH_CFG);
+      t_load += cpu_features_get_time_usec() - start;
+
+      if (!conf || !bench_check(conf, keys))
+      {
+         ret = 1;
+         config_file_free(conf);
+         break;
+      }
+
+      /* Lookups, including some keys that are not there */
+      start = cpu_features_get_time_usec();
+      for (i = 0; i < keys + 64; i++)
+      {
+         bench_key(key, sizeof(key), i);
+         config_get_bool(conf, key, &b);
+      }
+      t_get += cpu_features_get_time_usec() - start;
+
+      start = cpu_features_get_time_usec();
+      for (i = 0; i < keys + 64; i++)
+      {
+         bench_key(key, sizeof(key), i);
+         bench_walk(conf, key);
+      }
+      t_walk += cpu_features_get_time_usec() - start;
+
+      /* What saving the config does: set every key,
+       * most to the value they already have */
+      start = cpu_features_get_time_usec();
+      for (i = 0; i < keys + 64; i++)
+      {
+         bench_key(key, sizeof(key), i);
+         config_set_string(conf, key, (i & 7) ? "true" : "changed");
+      }
+      t_set += cpu_features_get_time_usec() - start;
+
+      start = cpu_features_get_time_usec();
+      for (i = 0; i < keys; i += 4)
+      {
+         bench_key(key, sizeof(key), i);
+         config_unset(conf, key);
+      }
+      t_unset += cpu_features_get_time_usec() - start;
+
+      /* Switching overrides appends a file in front */
+      start = cpu_features_get_time_usec();
+      config_append_file(conf, BENCH_OVERRIDE);
+      t_append += cpu_features_get_time_usec() - start;
+
+      if (!bench_check(conf, keys))
+         ret = 1;
+
+      config_file_free(conf);
+      if (ret)
+         break;
+   }
+
+   remove(BENCH_CFG);
+   remove(BENCH_OVERRIDE);
+
+   if (ret)
+      return ret;
+
+   printf("%u keys, %u rounds\n", keys, rounds);
+   printf("%-14s %12s %12s\n", "operation", "total ms", "ns/op");
+   bench_report("load",        t_load,   rounds);
+   bench_report("get",         t_get,    rounds * (keys + 64));
+   bench_report("list walk",   t_walk,   rounds * (keys + 64));
+   bench_report("set",         t_set,    rounds * (keys + 64));
+   bench_report("unset",       t_unset,  rounds * ((keys + 3) / 4));
+   bench_report("append file", t_append, rounds);
+
+   return 0;
+}
@@ -0,0 +1,229 @@
+/* Copyright  (C) 2010-2020 The KingStation team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (chd_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Reads a CHD track through chdstream the way cores do, once
+ * with a single cached hunk, once with the hunk cache and once
+ * with the cache and read-ahead, and checks all three return the
+ * same bytes. Then times decompressing every hunk with chd_read(),
+ * after chd_precache() and after chd_precache_hunks().
+ *
+ * Usage: chd_bench <file.chd> [track [threads]]
+ *
+ * The sequential pass reads the track sector by sector, the
+ * scattered pass reads runs of 16 sectors at random positions.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <libchdr/chd.h>
+#include <streams/chd_stream.h>
+#include <features/features_cpu.h>
+
+#define BENCH_SECTOR      2352
+#define BENCH_RUN_SECTORS 16
+#define BENCH_RUNS        4000
+
+struct bench_config
+{
+   const char *ident;
+   unsigned cache_hunks;
+   unsigned readahead_hunks;
+};
+
+static uint32_t bench_sum(uint32_t sum, const uint8_t *buf, size_t len)
+{
+   while (len--)
+      sum = (sum << 5) + sum + *buf++;
+   return sum;
+}
+
+/* Returns a checksum of everything read, or 0 on error. */
+static uint32_t bench_stream(const char *path, int32_t track,
+      int scattered, double *elapsed, double *mb)
+{
+   retro_time_t start;
+   size_t i, sectors;
+   uint8_t buf[BENCH_SECTOR * BENCH_RUN_SECTORS];
+   uint32_t sum          = 5381;
+   size_t bytes          = 0;
+   chdstream_t *stream   = chdstream_open(path, track);
+
+   if (!stream)
+      return 0;
+
+   sectors = chdstream_get_size(stream) / BENCH_SECTOR;
+   start   = cpu_features_get_time_usec();
+
+   if (!scattered)
+   {
+      for (i = 0; i < sectors; i++)
+      {
+         if (chdstream_read(stream, buf, BENCH_SECTOR) != BENCH_SECTOR)
+            break;
+         sum    = bench_sum(sum, buf, BENCH_SECTOR);
+         bytes += BENCH_SECTOR;
+      }
+   }
+   else
+   {
+      srand(1);
+      for (i = 0; i < BENCH_RUNS && sectors > BENCH_RUN_SECTORS; i++)
+      {
+         size_t sector = (size_t)rand() % (sectors - BENCH_RUN_SECTORS);
+         ssize_t len;
+
+         chdstream_seek(stream, sector * BENCH_SECTOR, SEEK_SET);
+         len    = chdstream_read(stream, buf, sizeof(buf));
+         if (len <= 0)
+            break;
+         sum    = bench_sum(sum, buf, len);
+         bytes += len;
+      }
+   }
+
+   *elapsed = (cpu_features_get_time_usec() - start) / 1000000.0;
+   *mb      = bytes / (1024.0 * 1024.0);
+
+   chdstream_close(stream);
+   return sum;
+}
+
+/* 0: chd_read() only, 1: chd_precache(), 2: chd_precache_hunks() */
+static uint32_t bench_hunks(const char *path, int mode, unsigned threads,
+      double *elapsed)
+{
+   UINT32 i;
+   retro_time_t start;
+   const chd_header *hd;
+   uint8_t *buf;
+   uint32_t sum  = 5381;
+   chd_file *chd = NULL;
+
+   if (chd_open(path, CHD_OPEN_READ, NULL, &chd) != CHDERR_NONE)
+      return 0;
+
+   hd    = chd_get_header(chd);
+   buf   = (uint8_t*)malloc(hd->hunkbytes);
+   start = cpu_features_get_time_usec();
+
+   if (     (mode == 1 && chd_precache(chd) != CHDERR_NONE)
+         || (mode == 2 && chd_precache_hunks(chd, threads) != CHDERR_NONE))
+      sum  = 0;
+
+   for (i = 0; sum && i < hd->totalhunks; i++)
+   {
+      if (chd_read(chd, i, buf) != CHDERR_NONE)
+         sum = 0;
+      else
+         sum = bench_sum(sum, buf, hd->hunkbytes);
+   }
+
+   *elapsed = (cpu_features_get_time_usec() - start) / 1000000.0;
+
+   free(buf);
+   chd_close(chd);
+   return sum;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned c;
+   int pass;
+   static const struct bench_config configs[] = {
+      { "1 hunk",    2,                             0 },
+      { "cache",     CHDSTREAM_DEFAULT_CACHE_HUNKS, 0 },
+      { "readahead", CHDSTREAM_DEFAULT_CACHE_HUNKS,
+                     CHDSTREAM_DEFAULT_READAHEAD_HUNKS },
+   };
+   static const char *modes[] = { "chd_read", "precache", "precache_hunks" };
+   int32_t track    = argc > 2 ? atoi(argv[2]) : CHDSTREAM_TRACK_PRIMARY;
+   unsigned threads = argc > 3 ? (unsigned)atoi(argv[3]) : 0;
+   uint32_t want    = 0;
+
+   if (argc < 2)
+   {
+      fprintf(stderr, "Usage: %s <file.chd> [track [threads]]\n", argv[0]);
+      return 1;
+   }
+
+   printf("%-10s %-10s %10s %10s\n", "stream", "pattern", "MB/s", "ms");
+
+   for (pass = 0; pass < 2; pass++)
+   {
+      for (c = 0; c < sizeof(configs) / sizeof(configs[0]); c++)
+      {
+         double elapsed, mb;
+         uint32_t sum;
+
+         chdstream_set_cache(configs[c].cache_hunks,
+               configs[c].readahead_hunks);
+
+         sum = bench_stream(argv[1], track, pass, &elapsed, &mb);
+         if (!sum)
+         {
+            fprintf(stderr, "Could not read track %d of %s.\n",
+                  track, argv[1]);
+            return 1;
+         }
+
+         if (c == 0)
+            want = sum;
+         else if (sum != want)
+         {
+            fprintf(stderr, "%s: read different data.\n", configs[c].ident);
+            return 1;
+         }
+
+         printf("%-10s %-10s %10.1f %10.1f\n", configs[c].ident,
+               pass ? "scattered" : "sequential",
+               elapsed > 0.0 ? mb / elapsed : 0.0, elapsed * 1000.0);
+      }
+   }
+
+   printf("\n%-16s %10s\n", "all hunks", "ms");
+
+   for (pass = 0; pass < 3; pass++)
+   {
+      double elapsed;
+      uint32_t sum = bench_hunks(argv[1], pass, threads, &elapsed);
+
+      if (!sum)
+      {
+         fprintf(stderr, "%s: could not read the hunks.\n", modes[pass]);
+         return 1;
+      }
+
+      if (pass == 0)
+         want = sum;
+      else if (sum != want)
+      {
+         fprintf(stderr, "%s: read different data.\n", modes[pass]);
+         return 1;
+      }
+
+      printf("%-16s %10.1f\n", modes[pass], elapsed * 1000.0);
+   }
+
+   return 0;
+}
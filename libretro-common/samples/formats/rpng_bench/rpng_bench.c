@@ -0,0 +1,413 @@
+/* Copyright  (C) 2010-2020 The KingStation team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (rpng_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Checks the SIMD reverse filters and line copies against the
+ * plain C ones, reports their throughput on a 4K wide line, then
+ * decodes a set of PNG files on one thread and on several.
+ *
+ * Usage: rpng_bench [-j threads] [png file ...]
+ *
+ * The threaded run decodes different files at the same time, the
+ * way several image load tasks would. The kernels are static, so
+ * the decoder is included here instead of being linked.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <features/features_cpu.h>
+#include <file/nbio.h>
+#include <rthreads/rthreads.h>
+#include <streams/file_stream.h>
+
+#include "../../../formats/png/rpng.c"
+
+/* 3840 RGBA pixels */
+#define BENCH_PITCH  (3840 * 4)
+#define BENCH_LINES  20000
+
+struct bench_file
+{
+   const char *path;
+   void *data;
+   int64_t len;
+};
+
+struct bench_corpus
+{
+   struct bench_file *files;
+   slock_t *lock;
+   unsigned num_files;
+   unsigned next;
+   unsigned failed;
+   uint64_t pixels;
+};
+
+static const char *bench_filter_names[] = {
+   "none", "sub", "up", "average", "paeth"
+};
+
+static void bench_unfilter_c(uint8_t *out, const uint8_t *in,
+      const uint8_t *prev, unsigned pitch, unsigned bpp, unsigned filter)
+{
+   switch (filter)
+   {
+      case PNG_FILTER_NONE:
+         memcpy(out, in, pitch);
+         break;
+      case PNG_FILTER_SUB:
+         png_unfilter_sub(out, in, pitch, bpp);
+         break;
+      case PNG_FILTER_UP:
+         png_unfilter_up(out, in, prev, pitch);
+         break;
+      case PNG_FILTER_AVERAGE:
+         png_unfilter_avg(out, in, prev, pitch, bpp);
+         break;
+      case PNG_FILTER_PAETH:
+         png_unfilter_paeth(out, in, prev, pitch, bpp);
+         break;
+   }
+}
+
+static int bench_check(uint8_t *in, uint8_t *prev)
+{
+   unsigned bpp, filter, pitch;
+   uint8_t *want = (uint8_t*)malloc(BENCH_PITCH);
+   uint8_t *got  = (uint8_t*)malloc(BENCH_PITCH);
+   uint32_t *want_px = (uint32_t*)malloc(BENCH_PITCH / 3 * 4);
+   uint32_t *got_px  = (uint32_t*)malloc(BENCH_PITCH / 3 * 4);
+
+   for (bpp = 1; bpp <= 8; bpp++)
+   {
+      for (filter = PNG_FILTER_NONE; filter <= PNG_FILTER_PAETH; filter++)
+      {
+         for (pitch = bpp; pitch < 256; pitch += bpp)
+         {
+            bench_unfilter_c(want, in, prev, pitch, bpp, filter);
+            png_reverse_filter_line(got, in, prev, pitch, bpp, filter);
+
+            if (memcmp(want, got, pitch))
+            {
+               fprintf(stderr, "%s: mismatch at %u bytes per pixel, "
+                     "%u bytes\n", bench_filter_names[filter], bpp, pitch);
+               return 1;
+            }
+         }
+      }
+   }
+
+#ifdef RPNG_SIMD
+   for (pitch = 0; pitch < 256; pitch++)
+   {
+      png_reverse_filter_copy_line_rgb(want_px, in, pitch, 8);
+      png_copy_line_rgb8_simd(got_px, in, pitch);
+
+      if (memcmp(want_px, got_px, pitch * sizeof(uint32_t)))
+      {
+         fprintf(stderr, "rgb: mismatch at width %u\n", pitch);
+         return 1;
+      }
+
+      png_reverse_filter_copy_line_rgba(want_px, in, pitch, 8);
+      png_copy_line_rgba8_simd(got_px, in, pitch);
+
+      if (memcmp(want_px, got_px, pitch * sizeof(uint32_t)))
+      {
+         fprintf(stderr, "rgba: mismatch at width %u\n", pitch);
+         return 1;
+      }
+   }
+#endif
+
+   free(want);
+   free(got);
+   free(want_px);
+   free(got_px);
+
+   return 0;
+}
+
+static double bench_mbps(retro_time_t elapsed, size_t bytes)
+{
+   return elapsed ? (double)bytes / elapsed : 0.0;
+}
+
+static void bench_kernels(uint8_t *in, uint8_t *prev)
+{
+   unsigned bpp, filter, i;
+   uint8_t *out  = (uint8_t*)malloc(BENCH_PITCH);
+   uint32_t *px  = (uint32_t*)malloc(BENCH_PITCH / 3 * 4);
+
+   printf("%-8s %4s %10s %10s   (MB/s, %u byte lines)\n",
+         "filter", "bpp", "c", "dispatch", BENCH_PITCH);
+
+   for (bpp = 3; bpp <= 4; bpp++)
+   {
+      for (filter = PNG_FILTER_SUB; filter <= PNG_FILTER_PAETH; filter++)
+      {
+         retro_time_t start, c_time, simd_time;
+
+         start     = cpu_features_get_time_usec();
+         for (i = 0; i < BENCH_LINES; i++)
+            bench_unfilter_c(out, in, prev, BENCH_PITCH, bpp, filter);
+         c_time    = cpu_features_get_time_usec() - start;
+
+         start     = cpu_features_get_time_usec();
+         for (i = 0; i < BENCH_LINES; i++)
+            png_reverse_filter_line(out, in, prev, BENCH_PITCH, bpp, filter);
+         simd_time = cpu_features_get_time_usec() - start;
+
+         /* Keeps the loops from being optimized out */
+         in[0] ^= out[BENCH_PITCH - 1];
+
+         printf("%-8s %4u %10.1f %10.1f\n", bench_filter_names[filter], bpp,
+               bench_mbps(c_time,    (size_t)BENCH_PITCH * BENCH_LINES),
+               bench_mbps(simd_time, (size_t)BENCH_PITCH * BENCH_LINES));
+      }
+   }
+
+#ifdef RPNG_SIMD
+   for (bpp = 3; bpp <= 4; bpp++)
+   {
+      retro_time_t start, c_time, simd_time;
+      unsigned width = BENCH_PITCH / 4;
+
+      start     = cpu_features_get_time_usec();
+      for (i = 0; i < BENCH_LINES; i++)
+      {
+         if (bpp == 3)
+            png_reverse_filter_copy_line_rgb(px, in, width, 8);
+         else
+            png_reverse_filter_copy_line_rgba(px, in, width, 8);
+      }
+      c_time    = cpu_features_get_time_usec() - start;
+
+      start     = cpu_features_get_time_usec();
+      for (i = 0; i < BENCH_LINES; i++)
+      {
+         if (bpp == 3)
+            png_copy_line_rgb8_simd(px, in, width);
+         else
+            png_copy_line_rgba8_simd(px, in, width);
+      }
+      simd_time = cpu_features_get_time_usec() - start;
+
+      in[0] ^= (uint8_t)px[width - 1];
+
+      printf("%-8s %4u %10.1f %10.1f\n", bpp == 3 ? "rgb" : "rgba", bpp,
+            bench_mbps(c_time,    (size_t)width * bpp * BENCH_LINES),
+            bench_mbps(simd_time, (size_t)width * bpp * BENCH_LINES));
+   }
+#endif
+
+   free(out);
+   free(px);
+}
+
+static bool bench_decode(const struct bench_file *file,
+      unsigned *width, unsigned *height)
+{
+   int ret;
+   uint32_t *data = NULL;
+   rpng_t *rpng   = rpng_alloc();
+
+   if (!rpng)
+      return false;
+
+   if (     !rpng_set_buf_ptr(rpng, file->data, (size_t)file->len)
+         || !rpng_start(rpng))
+   {
+      rpng_free(rpng);
+      return false;
+   }
+
+   while (rpng_iterate_image(rpng));
+
+   if (!rpng_is_valid(rpng))
+   {
+      rpng_free(rpng);
+      return false;
+   }
+
+   do
+   {
+      ret = rpng_process_image(rpng, (void**)&data,
+            (size_t)file->len, width, height);
+   } while (ret == IMAGE_PROCESS_NEXT);
+
+   rpng_free(rpng);
+   free(data);
+
+   return ret == IMAGE_PROCESS_END;
+}
+
+static void bench_decode_thread(void *userdata)
+{
+   struct bench_corpus *corpus = (struct bench_corpus*)userdata;
+
+   for (;;)
+   {
+      unsigned width  = 0;
+      unsigned height = 0;
+      unsigned index;
+      bool ok;
+
+      slock_lock(corpus->lock);
+      index = corpus->next++;
+      slock_unlock(corpus->lock);
+
+      if (index >= corpus->num_files)
+         break;
+
+      ok = bench_decode(&corpus->files[index], &width, &height);
+
+      slock_lock(corpus->lock);
+      if (ok)
+         corpus->pixels += (uint64_t)width * height;
+      else
+         corpus->failed++;
+      slock_unlock(corpus->lock);
+   }
+}
+
+/* Decodes every file once on @num_threads threads */
+static retro_time_t bench_corpus_run(struct bench_corpus *corpus,
+      unsigned num_threads)
+{
+   unsigned i;
+   retro_time_t start;
+   sthread_t **threads = (sthread_t**)calloc(num_threads, sizeof(*threads));
+
+   corpus->next   = 0;
+   corpus->failed = 0;
+   corpus->pixels = 0;
+
+   start = cpu_features_get_time_usec();
+
+   if (num_threads == 1)
+      bench_decode_thread(corpus);
+   else
+   {
+      for (i = 0; i < num_threads; i++)
+         threads[i] = sthread_create(bench_decode_thread, corpus);
+      for (i = 0; i < num_threads; i++)
+         if (threads[i])
+            sthread_join(threads[i]);
+   }
+
+   free(threads);
+
+   return cpu_features_get_time_usec() - start;
+}
+
+int main(int argc, char *argv[])
+{
+   int i;
+   size_t j;
+   struct bench_corpus corpus;
+   unsigned num_threads = cpu_features_get_core_amount();
+   uint8_t *in          = (uint8_t*)malloc(BENCH_PITCH);
+   uint8_t *prev        = (uint8_t*)malloc(BENCH_PITCH);
+
+   if (!in || !prev)
+      return 1;
+
+   srand(1);
+   for (j = 0; j < BENCH_PITCH; j++)
+   {
+      in[j]   = (uint8_t)rand();
+      prev[j] = (uint8_t)rand();
+   }
+
+   if (bench_check(in, prev) != 0)
+      return 1;
+
+#if defined(RPNG_SIMD_SSE2)
+   printf("kernels: sse2\n");
+#elif defined(RPNG_SIMD_NEON)
+   printf("kernels: neon\n");
+#else
+   printf("kernels: c only\n");
+#endif
+
+   bench_kernels(in, prev);
+
+   free(in);
+   free(prev);
+
+   memset(&corpus, 0, sizeof(corpus));
+   corpus.files = (struct bench_file*)calloc(argc, sizeof(*corpus.files));
+   corpus.lock  = slock_new();
+
+   for (i = 1; i < argc; i++)
+   {
+      struct bench_file *file = &corpus.files[corpus.num_files];
+
+      if (string_is_equal(argv[i], "-j") && i + 1 < argc)
+      {
+         num_threads = (unsigned)atoi(argv[++i]);
+         continue;
+      }
+
+      file->path = argv[i];
+      if (!filestream_read_file(file->path, &file->data, &file->len))
+      {
+         fprintf(stderr, "Could not read %s\n", file->path);
+         continue;
+      }
+      corpus.num_files++;
+   }
+
+   if (corpus.num_files)
+   {
+      retro_time_t single, threaded;
+
+      if (num_threads < 1)
+         num_threads = 1;
+
+      single   = bench_corpus_run(&corpus, 1);
+      threaded = bench_corpus_run(&corpus, num_threads);
+
+      if (corpus.failed)
+         fprintf(stderr, "%u files failed to decode\n", corpus.failed);
+
+      printf("\n%u files, %.1f megapixels\n", corpus.num_files,
+            corpus.pixels / 1e6);
+      printf("%-10s %10s %12s %10s\n",
+            "threads", "ms", "Mpixel/s", "ms/file");
+      printf("%-10u %10.1f %12.1f %10.2f\n", 1, single / 1000.0,
+            single ? (double)corpus.pixels / single : 0.0,
+            single / 1000.0 / corpus.num_files);
+      printf("%-10u %10.1f %12.1f %10.2f\n", num_threads, threaded / 1000.0,
+            threaded ? (double)corpus.pixels / threaded : 0.0,
+            threaded / 1000.0 / corpus.num_files);
+   }
+
+   for (j = 0; j < corpus.num_files; j++)
+      free(corpus.files[j].data);
+   free(corpus.files);
+   slock_free(corpus.lock);
+
+   return 0;
+}
@@ -31,23 +31,65 @@
 #include <libchdr/chd.h>
 #include <string/stdstring.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <features/features_cpu.h>
+#endif
+
 #define SECTOR_SIZE 2352
 #define SUBCODE_SIZE 96
 #define TRACK_PAD 4
+/* Hunks read in order before reading ahead, so short runs
+ * of sectors do not decompress hunks nobody asks for */
+#define SEQUENTIAL_HUNKS 3
+
+/* Used by streams opened after chdstream_set_cache() */
+static unsigned chdstream_cache_hunks     = CHDSTREAM_DEFAULT_CACHE_HUNKS;
+static unsigned chdstream_readahead_hunks = CHDSTREAM_DEFAULT_READAHEAD_HUNKS;
+
+struct chdstream_hunk
+{
+   uint8_t *data;
+   /* -1 if empty */
+   int32_t hunknum;
+   uint32_t last_use;
+};
 
 struct chdstream
 {
    chd_file *chd;
-   /* Loaded hunk */
-   uint8_t *hunkmem;
+   /* Decompressed hunks, least recently used goes first */
+   struct chdstream_hunk *hunks;
+   unsigned num_hunks;
+   /* Hunk read from, never replaced by the read-ahead thread */
+   unsigned current;
+   uint32_t use_count;
+   /* Last hunk read, to tell sequential reads apart */
+   int32_t last_hunknum;
+   /* Hunks read in order so far */
+   unsigned sequential;
+#ifdef HAVE_THREADS
+   /* Guards hunks, current and the read-ahead state */
+   slock_t *lock;
+   scond_t *cond;
+   sthread_t *ahead_thread;
+   /* Handle of the read-ahead thread, with its own codecs */
+   chd_file *ahead_chd;
+   uint8_t *ahead_buf;
+   /* Hunk being decompressed ahead, -1 if none */
+   int32_t ahead_hunknum;
+   /* Hunks still to decompress ahead */
+   uint32_t ahead_next;
+   uint32_t ahead_end;
+   unsigned readahead_hunks;
+   bool ahead_quit;
+#endif
    /* Byte offset where track data starts (after pregap) */
    size_t track_start;
    /* Byte offset where track data ends */
    size_t track_end;
    /* Byte offset of read cursor */
    size_t offset;
-   /* Loaded hunk number */
-   int32_t hunknum;
    /* Size of frame taken from each hunk */
    uint32_t frame_size;
    /* Offset of data within frame */
@@ -204,11 +246,24 @@ chdstream_find_track(chd_file *fd, int32_t track, metadata_t *meta)
    return chdstream_find_track_number(fd, track, meta);
 }
 
+void chdstream_set_cache(unsigned cache_hunks, unsigned readahead_hunks)
+{
+   /* One hunk being read and one being decompressed ahead
+    * leave room for the hunks decompressed before */
+   if (cache_hunks < 2)
+      cache_hunks     = 2;
+   if (readahead_hunks > cache_hunks - 2)
+      readahead_hunks = cache_hunks - 2;
+
+   chdstream_cache_hunks     = cache_hunks;
+   chdstream_readahead_hunks = readahead_hunks;
+}
+
 chdstream_t *chdstream_open(const char *path, int32_t track)
 {
    metadata_t meta;
+   unsigned i;
    uint32_t pregap         = 0;
-   uint8_t *hunkmem        = NULL;
    const chd_header *hd    = NULL;
    chdstream_t *stream     = NULL;
    chd_file *chd           = NULL;
@@ -220,28 +275,38 @@ chdstream_t *chdstream_open(const char *path, int32_t track)
    if (!chdstream_find_track(chd, track, &meta))
       goto error;
 
-   stream                  = (chdstream_t*)malloc(sizeof(*stream));
+   stream                  = (chdstream_t*)calloc(1, sizeof(*stream));
    if (!stream)
       goto error;
 
-   stream->chd             = NULL;
-   stream->swab            = false;
-   stream->frame_size      = 0;
-   stream->frame_offset    = 0;
-   stream->frames_per_hunk = 0;
-   stream->track_frame     = 0;
-   stream->track_start     = 0;
-   stream->track_end       = 0;
-   stream->offset          = 0;
-   stream->hunkmem         = NULL;
-   stream->hunknum         = -1;
+   stream->last_hunknum    = -1;
 
    hd                      = chd_get_header(chd);
-   hunkmem                 = (uint8_t*)malloc(hd->hunkbytes);
-   if (!hunkmem)
+   stream->hunks           = (struct chdstream_hunk*)calloc(
+         chdstream_cache_hunks, sizeof(*stream->hunks));
+   if (!stream->hunks)
       goto error;
 
-   stream->hunkmem         = hunkmem;
+   stream->num_hunks       = chdstream_cache_hunks;
+   for (i = 0; i < stream->num_hunks; i++)
+   {
+      stream->hunks[i].hunknum = -1;
+      stream->hunks[i].data    = (uint8_t*)malloc(hd->hunkbytes);
+      if (!stream->hunks[i].data)
+         goto error;
+   }
+
+#ifdef HAVE_THREADS
+   /* The thread itself is started by the first sequential reads,
+    * with a single core it would only take turns with this one */
+   stream->ahead_hunknum   = -1;
+   if (cpu_features_get_core_amount() > 1)
+      stream->readahead_hunks = chdstream_readahead_hunks;
+   stream->lock            = slock_new();
+   stream->cond            = scond_new();
+   if (!stream->lock || !stream->cond)
+      goto error;
+#endif
 
    if (string_is_equal(meta.type, "MODE1_RAW"))
       stream->frame_size   = SECTOR_SIZE;
@@ -280,38 +345,251 @@ error:
 
 void chdstream_close(chdstream_t *stream)
 {
+   unsigned i;
+
    if (!stream)
       return;
 
-   if (stream->hunkmem)
-      free(stream->hunkmem);
+#ifdef HAVE_THREADS
+   if (stream->ahead_thread)
+   {
+      slock_lock(stream->lock);
+      stream->ahead_quit = true;
+      scond_broadcast(stream->cond);
+      slock_unlock(stream->lock);
+      sthread_join(stream->ahead_thread);
+   }
+   if (stream->ahead_chd)
+      chd_close(stream->ahead_chd);
+   if (stream->ahead_buf)
+      free(stream->ahead_buf);
+   if (stream->cond)
+      scond_free(stream->cond);
+   if (stream->lock)
+      slock_free(stream->lock);
+#endif
+
+   if (stream->hunks)
+   {
+      for (i = 0; i < stream->num_hunks; i++)
+         if (stream->hunks[i].data)
+            free(stream->hunks[i].data);
+      free(stream->hunks);
+   }
    if (stream->chd)
       chd_close(stream->chd);
    free(stream);
 }
 
-static bool
-chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
+static void chdstream_swab(chdstream_t *stream, uint8_t *data)
 {
-   uint16_t *array;
+   uint32_t i;
+   uint32_t count  = chd_get_header(stream->chd)->hunkbytes / 2;
+   uint16_t *array = (uint16_t*)data;
 
-   if (hunknum == stream->hunknum)
-      return true;
+   for (i = 0; i < count; ++i)
+      array[i] = SWAP16(array[i]);
+}
+
+static int chdstream_find_hunk(chdstream_t *stream, int32_t hunknum)
+{
+   unsigned i;
+
+   for (i = 0; i < stream->num_hunks; i++)
+      if (stream->hunks[i].hunknum == hunknum)
+         return i;
+
+   return -1;
+}
+
+/* Least recently used hunk, except for the one being read from */
+static unsigned chdstream_oldest_hunk(chdstream_t *stream)
+{
+   unsigned i;
+   unsigned oldest = stream->current == 0 ? 1 : 0;
+
+   for (i = 0; i < stream->num_hunks; i++)
+   {
+      if (i == stream->current)
+         continue;
+      if (stream->hunks[i].hunknum < 0)
+         return i;
+      if (stream->hunks[i].last_use < stream->hunks[oldest].last_use)
+         oldest = i;
+   }
+
+   return oldest;
+}
+
+#ifdef HAVE_THREADS
+static void chdstream_ahead_thread(void *data)
+{
+   chdstream_t *stream = (chdstream_t*)data;
 
-   if (chd_read(stream->chd, hunknum, stream->hunkmem) != CHDERR_NONE)
-      return false;
+   slock_lock(stream->lock);
 
-   if (stream->swab)
+   for (;;)
    {
-      uint32_t i;
-      uint32_t count = chd_get_header(stream->chd)->hunkbytes / 2;
-      array          = (uint16_t*)stream->hunkmem;
-      for (i = 0; i < count; ++i)
-         array[i] = SWAP16(array[i]);
+      int32_t hunknum;
+      bool ok;
+
+      while (!stream->ahead_quit && stream->ahead_next >= stream->ahead_end)
+         scond_wait(stream->cond, stream->lock);
+
+      if (stream->ahead_quit)
+         break;
+
+      hunknum = stream->ahead_next++;
+      if (chdstream_find_hunk(stream, hunknum) >= 0)
+         continue;
+
+      stream->ahead_hunknum = hunknum;
+      slock_unlock(stream->lock);
+
+      ok = chd_read(stream->ahead_chd, hunknum,
+            stream->ahead_buf) == CHDERR_NONE;
+      if (ok && stream->swab)
+         chdstream_swab(stream, stream->ahead_buf);
+
+      slock_lock(stream->lock);
+
+      if (ok)
+      {
+         /* Trade buffers with the hunk it replaces */
+         struct chdstream_hunk *hunk = &stream->hunks[
+            chdstream_oldest_hunk(stream)];
+         uint8_t *buf                = hunk->data;
+
+         hunk->data                  = stream->ahead_buf;
+         hunk->hunknum               = hunknum;
+         hunk->last_use              = ++stream->use_count;
+         stream->ahead_buf           = buf;
+      }
+
+      stream->ahead_hunknum          = -1;
+      scond_broadcast(stream->cond);
+   }
+
+   slock_unlock(stream->lock);
+}
+
+/* Called with the lock held for every hunk read. A read of the
+ * hunk after the last one decompresses the next few ahead, any
+ * other read stops doing so. */
+static void chdstream_read_ahead(chdstream_t *stream, uint32_t hunknum)
+{
+   uint32_t total = chd_get_header(stream->chd)->totalhunks;
+
+   if (!stream->readahead_hunks)
+      return;
+
+   if ((int32_t)hunknum != stream->last_hunknum + 1)
+   {
+      stream->sequential = 0;
+      stream->ahead_end  = stream->ahead_next;
+      return;
+   }
+
+   if (++stream->sequential < SEQUENTIAL_HUNKS)
+      return;
+
+   if (!stream->ahead_thread)
+   {
+      if (!stream->ahead_chd)
+      {
+         /* Without a handle of its own, never try again */
+         if (chd_clone(stream->chd, &stream->ahead_chd) != CHDERR_NONE)
+         {
+            stream->readahead_hunks = 0;
+            return;
+         }
+         stream->ahead_buf = (uint8_t*)malloc(
+               chd_get_header(stream->chd)->hunkbytes);
+      }
+
+      if (stream->ahead_buf)
+         stream->ahead_thread = sthread_create(
+               chdstream_ahead_thread, stream);
+
+      if (!stream->ahead_thread)
+      {
+         stream->readahead_hunks = 0;
+         return;
+      }
+   }
+
+   stream->ahead_next = hunknum + 1;
+   stream->ahead_end  = hunknum + 1 + stream->readahead_hunks;
+   if (stream->ahead_end > total)
+      stream->ahead_end = total;
+
+   scond_broadcast(stream->cond);
+}
+#endif
+
+static uint8_t *chdstream_load_hunk(chdstream_t *stream, uint32_t hunknum)
+{
+   int slot;
+   bool miss = false;
+
+#ifdef HAVE_THREADS
+   slock_lock(stream->lock);
+#endif
+
+   slot = chdstream_find_hunk(stream, hunknum);
+
+#ifdef HAVE_THREADS
+   /* Cheaper to wait than to decompress it a second time */
+   while (slot < 0 && stream->ahead_hunknum == (int32_t)hunknum)
+   {
+      scond_wait(stream->cond, stream->lock);
+      slot = chdstream_find_hunk(stream, hunknum);
+   }
+#endif
+
+   if (slot < 0)
+   {
+      slot                        = chdstream_oldest_hunk(stream);
+      stream->hunks[slot].hunknum = hunknum;
+      miss                        = true;
+   }
+
+   stream->current                = slot;
+   stream->hunks[slot].last_use   = ++stream->use_count;
+
+   if ((int32_t)hunknum != stream->last_hunknum)
+   {
+#ifdef HAVE_THREADS
+      chdstream_read_ahead(stream, hunknum);
+#endif
+      stream->last_hunknum        = hunknum;
+   }
+
+#ifdef HAVE_THREADS
+   slock_unlock(stream->lock);
+#endif
+
+   /* The current hunk is left alone by the read-ahead thread */
+   if (miss)
+   {
+      if (chd_read(stream->chd, hunknum,
+               stream->hunks[slot].data) != CHDERR_NONE)
+      {
+#ifdef HAVE_THREADS
+         slock_lock(stream->lock);
+#endif
+         stream->hunks[slot].hunknum = -1;
+#ifdef HAVE_THREADS
+         slock_unlock(stream->lock);
+#endif
+         return NULL;
+      }
+
+      if (stream->swab)
+         chdstream_swab(stream, stream->hunks[slot].data);
    }
 
-   stream->hunknum = hunknum;
-   return true;
+   return stream->hunks[slot].data;
 }
 
 ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
@@ -344,12 +622,13 @@ ssize_t chdstream_read(chdstream_t *stream, void *data, size_t bytes)
          uint32_t hunk        = chd_frame / stream->frames_per_hunk;
          uint32_t hunk_offset = (chd_frame % stream->frames_per_hunk) 
             * hd->unitbytes;
+         uint8_t *hunkmem     = chdstream_load_hunk(stream, hunk);
 
-         if (!chdstream_load_hunk(stream, hunk))
+         if (!hunkmem)
             return -1;
 
          memcpy(out + data_offset,
-                stream->hunkmem + frame_offset
+                hunkmem + frame_offset
                 + hunk_offset + stream->frame_offset, amount);
       }
 
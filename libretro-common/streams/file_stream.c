@@ -584,6 +584,73 @@ error:
    return 0;
 }
 
+struct filestream_read_async
+{
+   libretro_vfs_implementation_read_async *async;
+   char *path;
+};
+
+/**
+ * filestream_read_file_async_begin:
+ * @path             : path to file.
+ *
+ * Starts reading the contents of a file in the background, where
+ * the platform allows it. Finish with filestream_read_file_async_end().
+ *
+ * Returns: handle, NULL on error.
+ */
+void *filestream_read_file_async_begin(const char *path)
+{
+   struct filestream_read_async *handle = NULL;
+
+   if (!path)
+      return NULL;
+
+   handle = (struct filestream_read_async*)malloc(sizeof(*handle));
+   if (!handle)
+      return NULL;
+
+   handle->async = NULL;
+   handle->path  = strdup(path);
+
+   /* A VFS interface from the frontend has no way of doing this */
+   if (!filestream_open_cb)
+      handle->async = retro_vfs_file_read_async_begin_impl(path);
+
+   return handle;
+}
+
+/**
+ * filestream_read_file_async_end:
+ * @data             : handle from filestream_read_file_async_begin().
+ * @buf              : same as for filestream_read_file(). If NULL,
+ *                     the read is cancelled.
+ *
+ * Waits for the read to finish, or does it now if it could not be
+ * started, and frees @data.
+ *
+ * Returns: same as filestream_read_file().
+ */
+int64_t filestream_read_file_async_end(void *data, void **buf, int64_t *len)
+{
+   int64_t ret                          = 0;
+   struct filestream_read_async *handle = (struct filestream_read_async*)data;
+
+   if (!handle)
+      return 0;
+
+   if (handle->async)
+      ret = retro_vfs_file_read_async_end_impl(handle->async, buf, len);
+
+   if (!ret && buf && handle->path)
+      ret = filestream_read_file(handle->path, buf, len);
+
+   free(handle->path);
+   free(handle);
+
+   return ret;
+}
+
 /**
  * filestream_write_file:
  * @path             : path to file.
@@ -31,6 +31,9 @@
 #if defined(HAVE_ZLIB)
 #include <streams/rzip_stream.h>
 #endif
+#ifdef HAVE_COMPRESSION
+#include <file/archive_file.h>
+#endif
 #include <encodings/crc32.h>
 
 struct intfstream_internal
@@ -62,6 +65,12 @@ struct intfstream_internal
    {
       rzipstream_t *fp;
    } rzip;
+#endif
+#ifdef HAVE_COMPRESSION
+   struct
+   {
+      file_archive_stream_t *fp;
+   } archive;
 #endif
    enum intfstream_type type;
 };
@@ -88,6 +97,12 @@ int64_t intfstream_get_size(intfstream_internal_t *intf)
          return rzipstream_get_size(intf->rzip.fp);
 #else
          break;
+#endif
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         return file_archive_stream_get_size(intf->archive.fp);
+#else
+         break;
 #endif
    }
 
@@ -115,6 +130,7 @@ bool intfstream_resize(intfstream_internal_t *intf, intfstream_info_t *info)
 #endif
          break;
       case INTFSTREAM_RZIP:
+      case INTFSTREAM_ARCHIVE:
          /* Unsupported */
          return false;
    }
@@ -157,6 +173,15 @@ bool intfstream_open(intfstream_internal_t *intf, const char *path,
          break;
 #else
          return false;
+#endif
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         intf->archive.fp = file_archive_stream_open(path);
+         if (!intf->archive.fp)
+            return false;
+         break;
+#else
+         return false;
 #endif
    }
 
@@ -175,6 +200,7 @@ int intfstream_flush(intfstream_internal_t *intf)
       case INTFSTREAM_MEMORY:
       case INTFSTREAM_CHD:
       case INTFSTREAM_RZIP:
+      case INTFSTREAM_ARCHIVE:
          /* Should we stub this for these interfaces? */
          break;
    }
@@ -207,6 +233,12 @@ int intfstream_close(intfstream_internal_t *intf)
 #if defined(HAVE_ZLIB)
          if (intf->rzip.fp)
             return rzipstream_close(intf->rzip.fp);
+#endif
+         return 0;
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         if (intf->archive.fp)
+            file_archive_stream_close(intf->archive.fp);
 #endif
          return 0;
    }
@@ -238,6 +270,9 @@ void *intfstream_init(intfstream_info_t *info)
 #ifdef HAVE_ZLIB
    intf->rzip.fp         = NULL;
 #endif
+#ifdef HAVE_COMPRESSION
+   intf->archive.fp      = NULL;
+#endif
 
    switch (intf->type)
    {
@@ -257,6 +292,12 @@ void *intfstream_init(intfstream_info_t *info)
 #endif
       case INTFSTREAM_RZIP:
          break;
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         break;
+#else
+         goto error;
+#endif
    }
 
    return intf;
@@ -304,6 +345,12 @@ int64_t intfstream_seek(
       case INTFSTREAM_RZIP:
          /* Unsupported */
          break;
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         return file_archive_stream_seek(intf->archive.fp, offset, whence);
+#else
+         break;
+#endif
    }
 
    return -1;
@@ -331,6 +378,12 @@ int64_t intfstream_read(intfstream_internal_t *intf, void *s, uint64_t len)
          return rzipstream_read(intf->rzip.fp, s, len);
 #else
          break;
+#endif
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         return file_archive_stream_read(intf->archive.fp, s, (int64_t)len);
+#else
+         break;
 #endif
    }
 
@@ -357,6 +410,8 @@ int64_t intfstream_write(intfstream_internal_t *intf,
 #else
          return -1;
 #endif
+      case INTFSTREAM_ARCHIVE:
+         return -1;
    }
 
    return 0;
@@ -391,6 +446,8 @@ int intfstream_printf(intfstream_internal_t *intf,
 #else
          return -1;
 #endif
+      case INTFSTREAM_ARCHIVE:
+         return -1;
    }
 
    return 0;
@@ -411,6 +468,8 @@ int64_t intfstream_get_ptr(intfstream_internal_t* intf)
          return -1;
       case INTFSTREAM_RZIP:
          return -1;
+      case INTFSTREAM_ARCHIVE:
+         return -1;
    }
 
    return 0;
@@ -441,6 +500,29 @@ char *intfstream_gets(intfstream_internal_t *intf,
          return rzipstream_gets(intf->rzip.fp, buffer, (size_t)len);
 #else
          break;
+#endif
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         {
+            uint64_t i = 0;
+
+            if (!len)
+               return NULL;
+
+            while (i < len - 1)
+            {
+               if (file_archive_stream_read(intf->archive.fp,
+                        buffer + i, 1) != 1)
+                  break;
+               if (buffer[i++] == '\n')
+                  break;
+            }
+
+            buffer[i] = '\0';
+            return i ? buffer : NULL;
+         }
+#else
+         break;
 #endif
    }
 
@@ -470,6 +552,15 @@ int intfstream_getc(intfstream_internal_t *intf)
 #else
          break;
 #endif
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         {
+            uint8_t c;
+            if (file_archive_stream_read(intf->archive.fp, &c, 1) == 1)
+               return c;
+         }
+#endif
+         break;
    }
 
    return -1;
@@ -497,6 +588,12 @@ int64_t intfstream_tell(intfstream_internal_t *intf)
          return (int64_t)rzipstream_tell(intf->rzip.fp);
 #else
          break;
+#endif
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         return file_archive_stream_tell(intf->archive.fp);
+#else
+         break;
 #endif
    }
 
@@ -525,6 +622,13 @@ int intfstream_eof(intfstream_internal_t *intf)
          return rzipstream_eof(intf->rzip.fp);
 #else
          break;
+#endif
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         return file_archive_stream_tell(intf->archive.fp)
+            >= file_archive_stream_get_size(intf->archive.fp);
+#else
+         break;
 #endif
    }
 
@@ -549,6 +653,11 @@ void intfstream_rewind(intfstream_internal_t *intf)
       case INTFSTREAM_RZIP:
 #if defined(HAVE_ZLIB)
          rzipstream_rewind(intf->rzip.fp);
+#endif
+         break;
+      case INTFSTREAM_ARCHIVE:
+#ifdef HAVE_COMPRESSION
+         file_archive_stream_seek(intf->archive.fp, 0, SEEK_SET);
 #endif
          break;
    }
@@ -575,6 +684,8 @@ void intfstream_putc(intfstream_internal_t *intf, int c)
 #else
          break;
 #endif
+      case INTFSTREAM_ARCHIVE:
+         break;
    }
 }
 
@@ -623,6 +734,8 @@ bool intfstream_is_compressed(intfstream_internal_t *intf)
 #else
          break;
 #endif
+      case INTFSTREAM_ARCHIVE:
+         return true;
    }
 
    return false;
@@ -637,6 +750,15 @@ bool intfstream_get_crc(intfstream_internal_t *intf, uint32_t *crc)
    if (!intf || !crc)
       return false;
 
+#ifdef HAVE_COMPRESSION
+   /* The archive directory already has it */
+   if (intf->type == INTFSTREAM_ARCHIVE)
+   {
+      *crc = file_archive_stream_get_crc32(intf->archive.fp);
+      return true;
+   }
+#endif
+
    /* Ensure we start at the beginning of the file */
    intfstream_rewind(intf);
 
@@ -791,3 +913,29 @@ error:
    }
    return NULL;
 }
+
+intfstream_t *intfstream_open_archive_member(const char *path,
+      unsigned mode, unsigned hints)
+{
+   intfstream_info_t info;
+   intfstream_t *fd = NULL;
+
+   info.type        = INTFSTREAM_ARCHIVE;
+   fd               = (intfstream_t*)intfstream_init(&info);
+
+   if (!fd)
+      return NULL;
+
+   if (!intfstream_open(fd, path, mode, hints))
+      goto error;
+
+   return fd;
+
+error:
+   if (fd)
+   {
+      intfstream_close(fd);
+      free(fd);
+   }
+   return NULL;
+}
@@ -164,6 +164,10 @@
 #include <vfs/vfs_implementation_cdrom.h>
 #endif
 
+#ifdef HAVE_IO_URING
+#include <file/nbio_uring.h>
+#endif
+
 #if (defined(_POSIX_C_SOURCE) && (_POSIX_C_SOURCE - 0) >= 200112) || (defined(__POSIX_VISIBLE) && __POSIX_VISIBLE >= 200112) || (defined(_POSIX_VERSION) && _POSIX_VERSION >= 200112) || __USE_LARGEFILE || (defined(_FILE_OFFSET_BITS) && _FILE_OFFSET_BITS == 64)
 #ifndef HAVE_64BIT_OFFSETS
 #define HAVE_64BIT_OFFSETS
@@ -796,7 +800,8 @@ int retro_vfs_file_remove_impl(const char *path)
 int retro_vfs_file_rename_impl(const char *old_path, const char *new_path)
 {
 #if defined(_WIN32) && !defined(_XBOX)
-   /* Win32 (no Xbox) */
+   /* Win32 (no Xbox). Replaces an existing 'new_path' like
+    * rename() does elsewhere, which _wrename() refuses to */
    int ret                 = -1;
 #if defined(_WIN32_WINNT) && _WIN32_WINNT < 0x0500
    char *old_path_local    = NULL;
@@ -816,6 +821,8 @@ int retro_vfs_file_rename_impl(const char *old_path, const char *new_path)
 
       if (new_path_local)
       {
+         /* No MoveFileEx() before Windows 2000 */
+         remove(new_path_local);
          if (rename(old_path_local, new_path_local) == 0)
             ret = 0;
          free(new_path_local);
@@ -832,7 +839,8 @@ int retro_vfs_file_rename_impl(const char *old_path, const char *new_path)
 
       if (new_path_wide)
       {
-         if (_wrename(old_path_wide, new_path_wide) == 0)
+         if (MoveFileExW(old_path_wide, new_path_wide,
+                  MOVEFILE_REPLACE_EXISTING))
             ret = 0;
          free(new_path_wide);
       }
@@ -866,6 +874,96 @@ const char *retro_vfs_file_get_path_impl(
    return stream->orig_path;
 }
 
+struct libretro_vfs_implementation_read_async
+{
+#ifdef HAVE_IO_URING
+   struct nbio_uring_op op;
+#endif
+   int fd;
+};
+
+libretro_vfs_implementation_read_async *retro_vfs_file_read_async_begin_impl(
+      const char *path)
+{
+#ifdef HAVE_IO_URING
+   struct stat st;
+   libretro_vfs_implementation_read_async *async = NULL;
+   int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+   if (fd < 0)
+      return NULL;
+
+   /* Pipes and devices have no size to allocate up front */
+   if (     fstat(fd, &st) != 0
+         || !S_ISREG(st.st_mode)
+         || (uint64_t)st.st_size >= SIZE_MAX
+         || !nbio_uring_acquire())
+   {
+      close(fd);
+      return NULL;
+   }
+
+   async = (libretro_vfs_implementation_read_async*)
+      calloc(1, sizeof(*async));
+   if (!async)
+      goto error;
+
+   async->fd        = fd;
+   async->op.fd     = fd;
+   async->op.len    = (size_t)st.st_size;
+   async->op.buf    = malloc(async->op.len + 1);
+   if (!async->op.buf || !nbio_uring_submit(&async->op))
+      goto error;
+
+   /* Get the kernel started right away */
+   nbio_uring_poll(&async->op, false);
+   return async;
+
+error:
+   if (async)
+      free(async->op.buf);
+   free(async);
+   nbio_uring_release();
+   close(fd);
+#endif
+   return NULL;
+}
+
+int64_t retro_vfs_file_read_async_end_impl(
+      libretro_vfs_implementation_read_async *async,
+      void **buf, int64_t *len)
+{
+   int64_t ret = 0;
+
+   if (!async)
+      return 0;
+
+#ifdef HAVE_IO_URING
+   if (buf)
+      nbio_uring_poll(&async->op, true);
+   else
+      nbio_uring_cancel(&async->op);
+
+   if (buf && !async->op.error)
+   {
+      /* Same as filestream_read_file(), safe to read as a string */
+      ((char*)async->op.buf)[async->op.done] = '\0';
+      *buf         = async->op.buf;
+      if (len)
+         *len      = (int64_t)async->op.done;
+      async->op.buf = NULL;
+      ret           = 1;
+   }
+
+   free(async->op.buf);
+   nbio_uring_release();
+   close(async->fd);
+#endif
+   free(async);
+
+   return ret;
+}
+
 int retro_vfs_stat_impl(const char *path, int32_t *size)
 {
    bool is_dir               = false;
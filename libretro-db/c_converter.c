@@ -832,6 +832,29 @@ int main(int argc, char** argv)
 
    filestream_close(rdb_file);
 
+   /* The frontend looks content up by CRC and serial, let
+    * those queries seek instead of scanning every record */
+   {
+      unsigned i;
+      static const char *index_fields[] = { "crc", "serial" };
+      libretrodb_t *db                  = libretrodb_new();
+
+      if (db && libretrodb_open(rdb_path, db) == 0)
+      {
+         for (i = 0; i < sizeof(index_fields) / sizeof(index_fields[0]); i++)
+         {
+            int rv = libretrodb_create_index(db,
+                  index_fields[i], index_fields[i]);
+
+            if (rv < 0 && rv != -ENOENT)
+               printf("  could not create index '%s': %s\n",
+                     index_fields[i], strerror(-rv));
+         }
+         libretrodb_close(db);
+      }
+      libretrodb_free(db);
+   }
+
    dat_converter_list_free(dat_parser_list);
 
    while (dat_count--)
@@ -35,26 +35,44 @@
 #include <retro_endianness.h>
 #include <string/stdstring.h>
 #include <compat/strl.h>
+#include <memmap.h>
+
+#if defined(HAVE_MMAN) || (defined(_WIN32) && !defined(_XBOX))
+#define LIBRETRODB_HAVE_MMAP
+#include <fcntl.h>
+#ifdef _WIN32
+#include <encodings/utf.h>
+#ifndef PROT_READ
+#define PROT_READ  0x1
+#endif
+#ifndef MAP_SHARED
+#define MAP_SHARED 0x01
+#endif
+#ifndef MAP_FAILED
+#define MAP_FAILED ((void*)-1)
+#endif
+#endif
+#endif
 
 #include "libretrodb.h"
 #include "rmsgpack_dom.h"
 #include "rmsgpack.h"
-#include "bintree.h"
 #include "query.h"
 #include "libretrodb.h"
 
 #define MAGIC_NUMBER "RARCHDB"
 
-struct node_iter_ctx
-{
-	libretrodb_t *db;
-	libretrodb_index_t *idx;
-};
+/* Most keys an or() may list and still be answered by an index seek. */
+#define LIBRETRODB_SEEK_MAX_KEYS 16
 
 struct libretrodb
 {
 	RFILE *fd;
    char *path;
+	/* The whole file, mapped by the first cursor that has to
+	 * scan the records */
+	const uint8_t *map;
+	uint64_t map_size;
 	uint64_t root;
 	uint64_t count;
 	uint64_t first_index_offset;
@@ -83,10 +101,36 @@ struct libretrodb_cursor
    RFILE *fd;
 	libretrodb_query_t *query;
 	libretrodb_t *db;
+	/* Record offsets found through an index, in file order.
+	 * Only these are read when is_seek is set. */
+	uint64_t *seek_offsets;
+	size_t seek_count;
+	size_t seek_pos;
+	/* Read position when reading from the mapped file */
+	uint64_t pos;
+	/* Fields named by a table query, for filtering mapped
+	 * records before decoding them */
+	struct rmsgpack_dom_pair *filter_fields;
+	unsigned filter_count;
+	char *filter_buff;
+	size_t filter_buff_size;
+	int is_filter_table;
+	int is_mapped;
+	int is_seek;
 	int is_valid;
 	int eof;
 };
 
+/* Index entries are the field value zero-padded to key_size,
+ * followed by the big-endian offset of the record, sorted by
+ * value and then offset so equal values are adjacent. */
+struct libretrodb_index_entry
+{
+   uint8_t *key;
+   uint64_t len;
+   uint64_t offset;
+};
+
 static int libretrodb_read_metadata(RFILE *fd, libretrodb_metadata_t *md)
 {
    return rmsgpack_dom_read_into(fd, "count", &md->count, NULL);
@@ -200,14 +244,70 @@ static void libretrodb_write_index_header(RFILE *fd, libretrodb_index_t *idx)
    rmsgpack_write_uint(fd, idx->next);
 }
 
+static void libretrodb_map(libretrodb_t *db)
+{
+#ifdef LIBRETRODB_HAVE_MMAP
+   int fd;
+   void *map;
+#ifdef _WIN32
+   struct _stati64 st;
+   wchar_t *path_w = utf8_to_utf16_string_alloc(db->path);
+
+   if (!path_w)
+      return;
+   fd = _wopen(path_w, _O_RDONLY | _O_BINARY);
+   free(path_w);
+
+   if (fd < 0)
+      return;
+
+   if (_fstati64(fd, &st) != 0)
+      goto end;
+#else
+   struct stat st;
+
+   if ((fd = open(db->path, O_RDONLY)) < 0)
+      return;
+
+   if (fstat(fd, &st) != 0)
+      goto end;
+#endif
+
+   if (st.st_size <= 0 || (uint64_t)st.st_size > (size_t)-1)
+      goto end;
+
+   map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+
+   if (map != MAP_FAILED)
+   {
+      db->map      = (const uint8_t*)map;
+      db->map_size = (uint64_t)st.st_size;
+   }
+
+   /* The mapping stays valid after the descriptor is closed */
+end:
+#ifdef _WIN32
+   _close(fd);
+#else
+   close(fd);
+#endif
+#endif
+}
+
 void libretrodb_close(libretrodb_t *db)
 {
+#ifdef LIBRETRODB_HAVE_MMAP
+   if (db->map)
+      munmap((void*)db->map, (size_t)db->map_size);
+#endif
    if (db->fd)
       filestream_close(db->fd);
    if (!string_is_empty(db->path))
       free(db->path);
-   db->path = NULL;
-   db->fd   = NULL;
+   db->path     = NULL;
+   db->fd       = NULL;
+   db->map      = NULL;
+   db->map_size = 0;
 }
 
 int libretrodb_open(const char *path, libretrodb_t *db)
@@ -261,93 +361,228 @@ error:
    return rv;
 }
 
-static int libretrodb_find_index(libretrodb_t *db, const char *index_name,
-      libretrodb_index_t *idx)
+static int libretrodb_find_index(libretrodb_t *db, RFILE *fd,
+      const char *index_name, libretrodb_index_t *idx)
 {
-   ssize_t eof    = filestream_get_size(db->fd);
-   ssize_t offset = filestream_seek(db->fd,
-         (ssize_t)db->first_index_offset,
+   int64_t eof    = filestream_get_size(fd);
+   int64_t offset = filestream_seek(fd,
+         (int64_t)db->first_index_offset,
          RETRO_VFS_SEEK_POSITION_START);
 
    /* TODO: this should use filestream_eof instead */
-   while (offset < eof)
+   while (offset >= 0 && offset < eof)
    {
-      libretrodb_read_index_header(db->fd, idx);
+      memset(idx, 0, sizeof(*idx));
+      if (libretrodb_read_index_header(fd, idx) < 0)
+         break;
+      idx->name[sizeof(idx->name) - 1] = '\0';
 
-      if (strncmp(index_name, idx->name, strlen(idx->name)) == 0)
+      if (string_is_equal(index_name, idx->name))
          return 0;
 
-      filestream_seek(db->fd, (ssize_t)idx->next,
+      filestream_seek(fd, (int64_t)idx->next,
             RETRO_VFS_SEEK_POSITION_CURRENT);
-      offset = filestream_tell(db->fd);
+      offset = filestream_tell(fd);
    }
 
    return -1;
 }
 
-static int binsearch(const void *buff, const void *item,
-      uint64_t count, uint8_t field_size, uint64_t *offset)
+static int libretrodb_push_offset(uint64_t **offsets,
+      size_t *count, size_t *cap, uint64_t offset)
 {
-   int mid            = (int)(count / 2);
-   int item_size      = field_size + sizeof(uint64_t);
-   uint64_t *current  = (uint64_t *)buff + (mid * item_size);
-   int rv             = memcmp(current, item, field_size);
-
-   if (rv == 0)
+   if (*count == *cap)
    {
-      *offset = *(uint64_t *)(current + field_size);
+      size_t new_cap   = *cap ? *cap * 2 : 8;
+      uint64_t *tmp    = (uint64_t*)realloc(*offsets,
+            new_cap * sizeof(uint64_t));
+      if (!tmp)
+         return -ENOMEM;
+      *offsets         = tmp;
+      *cap             = new_cap;
+   }
+   (*offsets)[(*count)++] = offset;
+   return 0;
+}
+
+/* Looks @key up in the index whose entries start at @start and
+ * appends the offsets of all records holding it. The index is
+ * binary searched in place, so only log2(n) entries are read. */
+static int libretrodb_index_seek(RFILE *fd,
+      const libretrodb_index_t *idx, int64_t start,
+      const struct rmsgpack_dom_value *key,
+      uint64_t **offsets, size_t *count, size_t *cap)
+{
+   uint64_t lo, hi, total;
+   uint8_t *buff       = NULL;
+   uint8_t *entry      = NULL;
+   int rv              = 0;
+   uint64_t entry_size = idx->key_size + sizeof(uint64_t);
+
+   if (     key->type != RDT_BINARY
+         || idx->key_size == 0
+         || key->val.binary.len > idx->key_size)
       return 0;
+
+   if (!(buff = (uint8_t*)calloc(1, (size_t)(idx->key_size + entry_size))))
+      return -ENOMEM;
+
+   memcpy(buff, key->val.binary.buff, key->val.binary.len);
+   entry = buff + idx->key_size;
+   total = idx->next / entry_size;
+   lo    = 0;
+   hi    = total;
+
+   while (lo < hi)
+   {
+      uint64_t mid = lo + (hi - lo) / 2;
+
+      filestream_seek(fd, start + (int64_t)(mid * entry_size),
+            RETRO_VFS_SEEK_POSITION_START);
+      if (filestream_read(fd, entry, (int64_t)entry_size)
+            != (int64_t)entry_size)
+      {
+         rv = -EIO;
+         goto end;
+      }
+
+      if (memcmp(entry, buff, (size_t)idx->key_size) < 0)
+         lo = mid + 1;
+      else
+         hi = mid;
    }
 
-   if (count == 0)
-      return -1;
+   filestream_seek(fd, start + (int64_t)(lo * entry_size),
+         RETRO_VFS_SEEK_POSITION_START);
+
+   for (; lo < total; lo++)
+   {
+      uint64_t offset;
+
+      if (filestream_read(fd, entry, (int64_t)entry_size)
+            != (int64_t)entry_size)
+      {
+         rv = -EIO;
+         break;
+      }
 
-   if (rv > 0)
-      return binsearch(buff, item, mid, field_size, offset);
+      if (memcmp(entry, buff, (size_t)idx->key_size) != 0)
+         break;
+
+      memcpy(&offset, entry + idx->key_size, sizeof(offset));
+      if ((rv = libretrodb_push_offset(offsets, count, cap,
+                  swap_if_little64(offset))) < 0)
+         break;
+   }
 
-   return binsearch(current + item_size, item,
-         count - mid, field_size, offset);
+end:
+   free(buff);
+   return rv;
 }
 
 int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
       const void *key, struct rmsgpack_dom_value *out)
 {
    libretrodb_index_t idx;
-   int rv;
-   void *buff;
-   uint64_t offset;
-   ssize_t bufflen, nread = 0;
+   struct rmsgpack_dom_value key_value;
+   uint64_t *offsets = NULL;
+   size_t count      = 0;
+   size_t cap        = 0;
+   int rv            = -1;
 
-   if (libretrodb_find_index(db, index_name, &idx) < 0)
+   if (libretrodb_find_index(db, db->fd, index_name, &idx) < 0)
       return -1;
 
-   bufflen = idx.next;
-   buff    = malloc(bufflen);
+   key_value.type            = RDT_BINARY;
+   key_value.val.binary.len  = (uint32_t)idx.key_size;
+   key_value.val.binary.buff = (char*)key;
 
-   if (!buff)
-      return -ENOMEM;
+   if (libretrodb_index_seek(db->fd, &idx, filestream_tell(db->fd),
+            &key_value, &offsets, &count, &cap) == 0 && count > 0)
+   {
+      filestream_seek(db->fd, (int64_t)offsets[0],
+            RETRO_VFS_SEEK_POSITION_START);
+      rv = rmsgpack_dom_read(db->fd, out);
+   }
 
-   while (nread < bufflen)
+   free(offsets);
+   return rv;
+}
+
+static int libretrodb_offset_cmp(const void *a, const void *b)
+{
+   uint64_t oa = *(const uint64_t*)a;
+   uint64_t ob = *(const uint64_t*)b;
+   return (oa > ob) - (oa < ob);
+}
+
+/* Looks for a table entry of the cursor's query that an index
+ * of the same name can answer, and if there is one collects the
+ * offsets of the candidate records. The query is still applied
+ * to each of them, so this only ever narrows down the scan. */
+static void libretrodb_cursor_plan(libretrodb_cursor_t *cursor)
+{
+   int n;
+   unsigned entry;
+   const struct rmsgpack_dom_value *keys[LIBRETRODB_SEEK_MAX_KEYS];
+
+   for (entry = 0; ; entry++)
    {
-      void *buff_ = (uint64_t *)buff + nread;
-      rv          = (int)filestream_read(db->fd, buff_, bufflen - nread);
+      int i;
+      libretrodb_index_t idx;
+      char name[sizeof(idx.name)];
+      int64_t start;
+      size_t j, unique;
+      size_t cap                              = 0;
+      const struct rmsgpack_dom_value *field  = NULL;
+
+      n = libretrodb_query_get_seek_keys(cursor->query, entry,
+            &field, keys, LIBRETRODB_SEEK_MAX_KEYS);
+
+      if (n < 0)
+         break;
+      if (n == 0 || field->val.string.len >= sizeof(name))
+         continue;
+
+      memcpy(name, field->val.string.buff, field->val.string.len);
+      name[field->val.string.len] = '\0';
+
+      if (libretrodb_find_index(cursor->db, cursor->fd, name, &idx) < 0)
+         continue;
 
-      if (rv <= 0)
+      start = filestream_tell(cursor->fd);
+
+      for (i = 0; i < n; i++)
       {
-         free(buff);
-         return -errno;
+         if (libretrodb_index_seek(cursor->fd, &idx, start, keys[i],
+                  &cursor->seek_offsets, &cursor->seek_count, &cap) < 0)
+            break;
       }
-      nread += rv;
-   }
 
-   rv = binsearch(buff, key, db->count, (ssize_t)idx.key_size, &offset);
-   free(buff);
+      if (i < n)
+      {
+         /* Fall back to a full scan */
+         free(cursor->seek_offsets);
+         cursor->seek_offsets = NULL;
+         cursor->seek_count   = 0;
+         continue;
+      }
 
-   if (rv == 0)
-      filestream_seek(db->fd, (ssize_t)offset,
-            RETRO_VFS_SEEK_POSITION_START);
+      /* An or() of several keys may hit the same record twice */
+      if (cursor->seek_count > 1)
+         qsort(cursor->seek_offsets, cursor->seek_count,
+               sizeof(uint64_t), libretrodb_offset_cmp);
+      for (j = 1, unique = cursor->seek_count ? 1 : 0;
+            j < cursor->seek_count; j++)
+         if (cursor->seek_offsets[j] != cursor->seek_offsets[unique - 1])
+            cursor->seek_offsets[unique++] = cursor->seek_offsets[j];
+
+      cursor->seek_count = unique;
+      cursor->is_seek    = 1;
+      break;
+   }
 
-   return rmsgpack_dom_read(db->fd, out);
+   libretrodb_cursor_reset(cursor);
 }
 
 /**
@@ -360,12 +595,197 @@ int libretrodb_find_entry(libretrodb_t *db, const char *index_name,
  **/
 int libretrodb_cursor_reset(libretrodb_cursor_t *cursor)
 {
-   cursor->eof = 0;
+   cursor->eof      = 0;
+   cursor->seek_pos = 0;
+   cursor->pos      = cursor->db->root + sizeof(libretrodb_header_t);
    return (int)filestream_seek(cursor->fd,
          (ssize_t)(cursor->db->root + sizeof(libretrodb_header_t)),
          RETRO_VFS_SEEK_POSITION_START);
 }
 
+static uint64_t libretrodb_cursor_tell(libretrodb_cursor_t *cursor)
+{
+   if (cursor->is_mapped)
+      return cursor->pos;
+   return (uint64_t)filestream_tell(cursor->fd);
+}
+
+/* Collects the fields a table query names, so that mapped
+ * records can be filtered on just those. */
+static void libretrodb_cursor_prepare_filter(libretrodb_cursor_t *cursor)
+{
+   int rv;
+   unsigned i, n;
+   const struct rmsgpack_dom_value *field = NULL;
+
+   for (n = 0; (rv = libretrodb_query_get_table_field(
+               cursor->query, n, &field)) == 1; n++);
+
+   if (rv < 0)
+      return;
+
+   cursor->filter_fields = (struct rmsgpack_dom_pair*)
+      calloc(n ? n : 1, sizeof(*cursor->filter_fields));
+
+   if (!cursor->filter_fields)
+      return;
+
+   /* The keys stay owned by the query */
+   for (i = 0; i < n; i++)
+   {
+      libretrodb_query_get_table_field(cursor->query, i, &field);
+      cursor->filter_fields[i].key = *field;
+   }
+
+   cursor->filter_count    = n;
+   cursor->is_filter_table = 1;
+}
+
+/* Runs the query on a map of only the fields it names, read
+ * lazily from the encoded record @rec. Strings are copied out so
+ * they are NUL-terminated like decoded ones.
+ *
+ * Returns: 1 if the record matches, 0 if not, -1 if it has to be
+ * decoded to tell. */
+static int libretrodb_cursor_filter_mapped(libretrodb_cursor_t *cursor,
+      const uint8_t *rec, size_t len)
+{
+   unsigned i;
+   struct rmsgpack_dom_value map;
+   size_t needed                    = 0;
+   char *buff                       = NULL;
+   struct rmsgpack_dom_pair *fields = cursor->filter_fields;
+
+   for (i = 0; i < cursor->filter_count; i++)
+   {
+      struct rmsgpack_dom_value *v = &fields[i].value;
+      int rv = rmsgpack_dom_map_value_buf(rec, len, &fields[i].key, v);
+
+      if (rv < 0)
+         return -1;
+
+      /* Missing fields compare as nil */
+      if (rv == 1)
+         v->type = RDT_NULL;
+
+      switch (v->type)
+      {
+         case RDT_MAP:
+         case RDT_ARRAY:
+            return -1;
+         case RDT_STRING:
+            needed += v->val.string.len + 1;
+            break;
+         case RDT_BINARY:
+            needed += v->val.binary.len + 1;
+            break;
+         default:
+            break;
+      }
+   }
+
+   if (needed > cursor->filter_buff_size)
+   {
+      char *tmp = (char*)realloc(cursor->filter_buff, needed);
+      if (!tmp)
+         return -1;
+      cursor->filter_buff      = tmp;
+      cursor->filter_buff_size = needed;
+   }
+
+   buff = cursor->filter_buff;
+
+   for (i = 0; i < cursor->filter_count; i++)
+   {
+      struct rmsgpack_dom_value *v = &fields[i].value;
+
+      if (v->type == RDT_STRING)
+      {
+         memcpy(buff, v->val.string.buff, v->val.string.len);
+         buff[v->val.string.len] = '\0';
+         v->val.string.buff      = buff;
+         buff                   += v->val.string.len + 1;
+      }
+      else if (v->type == RDT_BINARY)
+      {
+         memcpy(buff, v->val.binary.buff, v->val.binary.len);
+         buff[v->val.binary.len] = '\0';
+         v->val.binary.buff      = buff;
+         buff                   += v->val.binary.len + 1;
+      }
+   }
+
+   map.type          = RDT_MAP;
+   map.val.map.len   = cursor->filter_count;
+   map.val.map.items = fields;
+
+   return libretrodb_query_filter(cursor->query, &map);
+}
+
+/* Reads records straight from the mapped file. A table query is
+ * answered from the few fields it names, so records it rejects
+ * are skipped without being decoded. */
+static int libretrodb_cursor_read_mapped(libretrodb_cursor_t *cursor,
+      struct rmsgpack_dom_value *out)
+{
+   const uint8_t *map = cursor->db->map;
+   size_t size        = (size_t)cursor->db->map_size;
+
+   for (;;)
+   {
+      int rv;
+      size_t start, end, pos;
+      struct rmsgpack_dom_value peek;
+      int match = -1;
+
+      if (cursor->is_seek)
+      {
+         if (cursor->seek_pos >= cursor->seek_count)
+            break;
+         cursor->pos = cursor->seek_offsets[cursor->seek_pos++];
+      }
+
+      if (cursor->pos >= size)
+         break;
+
+      start = end = pos = (size_t)cursor->pos;
+
+      /* The records end with a nil */
+      if ((rv = rmsgpack_dom_peek_buf(map, size, &pos, &peek)) < 0)
+         return rv;
+      if (peek.type == RDT_NULL)
+         break;
+
+      if ((rv = rmsgpack_skip_buf(map, size, &end)) < 0)
+         return rv;
+      cursor->pos = end;
+
+      if (cursor->query && cursor->is_filter_table)
+      {
+         if ((match = libretrodb_cursor_filter_mapped(cursor,
+                     map + start, end - start)) == 0)
+            continue;
+      }
+
+      pos = 0;
+      if ((rv = rmsgpack_dom_read_buf(map + start, end - start,
+                  &pos, out)) < 0)
+         return rv;
+
+      if (cursor->query && match < 0
+            && !libretrodb_query_filter(cursor->query, out))
+      {
+         rmsgpack_dom_value_free(out);
+         continue;
+      }
+
+      return 0;
+   }
+
+   cursor->eof = 1;
+   return EOF;
+}
+
 int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
       struct rmsgpack_dom_value *out)
 {
@@ -374,7 +794,22 @@ int libretrodb_cursor_read_item(libretrodb_cursor_t *cursor,
    if (cursor->eof)
       return EOF;
 
+   if (cursor->is_mapped)
+      return libretrodb_cursor_read_mapped(cursor, out);
+
 retry:
+   if (cursor->is_seek)
+   {
+      if (cursor->seek_pos >= cursor->seek_count)
+      {
+         cursor->eof = 1;
+         return EOF;
+      }
+      filestream_seek(cursor->fd,
+            (int64_t)cursor->seek_offsets[cursor->seek_pos++],
+            RETRO_VFS_SEEK_POSITION_START);
+   }
+
    rv = rmsgpack_dom_read(cursor->fd, out);
    if (rv < 0)
       return rv;
@@ -414,11 +849,29 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
    if (cursor->query)
       libretrodb_query_free(cursor->query);
 
-   cursor->is_valid = 0;
-   cursor->eof      = 1;
-   cursor->fd       = NULL;
-   cursor->db       = NULL;
-   cursor->query    = NULL;
+   if (cursor->seek_offsets)
+      free(cursor->seek_offsets);
+
+   if (cursor->filter_fields)
+      free(cursor->filter_fields);
+
+   if (cursor->filter_buff)
+      free(cursor->filter_buff);
+
+   cursor->is_valid         = 0;
+   cursor->eof              = 1;
+   cursor->fd               = NULL;
+   cursor->db               = NULL;
+   cursor->query            = NULL;
+   cursor->seek_offsets     = NULL;
+   cursor->seek_count       = 0;
+   cursor->is_seek          = 0;
+   cursor->filter_fields    = NULL;
+   cursor->filter_count     = 0;
+   cursor->filter_buff      = NULL;
+   cursor->filter_buff_size = 0;
+   cursor->is_filter_table  = 0;
+   cursor->is_mapped        = 0;
 }
 
 /**
@@ -427,7 +880,9 @@ void libretrodb_cursor_close(libretrodb_cursor_t *cursor)
  * @cursor              : Handle to database cursor.
  * @q                   : Query to execute.
  *
- * Opens cursor to database based on query @q.
+ * Opens cursor to database based on query @q. When @q
+ * compares a field that has an index of the same name against
+ * binary values, only the records found in the index are read.
  *
  * Returns: 0 if successful, otherwise negative.
  **/
@@ -446,133 +901,227 @@ int libretrodb_cursor_open(libretrodb_t *db,
    if (!fd)
       return -errno;
 
-   cursor->fd       = fd;
-   cursor->db       = db;
-   cursor->is_valid = 1;
+   cursor->fd               = fd;
+   cursor->db               = db;
+   cursor->is_valid         = 1;
+   cursor->seek_offsets     = NULL;
+   cursor->seek_count       = 0;
+   cursor->is_seek          = 0;
+   cursor->filter_fields    = NULL;
+   cursor->filter_count     = 0;
+   cursor->filter_buff      = NULL;
+   cursor->filter_buff_size = 0;
+   cursor->is_filter_table  = 0;
+   cursor->is_mapped        = 0;
    libretrodb_cursor_reset(cursor);
-   cursor->query    = q;
+   cursor->query            = q;
 
    if (q)
+   {
       libretrodb_query_inc_ref(q);
+      libretrodb_cursor_plan(cursor);
+   }
 
-   return 0;
-}
-
-static int node_iter(void *value, void *ctx)
-{
-   struct node_iter_ctx *nictx = (struct node_iter_ctx*)ctx;
+   /* An index seek only reads a few records, mapping the file
+    * costs more than it saves there */
+   if (!cursor->is_seek)
+   {
+      if (!db->map)
+         libretrodb_map(db);
 
-   if (filestream_write(nictx->db->fd, value,
-            (ssize_t)(nictx->idx->key_size + sizeof(uint64_t))) > 0)
-      return 0;
+      if (db->map)
+      {
+         cursor->is_mapped = 1;
+         if (q)
+            libretrodb_cursor_prepare_filter(cursor);
+      }
+   }
 
-   return -1;
+   return 0;
 }
 
-static uint64_t libretrodb_tell(libretrodb_t *db)
+static int libretrodb_index_entry_cmp(const void *a, const void *b)
 {
-   return filestream_tell(db->fd);
-}
+   const struct libretrodb_index_entry *ea =
+      (const struct libretrodb_index_entry*)a;
+   const struct libretrodb_index_entry *eb =
+      (const struct libretrodb_index_entry*)b;
+   uint64_t len = ea->len < eb->len ? ea->len : eb->len;
+   uint64_t i;
+   int rv       = memcmp(ea->key, eb->key, (size_t)len);
+
+   if (rv != 0)
+      return rv;
 
-static int node_compare(const void *a, const void *b, void *ctx)
-{
-   return memcmp(a, b, *(uint8_t *)ctx);
+   /* Compare as if both were zero-padded to the same size */
+   for (i = len; i < ea->len; i++)
+      if (ea->key[i])
+         return 1;
+   for (i = len; i < eb->len; i++)
+      if (eb->key[i])
+         return -1;
+
+   return (ea->offset > eb->offset) - (ea->offset < eb->offset);
 }
 
+/**
+ * libretrodb_create_index:
+ * @db                  : Handle to database.
+ * @name                : Name of the index.
+ * @field_name          : Binary field to index.
+ *
+ * Appends an index over @field_name to the database file.
+ * Records without the field are left out, and values may repeat.
+ * Queries only use an index whose name is the field name.
+ *
+ * Returns: 0 if successful, -EEXIST if an index called @name
+ * already exists, -ENOENT if no record has the field, otherwise
+ * negative.
+ **/
 int libretrodb_create_index(libretrodb_t *db,
       const char *name, const char *field_name)
 {
-   struct node_iter_ctx nictx;
-   struct rmsgpack_dom_value key;
    libretrodb_index_t idx;
+   struct rmsgpack_dom_value key;
    struct rmsgpack_dom_value item;
-   libretrodb_cursor_t cur          = {0};
-   struct rmsgpack_dom_value *field = NULL;
-   void *buff                       = NULL;
-   uint64_t *buff_u64               = NULL;
-   uint8_t field_size               = 0;
-   uint64_t item_loc                = libretrodb_tell(db);
-   bintree_t *tree                  = bintree_new(node_compare, &field_size);
+   size_t i;
+   libretrodb_cursor_t cur                  = {0};
+   struct libretrodb_index_entry *entries   = NULL;
+   size_t count                             = 0;
+   size_t cap                               = 0;
+   uint64_t key_size                        = 0;
+   uint8_t *buff                            = NULL;
+   RFILE *fd                                = NULL;
+   int rv                                   = 0;
+   int64_t item_loc                         = 0;
+
+   item.type = RDT_NULL;
+
+   if (!db || string_is_empty(db->path))
+      return -EINVAL;
 
-   item.type                        = RDT_NULL;
+   fd = filestream_open(db->path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!fd)
+      return -errno;
+
+   if (libretrodb_find_index(db, fd, name, &idx) == 0)
+   {
+      rv = -EEXIST;
+      goto clean;
+   }
 
-   if (!tree || (libretrodb_cursor_open(db, &cur, NULL) != 0))
+   if ((rv = libretrodb_cursor_open(db, &cur, NULL)) != 0)
       goto clean;
 
    key.type            = RDT_STRING;
    key.val.string.len  = (uint32_t)strlen(field_name);
    key.val.string.buff = (char *) field_name;   /* We know we aren't going to change it */
 
+   item_loc            = libretrodb_cursor_tell(&cur);
+
    while (libretrodb_cursor_read_item(&cur, &item) == 0)
    {
-      /* Only map keys are supported */
-      if (item.type != RDT_MAP)
-         goto clean;
+      struct rmsgpack_dom_value *field = NULL;
 
-      field = rmsgpack_dom_value_map_value(&item, &key);
+      if (item.type == RDT_MAP)
+         field = rmsgpack_dom_value_map_value(&item, &key);
 
-      /* Field not found in item */
-      if (!field)
-         goto clean;
+      /* Only non-empty binary fields are indexed */
+      if (     field
+            && field->type == RDT_BINARY
+            && field->val.binary.len > 0)
+      {
+         if (count == cap)
+         {
+            size_t new_cap = cap ? cap * 2 : 1024;
+            struct libretrodb_index_entry *tmp =
+               (struct libretrodb_index_entry*)realloc(entries,
+                     new_cap * sizeof(*entries));
+
+            if (!tmp)
+            {
+               rv = -ENOMEM;
+               goto clean;
+            }
+            entries = tmp;
+            cap     = new_cap;
+         }
+
+         entries[count].len    = field->val.binary.len;
+         entries[count].offset = (uint64_t)item_loc;
+         entries[count].key    = (uint8_t*)malloc(field->val.binary.len);
+
+         if (!entries[count].key)
+         {
+            rv = -ENOMEM;
+            goto clean;
+         }
+
+         memcpy(entries[count].key, field->val.binary.buff,
+               field->val.binary.len);
+
+         if (field->val.binary.len > key_size)
+            key_size = field->val.binary.len;
+         count++;
+      }
 
-      /* Field is not binary */
-      if (field->type != RDT_BINARY)
-         goto clean;
+      rmsgpack_dom_value_free(&item);
+      item.type = RDT_NULL;
+      item_loc  = libretrodb_cursor_tell(&cur);
+   }
 
-      /* Field is empty */
-      if (field->val.binary.len == 0)
-         goto clean;
+   if (count == 0)
+   {
+      rv = -ENOENT;
+      goto clean;
+   }
 
-      if (field_size == 0)
-         field_size = field->val.binary.len;
-      /* Field is not of correct size */
-      else if (field->val.binary.len != field_size) 
-         goto clean;
+   qsort(entries, count, sizeof(*entries), libretrodb_index_entry_cmp);
 
-      buff = malloc(field_size + sizeof(uint64_t));
-      if (!buff)
-         goto clean;
+   if (!(buff = (uint8_t*)malloc((size_t)key_size + sizeof(uint64_t))))
+   {
+      rv = -ENOMEM;
+      goto clean;
+   }
 
-      memcpy(buff, field->val.binary.buff, field_size);
+   filestream_seek(fd, 0, RETRO_VFS_SEEK_POSITION_END);
 
-      buff_u64 = (uint64_t *)buff + field_size;
+   memset(&idx, 0, sizeof(idx));
+   strlcpy(idx.name, name, sizeof(idx.name));
+   idx.key_size = key_size;
+   idx.next     = count * (key_size + sizeof(uint64_t));
+   libretrodb_write_index_header(fd, &idx);
 
-      memcpy(buff_u64, &item_loc, sizeof(uint64_t));
+   for (i = 0; i < count; i++)
+   {
+      uint64_t offset = swap_if_little64(entries[i].offset);
+
+      memset(buff, 0, (size_t)key_size);
+      memcpy(buff, entries[i].key, (size_t)entries[i].len);
+      memcpy(buff + key_size, &offset, sizeof(offset));
 
-      /* Value is not unique? */
-      if (bintree_insert(tree, buff) != 0)
+      if (filestream_write(fd, buff, (int64_t)(key_size + sizeof(uint64_t)))
+            != (int64_t)(key_size + sizeof(uint64_t)))
       {
-         rmsgpack_dom_value_print(field);
-         goto clean;
+         rv = -EIO;
+         break;
       }
-      buff     = NULL;
-      rmsgpack_dom_value_free(&item);
-      item_loc = libretrodb_tell(db);
    }
 
-   filestream_seek(db->fd, 0, RETRO_VFS_SEEK_POSITION_END);
-
-   strncpy(idx.name, name, 50);
-
-   idx.name[49] = '\0';
-   idx.key_size = field_size;
-   idx.next     = db->count * (field_size + sizeof(uint64_t));
-   libretrodb_write_index_header(db->fd, &idx);
-
-   nictx.db     = db;
-   nictx.idx    = &idx;
-   bintree_iterate(tree, node_iter, &nictx);
-
 clean:
    rmsgpack_dom_value_free(&item);
-   if (buff)
-      free(buff);
+   for (i = 0; i < count; i++)
+      free(entries[i].key);
+   free(entries);
+   free(buff);
    if (cur.is_valid)
       libretrodb_cursor_close(&cur);
-   if (tree)
-      bintree_free(tree);
-   free(tree);
-   return 0;
+   filestream_close(fd);
+   return rv;
 }
 
 libretrodb_cursor_t *libretrodb_cursor_new(void)
@@ -585,6 +1134,17 @@ libretrodb_cursor_t *libretrodb_cursor_new(void)
 
    dbc->is_valid            = 0;
    dbc->fd                  = NULL;
+   dbc->seek_offsets        = NULL;
+   dbc->seek_count          = 0;
+   dbc->seek_pos            = 0;
+   dbc->is_seek             = 0;
+   dbc->pos                 = 0;
+   dbc->filter_fields       = NULL;
+   dbc->filter_count        = 0;
+   dbc->filter_buff         = NULL;
+   dbc->filter_buff_size    = 0;
+   dbc->is_filter_table     = 0;
+   dbc->is_mapped           = 0;
    dbc->eof                 = 0;
    dbc->query               = NULL;
    dbc->db                  = NULL;
@@ -612,6 +1172,8 @@ libretrodb_t *libretrodb_new(void)
    db->count              = 0;
    db->first_index_offset = 0;
    db->path               = NULL;
+   db->map                = NULL;
+   db->map_size           = 0;
 
    return db;
 }
@@ -51,6 +51,19 @@ void libretrodb_close(libretrodb_t *db);
 
 int libretrodb_open(const char *path, libretrodb_t *db);
 
+/**
+ * libretrodb_create_index:
+ * @db                  : Handle to database.
+ * @name                : Name of the index.
+ * @field_name          : Binary field to index.
+ *
+ * Appends an index over @field_name to the database file.
+ * Queries only use an index whose name is the field name.
+ *
+ * Returns: 0 if successful, -EEXIST if an index called @name
+ * already exists, -ENOENT if no record has the field, otherwise
+ * negative.
+ **/
 int libretrodb_create_index(libretrodb_t *db, const char *name,
       const char *field_name);
 
@@ -0,0 +1,226 @@
+/* Copyright  (C) 2010-2020 The KingStation team
+ *
+ * ---------------------------------------------------------------------------------------
+ * The following license statement only applies to this file (libretrodb_bench.c).
+ * ---------------------------------------------------------------------------------------
+ *
+ * Permission is hereby granted, free of charge,
+ * to any person obtaining a copy of this software and associated documentation files (the "Software"),
+ * to deal in the Software without restriction, including without limitation the rights to
+ * use, copy, modify, merge, publish, distribute, sublicense, and/or sell copies of the Software,
+ * and to permit persons to whom the Software is furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED,
+ * INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.
+ * IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY,
+ * WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ */
+
+/* Looks CRCs up in a set of databases the way the content scanner
+ * does: every lookup opens each database in turn, compiles a
+ * {crc:or(b"...",b"...")} query and reads all matches. Each lookup
+ * is run once through the cursor, which seeks when the database
+ * has a crc index, and once as a full scan filtering every record,
+ * and both must return the same number of records.
+ *
+ * Usage: libretrodb_bench <lookups> <db file> [db file ...]
+ *
+ * Half of the lookups use a CRC taken from the databases, the
+ * other half one that is most likely in none of them. Finally
+ * every record is read once, as the database views do.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include <string/stdstring.h>
+
+#include "libretrodb.h"
+
+static double bench_now(void)
+{
+   struct timespec ts;
+   clock_gettime(CLOCK_MONOTONIC, &ts);
+   return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/* Returns the number of records matching @query in @path, or -1. */
+static int bench_lookup(const char *path, const char *query, int scan)
+{
+   struct rmsgpack_dom_value item;
+   const char *error        = NULL;
+   libretrodb_query_t *q    = NULL;
+   libretrodb_t *db         = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+   int found                = -1;
+
+   if (!db || !cur || libretrodb_open(path, db) != 0)
+      goto end;
+
+   q = (libretrodb_query_t*)libretrodb_query_compile(db, query,
+         strlen(query), &error);
+
+   if (error || !q)
+      goto end;
+
+   if (libretrodb_cursor_open(db, cur, scan ? NULL : q) != 0)
+      goto end;
+
+   found = 0;
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      if (!scan || libretrodb_query_filter(q, &item))
+         found++;
+      rmsgpack_dom_value_free(&item);
+   }
+
+   libretrodb_cursor_close(cur);
+
+end:
+   if (q)
+      libretrodb_query_free(q);
+   libretrodb_close(db);
+   libretrodb_free(db);
+   libretrodb_cursor_free(cur);
+   return found;
+}
+
+/* Collects the CRC of every record in @path. */
+static size_t bench_collect_crcs(const char *path,
+      uint32_t **crcs, size_t count, size_t *cap)
+{
+   struct rmsgpack_dom_value item;
+   struct rmsgpack_dom_value key;
+   libretrodb_t *db         = libretrodb_new();
+   libretrodb_cursor_t *cur = libretrodb_cursor_new();
+
+   key.type            = RDT_STRING;
+   key.val.string.len  = 3;
+   key.val.string.buff = (char*)"crc";
+
+   if (!db || !cur || libretrodb_open(path, db) != 0
+         || libretrodb_cursor_open(db, cur, NULL) != 0)
+      goto end;
+
+   while (libretrodb_cursor_read_item(cur, &item) == 0)
+   {
+      struct rmsgpack_dom_value *crc = NULL;
+
+      if (item.type == RDT_MAP)
+         crc = rmsgpack_dom_value_map_value(&item, &key);
+
+      if (crc && crc->type == RDT_BINARY && crc->val.binary.len == 4)
+      {
+         const uint8_t *b = (const uint8_t*)crc->val.binary.buff;
+
+         if (count == *cap)
+         {
+            *cap  = *cap ? *cap * 2 : 1024;
+            *crcs = (uint32_t*)realloc(*crcs, *cap * sizeof(uint32_t));
+         }
+         (*crcs)[count++] = ((uint32_t)b[0] << 24) | (b[1] << 16)
+            | (b[2] << 8) | b[3];
+      }
+      rmsgpack_dom_value_free(&item);
+   }
+
+   libretrodb_cursor_close(cur);
+
+end:
+   libretrodb_close(db);
+   libretrodb_free(db);
+   libretrodb_cursor_free(cur);
+   return count;
+}
+
+int main(int argc, char **argv)
+{
+   int i, pass;
+   size_t cap        = 0;
+   size_t num_crcs   = 0;
+   uint32_t *crcs    = NULL;
+   long lookups      = argc > 2 ? strtol(argv[1], NULL, 10) : 0;
+   double elapsed[2] = {0};
+   double walk_start, walk_time;
+   long matches[2]   = {0};
+   char (*queries)[64];
+
+   if (lookups <= 0)
+   {
+      fprintf(stderr, "Usage: %s <lookups> <db file> [db file ...]\n",
+            argv[0]);
+      return 1;
+   }
+
+   walk_start = bench_now();
+   for (i = 2; i < argc; i++)
+      num_crcs = bench_collect_crcs(argv[i], &crcs, num_crcs, &cap);
+   walk_time  = bench_now() - walk_start;
+
+   if (!num_crcs)
+   {
+      fprintf(stderr, "No CRCs found in the databases.\n");
+      return 1;
+   }
+
+   /* The scanner queries the CRC of the file and of the archive
+    * member, build the same kind of two-key queries */
+   queries = (char (*)[64])malloc(lookups * sizeof(*queries));
+   if (!queries)
+      return 1;
+
+   srand(1);
+   for (i = 0; i < lookups; i++)
+   {
+      uint32_t hit  = crcs[(size_t)rand() % num_crcs];
+      uint32_t miss = ((uint32_t)rand() << 16) ^ (uint32_t)rand();
+      snprintf(queries[i], sizeof(queries[i]),
+            "{crc:or(b\"%08X\",b\"%08X\")}",
+            (i & 1) ? miss : hit, miss ^ 0x5A5A5A5A);
+   }
+
+   for (pass = 0; pass < 2; pass++)
+   {
+      double start = bench_now();
+
+      for (i = 0; i < lookups; i++)
+      {
+         int j;
+         for (j = 2; j < argc; j++)
+         {
+            int found = bench_lookup(argv[j], queries[i], pass);
+            if (found > 0)
+               matches[pass] += found;
+         }
+      }
+
+      elapsed[pass] = bench_now() - start;
+   }
+
+   printf("%d databases, %u CRCs, %ld lookups\n",
+         argc - 2, (unsigned)num_crcs, lookups);
+   printf("%-6s %12s %12s %10s\n", "path", "lookups/s", "ms/lookup", "matches");
+   for (pass = 0; pass < 2; pass++)
+      printf("%-6s %12.1f %12.3f %10ld\n", pass ? "scan" : "cursor",
+            lookups / elapsed[pass],
+            1000.0 * elapsed[pass] / lookups, matches[pass]);
+   printf("read all records: %.1f ms, %.0f records/s\n",
+         1000.0 * walk_time, num_crcs / walk_time);
+
+   free(queries);
+   free(crcs);
+
+   if (matches[0] != matches[1])
+   {
+      fprintf(stderr, "Cursor and scan found different records.\n");
+      return 1;
+   }
+
+   return 0;
+}
@@ -45,7 +45,7 @@ int main(int argc, char ** argv)
       printf("Usage: %s <db file> <command> [extra args...]\n", argv[0]);
       printf("Available Commands:\n");
       printf("\tlist\n");
-      printf("\tcreate-index <index name> <field name>\n");
+      printf("\tcreate-index [<index name> <field name>]\n");
       printf("\tfind <query expression>\n");
       printf("\tget-names <query expression>\n");
       return 1;
@@ -161,18 +161,33 @@ int main(int argc, char ** argv)
    }
    else if (memcmp(command, "create-index", 12) == 0)
    {
-      const char * index_name, * field_name;
+      unsigned i;
+      /* Without arguments, create the indexes the frontend
+       * uses to look content up by CRC and serial */
+      static const char *default_fields[] = { "crc", "serial" };
 
-      if (argc != 5)
+      if (argc != 3 && argc != 5)
       {
-         printf("Usage: %s <db file> create-index <index name> <field name>\n", argv[0]);
+         printf("Usage: %s <db file> create-index [<index name> <field name>]\n", argv[0]);
          goto error;
       }
 
-      index_name = argv[3];
-      field_name = argv[4];
-
-      libretrodb_create_index(db, index_name, field_name);
+      if (argc == 5)
+      {
+         if ((rv = libretrodb_create_index(db, argv[3], argv[4])) != 0)
+            printf("Could not create index '%s': %s\n",
+                  argv[3], strerror(-rv));
+      }
+      else
+      {
+         for (i = 0; i < sizeof(default_fields) / sizeof(default_fields[0]); i++)
+         {
+            if ((rv = libretrodb_create_index(db,
+                        default_fields[i], default_fields[i])) != 0)
+               printf("Could not create index '%s': %s\n",
+                     default_fields[i], strerror(-rv));
+         }
+      }
    }
    else
    {
@@ -999,3 +999,65 @@ int libretrodb_query_filter(libretrodb_query_t *q,
    struct rmsgpack_dom_value res = inv.func(*v, inv.argc, inv.argv);
    return (res.type == RDT_BOOL && res.val.bool_);
 }
+
+int libretrodb_query_get_table_field(libretrodb_query_t *q, unsigned entry,
+      const struct rmsgpack_dom_value **field)
+{
+   struct invocation *inv = &((struct query *)q)->root;
+
+   if (inv->func != query_func_all_map || inv->argc % 2 != 0)
+      return -1;
+
+   if (entry * 2 + 1 >= inv->argc)
+      return 0;
+
+   /* query_func_all_map() rejects non-value keys outright */
+   if (inv->argv[entry * 2].type != AT_VALUE)
+      return -1;
+
+   *field = &inv->argv[entry * 2].a.value;
+   return 1;
+}
+
+int libretrodb_query_get_seek_keys(libretrodb_query_t *q, unsigned entry,
+      const struct rmsgpack_dom_value **field,
+      const struct rmsgpack_dom_value **keys, unsigned max_keys)
+{
+   unsigned i;
+   const struct argument *arg = NULL;
+   struct invocation *inv     = &((struct query *)q)->root;
+
+   if (inv->func != query_func_all_map || entry * 2 + 1 >= inv->argc)
+      return -1;
+
+   if (     inv->argv[entry * 2].type         != AT_VALUE
+         || inv->argv[entry * 2].a.value.type != RDT_STRING)
+      return 0;
+
+   *field = &inv->argv[entry * 2].a.value;
+   arg    = &inv->argv[entry * 2 + 1];
+
+   if (arg->type == AT_VALUE)
+   {
+      if (arg->a.value.type != RDT_BINARY || max_keys < 1)
+         return 0;
+      keys[0] = &arg->a.value;
+      return 1;
+   }
+
+   if (     arg->a.invocation.func != query_func_operator_or
+         || arg->a.invocation.argc == 0
+         || arg->a.invocation.argc > max_keys)
+      return 0;
+
+   for (i = 0; i < arg->a.invocation.argc; i++)
+   {
+      const struct argument *or_arg = &arg->a.invocation.argv[i];
+
+      if (or_arg->type != AT_VALUE || or_arg->a.value.type != RDT_BINARY)
+         return 0;
+      keys[i] = &or_arg->a.value;
+   }
+
+   return (int)arg->a.invocation.argc;
+}
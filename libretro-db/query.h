@@ -38,6 +38,42 @@ void libretrodb_query_dec_ref(libretrodb_query_t *q);
 
 int libretrodb_query_filter(libretrodb_query_t *q, struct rmsgpack_dom_value *v);
 
+/**
+ * libretrodb_query_get_table_field:
+ * @q                   : Compiled query.
+ * @entry               : Table entry to inspect.
+ * @field               : Set to the field name of the entry.
+ *
+ * A table query only looks at the fields it names, so it gives
+ * the same result on a map holding just those fields as on the
+ * whole record.
+ *
+ * Returns: 1 if @field was set, 0 past the last entry, or -1 if
+ * @q is not a table query.
+ **/
+int libretrodb_query_get_table_field(libretrodb_query_t *q, unsigned entry,
+      const struct rmsgpack_dom_value **field);
+
+/**
+ * libretrodb_query_get_seek_keys:
+ * @q                   : Compiled query.
+ * @entry               : Table entry to inspect.
+ * @field               : Set to the field name of the entry.
+ * @keys                : Set to the values the field has to equal.
+ * @max_keys            : Size of @keys.
+ *
+ * A table entry of the form {field: b"..."} or
+ * {field: or(b"...", b"...")} only matches records whose field
+ * equals one of a few binary values, so it can be answered by
+ * an index seek instead of a full scan.
+ *
+ * Returns: number of keys, 0 if the entry is not such a
+ * predicate, or -1 past the last entry.
+ **/
+int libretrodb_query_get_seek_keys(libretrodb_query_t *q, unsigned entry,
+      const struct rmsgpack_dom_value **field,
+      const struct rmsgpack_dom_value **keys, unsigned max_keys);
+
 RETRO_END_DECLS
 
 #endif
@@ -658,3 +658,227 @@ int rmsgpack_read(RFILE *fd,
 error:
    return -errno;
 }
+
+static int rmsgpack_buf_read_uint(const uint8_t *buf, size_t len,
+      size_t *pos, size_t size, uint64_t *out)
+{
+   size_t i;
+   uint64_t value = 0;
+
+   if (len - *pos < size)
+      return -EINVAL;
+
+   for (i = 0; i < size; i++)
+      value = (value << 8) | buf[*pos + i];
+
+   *pos += size;
+   *out  = value;
+   return 0;
+}
+
+static int rmsgpack_read_buf_internal(const uint8_t *buf, size_t len,
+      size_t *pos, struct rmsgpack_read_callbacks *callbacks, void *data,
+      int in_place)
+{
+   int rv;
+   uint32_t i;
+   uint64_t tmp_len  = 0;
+   uint64_t tmp_uint = 0;
+   uint8_t type      = 0;
+   int is_map        = 0;
+   int is_string     = 0;
+
+   if (*pos >= len)
+      return -EINVAL;
+
+   type = buf[(*pos)++];
+
+   if (type < MPF_FIXMAP)
+   {
+      if (!callbacks->read_int)
+         return 0;
+      return callbacks->read_int(type, data);
+   }
+   else if (type < MPF_FIXARRAY)
+   {
+      tmp_len = type - MPF_FIXMAP;
+      is_map  = 1;
+      goto container;
+   }
+   else if (type < MPF_FIXSTR)
+   {
+      tmp_len = type - MPF_FIXARRAY;
+      goto container;
+   }
+   else if (type < MPF_NIL)
+   {
+      tmp_len   = type - MPF_FIXSTR;
+      is_string = 1;
+      goto buffer;
+   }
+   else if (type > MPF_MAP32)
+   {
+      if (!callbacks->read_int)
+         return 0;
+      return callbacks->read_int(type - 0xff - 1, data);
+   }
+
+   switch (type)
+   {
+      case _MPF_NIL:
+         if (callbacks->read_nil)
+            return callbacks->read_nil(data);
+         return 0;
+      case _MPF_FALSE:
+      case _MPF_TRUE:
+         if (callbacks->read_bool)
+            return callbacks->read_bool(type == _MPF_TRUE, data);
+         return 0;
+      case _MPF_BIN8:
+      case _MPF_BIN16:
+      case _MPF_BIN32:
+         if ((rv = rmsgpack_buf_read_uint(buf, len, pos,
+                     (size_t)1 << (type - _MPF_BIN8), &tmp_len)) < 0)
+            return rv;
+         goto buffer;
+      case _MPF_STR8:
+      case _MPF_STR16:
+      case _MPF_STR32:
+         if ((rv = rmsgpack_buf_read_uint(buf, len, pos,
+                     (size_t)1 << (type - _MPF_STR8), &tmp_len)) < 0)
+            return rv;
+         is_string = 1;
+         goto buffer;
+      case _MPF_UINT8:
+      case _MPF_UINT16:
+      case _MPF_UINT32:
+      case _MPF_UINT64:
+         if ((rv = rmsgpack_buf_read_uint(buf, len, pos,
+                     (size_t)1 << (type - _MPF_UINT8), &tmp_uint)) < 0)
+            return rv;
+         if (callbacks->read_uint)
+            return callbacks->read_uint(tmp_uint, data);
+         return 0;
+      case _MPF_INT8:
+      case _MPF_INT16:
+      case _MPF_INT32:
+      case _MPF_INT64:
+         {
+            int64_t tmp_int;
+            size_t size = (size_t)1 << (type - _MPF_INT8);
+
+            if ((rv = rmsgpack_buf_read_uint(buf, len, pos,
+                        size, &tmp_uint)) < 0)
+               return rv;
+
+            switch (size)
+            {
+               case 1:
+                  tmp_int = (int8_t)tmp_uint;
+                  break;
+               case 2:
+                  tmp_int = (int16_t)tmp_uint;
+                  break;
+               case 4:
+                  tmp_int = (int32_t)tmp_uint;
+                  break;
+               default:
+                  tmp_int = (int64_t)tmp_uint;
+                  break;
+            }
+
+            if (callbacks->read_int)
+               return callbacks->read_int(tmp_int, data);
+         }
+         return 0;
+      case _MPF_ARRAY16:
+      case _MPF_ARRAY32:
+         if ((rv = rmsgpack_buf_read_uint(buf, len, pos,
+                     (size_t)2 << (type - _MPF_ARRAY16), &tmp_len)) < 0)
+            return rv;
+         goto container;
+      case _MPF_MAP16:
+      case _MPF_MAP32:
+         if ((rv = rmsgpack_buf_read_uint(buf, len, pos,
+                     (size_t)2 << (type - _MPF_MAP16), &tmp_len)) < 0)
+            return rv;
+         is_map = 1;
+         goto container;
+      default:
+         break;
+   }
+
+   return -EINVAL;
+
+buffer:
+   {
+      char *ptr = (char*)buf + *pos;
+
+      if (len - *pos < tmp_len)
+         return -EINVAL;
+
+      *pos += (size_t)tmp_len;
+
+      if (is_string ? !callbacks->read_string : !callbacks->read_bin)
+         return 0;
+
+      if (!in_place)
+      {
+         char *copy = (char*)malloc((size_t)tmp_len + 1);
+         if (!copy)
+            return -ENOMEM;
+         memcpy(copy, ptr, (size_t)tmp_len);
+         copy[tmp_len] = '\0';
+         ptr           = copy;
+      }
+
+      if (is_string)
+         return callbacks->read_string(ptr, (uint32_t)tmp_len, data);
+      return callbacks->read_bin(ptr, (uint32_t)tmp_len, data);
+   }
+
+container:
+   if (is_map)
+   {
+      if (callbacks->read_map_start &&
+            (rv = callbacks->read_map_start((uint32_t)tmp_len, data)) < 0)
+         return rv;
+      tmp_len *= 2;
+   }
+   else if (callbacks->read_array_start &&
+         (rv = callbacks->read_array_start((uint32_t)tmp_len, data)) < 0)
+      return rv;
+
+   if (in_place)
+      return 0;
+
+   for (i = 0; i < tmp_len; i++)
+   {
+      if ((rv = rmsgpack_read_buf_internal(buf, len, pos,
+                  callbacks, data, 0)) < 0)
+         return rv;
+   }
+
+   return 0;
+}
+
+int rmsgpack_read_buf(const void *buf, size_t len, size_t *pos,
+      struct rmsgpack_read_callbacks *callbacks, void *data)
+{
+   return rmsgpack_read_buf_internal((const uint8_t*)buf, len, pos,
+         callbacks, data, 0);
+}
+
+int rmsgpack_peek_buf(const void *buf, size_t len, size_t *pos,
+      struct rmsgpack_read_callbacks *callbacks, void *data)
+{
+   return rmsgpack_read_buf_internal((const uint8_t*)buf, len, pos,
+         callbacks, data, 1);
+}
+
+int rmsgpack_skip_buf(const void *buf, size_t len, size_t *pos)
+{
+   static struct rmsgpack_read_callbacks skip_callbacks;
+   return rmsgpack_read_buf_internal((const uint8_t*)buf, len, pos,
+         &skip_callbacks, NULL, 0);
+}
@@ -57,4 +57,19 @@ int rmsgpack_write_uint(RFILE *fd, uint64_t value );
 
 int rmsgpack_read(RFILE *fd, struct rmsgpack_read_callbacks *callbacks, void *data);
 
+/* Same as rmsgpack_read(), but decodes the item at *pos of an
+ * in-memory buffer and advances *pos past it. */
+int rmsgpack_read_buf(const void *buf, size_t len, size_t *pos,
+      struct rmsgpack_read_callbacks *callbacks, void *data);
+
+/* Decodes the item at *pos without copying anything: strings and
+ * binaries are handed to the callbacks pointing into @buf, which
+ * they must not free, and of a map or array only the header is
+ * read, leaving *pos at its first element. */
+int rmsgpack_peek_buf(const void *buf, size_t len, size_t *pos,
+      struct rmsgpack_read_callbacks *callbacks, void *data);
+
+/* Advances *pos past the item there, including all its elements. */
+int rmsgpack_skip_buf(const void *buf, size_t len, size_t *pos);
+
 #endif
@@ -505,3 +505,144 @@ clean:
    rmsgpack_dom_value_free(&map);
    return 0;
 }
+
+int rmsgpack_dom_read_buf(const void *buf, size_t len, size_t *pos,
+      struct rmsgpack_dom_value *out)
+{
+   struct dom_reader_state s;
+   int rv     = 0;
+
+   s.i        = 0;
+   s.stack[0] = out;
+
+   rv         = rmsgpack_read_buf(buf, len, pos, &dom_reader_callbacks, &s);
+
+   if (rv < 0)
+      rmsgpack_dom_value_free(out);
+
+   return rv;
+}
+
+static int dom_peek_nil(void *data)
+{
+   ((struct rmsgpack_dom_value*)data)->type = RDT_NULL;
+   return 0;
+}
+
+static int dom_peek_bool(int value, void *data)
+{
+   struct rmsgpack_dom_value *v = (struct rmsgpack_dom_value*)data;
+   v->type                      = RDT_BOOL;
+   v->val.bool_                 = value;
+   return 0;
+}
+
+static int dom_peek_int(int64_t value, void *data)
+{
+   struct rmsgpack_dom_value *v = (struct rmsgpack_dom_value*)data;
+   v->type                      = RDT_INT;
+   v->val.int_                  = value;
+   return 0;
+}
+
+static int dom_peek_uint(uint64_t value, void *data)
+{
+   struct rmsgpack_dom_value *v = (struct rmsgpack_dom_value*)data;
+   v->type                      = RDT_UINT;
+   v->val.uint_                 = value;
+   return 0;
+}
+
+static int dom_peek_string(char *value, uint32_t len, void *data)
+{
+   struct rmsgpack_dom_value *v = (struct rmsgpack_dom_value*)data;
+   v->type                      = RDT_STRING;
+   v->val.string.len            = len;
+   v->val.string.buff           = value;
+   return 0;
+}
+
+static int dom_peek_bin(void *value, uint32_t len, void *data)
+{
+   struct rmsgpack_dom_value *v = (struct rmsgpack_dom_value*)data;
+   v->type                      = RDT_BINARY;
+   v->val.binary.len            = len;
+   v->val.binary.buff           = (char*)value;
+   return 0;
+}
+
+static int dom_peek_map_start(uint32_t len, void *data)
+{
+   struct rmsgpack_dom_value *v = (struct rmsgpack_dom_value*)data;
+   v->type                      = RDT_MAP;
+   v->val.map.len               = len;
+   v->val.map.items             = NULL;
+   return 0;
+}
+
+static int dom_peek_array_start(uint32_t len, void *data)
+{
+   struct rmsgpack_dom_value *v = (struct rmsgpack_dom_value*)data;
+   v->type                      = RDT_ARRAY;
+   v->val.array.len             = len;
+   v->val.array.items           = NULL;
+   return 0;
+}
+
+static struct rmsgpack_read_callbacks dom_peek_callbacks = {
+   dom_peek_nil,
+   dom_peek_bool,
+   dom_peek_int,
+   dom_peek_uint,
+   dom_peek_string,
+   dom_peek_bin,
+   dom_peek_map_start,
+   dom_peek_array_start
+};
+
+int rmsgpack_dom_peek_buf(const void *buf, size_t len, size_t *pos,
+      struct rmsgpack_dom_value *out)
+{
+   out->type = RDT_NULL;
+   return rmsgpack_peek_buf(buf, len, pos, &dom_peek_callbacks, out);
+}
+
+int rmsgpack_dom_map_value_buf(const void *buf, size_t len,
+      const struct rmsgpack_dom_value *key,
+      struct rmsgpack_dom_value *out)
+{
+   int rv;
+   uint32_t i;
+   struct rmsgpack_dom_value map;
+   size_t pos = 0;
+
+   if ((rv = rmsgpack_dom_peek_buf(buf, len, &pos, &map)) < 0)
+      return rv;
+
+   if (map.type != RDT_MAP)
+      return -EINVAL;
+
+   for (i = 0; i < map.val.map.len; i++)
+   {
+      struct rmsgpack_dom_value k;
+      size_t value_pos;
+
+      if ((rv = rmsgpack_dom_peek_buf(buf, len, &pos, &k)) < 0)
+         return rv;
+
+      /* Database records only use scalar keys */
+      if (k.type == RDT_MAP || k.type == RDT_ARRAY)
+         return -EINVAL;
+
+      value_pos = pos;
+
+      if (rmsgpack_dom_value_cmp(key, &k) == 0)
+         return rmsgpack_dom_peek_buf(buf, len, &value_pos, out) < 0
+            ? -EINVAL : 0;
+
+      if ((rv = rmsgpack_skip_buf(buf, len, &pos)) < 0)
+         return rv;
+   }
+
+   return 1;
+}
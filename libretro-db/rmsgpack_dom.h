@@ -95,6 +95,28 @@ int rmsgpack_dom_write(RFILE *fd, const struct rmsgpack_dom_value *obj);
 
 int rmsgpack_dom_read_into(RFILE *fd, ...);
 
+/* Decodes the value at *pos of an in-memory buffer and advances
+ * *pos past it. Free @out with rmsgpack_dom_value_free(). */
+int rmsgpack_dom_read_buf(const void *buf, size_t len, size_t *pos,
+      struct rmsgpack_dom_value *out);
+
+/* Lazy access to an encoded buffer, without building a DOM.
+ * Strings and binaries in @out point into @buf and are not
+ * NUL-terminated, maps and arrays only get their length and
+ * NULL items. Never free the result. */
+
+/* Reads the value at *pos. For a map or array, *pos is left at
+ * its first element, otherwise it is advanced past the value. */
+int rmsgpack_dom_peek_buf(const void *buf, size_t len, size_t *pos,
+      struct rmsgpack_dom_value *out);
+
+/* Looks @key up in the map encoded at the start of @buf.
+ * Returns 0 if found, 1 if not, negative if @buf is not a
+ * valid map. */
+int rmsgpack_dom_map_value_buf(const void *buf, size_t len,
+      const struct rmsgpack_dom_value *key,
+      struct rmsgpack_dom_value *out);
+
 RETRO_END_DECLS
 
 #endif
@@ -2124,6 +2124,7 @@ static int action_ok_playlist_entry_collection(const char *path,
    playlist_config.capacity               = COLLECTION_SIZE;
    playlist_config.old_format             = settings->bools.playlist_use_old_format;
    playlist_config.compress               = settings->bools.playlist_compression;
+   playlist_config.binary                 = settings->bools.playlist_use_binary_format;
    playlist_config.fuzzy_archive_match    = settings->bools.playlist_fuzzy_archive_match;
    playlist_config_set_base_content_directory(&playlist_config, settings->bools.playlist_portable_paths ? settings->paths.directory_menu_content : NULL);
 
@@ -6690,6 +6691,7 @@ static int action_ok_manual_content_scan_start(const char *path,
    playlist_config.capacity            = COLLECTION_SIZE;
    playlist_config.old_format          = settings->bools.playlist_use_old_format;
    playlist_config.compress            = settings->bools.playlist_compression;
+   playlist_config.binary              = settings->bools.playlist_use_binary_format;
    playlist_config.fuzzy_archive_match = settings->bools.playlist_fuzzy_archive_match;
    playlist_config_set_base_content_directory(&playlist_config, settings->bools.playlist_portable_paths ? settings->paths.directory_menu_content : NULL);
 
@@ -7059,6 +7061,7 @@ static int action_ok_pl_content_thumbnails(const char *path,
       playlist_config.capacity            = COLLECTION_SIZE;
       playlist_config.old_format          = settings->bools.playlist_use_old_format;
       playlist_config.compress            = settings->bools.playlist_compression;
+      playlist_config.binary              = settings->bools.playlist_use_binary_format;
       playlist_config.fuzzy_archive_match = settings->bools.playlist_fuzzy_archive_match;
 
       if (!string_is_empty(path_dir_playlist))
@@ -3135,6 +3135,8 @@ static bool materialui_render_process_entry_default(
       size_t entry_idx, size_t selection, size_t playlist_idx,
       bool first_entry_found, bool last_entry_found,
       unsigned thumbnail_upscale_threshold,
+      unsigned thumbnail_cache_size,
+      const char *thumbnail_cache_dir,
       bool network_on_demand_thumbnails)
 {
    /* 'Normal' menu lists require no entry-specific
@@ -3154,6 +3156,8 @@ static bool materialui_render_process_entry_playlist_thumb_list(
       size_t entry_idx, size_t selection, size_t playlist_idx,
       bool first_entry_found, bool last_entry_found,
       unsigned thumbnail_upscale_threshold,
+      unsigned thumbnail_cache_size,
+      const char *thumbnail_cache_dir,
       bool network_on_demand_thumbnails)
 {
    bool on_screen = first_entry_found && !last_entry_found;
@@ -3166,6 +3170,8 @@ static bool materialui_render_process_entry_playlist_thumb_list(
             &node->thumbnails.primary, &node->thumbnails.secondary,
             on_screen,
             thumbnail_upscale_threshold,
+            thumbnail_cache_size,
+            thumbnail_cache_dir,
             network_on_demand_thumbnails);
    else
       gfx_thumbnail_process_stream(
@@ -3173,6 +3179,8 @@ static bool materialui_render_process_entry_playlist_thumb_list(
             mui->playlist, playlist_idx, &node->thumbnails.primary,
             on_screen,
             thumbnail_upscale_threshold,
+            thumbnail_cache_size,
+            thumbnail_cache_dir,
             network_on_demand_thumbnails);
 
    /* Always return true - every entry must
@@ -3189,6 +3197,8 @@ static bool materialui_render_process_entry_playlist_dual_icon(
       size_t entry_idx, size_t selection, size_t playlist_idx,
       bool first_entry_found, bool last_entry_found,
       unsigned thumbnail_upscale_threshold,
+      unsigned thumbnail_cache_size,
+      const char *thumbnail_cache_dir,
       bool network_on_demand_thumbnails)
 {
    bool on_screen = first_entry_found && !last_entry_found;
@@ -3202,6 +3212,8 @@ static bool materialui_render_process_entry_playlist_dual_icon(
          &node->thumbnails.primary, &node->thumbnails.secondary,
          on_screen,
          thumbnail_upscale_threshold,
+         thumbnail_cache_size,
+         thumbnail_cache_dir,
          network_on_demand_thumbnails);
 
    /* Always return true - every entry must
@@ -3218,6 +3230,8 @@ static bool materialui_render_process_entry_playlist_desktop(
       size_t entry_idx, size_t selection, size_t playlist_idx,
       bool first_entry_found, bool last_entry_found,
       unsigned thumbnail_upscale_threshold,
+      unsigned thumbnail_cache_size,
+      const char *thumbnail_cache_dir,
       bool network_on_demand_thumbnails)
 {
    gfx_thumbnail_state_t *p_gfx_thumb = gfx_thumb_get_ptr();
@@ -3243,6 +3257,8 @@ static bool materialui_render_process_entry_playlist_desktop(
          &node->thumbnails.primary, &node->thumbnails.secondary,
          is_on_screen,
          thumbnail_upscale_threshold,
+         thumbnail_cache_size,
+         thumbnail_cache_dir,
          network_on_demand_thumbnails);
 
    /* If this is *not* the currently selected
@@ -3406,6 +3422,8 @@ static bool (*materialui_render_process_entry)(
       size_t entry_idx, size_t selection, size_t playlist_idx,
       bool first_entry_found, bool last_entry_found,
       unsigned thumbnail_upscale_threshold,
+      unsigned thumbnail_cache_size,
+      const char *thumbnail_cache_dir,
       bool network_on_demand_thumbnails) = materialui_render_process_entry_default;
 
 /* ==============================
@@ -3442,6 +3460,11 @@ static void materialui_render(void *data,
    bool auto_rotate_nav_bar = settings->bools.menu_materialui_auto_rotate_nav_bar;
    unsigned thumbnail_upscale_threshold = 
       settings->uints.gfx_thumbnail_upscale_threshold;
+   unsigned thumbnail_cache_size        =
+      settings->uints.gfx_thumbnail_cache_size;
+   const char *thumbnail_cache_dir      =
+      settings->bools.gfx_thumbnail_disk_cache
+      ? settings->paths.directory_cache : NULL;
    bool network_on_demand_thumbnails    = 
       settings->bools.network_on_demand_thumbnails;
 
@@ -3667,6 +3690,8 @@ static void materialui_render(void *data,
             list->list[i].entry_idx,
             first_entry_found, last_entry_found,
             thumbnail_upscale_threshold,
+            thumbnail_cache_size,
+            thumbnail_cache_dir,
             network_on_demand_thumbnails))
          break;
    }
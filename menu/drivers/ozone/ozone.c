@@ -925,6 +925,9 @@ static void ozone_update_thumbnail_image(void *data)
    settings_t *settings              = config_get_ptr();
    playlist_t *playlist              = playlist_get_cached();
    unsigned gfx_thumbnail_upscale_threshold = settings->uints.gfx_thumbnail_upscale_threshold;
+   unsigned gfx_thumbnail_cache_size = settings->uints.gfx_thumbnail_cache_size;
+   const char *gfx_thumbnail_cache_dir = settings->bools.gfx_thumbnail_disk_cache
+      ? settings->paths.directory_cache : NULL;
    bool network_on_demand_thumbnails = settings->bools.network_on_demand_thumbnails;
 
    if (!ozone)
@@ -939,6 +942,8 @@ static void ozone_update_thumbnail_image(void *data)
          selection,
          &ozone->thumbnails.right,
          gfx_thumbnail_upscale_threshold,
+         gfx_thumbnail_cache_size,
+         gfx_thumbnail_cache_dir,
          network_on_demand_thumbnails
          );
 
@@ -959,6 +964,8 @@ static void ozone_update_thumbnail_image(void *data)
          selection,
          &ozone->thumbnails.left,
          gfx_thumbnail_upscale_threshold,
+         gfx_thumbnail_cache_size,
+         gfx_thumbnail_cache_dir,
          network_on_demand_thumbnails);
    }
 }
@@ -1126,6 +1126,9 @@ static void xmb_update_thumbnail_image(void *data)
    playlist_t                *playlist  = playlist_get_cached();
    settings_t                *settings  = config_get_ptr();
    unsigned thumbnail_upscale_threshold = settings->uints.gfx_thumbnail_upscale_threshold;
+   unsigned thumbnail_cache_size        = settings->uints.gfx_thumbnail_cache_size;
+   const char *thumbnail_cache_dir      = settings->bools.gfx_thumbnail_disk_cache
+      ? settings->paths.directory_cache : NULL;
    bool network_on_demand_thumbnails    = settings->bools.network_on_demand_thumbnails;
 
    if (!xmb)
@@ -1150,6 +1153,8 @@ static void xmb_update_thumbnail_image(void *data)
             selection,
             &xmb->thumbnails.right,
             thumbnail_upscale_threshold,
+            thumbnail_cache_size,
+            thumbnail_cache_dir,
             network_on_demand_thumbnails);
       /* Left thumbnail */
       else if (gfx_thumbnail_is_enabled(xmb->thumbnail_path_data,
@@ -1161,6 +1166,8 @@ static void xmb_update_thumbnail_image(void *data)
             selection,
             &xmb->thumbnails.left,
             thumbnail_upscale_threshold,
+            thumbnail_cache_size,
+            thumbnail_cache_dir,
             network_on_demand_thumbnails);
    }
    else
@@ -1173,6 +1180,8 @@ static void xmb_update_thumbnail_image(void *data)
          selection,
          &xmb->thumbnails.right,
          thumbnail_upscale_threshold,
+         thumbnail_cache_size,
+         thumbnail_cache_dir,
          network_on_demand_thumbnails);
 
       /* Left thumbnail */
@@ -1183,6 +1192,8 @@ static void xmb_update_thumbnail_image(void *data)
          selection,
          &xmb->thumbnails.left,
          thumbnail_upscale_threshold,
+         thumbnail_cache_size,
+         thumbnail_cache_dir,
          network_on_demand_thumbnails);
    }
 }
@@ -1357,6 +1368,11 @@ static void xmb_update_savestate_thumbnail_image(void *data)
    settings_t *settings = config_get_ptr();
    unsigned thumbnail_upscale_threshold
                         = settings->uints.gfx_thumbnail_upscale_threshold;
+   unsigned thumbnail_cache_size
+                        = settings->uints.gfx_thumbnail_cache_size;
+   const char *thumbnail_cache_dir
+                        = settings->bools.gfx_thumbnail_disk_cache
+                        ? settings->paths.directory_cache : NULL;
    if (!xmb)
       return;
 
@@ -1378,7 +1394,9 @@ static void xmb_update_savestate_thumbnail_image(void *data)
          gfx_thumbnail_request_file(
                xmb->savestate_thumbnail_file_path,
                &xmb->thumbnails.savestate,
-               thumbnail_upscale_threshold);
+               thumbnail_upscale_threshold,
+               thumbnail_cache_size,
+               thumbnail_cache_dir);
    }
 }
 
@@ -444,6 +444,7 @@ static explore_state_t *explore_build_list(void)
       playlist_config.capacity                  = 0;
       playlist_config.old_format                = false;
       playlist_config.compress                  = false;
+      playlist_config.binary                    = false;
       playlist_config.fuzzy_archive_match       = false;
       playlist_config.autofix_paths             = false;
 
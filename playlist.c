@@ -27,16 +27,28 @@
 #include <compat/posix_string.h>
 #include <string/stdstring.h>
 #include <streams/interface_stream.h>
+#include <streams/file_stream.h>
 #include <file/file_path.h>
 #include <lists/string_list.h>
 #include <formats/rjson.h>
 #include <array/rbuf.h>
+#include <array/rhmap.h>
+#include <features/features_cpu.h>
 
 #include "playlist.h"
 #include "verbosity.h"
 #include "file_path_special.h"
 #include "core_info.h"
 
+#if defined(HAVE_MMAP) && !defined(_WIN32)
+#define PLAYLIST_HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/file.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
 #if defined(ANDROID)
 #include "play_feature_delivery/play_feature_delivery.h"
 #endif
@@ -56,6 +68,20 @@
 #define USING_POSIX_FILE_SYSTEM
 #endif
 
+/* Path index node for one playlist entry, see
+ * playlist_index_find() */
+struct playlist_path_node
+{
+   char *real_path;          /* entry path after path_resolve_realpath() */
+   const char *entry_path;   /* entry->path itself, identifies the entry */
+   struct playlist_path_node *next;         /* same real_path hash */
+   struct playlist_path_node *archive_next; /* same archive_hash */
+   size_t archive_len;       /* length of the [archive_path] part */
+   uint32_t hash;
+   uint32_t archive_hash;
+   bool is_compressed;
+};
+
 struct content_playlist
 {
    char *default_core_path;
@@ -64,6 +90,26 @@ struct content_playlist
 
    struct playlist_entry *entries;
 
+   /* Path index, built on the first path lookup:
+    * path_map and archive_map are rhmaps of node chains
+    * keyed by the hash of real_path and of its
+    * [archive_path] part; path_nodes holds every node */
+   struct playlist_path_node **path_nodes;
+   struct playlist_path_node **path_map;
+   struct playlist_path_node **archive_map;
+
+   /* Binary playlist file, see playlist_bin_load().
+    * bin_data holds the file, mapped or read, and
+    * bin_decoded flags the entries decoded from it
+    * until all of them are */
+   const uint8_t *bin_data;
+   uint8_t *bin_decoded;
+   size_t *bin_dirty;            /* rbuf of entries to patch */
+   size_t bin_size;
+   size_t bin_records_offset;
+   size_t bin_record_size;
+   size_t bin_appended;          /* string bytes added by patches */
+
    playlist_config_t config;  /* size_t alignment */
 
    enum playlist_label_display_mode label_display_mode;
@@ -71,10 +117,17 @@ struct content_playlist
    enum playlist_thumbnail_mode left_thumbnail_mode;
    enum playlist_sort_mode sort_mode;
 
+   uint32_t bin_serial;          /* identifies the file on disk */
+   int bin_fd;                   /* holds a shared lock while mapped */
+
    bool modified;
    bool old_format;
    bool compressed;
+   bool binary;
    bool cached_external;
+   bool path_index_built;
+   bool bin_mapped;
+   bool bin_rewrite;             /* file must be written in full */
 };
 
 typedef struct
@@ -162,6 +215,7 @@ bool playlist_config_copy(const playlist_config_t *src,
    dst->capacity            = src->capacity;
    dst->old_format          = src->old_format;
    dst->compress            = src->compress;
+   dst->binary              = src->binary;
    dst->fuzzy_archive_match = src->fuzzy_archive_match;
    dst->autofix_paths       = src->autofix_paths;
 
@@ -352,6 +406,974 @@ static bool playlist_core_path_equal(const char *real_core_path, const char *ent
    return false;
 }
 
+/* Turns a 'real' path into the key stored in the index */
+static void playlist_index_normalize(char *path)
+{
+#ifdef _WIN32
+   /* Handle case-insensitive operating systems*/
+   string_to_lower(path);
+#endif
+}
+
+/**
+ * playlist_index_add:
+ * @playlist            : Playlist handle.
+ * @entry               : Playlist entry, whose path has just been set.
+ *
+ * Adds entry to the path index, if the index has been built.
+ **/
+static void playlist_index_add(playlist_t *playlist,
+      const struct playlist_entry *entry)
+{
+   const char *delim               = NULL;
+   struct playlist_path_node *node = NULL;
+   char real_path[PATH_MAX_LENGTH];
+
+   if (!playlist->path_index_built || string_is_empty(entry->path))
+      return;
+
+   /* Get entry 'real' path, as playlist_path_equal() does */
+   strlcpy(real_path, entry->path, sizeof(real_path));
+   path_resolve_realpath(real_path, sizeof(real_path), true);
+
+   if (string_is_empty(real_path))
+      return;
+
+   playlist_index_normalize(real_path);
+
+   if (!(node = (struct playlist_path_node*)calloc(1, sizeof(*node))))
+      return;
+
+   node->real_path     = strdup(real_path);
+   node->entry_path    = entry->path;
+   node->hash          = hash_string(real_path);
+   node->is_compressed = path_is_compressed_file(real_path);
+
+   node->next          = RHMAP_GET(playlist->path_map, node->hash);
+   RHMAP_SET(playlist->path_map, node->hash, node);
+
+   /* [archive_path][delimiter][rom_file] entries are also
+    * found by their [archive_path] */
+   if (!node->is_compressed && (delim = path_get_archive_delim(real_path)))
+   {
+      node->archive_len  = (size_t)(delim - real_path);
+      /* Hash the [archive_path] part alone */
+      real_path[node->archive_len] = '\0';
+      node->archive_hash = hash_string(real_path);
+      node->archive_next = RHMAP_GET(playlist->archive_map,
+            node->archive_hash);
+      RHMAP_SET(playlist->archive_map, node->archive_hash, node);
+   }
+
+   RBUF_PUSH(playlist->path_nodes, node);
+}
+
+/**
+ * playlist_index_remove:
+ * @playlist            : Playlist handle.
+ * @entry               : Playlist entry, whose path is about to be freed.
+ *
+ * Removes entry from the path index, if the index has been built.
+ **/
+static void playlist_index_remove(playlist_t *playlist,
+      const struct playlist_entry *entry)
+{
+   size_t i, len;
+   struct playlist_path_node *node  = NULL;
+   struct playlist_path_node *chain = NULL;
+
+   if (!playlist->path_index_built || !entry->path)
+      return;
+
+   for (i = 0, len = RBUF_LEN(playlist->path_nodes); i < len; i++)
+   {
+      if (playlist->path_nodes[i]->entry_path == entry->path)
+         break;
+   }
+
+   if (i == len)
+      return;
+
+   node                    = playlist->path_nodes[i];
+   playlist->path_nodes[i] = playlist->path_nodes[len - 1];
+   RBUF_RESIZE(playlist->path_nodes, len - 1);
+
+   chain = RHMAP_GET(playlist->path_map, node->hash);
+   if (chain == node)
+   {
+      if (node->next)
+         RHMAP_SET(playlist->path_map, node->hash, node->next);
+      else
+         (void)RHMAP_DEL(playlist->path_map, node->hash);
+   }
+   else
+   {
+      for (; chain && chain->next != node; chain = chain->next);
+      if (chain)
+         chain->next = node->next;
+   }
+
+   if (node->archive_hash)
+   {
+      chain = RHMAP_GET(playlist->archive_map, node->archive_hash);
+      if (chain == node)
+      {
+         if (node->archive_next)
+            RHMAP_SET(playlist->archive_map, node->archive_hash,
+                  node->archive_next);
+         else
+            (void)RHMAP_DEL(playlist->archive_map, node->archive_hash);
+      }
+      else
+      {
+         for (; chain && chain->archive_next != node;
+               chain = chain->archive_next);
+         if (chain)
+            chain->archive_next = node->archive_next;
+      }
+   }
+
+   free(node->real_path);
+   free(node);
+}
+
+/* Drops the path index, it is rebuilt on the next lookup */
+static void playlist_index_free(playlist_t *playlist)
+{
+   size_t i, len;
+
+   for (i = 0, len = RBUF_LEN(playlist->path_nodes); i < len; i++)
+   {
+      free(playlist->path_nodes[i]->real_path);
+      free(playlist->path_nodes[i]);
+   }
+
+   RBUF_FREE(playlist->path_nodes);
+   RHMAP_FREE(playlist->path_map);
+   RHMAP_FREE(playlist->archive_map);
+   playlist->path_index_built = false;
+}
+
+/* Binary playlist format
+ *
+ * All values are little-endian uint32. A 64 byte header
+ * is followed by one fixed size record per entry and by
+ * a table of NUL-terminated strings. Strings are referred
+ * to by their offset in the file, 0 being NULL.
+ *
+ * Header:  magic, version, header size, record size,
+ *          entry count, records offset, appended bytes,
+ *          serial, default core path, default core name,
+ *          base content directory, label display mode,
+ *          right/left thumbnail modes, sort mode, reserved
+ * Record:  path, label, core path, core name, crc32,
+ *          db name, subsystem ident, subsystem name,
+ *          subsystem roms (offset of an array of string
+ *          offsets) and their count, runtime h/m/s,
+ *          last played y/m/d/h/m/s, reserved
+ *
+ * Updating entries in place appends their new strings
+ * at the end of the file and overwrites their records.
+ * Runtime values are only stored in this format. */
+#define PLAYLIST_BIN_MAGIC          "KSPL"
+#define PLAYLIST_BIN_VERSION        1
+#define PLAYLIST_BIN_HEADER_SIZE    64
+#define PLAYLIST_BIN_RECORD_SIZE    80
+
+#define PLAYLIST_BIN_HDR_VERSION    4
+#define PLAYLIST_BIN_HDR_HEADER     8
+#define PLAYLIST_BIN_HDR_RECORD     12
+#define PLAYLIST_BIN_HDR_COUNT      16
+#define PLAYLIST_BIN_HDR_RECORDS    20
+#define PLAYLIST_BIN_HDR_APPENDED   24
+#define PLAYLIST_BIN_HDR_SERIAL     28
+#define PLAYLIST_BIN_HDR_STRINGS    32 /* 3 strings */
+#define PLAYLIST_BIN_HDR_MODES      44 /* 4 values */
+
+#define PLAYLIST_BIN_REC_STRINGS    0  /* 8 strings */
+#define PLAYLIST_BIN_REC_ROMS       32
+#define PLAYLIST_BIN_REC_NUM_ROMS   36
+#define PLAYLIST_BIN_REC_RUNTIME    40 /* 3 values */
+#define PLAYLIST_BIN_REC_PLAYED     52 /* 6 values */
+
+/* Past this many changed entries, rewriting the
+ * file is cheaper than patching it */
+#define PLAYLIST_BIN_MAX_PATCHES    64
+
+/* Collects the string table of a binary playlist */
+typedef struct
+{
+   uint8_t *buf;       /* rbuf of data to write at 'base' */
+   uint32_t *strings;  /* rhmap of string hash -> file offset */
+   size_t base;        /* file offset of buf[0] */
+} playlist_bin_writer_t;
+
+static uint32_t playlist_bin_get32(const uint8_t *data)
+{
+   return  (uint32_t)data[0]        | ((uint32_t)data[1] << 8)
+        | ((uint32_t)data[2] << 16) | ((uint32_t)data[3] << 24);
+}
+
+static void playlist_bin_set32(uint8_t *data, uint32_t value)
+{
+   data[0] = (uint8_t)(value);
+   data[1] = (uint8_t)(value >> 8);
+   data[2] = (uint8_t)(value >> 16);
+   data[3] = (uint8_t)(value >> 24);
+}
+
+/* Returns the string at 'offset' in the loaded file,
+ * or NULL if it is not a valid string offset */
+static const char *playlist_bin_peek(const playlist_t *playlist,
+      uint32_t offset)
+{
+   const char *str;
+
+   if (!playlist->bin_data || !offset || offset >= playlist->bin_size)
+      return NULL;
+
+   str = (const char*)playlist->bin_data + offset;
+   if (!memchr(str, '\0', playlist->bin_size - offset))
+      return NULL;
+
+   return str;
+}
+
+static char *playlist_bin_strdup(const playlist_t *playlist,
+      uint32_t offset)
+{
+   const char *str = playlist_bin_peek(playlist, offset);
+   return str ? strdup(str) : NULL;
+}
+
+/* Maps the playlist file, or reads it if it cannot be mapped */
+static bool playlist_bin_map(playlist_t *playlist)
+{
+   void *buf   = NULL;
+   int64_t len = 0;
+#ifdef PLAYLIST_HAVE_MMAP
+   int fd;
+   struct stat st;
+
+   if ((fd = open(playlist->config.path, O_RDONLY)) >= 0)
+   {
+      if (     fstat(fd, &st) == 0
+            && st.st_size > 0
+            && (uint64_t)st.st_size <= (size_t)-1
+            && (buf = mmap(NULL, (size_t)st.st_size, PROT_READ,
+                  MAP_SHARED, fd, 0)) != MAP_FAILED)
+      {
+         playlist->bin_data   = (const uint8_t*)buf;
+         playlist->bin_size   = (size_t)st.st_size;
+         playlist->bin_mapped = true;
+
+         /* The mapping would stay valid without the descriptor,
+          * it is kept for the lock that tells playlist_bin_patch()
+          * of other handles, in any process, mapping the file */
+         flock(fd, LOCK_SH);
+         playlist->bin_fd     = fd;
+         return true;
+      }
+
+      close(fd);
+      buf = NULL;
+   }
+#endif
+
+   if (!filestream_read_file(playlist->config.path, &buf, &len) || len <= 0)
+   {
+      free(buf);
+      return false;
+   }
+
+   playlist->bin_data   = (const uint8_t*)buf;
+   playlist->bin_size   = (size_t)len;
+   playlist->bin_mapped = false;
+   return true;
+}
+
+/* Drops the loaded file. Entries that were not decoded
+ * yet stay empty, so this must follow
+ * playlist_bin_decode_all() unless the entries are
+ * being freed */
+static void playlist_bin_release(playlist_t *playlist)
+{
+   if (playlist->bin_data)
+   {
+#ifdef PLAYLIST_HAVE_MMAP
+      if (playlist->bin_mapped)
+         munmap((void*)playlist->bin_data, playlist->bin_size);
+      else
+#endif
+         free((void*)playlist->bin_data);
+   }
+
+#ifdef PLAYLIST_HAVE_MMAP
+   if (playlist->bin_fd >= 0)
+      close(playlist->bin_fd);
+   playlist->bin_fd      = -1;
+#endif
+
+   if (playlist->bin_decoded)
+      free(playlist->bin_decoded);
+
+   playlist->bin_data    = NULL;
+   playlist->bin_decoded = NULL;
+   playlist->bin_mapped  = false;
+}
+
+/* Fills in entry 'idx' from its record, if it was
+ * loaded from a binary playlist and not decoded yet */
+static void playlist_bin_decode(playlist_t *playlist, size_t idx)
+{
+   size_t i;
+   uint32_t roms, num_roms;
+   const uint8_t *rec;
+   struct playlist_entry *entry;
+
+   if (!playlist->bin_decoded || playlist->bin_decoded[idx])
+      return;
+
+   playlist->bin_decoded[idx] = 1;
+
+   entry = &playlist->entries[idx];
+   rec   = playlist->bin_data + playlist->bin_records_offset
+         + idx * playlist->bin_record_size;
+
+   entry->path            = playlist_bin_strdup(playlist,
+         playlist_bin_get32(rec + PLAYLIST_BIN_REC_STRINGS));
+   entry->label           = playlist_bin_strdup(playlist,
+         playlist_bin_get32(rec + PLAYLIST_BIN_REC_STRINGS + 4));
+   entry->core_path       = playlist_bin_strdup(playlist,
+         playlist_bin_get32(rec + PLAYLIST_BIN_REC_STRINGS + 8));
+   entry->core_name       = playlist_bin_strdup(playlist,
+         playlist_bin_get32(rec + PLAYLIST_BIN_REC_STRINGS + 12));
+   entry->crc32           = playlist_bin_strdup(playlist,
+         playlist_bin_get32(rec + PLAYLIST_BIN_REC_STRINGS + 16));
+   entry->db_name         = playlist_bin_strdup(playlist,
+         playlist_bin_get32(rec + PLAYLIST_BIN_REC_STRINGS + 20));
+   entry->subsystem_ident = playlist_bin_strdup(playlist,
+         playlist_bin_get32(rec + PLAYLIST_BIN_REC_STRINGS + 24));
+   entry->subsystem_name  = playlist_bin_strdup(playlist,
+         playlist_bin_get32(rec + PLAYLIST_BIN_REC_STRINGS + 28));
+
+   entry->runtime_hours      = playlist_bin_get32(rec + PLAYLIST_BIN_REC_RUNTIME);
+   entry->runtime_minutes    = playlist_bin_get32(rec + PLAYLIST_BIN_REC_RUNTIME + 4);
+   entry->runtime_seconds    = playlist_bin_get32(rec + PLAYLIST_BIN_REC_RUNTIME + 8);
+   entry->last_played_year   = playlist_bin_get32(rec + PLAYLIST_BIN_REC_PLAYED);
+   entry->last_played_month  = playlist_bin_get32(rec + PLAYLIST_BIN_REC_PLAYED + 4);
+   entry->last_played_day    = playlist_bin_get32(rec + PLAYLIST_BIN_REC_PLAYED + 8);
+   entry->last_played_hour   = playlist_bin_get32(rec + PLAYLIST_BIN_REC_PLAYED + 12);
+   entry->last_played_minute = playlist_bin_get32(rec + PLAYLIST_BIN_REC_PLAYED + 16);
+   entry->last_played_second = playlist_bin_get32(rec + PLAYLIST_BIN_REC_PLAYED + 20);
+
+   roms     = playlist_bin_get32(rec + PLAYLIST_BIN_REC_ROMS);
+   num_roms = playlist_bin_get32(rec + PLAYLIST_BIN_REC_NUM_ROMS);
+
+   if (     roms
+         && num_roms
+         && roms < playlist->bin_size
+         && num_roms <= (playlist->bin_size - roms) / 4
+         && (entry->subsystem_roms = string_list_new()))
+   {
+      union string_list_elem_attr attributes = {0};
+
+      for (i = 0; i < num_roms; i++)
+      {
+         const char *rom = playlist_bin_peek(playlist,
+               playlist_bin_get32(playlist->bin_data + roms + i * 4));
+         string_list_append(entry->subsystem_roms,
+               rom ? rom : "", attributes);
+      }
+   }
+}
+
+/* Decodes every entry, before entries are added,
+ * removed, reordered or searched */
+static void playlist_bin_decode_all(playlist_t *playlist)
+{
+   size_t i, len;
+
+   if (!playlist->bin_decoded)
+      return;
+
+   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
+      playlist_bin_decode(playlist, i);
+
+   free(playlist->bin_decoded);
+   playlist->bin_decoded = NULL;
+}
+
+/* Records that entry 'idx' changed, so that it can
+ * be patched in place on the next write */
+static void playlist_bin_mark_dirty(playlist_t *playlist, size_t idx)
+{
+   size_t i, len;
+
+   if (playlist->bin_rewrite || !playlist->config.binary)
+      return;
+
+   for (i = 0, len = RBUF_LEN(playlist->bin_dirty); i < len; i++)
+   {
+      if (playlist->bin_dirty[i] == idx)
+         return;
+   }
+
+   if (len >= PLAYLIST_BIN_MAX_PATCHES)
+   {
+      playlist->bin_rewrite = true;
+      RBUF_FREE(playlist->bin_dirty);
+      return;
+   }
+
+   RBUF_PUSH(playlist->bin_dirty, idx);
+}
+
+/* Adds 'str' to the string table and returns its
+ * file offset. If 'old_offset' already holds the
+ * same string in the loaded file, it is reused */
+static uint32_t playlist_bin_add_string(const playlist_t *playlist,
+      playlist_bin_writer_t *writer, const char *str, uint32_t old_offset)
+{
+   size_t len, offset;
+   uint32_t hash;
+   const char *old_str = playlist_bin_peek(playlist, old_offset);
+
+   if (!str)
+      return 0;
+
+   if (old_str && string_is_equal(old_str, str))
+      return old_offset;
+
+   len    = strlen(str);
+   hash   = hash_string(str);
+   offset = RHMAP_GET(writer->strings, hash);
+
+   if (     offset
+         && string_is_equal(
+            (const char*)writer->buf + (offset - writer->base), str))
+      return (uint32_t)offset;
+
+   offset = writer->base + RBUF_LEN(writer->buf);
+   if (offset + len + 1 > 0xFFFFFFFF)
+      return 0;
+
+   RBUF_RESIZE(writer->buf, RBUF_LEN(writer->buf) + len + 1);
+   memcpy(writer->buf + (offset - writer->base), str, len + 1);
+   RHMAP_SET(writer->strings, hash, (uint32_t)offset);
+
+   return (uint32_t)offset;
+}
+
+/* Fills 'rec' with the record of 'entry'. 'old_rec'
+ * is its record in the loaded file, or NULL */
+static void playlist_bin_encode(const playlist_t *playlist,
+      playlist_bin_writer_t *writer, const struct playlist_entry *entry,
+      const uint8_t *old_rec, uint8_t *rec)
+{
+   size_t i;
+   const char *strings[8];
+   uint32_t roms     = 0;
+   uint32_t num_roms = 0;
+
+   strings[0] = entry->path;
+   strings[1] = entry->label;
+   strings[2] = entry->core_path;
+   strings[3] = entry->core_name;
+   strings[4] = entry->crc32;
+   strings[5] = entry->db_name;
+   strings[6] = entry->subsystem_ident;
+   strings[7] = entry->subsystem_name;
+
+   memset(rec, 0, PLAYLIST_BIN_RECORD_SIZE);
+
+   for (i = 0; i < 8; i++)
+      playlist_bin_set32(rec + PLAYLIST_BIN_REC_STRINGS + i * 4,
+            playlist_bin_add_string(playlist, writer, strings[i],
+               old_rec ? playlist_bin_get32(
+                  old_rec + PLAYLIST_BIN_REC_STRINGS + i * 4) : 0));
+
+   if (entry->subsystem_roms && entry->subsystem_roms->size > 0)
+   {
+      uint32_t *offsets;
+
+      num_roms = (uint32_t)entry->subsystem_roms->size;
+      offsets  = (uint32_t*)malloc(num_roms * sizeof(*offsets));
+
+      if (offsets)
+      {
+         for (i = 0; i < num_roms; i++)
+            offsets[i] = playlist_bin_add_string(playlist, writer,
+                  entry->subsystem_roms->elems[i].data, 0);
+
+         roms = (uint32_t)(writer->base + RBUF_LEN(writer->buf));
+         RBUF_RESIZE(writer->buf, RBUF_LEN(writer->buf) + num_roms * 4);
+         for (i = 0; i < num_roms; i++)
+            playlist_bin_set32(writer->buf + (roms - writer->base) + i * 4,
+                  offsets[i]);
+
+         free(offsets);
+      }
+      else
+         num_roms = 0;
+   }
+
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_ROMS,          roms);
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_NUM_ROMS,      num_roms);
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_RUNTIME,       entry->runtime_hours);
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_RUNTIME + 4,   entry->runtime_minutes);
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_RUNTIME + 8,   entry->runtime_seconds);
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_PLAYED,        entry->last_played_year);
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_PLAYED + 4,    entry->last_played_month);
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_PLAYED + 8,    entry->last_played_day);
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_PLAYED + 12,   entry->last_played_hour);
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_PLAYED + 16,   entry->last_played_minute);
+   playlist_bin_set32(rec + PLAYLIST_BIN_REC_PLAYED + 20,   entry->last_played_second);
+}
+
+/**
+ * playlist_bin_load:
+ * @playlist            : Playlist handle.
+ * @res                 : Set to false if the playlist could not be loaded.
+ *
+ * Loads the playlist file if it is a binary playlist.
+ * Entries are only allocated here, playlist_bin_decode()
+ * fills them in when they are first accessed.
+ *
+ * Returns: true if the file is a binary playlist.
+ **/
+static bool playlist_bin_load(playlist_t *playlist, bool *res)
+{
+   size_t count;
+   uint8_t header[PLAYLIST_BIN_HEADER_SIZE];
+   int64_t len  = 0;
+   RFILE *file  = filestream_open(playlist->config.path,
+         RETRO_VFS_FILE_ACCESS_READ, RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   len = filestream_read(file, header, sizeof(header));
+   filestream_close(file);
+
+   if (     len != sizeof(header)
+         || memcmp(header, PLAYLIST_BIN_MAGIC, 4))
+      return false;
+
+   playlist->binary = true;
+
+   if (!playlist_bin_map(playlist))
+   {
+      RARCH_ERR("Failed to read playlist file: %s\n", playlist->config.path);
+      playlist->bin_rewrite = true;
+      return true;
+   }
+
+   playlist->bin_records_offset = playlist_bin_get32(header + PLAYLIST_BIN_HDR_RECORDS);
+   playlist->bin_record_size    = playlist_bin_get32(header + PLAYLIST_BIN_HDR_RECORD);
+   playlist->bin_appended       = playlist_bin_get32(header + PLAYLIST_BIN_HDR_APPENDED);
+   playlist->bin_serial         = playlist_bin_get32(header + PLAYLIST_BIN_HDR_SERIAL);
+   count                        = playlist_bin_get32(header + PLAYLIST_BIN_HDR_COUNT);
+
+   if (     playlist_bin_get32(header + PLAYLIST_BIN_HDR_VERSION) != PLAYLIST_BIN_VERSION
+         || playlist_bin_get32(header + PLAYLIST_BIN_HDR_HEADER) < PLAYLIST_BIN_HEADER_SIZE
+         || playlist->bin_record_size < PLAYLIST_BIN_RECORD_SIZE
+         || playlist->bin_records_offset < PLAYLIST_BIN_HEADER_SIZE
+         || playlist->bin_records_offset > playlist->bin_size
+         || count > (playlist->bin_size - playlist->bin_records_offset)
+            / playlist->bin_record_size)
+   {
+      RARCH_WARN("Invalid binary playlist: %s\n", playlist->config.path);
+      playlist_bin_release(playlist);
+      /* Replace it on the next write */
+      playlist->bin_rewrite = true;
+      return true;
+   }
+
+   playlist->default_core_path      = playlist_bin_strdup(playlist,
+         playlist_bin_get32(header + PLAYLIST_BIN_HDR_STRINGS));
+   playlist->default_core_name      = playlist_bin_strdup(playlist,
+         playlist_bin_get32(header + PLAYLIST_BIN_HDR_STRINGS + 4));
+   playlist->base_content_directory = playlist_bin_strdup(playlist,
+         playlist_bin_get32(header + PLAYLIST_BIN_HDR_STRINGS + 8));
+   playlist->label_display_mode     = (enum playlist_label_display_mode)
+      playlist_bin_get32(header + PLAYLIST_BIN_HDR_MODES);
+   playlist->right_thumbnail_mode   = (enum playlist_thumbnail_mode)
+      playlist_bin_get32(header + PLAYLIST_BIN_HDR_MODES + 4);
+   playlist->left_thumbnail_mode    = (enum playlist_thumbnail_mode)
+      playlist_bin_get32(header + PLAYLIST_BIN_HDR_MODES + 8);
+   playlist->sort_mode              = (enum playlist_sort_mode)
+      playlist_bin_get32(header + PLAYLIST_BIN_HDR_MODES + 12);
+
+   if (count > playlist->config.capacity)
+   {
+      RARCH_WARN("Binary playlist contains more entries than current playlist capacity. Excess entries will be discarded.\n");
+      count                 = playlist->config.capacity;
+      playlist->modified    = true;
+      playlist->bin_rewrite = true;
+   }
+
+   if (!count)
+      return true;
+
+   if (     !RBUF_TRYFIT(playlist->entries, count)
+         || !(playlist->bin_decoded = (uint8_t*)calloc(count, 1)))
+   {
+      RARCH_WARN("Ran out of memory while loading binary playlist\n");
+      *res = false;
+      return true;
+   }
+
+   RBUF_RESIZE(playlist->entries, count);
+   memset(playlist->entries, 0, count * sizeof(*playlist->entries));
+
+   return true;
+}
+
+/* Writes the whole playlist in binary format */
+static bool playlist_bin_write(playlist_t *playlist)
+{
+   size_t i;
+   uint8_t *header;
+   char write_path[PATH_MAX_LENGTH];
+   bool success                  = false;
+   size_t len                    = RBUF_LEN(playlist->entries);
+   size_t strings_offset         = PLAYLIST_BIN_HEADER_SIZE
+      + len * PLAYLIST_BIN_RECORD_SIZE;
+   playlist_bin_writer_t writer  = {0};
+   uint32_t serial               = (uint32_t)cpu_features_get_time_usec();
+
+   if (serial == playlist->bin_serial)
+      serial++;
+
+   if (!RBUF_TRYFIT(writer.buf, strings_offset))
+      return false;
+   RBUF_RESIZE(writer.buf, strings_offset);
+   memset(writer.buf, 0, strings_offset);
+
+   for (i = 0; i < len; i++)
+   {
+      uint8_t rec[PLAYLIST_BIN_RECORD_SIZE];
+      playlist_bin_encode(playlist, &writer, &playlist->entries[i],
+            NULL, rec);
+      memcpy(writer.buf + PLAYLIST_BIN_HEADER_SIZE
+            + i * PLAYLIST_BIN_RECORD_SIZE, rec, sizeof(rec));
+   }
+
+   playlist_bin_set32(writer.buf + PLAYLIST_BIN_HDR_STRINGS,
+         playlist_bin_add_string(playlist, &writer,
+            playlist->default_core_path, 0));
+   playlist_bin_set32(writer.buf + PLAYLIST_BIN_HDR_STRINGS + 4,
+         playlist_bin_add_string(playlist, &writer,
+            playlist->default_core_name, 0));
+   playlist_bin_set32(writer.buf + PLAYLIST_BIN_HDR_STRINGS + 8,
+         playlist_bin_add_string(playlist, &writer,
+            playlist->base_content_directory, 0));
+
+   /* String offsets are 32 bit */
+   if (RBUF_LEN(writer.buf) > 0xFFFFFFFF)
+      goto end;
+
+   header = writer.buf;
+   memcpy(header, PLAYLIST_BIN_MAGIC, 4);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_VERSION,  PLAYLIST_BIN_VERSION);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_HEADER,   PLAYLIST_BIN_HEADER_SIZE);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_RECORD,   PLAYLIST_BIN_RECORD_SIZE);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_COUNT,    (uint32_t)len);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_RECORDS,  PLAYLIST_BIN_HEADER_SIZE);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_APPENDED, 0);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_SERIAL,   serial);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_MODES,      playlist->label_display_mode);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_MODES + 4,  playlist->right_thumbnail_mode);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_MODES + 8,  playlist->left_thumbnail_mode);
+   playlist_bin_set32(header + PLAYLIST_BIN_HDR_MODES + 12, playlist->sort_mode);
+
+   strlcpy(write_path, playlist->config.path, sizeof(write_path));
+#ifdef PLAYLIST_HAVE_MMAP
+   /* Other playlist handles may have the file mapped,
+    * replace it instead of truncating it under them */
+   strlcat(write_path, ".tmp", sizeof(write_path));
+#endif
+
+   if (!filestream_write_file(write_path, writer.buf, RBUF_LEN(writer.buf)))
+      goto end;
+
+#ifdef PLAYLIST_HAVE_MMAP
+   if (filestream_rename(write_path, playlist->config.path) != 0)
+   {
+      filestream_delete(write_path);
+      goto end;
+   }
+#endif
+
+   playlist->bin_records_offset = PLAYLIST_BIN_HEADER_SIZE;
+   playlist->bin_record_size    = PLAYLIST_BIN_RECORD_SIZE;
+   playlist->bin_size           = RBUF_LEN(writer.buf);
+   playlist->bin_appended       = 0;
+   playlist->bin_serial         = serial;
+   success                      = true;
+
+end:
+   RBUF_FREE(writer.buf);
+   RHMAP_FREE(writer.strings);
+   return success;
+}
+
+/* Writes the records of the entries changed by
+ * playlist_update() and playlist_update_runtime()
+ * over their old records. Their new strings are
+ * appended to the file. Fails if the file is not
+ * the one that was last loaded or written. */
+static bool playlist_bin_patch(playlist_t *playlist)
+{
+   size_t i;
+   int64_t size;
+   uint8_t appended[4];
+   uint8_t header[PLAYLIST_BIN_HEADER_SIZE];
+   uint8_t *recs                = NULL;
+   bool success                 = false;
+   size_t num_dirty             = RBUF_LEN(playlist->bin_dirty);
+   playlist_bin_writer_t writer = {0};
+   RFILE *file                  = filestream_open(playlist->config.path,
+         RETRO_VFS_FILE_ACCESS_READ_WRITE
+         | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+   if (!file)
+      return false;
+
+   if (     filestream_read(file, header, sizeof(header)) != sizeof(header)
+         || memcmp(header, PLAYLIST_BIN_MAGIC, 4)
+         || playlist_bin_get32(header + PLAYLIST_BIN_HDR_SERIAL)
+            != playlist->bin_serial
+         || playlist_bin_get32(header + PLAYLIST_BIN_HDR_COUNT)
+            != RBUF_LEN(playlist->entries)
+         || (size = filestream_get_size(file)) <= 0
+         || !(recs = (uint8_t*)malloc(num_dirty * PLAYLIST_BIN_RECORD_SIZE)))
+      goto end;
+
+   writer.base = (size_t)size;
+
+   for (i = 0; i < num_dirty; i++)
+   {
+      size_t idx             = playlist->bin_dirty[i];
+      size_t rec_offset      = playlist->bin_records_offset
+         + idx * playlist->bin_record_size;
+      const uint8_t *old_rec = NULL;
+
+      if (     playlist->bin_data
+            && rec_offset + PLAYLIST_BIN_RECORD_SIZE <= playlist->bin_size)
+         old_rec = playlist->bin_data + rec_offset;
+
+      playlist_bin_encode(playlist, &writer, &playlist->entries[idx],
+            old_rec, recs + i * PLAYLIST_BIN_RECORD_SIZE);
+   }
+
+   if (writer.base + RBUF_LEN(writer.buf) > 0xFFFFFFFF)
+      goto end;
+
+   /* Strings first, so that no record points past
+    * the end of the file */
+   if (RBUF_LEN(writer.buf))
+   {
+      if (     filestream_seek(file, size, RETRO_VFS_SEEK_POSITION_START) != 0
+            || filestream_write(file, writer.buf, RBUF_LEN(writer.buf))
+               != (int64_t)RBUF_LEN(writer.buf))
+         goto end;
+   }
+
+   for (i = 0; i < num_dirty; i++)
+   {
+      if (     filestream_seek(file, playlist->bin_records_offset
+                  + playlist->bin_dirty[i] * playlist->bin_record_size,
+                  RETRO_VFS_SEEK_POSITION_START) != 0
+            || filestream_write(file, recs + i * PLAYLIST_BIN_RECORD_SIZE,
+                  PLAYLIST_BIN_RECORD_SIZE) != PLAYLIST_BIN_RECORD_SIZE)
+         goto end;
+   }
+
+   playlist->bin_appended = playlist_bin_get32(header + PLAYLIST_BIN_HDR_APPENDED)
+      + RBUF_LEN(writer.buf);
+   playlist_bin_set32(appended, (uint32_t)playlist->bin_appended);
+
+   success = filestream_seek(file, PLAYLIST_BIN_HDR_APPENDED,
+         RETRO_VFS_SEEK_POSITION_START) == 0
+      && filestream_write(file, appended, 4) == 4;
+
+end:
+   filestream_close(file);
+   free(recs);
+   RBUF_FREE(writer.buf);
+   RHMAP_FREE(writer.strings);
+   return success;
+}
+
+/* playlist_bin_patch(), unless another playlist handle
+ * may have the file mapped. Such a handle may not have
+ * decoded the records being patched yet, and would
+ * find their new strings past the end of its mapping. */
+static bool playlist_bin_patch_unshared(playlist_t *playlist)
+{
+#ifdef PLAYLIST_HAVE_MMAP
+   bool success = false;
+   int fd       = playlist->bin_fd;
+
+   if (fd < 0 && (fd = open(playlist->config.path, O_RDONLY)) < 0)
+      return false;
+
+   /* Every mapping holds a shared lock */
+   if (flock(fd, LOCK_EX | LOCK_NB) == 0)
+      success = playlist_bin_patch(playlist);
+
+   /* Converting the lock may have dropped it
+    * even if that failed, take it again */
+   if (fd == playlist->bin_fd)
+      flock(fd, LOCK_SH);
+   else
+      close(fd);
+
+   return success;
+#else
+   return playlist_bin_patch(playlist);
+#endif
+}
+
+/* Writes the playlist in binary format, patching the
+ * file in place when only some entries have changed
+ * since it was last loaded or written */
+static void playlist_bin_write_file(playlist_t *playlist)
+{
+   bool success = false;
+
+   if (     playlist->binary
+         && !playlist->bin_rewrite
+         && playlist->bin_appended <= playlist->bin_size)
+      success = !playlist->bin_dirty
+         || playlist_bin_patch_unshared(playlist);
+
+   if (!success)
+   {
+      playlist_bin_decode_all(playlist);
+      playlist_bin_release(playlist);
+      success = playlist_bin_write(playlist);
+   }
+
+   if (!success)
+   {
+      RARCH_ERR("Failed to write to playlist file: %s\n", playlist->config.path);
+      return;
+   }
+
+   RBUF_FREE(playlist->bin_dirty);
+   playlist->bin_rewrite = false;
+   playlist->modified    = false;
+   playlist->binary      = true;
+   playlist->old_format  = false;
+   playlist->compressed  = false;
+
+   RARCH_LOG("[Playlist]: Written to playlist file: %s\n", playlist->config.path);
+}
+
+/**
+ * playlist_index_find:
+ * @playlist            : Playlist handle.
+ * @real_path           : 'Real' search path, generated by path_resolve_realpath()
+ *
+ * Looks up every entry whose path playlist_path_equal()
+ * would match with real_path. Resolving the path of each
+ * entry is done once, when the index is built, instead of
+ * on every lookup.
+ *
+ * Returns: an rbuf of the matching entries' path strings,
+ * or NULL if there are none. Must be freed with RBUF_FREE().
+ **/
+static const char **playlist_index_find(playlist_t *playlist,
+      const char *real_path)
+{
+   size_t i, len;
+   const char *delim               = NULL;
+   const char **matches            = NULL;
+   struct playlist_path_node *node = NULL;
+   char key[PATH_MAX_LENGTH];
+
+   if (string_is_empty(real_path))
+      return NULL;
+
+   if (!playlist->path_index_built)
+   {
+      playlist_bin_decode_all(playlist);
+      playlist->path_index_built = true;
+      for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
+         playlist_index_add(playlist, &playlist->entries[i]);
+   }
+
+   strlcpy(key, real_path, sizeof(key));
+   playlist_index_normalize(key);
+   len = strlen(key);
+
+   for (node = RHMAP_GET(playlist->path_map, hash_string(key));
+         node; node = node->next)
+   {
+      if (string_is_equal(node->real_path, key))
+         RBUF_PUSH(matches, node->entry_path);
+   }
+
+#ifdef RARCH_INTERNAL
+   /* If fuzzy matching is disabled, we can give up now */
+   if (!playlist->config.fuzzy_archive_match)
+      return matches;
+#endif
+
+   /* Search path is [archive_path], match entries
+    * with [archive_path][delimiter][rom_file]... */
+   if (path_is_compressed_file(key))
+   {
+      for (node = RHMAP_GET(playlist->archive_map, hash_string(key));
+            node; node = node->archive_next)
+      {
+         if (     node->archive_len == len
+               && !strncmp(node->real_path, key, len))
+            RBUF_PUSH(matches, node->entry_path);
+      }
+   }
+   /* ...or vice versa */
+   else if ((delim = path_get_archive_delim(key)))
+   {
+      len      = (size_t)(delim - key);
+      /* Look up the [archive_path] part alone */
+      key[len] = '\0';
+
+      for (node = RHMAP_GET(playlist->path_map, hash_string(key));
+            node; node = node->next)
+      {
+         if (     node->is_compressed
+               && string_is_equal(node->real_path, key))
+            RBUF_PUSH(matches, node->entry_path);
+      }
+   }
+
+   return matches;
+}
+
+/* Returns true if entry_path is one of the
+ * playlist_index_find() matches */
+static bool playlist_index_is_match(const char **matches,
+      const char *entry_path)
+{
+   size_t i, len;
+
+   if (!entry_path)
+      return false;
+
+   for (i = 0, len = RBUF_LEN(matches); i < len; i++)
+   {
+      if (matches[i] == entry_path)
+         return true;
+   }
+
+   return false;
+}
+
 uint32_t playlist_get_size(playlist_t *playlist)
 {
    if (!playlist)
@@ -383,6 +1405,7 @@ void playlist_get_index(playlist_t *playlist,
    if (!playlist || !entry || (idx >= RBUF_LEN(playlist->entries)))
       return;
 
+   playlist_bin_decode(playlist, idx);
    *entry = &playlist->entries[idx];
 }
 
@@ -463,10 +1486,15 @@ void playlist_delete_index(playlist_t *playlist,
    if (idx >= len)
       return;
 
+   playlist_bin_decode_all(playlist);
+
    /* Free unwanted entry */
    entry_to_delete = (struct playlist_entry *)(playlist->entries + idx);
    if (entry_to_delete)
+   {
+      playlist_index_remove(playlist, entry_to_delete);
       playlist_free_entry(entry_to_delete);
+   }
 
    /* Shift remaining entries to fill the gap */
    memmove(playlist->entries + idx, playlist->entries + idx + 1,
@@ -474,7 +1502,8 @@ void playlist_delete_index(playlist_t *playlist,
 
    RBUF_RESIZE(playlist->entries, len - 1);
 
-   playlist->modified = true;
+   playlist->modified    = true;
+   playlist->bin_rewrite = true;
 }
 
 /**
@@ -488,7 +1517,8 @@ void playlist_delete_index(playlist_t *playlist,
 void playlist_delete_by_path(playlist_t *playlist,
       const char *search_path)
 {
-   size_t i = 0;
+   size_t i             = 0;
+   const char **matches = NULL;
    char real_search_path[PATH_MAX_LENGTH];
 
    real_search_path[0] = '\0';
@@ -500,21 +1530,36 @@ void playlist_delete_by_path(playlist_t *playlist,
    strlcpy(real_search_path, search_path, sizeof(real_search_path));
    path_resolve_realpath(real_search_path, sizeof(real_search_path), true);
 
-   while (i < RBUF_LEN(playlist->entries))
+   matches = playlist_index_find(playlist, real_search_path);
+
+   while (RBUF_LEN(matches) && i < RBUF_LEN(playlist->entries))
    {
-      if (!playlist_path_equal(real_search_path, playlist->entries[i].path,
-            &playlist->config))
+      size_t j;
+      size_t num_matches = RBUF_LEN(matches);
+
+      for (j = 0; j < num_matches; j++)
+      {
+         if (matches[j] == playlist->entries[i].path)
+            break;
+      }
+
+      if (j == num_matches)
       {
          i++;
          continue;
       }
 
-      /* Paths are equal - delete entry */
+      /* Paths are equal - delete entry. Drop the
+       * match first, the entry path is freed */
+      matches[j] = matches[num_matches - 1];
+      RBUF_RESIZE(matches, num_matches - 1);
       playlist_delete_index(playlist, i);
 
       /* Entries are shifted up by the delete
        * operation - *do not* increment i */
    }
+
+   RBUF_FREE(matches);
 }
 
 void playlist_get_index_by_path(playlist_t *playlist,
@@ -522,6 +1567,7 @@ void playlist_get_index_by_path(playlist_t *playlist,
       const struct playlist_entry **entry)
 {
    size_t i, len;
+   const char **matches = NULL;
    char real_search_path[PATH_MAX_LENGTH];
 
    real_search_path[0] = '\0';
@@ -533,22 +1579,27 @@ void playlist_get_index_by_path(playlist_t *playlist,
    strlcpy(real_search_path, search_path, sizeof(real_search_path));
    path_resolve_realpath(real_search_path, sizeof(real_search_path), true);
 
+   if (!(matches = playlist_index_find(playlist, real_search_path)))
+      return;
+
    for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
    {
-      if (!playlist_path_equal(real_search_path, playlist->entries[i].path,
-               &playlist->config))
+      if (!playlist_index_is_match(matches, playlist->entries[i].path))
          continue;
 
       *entry = &playlist->entries[i];
 
       break;
    }
+
+   RBUF_FREE(matches);
 }
 
 bool playlist_entry_exists(playlist_t *playlist,
       const char *path)
 {
-   size_t i, len;
+   bool exists          = false;
+   const char **matches = NULL;
    char real_search_path[PATH_MAX_LENGTH];
 
    real_search_path[0] = '\0';
@@ -560,32 +1611,38 @@ bool playlist_entry_exists(playlist_t *playlist,
    strlcpy(real_search_path, path, sizeof(real_search_path));
    path_resolve_realpath(real_search_path, sizeof(real_search_path), true);
 
-   for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
-   {
-      if (playlist_path_equal(real_search_path, playlist->entries[i].path,
-               &playlist->config))
-         return true;
-   }
+   matches = playlist_index_find(playlist, real_search_path);
+   exists  = RBUF_LEN(matches) > 0;
+   RBUF_FREE(matches);
 
-   return false;
+   return exists;
 }
 
 void playlist_update(playlist_t *playlist, size_t idx,
       const struct playlist_entry *update_entry)
 {
    struct playlist_entry *entry = NULL;
+   bool modified                = false;
 
    if (!playlist || idx >= RBUF_LEN(playlist->entries))
       return;
 
-   entry            = &playlist->entries[idx];
+   playlist_bin_decode(playlist, idx);
+
+   /* Only changes to this entry may be left
+    * in 'modified' by the end */
+   modified           = playlist->modified;
+   playlist->modified = false;
+   entry              = &playlist->entries[idx];
 
    if (update_entry->path && (update_entry->path != entry->path))
    {
+      playlist_index_remove(playlist, entry);
       if (entry->path)
          free(entry->path);
       entry->path        = strdup(update_entry->path);
       playlist->modified = true;
+      playlist_index_add(playlist, entry);
    }
 
    if (update_entry->label && (update_entry->label != entry->label))
@@ -628,6 +1685,10 @@ void playlist_update(playlist_t *playlist, size_t idx,
       entry->crc32       = strdup(update_entry->crc32);
       playlist->modified = true;
    }
+
+   if (playlist->modified)
+      playlist_bin_mark_dirty(playlist, idx);
+   playlist->modified = playlist->modified || modified;
 }
 
 void playlist_update_runtime(playlist_t *playlist, size_t idx,
@@ -635,19 +1696,28 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
       bool register_update)
 {
    struct playlist_entry *entry = NULL;
+   bool modified                = false;
 
    if (!playlist || idx >= RBUF_LEN(playlist->entries))
       return;
 
-   entry            = &playlist->entries[idx];
+   playlist_bin_decode(playlist, idx);
+
+   /* Only changes to this entry may be left
+    * in 'modified' by the end */
+   modified           = playlist->modified;
+   playlist->modified = false;
+   entry              = &playlist->entries[idx];
 
    if (update_entry->path && (update_entry->path != entry->path))
    {
+      playlist_index_remove(playlist, entry);
       if (entry->path)
          free(entry->path);
       entry->path        = NULL;
       entry->path        = strdup(update_entry->path);
       playlist->modified = playlist->modified || register_update;
+      playlist_index_add(playlist, entry);
    }
 
    if (update_entry->core_path && (update_entry->core_path != entry->core_path))
@@ -736,12 +1806,17 @@ void playlist_update_runtime(playlist_t *playlist, size_t idx,
       entry->last_played_str = strdup(update_entry->last_played_str);
       playlist->modified = playlist->modified || register_update;
    }
+
+   if (playlist->modified)
+      playlist_bin_mark_dirty(playlist, idx);
+   playlist->modified = playlist->modified || modified;
 }
 
 bool playlist_push_runtime(playlist_t *playlist,
       const struct playlist_entry *entry)
 {
    size_t i, len;
+   const char **matches = NULL;
    char real_path[PATH_MAX_LENGTH];
    char real_core_path[PATH_MAX_LENGTH];
 
@@ -777,14 +1852,20 @@ bool playlist_push_runtime(playlist_t *playlist,
       return false;
    }
 
-   len = RBUF_LEN(playlist->entries);
-   for (i = 0; i < len; i++)
+   playlist_bin_decode_all(playlist);
+
+   matches = playlist_index_find(playlist, real_path);
+   len     = RBUF_LEN(playlist->entries);
+
+   /* Unless some entry has the same path, there
+    * is no entry to bump to the top */
+   for (i = (matches || string_is_empty(real_path)) ? 0 : len; i < len; i++)
    {
       struct playlist_entry tmp;
       const char *entry_path = playlist->entries[i].path;
       bool equal_path        =
          (string_is_empty(real_path) && string_is_empty(entry_path)) ||
-         playlist_path_equal(real_path, entry_path, &playlist->config);
+         playlist_index_is_match(matches, entry_path);
 
       /* Core name can have changed while still being the same core.
        * Differentiate based on the core path only. */
@@ -794,6 +1875,8 @@ bool playlist_push_runtime(playlist_t *playlist,
       if (!playlist_core_path_equal(real_core_path, playlist->entries[i].core_path, &playlist->config))
          continue;
 
+      RBUF_FREE(matches);
+
       /* If top entry, we don't want to push a new entry since
        * the top and the entry to be pushed are the same. */
       if (i == 0)
@@ -808,12 +1891,15 @@ bool playlist_push_runtime(playlist_t *playlist,
       goto success;
    }
 
+   RBUF_FREE(matches);
+
    if (playlist->config.capacity == 0)
       return false;
 
    if (len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[len - 1];
+      playlist_index_remove(playlist, last_entry);
       playlist_free_entry(last_entry);
       len--;
    }
@@ -838,6 +1924,8 @@ bool playlist_push_runtime(playlist_t *playlist,
       if (!string_is_empty(real_core_path))
          playlist->entries[0].core_path = strdup(real_core_path);
 
+      playlist_index_add(playlist, &playlist->entries[0]);
+
       playlist->entries[0].runtime_status = entry->runtime_status;
       playlist->entries[0].runtime_hours = entry->runtime_hours;
       playlist->entries[0].runtime_minutes = entry->runtime_minutes;
@@ -859,7 +1947,8 @@ bool playlist_push_runtime(playlist_t *playlist,
    }
 
 success:
-   playlist->modified = true;
+   playlist->modified    = true;
+   playlist->bin_rewrite = true;
 
    return true;
 }
@@ -933,6 +2022,7 @@ bool playlist_push(playlist_t *playlist,
    size_t i, len;
    char real_path[PATH_MAX_LENGTH];
    char real_core_path[PATH_MAX_LENGTH];
+   const char **matches  = NULL;
    const char *core_name = entry->core_name;
    bool entry_updated    = false;
 
@@ -981,14 +2071,20 @@ bool playlist_push(playlist_t *playlist,
       }
    }
 
-   len = RBUF_LEN(playlist->entries);
-   for (i = 0; i < len; i++)
+   playlist_bin_decode_all(playlist);
+
+   matches = playlist_index_find(playlist, real_path);
+   len     = RBUF_LEN(playlist->entries);
+
+   /* Unless some entry has the same path, there
+    * is no entry to bump to the top */
+   for (i = (matches || string_is_empty(real_path)) ? 0 : len; i < len; i++)
    {
       struct playlist_entry tmp;
       const char *entry_path = playlist->entries[i].path;
       bool equal_path        =
          (string_is_empty(real_path) && string_is_empty(entry_path)) ||
-         playlist_path_equal(real_path, entry_path, &playlist->config);
+         playlist_index_is_match(matches, entry_path);
 
       /* Core name can have changed while still being the same core.
        * Differentiate based on the core path only. */
@@ -1077,6 +2173,8 @@ bool playlist_push(playlist_t *playlist,
          entry_updated                = true;
       }
 
+      RBUF_FREE(matches);
+
       /* If top entry, we don't want to push a new entry since
        * the top and the entry to be pushed are the same. */
       if (i == 0)
@@ -1096,12 +2194,15 @@ bool playlist_push(playlist_t *playlist,
       goto success;
    }
 
+   RBUF_FREE(matches);
+
    if (playlist->config.capacity == 0)
       return false;
 
    if (len == playlist->config.capacity)
    {
       struct playlist_entry *last_entry = &playlist->entries[len - 1];
+      playlist_index_remove(playlist, last_entry);
       playlist_free_entry(last_entry);
       len--;
    }
@@ -1156,6 +2257,8 @@ bool playlist_push(playlist_t *playlist,
       if (!string_is_empty(entry->subsystem_name))
          playlist->entries[0].subsystem_name  = strdup(entry->subsystem_name);
 
+      playlist_index_add(playlist, &playlist->entries[0]);
+
       if (entry->subsystem_roms)
       {
          union string_list_elem_attr attributes = {0};
@@ -1168,7 +2271,8 @@ bool playlist_push(playlist_t *playlist,
    }
 
 success:
-   playlist->modified = true;
+   playlist->modified    = true;
+   playlist->bin_rewrite = true;
 
    return true;
 }
@@ -1182,6 +2286,10 @@ void playlist_write_runtime_file(playlist_t *playlist)
    if (!playlist || !playlist->modified)
       return;
 
+   /* The file is truncated, drop any mapping of it */
+   playlist_bin_decode_all(playlist);
+   playlist_bin_release(playlist);
+
    file = intfstream_open_file(playlist->config.path,
          RETRO_VFS_FILE_ACCESS_WRITE, RETRO_VFS_FILE_ACCESS_HINT_NONE);
 
@@ -1326,6 +2434,8 @@ void playlist_write_runtime_file(playlist_t *playlist)
    playlist->modified        = false;
    playlist->old_format      = false;
    playlist->compressed      = false;
+   playlist->binary          = false;
+   RBUF_FREE(playlist->bin_dirty);
 
    RARCH_LOG("[Playlist]: Written to playlist file: %s\n", playlist->config.path);
 end:
@@ -1342,18 +2452,34 @@ void playlist_write_file(playlist_t *playlist)
    /* Playlist will be written if any of the
     * following are true:
     * > 'modified' flag is set
+    * > Current playlist format (binary/text) does
+    *   not match requested
     * > Current playlist format (old/new) does not
     *   match requested
     * > Current playlist compression status does
-    *   not match requested */
+    *   not match requested
+    * Binary playlists are never compressed and
+    * have no old format */
    if (!playlist ||
        !(playlist->modified ||
+        (playlist->binary != playlist->config.binary) ||
+        (!playlist->config.binary && (
 #if defined(HAVE_ZLIB)
         (playlist->compressed != playlist->config.compress) ||
 #endif
-        (playlist->old_format != playlist->config.old_format)))
+        (playlist->old_format != playlist->config.old_format)))))
       return;
 
+   if (playlist->config.binary)
+   {
+      playlist_bin_write_file(playlist);
+      return;
+   }
+
+   /* The file is truncated, drop any mapping of it */
+   playlist_bin_decode_all(playlist);
+   playlist_bin_release(playlist);
+
 #if defined(HAVE_ZLIB)
    if (playlist->config.compress)
       file = intfstream_open_rzip_file(playlist->config.path,
@@ -1635,6 +2761,8 @@ void playlist_write_file(playlist_t *playlist)
 
    playlist->modified   = false;
    playlist->compressed = compressed;
+   playlist->binary     = false;
+   RBUF_FREE(playlist->bin_dirty);
 
    RARCH_LOG("[Playlist]: Written to playlist file: %s\n", playlist->config.path);
 end:
@@ -1667,6 +2795,10 @@ void playlist_free(playlist_t *playlist)
       free(playlist->base_content_directory);
    playlist->base_content_directory = NULL;
 
+   playlist_index_free(playlist);
+   playlist_bin_release(playlist);
+   RBUF_FREE(playlist->bin_dirty);
+
    if (playlist->entries)
    {
       for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
@@ -1695,6 +2827,11 @@ void playlist_clear(playlist_t *playlist)
    if (!playlist)
       return;
 
+   playlist_index_free(playlist);
+   playlist_bin_release(playlist);
+   RBUF_FREE(playlist->bin_dirty);
+   playlist->bin_rewrite = true;
+
    for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
    {
       struct playlist_entry *entry = &playlist->entries[i];
@@ -2046,17 +3183,22 @@ static bool playlist_read_file(playlist_t *playlist)
 {
    unsigned i;
    int test_char;
-   bool res = true;
+   bool res             = true;
+   intfstream_t *file   = NULL;
+
+   /* Binary playlists are never compressed */
+   if (playlist_bin_load(playlist, &res))
+      return res;
 
 #if defined(HAVE_ZLIB)
       /* Always use RZIP interface when reading playlists
        * > this will automatically handle uncompressed
        *   data */
-   intfstream_t *file   = intfstream_open_rzip_file(
+   file = intfstream_open_rzip_file(
          playlist->config.path,
          RETRO_VFS_FILE_ACCESS_READ);
 #else
-   intfstream_t *file   = intfstream_open_file(
+   file = intfstream_open_file(
          playlist->config.path,
          RETRO_VFS_FILE_ACCESS_READ,
          RETRO_VFS_FILE_ACCESS_HINT_NONE);
@@ -2374,11 +3516,12 @@ bool playlist_init_cached(const playlist_config_t *config)
    /* If playlist format/compression state
     * does not match requested settings, update
     * file on disk immediately */
-   if (
+   if ((playlist->binary != playlist->config.binary) ||
+       (!playlist->config.binary && (
 #if defined(HAVE_ZLIB)
        (playlist->compressed != playlist->config.compress) ||
 #endif
-       (playlist->old_format != playlist->config.old_format))
+       (playlist->old_format != playlist->config.old_format))))
       playlist_write_file(playlist);
 
    playlist_cached      = playlist;
@@ -2403,11 +3546,27 @@ playlist_t *playlist_init(const playlist_config_t *config)
    playlist->modified               = false;
    playlist->old_format             = false;
    playlist->compressed             = false;
+   playlist->binary                 = false;
    playlist->cached_external        = false;
    playlist->default_core_name      = NULL;
    playlist->default_core_path      = NULL;
    playlist->base_content_directory = NULL;
    playlist->entries                = NULL;
+   playlist->path_nodes             = NULL;
+   playlist->path_map               = NULL;
+   playlist->archive_map            = NULL;
+   playlist->path_index_built       = false;
+   playlist->bin_data               = NULL;
+   playlist->bin_decoded            = NULL;
+   playlist->bin_dirty              = NULL;
+   playlist->bin_size               = 0;
+   playlist->bin_records_offset     = 0;
+   playlist->bin_record_size        = 0;
+   playlist->bin_appended           = 0;
+   playlist->bin_serial             = 0;
+   playlist->bin_fd                 = -1;
+   playlist->bin_mapped             = false;
+   playlist->bin_rewrite            = false;
    playlist->label_display_mode     = LABEL_DISPLAY_MODE_DEFAULT;
    playlist->right_thumbnail_mode   = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
    playlist->left_thumbnail_mode    = PLAYLIST_THUMBNAIL_MODE_DEFAULT;
@@ -2430,6 +3589,8 @@ playlist_t *playlist_init(const playlist_config_t *config)
          size_t i, j, len;
          char tmp_entry_path[PATH_MAX_LENGTH];
 
+         playlist_bin_decode_all(playlist);
+
          for (i = 0, len = RBUF_LEN(playlist->entries); i < len; i++)
          {
             struct playlist_entry* entry = &playlist->entries[i];
@@ -2483,7 +3644,8 @@ playlist_t *playlist_init(const playlist_config_t *config)
       playlist->base_content_directory = strdup(playlist->config.base_content_directory);
 
       /* Save playlist */
-      playlist->modified = true;
+      playlist->modified    = true;
+      playlist->bin_rewrite = true;
       playlist_write_file(playlist);
    }
 
@@ -2575,6 +3737,8 @@ end:
 
 void playlist_qsort(playlist_t *playlist)
 {
+   size_t i, len;
+
    /* Avoid inadvertent sorting if 'sort mode'
     * has been set explicitly to PLAYLIST_SORT_MODE_OFF */
    if (!playlist ||
@@ -2582,9 +3746,26 @@ void playlist_qsort(playlist_t *playlist)
        !playlist->entries)
       return;
 
-   qsort(playlist->entries, RBUF_LEN(playlist->entries),
+   playlist_bin_decode_all(playlist);
+
+   /* Playlists are usually saved sorted. Leaving
+    * them untouched keeps the records of a binary
+    * playlist in place, so they can be patched */
+   for (i = 1, len = RBUF_LEN(playlist->entries); i < len; i++)
+   {
+      if (playlist_qsort_func(&playlist->entries[i - 1],
+               &playlist->entries[i]) > 0)
+         break;
+   }
+
+   if (i >= len)
+      return;
+
+   qsort(playlist->entries, len,
          sizeof(struct playlist_entry),
          (int (*)(const void *, const void *))playlist_qsort_func);
+
+   playlist->bin_rewrite = true;
 }
 
 void command_playlist_push_write(
@@ -2625,6 +3806,8 @@ bool playlist_index_is_valid(playlist_t *playlist, size_t idx,
    if (idx >= RBUF_LEN(playlist->entries))
       return false;
 
+   playlist_bin_decode(playlist, idx);
+
    return string_is_equal(playlist->entries[idx].path, path) &&
           string_is_equal(path_basename(playlist->entries[idx].core_path), path_basename(core_path));
 }
@@ -2680,6 +3863,8 @@ void playlist_get_crc32(playlist_t *playlist, size_t idx,
    if (!playlist || idx >= RBUF_LEN(playlist->entries))
       return;
 
+   playlist_bin_decode(playlist, idx);
+
    if (crc32)
       *crc32 = playlist->entries[idx].crc32;
 }
@@ -2690,6 +3875,8 @@ void playlist_get_db_name(playlist_t *playlist, size_t idx,
    if (!playlist || idx >= RBUF_LEN(playlist->entries))
       return;
 
+   playlist_bin_decode(playlist, idx);
+
    if (db_name)
    {
       if (!string_is_empty(playlist->entries[idx].db_name))
@@ -2779,7 +3966,8 @@ void playlist_set_default_core_path(playlist_t *playlist, const char *core_path)
       if (playlist->default_core_path)
          free(playlist->default_core_path);
       playlist->default_core_path = strdup(real_core_path);
-      playlist->modified = true;
+      playlist->modified    = true;
+      playlist->bin_rewrite = true;
    }
 }
 
@@ -2794,7 +3982,8 @@ void playlist_set_default_core_name(
       if (playlist->default_core_name)
          free(playlist->default_core_name);
       playlist->default_core_name = strdup(core_name);
-      playlist->modified = true;
+      playlist->modified    = true;
+      playlist->bin_rewrite = true;
    }
 }
 
@@ -2807,7 +3996,8 @@ void playlist_set_label_display_mode(playlist_t *playlist,
    if (playlist->label_display_mode != label_display_mode)
    {
       playlist->label_display_mode = label_display_mode;
-      playlist->modified = true;
+      playlist->modified    = true;
+      playlist->bin_rewrite = true;
    }
 }
 
@@ -2823,10 +4013,12 @@ void playlist_set_thumbnail_mode(
       case PLAYLIST_THUMBNAIL_RIGHT:
          playlist->right_thumbnail_mode = thumbnail_mode;
          playlist->modified             = true;
+         playlist->bin_rewrite          = true;
          break;
       case PLAYLIST_THUMBNAIL_LEFT:
          playlist->left_thumbnail_mode = thumbnail_mode;
          playlist->modified            = true;
+         playlist->bin_rewrite         = true;
          break;
    }
 }
@@ -2839,8 +4031,9 @@ void playlist_set_sort_mode(playlist_t *playlist,
 
    if (playlist->sort_mode != sort_mode)
    {
-      playlist->sort_mode = sort_mode;
-      playlist->modified  = true;
+      playlist->sort_mode   = sort_mode;
+      playlist->modified    = true;
+      playlist->bin_rewrite = true;
    }
 }
 
@@ -121,6 +121,7 @@ typedef struct
    size_t capacity;
    bool old_format;
    bool compress;
+   bool binary;
    bool fuzzy_archive_match;
    bool autofix_paths;   
    char path[PATH_MAX_LENGTH];
@@ -283,7 +284,7 @@ playlist_t *playlist_get_cached(void);
 
 /* If current on-disk playlist file referenced
  * by 'config->path' does not match requested
- * 'old format' or 'compression' state, file will
+ * 'binary', 'old format' or 'compression' state, file will
  * be updated automatically
  * > Since this function is called whenever a
  *   playlist is browsed via the menu, this is
@@ -0,0 +1,249 @@
+/*  KingStation - A frontend for libretro.
+ *
+ *  KingStation is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  KingStation is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with KingStation.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Replays consecutive savestates through the rewind delta encoder,
+ * once per available kernel, with and without the page hash pass.
+ *
+ * Usage: state_manager_bench [state0 state1 ...]
+ *
+ * The states must be uncompressed and of equal size; each pair of
+ * consecutive files is compressed and decompressed again. Without
+ * arguments, a synthetic 8MB state with noisy RAM is used instead.
+ */
+
+#include <stdio.h>
+
+/* The encoder is private to state_manager.c */
+#include "../../state_manager.c"
+
+#include <streams/file_stream.h>
+
+#define SYNTHETIC_SIZE   (8 << 20)
+#define SYNTHETIC_STATES 64
+
+/* Frontend symbols state_manager.c links against */
+const char *msg_hash_to_str(enum msg_hash_enums msg) { return ""; }
+bool audio_driver_has_callback(void) { return false; }
+void audio_driver_frame_is_reverse(void) { }
+void audio_driver_setup_rewind(void) { }
+bool core_serialize_size(retro_ctx_size_info_t *info) { return false; }
+bool core_serialize(retro_ctx_serialize_info_t *info) { return false; }
+bool core_unserialize(retro_ctx_serialize_info_t *info) { return false; }
+bool core_set_rewind_callbacks(void) { return true; }
+bool rarch_ctl(enum rarch_ctl_state state, void *data) { return false; }
+void bsv_movie_frame_rewind(void) { }
+void RARCH_LOG(const char *fmt, ...) { }
+void RARCH_WARN(const char *fmt, ...) { }
+void RARCH_ERR(const char *fmt, ...) { }
+
+struct bench_kernel
+{
+   const char *ident;
+   uint64_t cpu;
+   uint64_t required;
+};
+
+static uint32_t bench_rand_state = 1;
+
+static uint32_t bench_rand(void)
+{
+   bench_rand_state = bench_rand_state * 1103515245 + 12345;
+   return bench_rand_state >> 8;
+}
+
+static uint8_t **bench_load_states(int argc, char *argv[],
+      size_t *num, size_t *size)
+{
+   int i;
+   uint8_t **states = NULL;
+
+   if (argc < 2)
+   {
+      /* Mostly static memory, scattered writes to a hot work RAM
+       * area and a few rewritten pages elsewhere, roughly what a
+       * 3D console core looks like frame to frame. */
+      *num   = SYNTHETIC_STATES;
+      *size  = SYNTHETIC_SIZE;
+      states = (uint8_t**)calloc(*num, sizeof(*states));
+
+      for (i = 0; i < (int)*num; i++)
+      {
+         size_t j;
+
+         states[i] = (uint8_t*)state_manager_raw_alloc(*size, i & 1);
+
+         if (i == 0)
+         {
+            for (j = 0; j < *size; j++)
+               states[i][j] = bench_rand();
+            continue;
+         }
+
+         memcpy(states[i], states[i - 1], *size);
+
+         for (j = 0; j < 20000; j++)
+            states[i][bench_rand() % (*size / 16)] = bench_rand();
+         for (j = 0; j < 8; j++)
+            memset(states[i] + bench_rand() % (*size - 4096),
+                  bench_rand(), 4096);
+      }
+
+      return states;
+   }
+
+   *num   = argc - 1;
+   *size  = 0;
+   states = (uint8_t**)calloc(*num, sizeof(*states));
+
+   for (i = 0; i < (int)*num; i++)
+   {
+      void *buf   = NULL;
+      int64_t len = 0;
+
+      if (!filestream_read_file(argv[i + 1], &buf, &len))
+      {
+         fprintf(stderr, "Could not read %s\n", argv[i + 1]);
+         exit(1);
+      }
+
+      if (!*size)
+         *size = (size_t)len;
+      else if (*size != (size_t)len)
+      {
+         fprintf(stderr, "%s has a different size\n", argv[i + 1]);
+         exit(1);
+      }
+
+      states[i] = (uint8_t*)state_manager_raw_alloc(*size, i & 1);
+      memcpy(states[i], buf, *size);
+      free(buf);
+   }
+
+   return states;
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned k, hashed;
+   size_t i, num, size;
+   uint64_t cpu                         = cpu_features_get();
+   static const struct bench_kernel kernels[] = {
+      { "c",    0,                 0 },
+#if __SSE2__
+      { "sse2", RETRO_SIMD_SSE2,   0 },
+#endif
+#ifdef STATE_MANAGER_AVX2
+      { "avx2", RETRO_SIMD_AVX2,   RETRO_SIMD_AVX2 },
+#endif
+#ifdef STATE_MANAGER_NEON
+      { "neon", RETRO_SIMD_NEON,   RETRO_SIMD_NEON },
+#endif
+   };
+   uint8_t **states   = bench_load_states(argc, argv, &num, &size);
+   uint8_t *patch     = (uint8_t*)malloc(state_manager_raw_maxsize(size));
+   uint8_t *out       = (uint8_t*)state_manager_raw_alloc(size, 0);
+   size_t num_pages   = (size + STATE_MANAGER_PAGE_SIZE - 1)
+      / STATE_MANAGER_PAGE_SIZE;
+   uint8_t *dirty     = (uint8_t*)malloc(num_pages);
+   uint64_t *hashes   = (uint64_t*)malloc(num_pages * sizeof(uint64_t));
+
+   if (num < 2)
+   {
+      fprintf(stderr, "Need at least two states.\n");
+      return 1;
+   }
+
+   printf("%zu states of %zu bytes\n", num, size);
+   printf("%-6s %-6s %12s %12s %10s\n",
+         "kernel", "pages", "comp MB/s", "decomp MB/s", "ratio");
+
+   for (k = 0; k < sizeof(kernels) / sizeof(kernels[0]); k++)
+   {
+      if ((cpu & kernels[k].required) != kernels[k].required)
+         continue;
+
+      state_manager_init_simd(kernels[k].cpu);
+
+      for (hashed = 0; hashed < 2; hashed++)
+      {
+         retro_time_t comp_time   = 0;
+         retro_time_t decomp_time = 0;
+         uint64_t comp_bytes      = 0;
+
+         for (i = 0; hashed && i < num_pages; i++)
+         {
+            size_t offset = i * STATE_MANAGER_PAGE_SIZE;
+            hashes[i]     = state_manager_page_hash(states[0] + offset,
+                  MIN(STATE_MANAGER_PAGE_SIZE, size - offset));
+         }
+
+         for (i = 1; i < num; i++)
+         {
+            size_t p, len;
+            const uint8_t *pages = NULL;
+            retro_time_t start   = cpu_features_get_time_usec();
+
+            /* Hashing the new state is part of the cost of the coarse
+             * pass, the previous state's hashes are kept around. */
+            if (hashed)
+            {
+               for (p = 0; p < num_pages; p++)
+               {
+                  size_t offset = p * STATE_MANAGER_PAGE_SIZE;
+                  uint64_t hash = state_manager_page_hash(
+                        states[i] + offset,
+                        MIN(STATE_MANAGER_PAGE_SIZE, size - offset));
+                  dirty[p]      = hash != hashes[p];
+                  hashes[p]     = hash;
+               }
+               pages = dirty;
+            }
+
+            len          = state_manager_raw_compress(states[i - 1],
+                  states[i], size, patch, pages);
+            comp_time   += cpu_features_get_time_usec() - start;
+            comp_bytes  += len;
+
+            memcpy(out, states[i], size);
+
+            start        = cpu_features_get_time_usec();
+            state_manager_raw_decompress(patch, len, out, size);
+            decomp_time += cpu_features_get_time_usec() - start;
+
+            if (memcmp(out, states[i - 1], size))
+            {
+               fprintf(stderr, "%s: state %zu did not round-trip!\n",
+                     kernels[k].ident, i);
+               return 1;
+            }
+         }
+
+         printf("%-6s %-6s %12.1f %12.1f %9.2f%%\n",
+               kernels[k].ident, hashed ? "hash" : "-",
+               (double)size * (num - 1) / (comp_time ? comp_time : 1),
+               (double)size * (num - 1) / (decomp_time ? decomp_time : 1),
+               100.0 * comp_bytes / ((double)size * (num - 1)));
+      }
+   }
+
+   for (i = 0; i < num; i++)
+      free(states[i]);
+   free(states);
+   free(patch);
+   free(out);
+   free(dirty);
+   free(hashes);
+
+   return 0;
+}
@@ -0,0 +1,162 @@
+/*  KingStation - A frontend for libretro.
+ *
+ *  KingStation is free software: you can redistribute it and/or modify it under the terms
+ *  of the GNU General Public License as published by the Free Software Found-
+ *  ation, either version 3 of the License, or (at your option) any later version.
+ *
+ *  KingStation is distributed in the hope that it will be useful, but WITHOUT ANY WARRANTY;
+ *  without even the implied warranty of MERCHANTABILITY or FITNESS FOR A PARTICULAR
+ *  PURPOSE.  See the GNU General Public License for more details.
+ *
+ *  You should have received a copy of the GNU General Public License along with KingStation.
+ *  If not, see <http://www.gnu.org/licenses/>.
+ */
+
+/* Loads two PNG images at once through the threaded task queue,
+ * on a pool of two threads, and checks that their handlers ran at
+ * the same time.
+ *
+ * Usage: image_task_test [dir]
+ *
+ * The images are written to 'dir', the current directory by
+ * default, and removed again. Exits with 1 if the loads ran one
+ * after the other or failed.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <file/file_path.h>
+#include <formats/image.h>
+#include <formats/rpng.h>
+#include <queues/task_queue.h>
+#include <retro_timers.h>
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#include <streams/file_stream.h>
+
+/* The real handler is wrapped below to watch the tasks */
+#define task_file_load_handler task_file_load_handler_real
+#include "../../../tasks/task_file_transfer.c"
+#undef task_file_load_handler
+
+#include "../../../configuration.h"
+#include "../../../KingStation.h"
+
+#define TEST_IMAGES  2
+#define TEST_SIZE    512
+#define TEST_TIMEOUT 5000 /* ms */
+
+static tpool_t *test_pool          = NULL;
+static slock_t *test_lock          = NULL;
+static unsigned test_in_flight     = 0;
+static unsigned test_max_in_flight = 0;
+static unsigned test_loaded        = 0;
+static unsigned test_failed        = 0;
+
+/* Frontend symbols task_image.c links against */
+settings_t *config_get_ptr(void) { return NULL; }
+tpool_t *KingStation_get_thread_pool(void) { return test_pool; }
+
+void task_file_load_handler(retro_task_t *task)
+{
+   slock_lock(test_lock);
+   if (++test_in_flight > test_max_in_flight)
+      test_max_in_flight = test_in_flight;
+   slock_unlock(test_lock);
+
+   /* Long enough for the other task to start meanwhile */
+   retro_sleep(20);
+   task_file_load_handler_real(task);
+
+   slock_lock(test_lock);
+   test_in_flight--;
+   slock_unlock(test_lock);
+}
+
+static void test_image_cb(retro_task_t *task,
+      void *task_data, void *user_data, const char *err)
+{
+   struct texture_image *img = (struct texture_image*)task_data;
+
+   if (img && img->pixels
+         && img->width == TEST_SIZE && img->height == TEST_SIZE)
+      test_loaded++;
+   else
+      test_failed++;
+
+   if (img)
+   {
+      image_texture_free(img);
+      free(img);
+   }
+}
+
+int main(int argc, char *argv[])
+{
+   unsigned i;
+   char paths[TEST_IMAGES][PATH_MAX_LENGTH];
+   const char *dir  = argc > 1 ? argv[1] : ".";
+   uint32_t *pixels = (uint32_t*)malloc(
+         TEST_SIZE * TEST_SIZE * sizeof(uint32_t));
+   unsigned waited  = 0;
+
+   if (!pixels)
+      return 1;
+
+   /* Noise, so the images take a while to inflate */
+   for (i = 0; i < TEST_SIZE * TEST_SIZE; i++)
+      pixels[i] = 0xff000000 | (i * 2654435761u >> 8);
+
+   for (i = 0; i < TEST_IMAGES; i++)
+   {
+      char name[32];
+      snprintf(name, sizeof(name), "image_task_test%u.png", i);
+      fill_pathname_join(paths[i], dir, name, sizeof(paths[i]));
+
+      if (!rpng_save_image_argb(paths[i], pixels,
+               TEST_SIZE, TEST_SIZE, TEST_SIZE * sizeof(uint32_t)))
+      {
+         fprintf(stderr, "Could not write %s\n", paths[i]);
+         return 1;
+      }
+   }
+   free(pixels);
+
+   test_lock = slock_new();
+   test_pool = tpool_create(TEST_IMAGES);
+
+   task_queue_set_thread_pool(test_pool);
+   task_queue_set_concurrency(TEST_IMAGES, NULL);
+   task_queue_init(true, NULL);
+   task_image_decode_init();
+
+   for (i = 0; i < TEST_IMAGES; i++)
+      task_push_image_load(paths[i], true, 0, test_image_cb, NULL);
+
+   while (test_loaded + test_failed < TEST_IMAGES && waited < TEST_TIMEOUT)
+   {
+      task_queue_check();
+      retro_sleep(1);
+      waited++;
+   }
+
+   task_queue_deinit();
+   task_image_decode_deinit();
+   tpool_destroy(test_pool);
+   slock_free(test_lock);
+
+   for (i = 0; i < TEST_IMAGES; i++)
+      filestream_delete(paths[i]);
+
+   printf("%u of %u images loaded, at most %u at once\n",
+         test_loaded, TEST_IMAGES, test_max_in_flight);
+
+   if (test_loaded != TEST_IMAGES || test_max_in_flight < TEST_IMAGES)
+   {
+      fprintf(stderr, "Image loads did not run concurrently!\n");
+      return 1;
+   }
+
+   return 0;
+}
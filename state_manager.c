@@ -24,8 +24,11 @@
 #include <string.h>
 
 #include <retro_inline.h>
+#include <retro_miscellaneous.h>
 #include <compat/strl.h>
 #include <compat/intrinsics.h>
+#include <features/features_cpu.h>
+#include <streams/trans_stream.h>
 
 #include "state_manager.h"
 #include "msg_hash.h"
@@ -62,6 +65,28 @@
 #include <emmintrin.h>
 #endif
 
+/* AVX2 kernels are built with a function-level target where the
+ * compiler allows it, and only used if the CPU reports AVX2. */
+#if defined(CPU_X86) && (defined(__AVX2__) || defined(__GNUC__) || (defined(_MSC_VER) && _MSC_VER >= 1700))
+#define STATE_MANAGER_AVX2
+#include <immintrin.h>
+#if defined(__GNUC__) && !defined(__AVX2__)
+#define AVX2_FUNC __attribute__((target("avx2")))
+#else
+#define AVX2_FUNC
+#endif
+#endif
+
+#if (defined(__ARM_NEON__) || defined(__ARM_NEON)) && !defined(DONT_WANT_ARM_OPTIMIZATIONS)
+#define STATE_MANAGER_NEON
+#include <arm_neon.h>
+#endif
+
+/* Granularity of the optional coarse pass; pages whose hash
+ * did not change since the last push are skipped entirely. */
+#define STATE_MANAGER_PAGE_SIZE 4096
+#define STATE_MANAGER_PAGE16    (STATE_MANAGER_PAGE_SIZE / sizeof(uint16_t))
+
 /* Format per frame (pseudocode): */
 #if 0
 size nextstart;
@@ -84,33 +109,8 @@ size thisstart;
 
 /* There's no equivalent in libc, you'd think so ...
  * std::mismatch exists, but it's not optimized at all. */
-static size_t find_change(const uint16_t *a, const uint16_t *b)
+static size_t find_change_c(const uint16_t *a, const uint16_t *b)
 {
-#if __SSE2__
-   const __m128i *a128 = (const __m128i*)a;
-   const __m128i *b128 = (const __m128i*)b;
-
-   for (;;)
-   {
-      __m128i v0    = _mm_loadu_si128(a128);
-      __m128i v1    = _mm_loadu_si128(b128);
-      __m128i c     = _mm_cmpeq_epi8(v0, v1);
-      uint32_t mask = _mm_movemask_epi8(c);
-
-      if (mask != 0xffff) /* Something has changed, figure out where. */
-      {
-         /* calculate the real offset to the differing byte */
-         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
-               (compat_ctz(~mask)));
-
-         /* and convert that to the uint16_t offset */
-         return (ret >> 1);
-      }
-
-      a128++;
-      b128++;
-   }
-#else
    const uint16_t *a_org = a;
 #ifdef NO_UNALIGNED_MEM
    while (((uintptr_t)a & (sizeof(size_t) - 1)) && *a == *b)
@@ -139,10 +139,9 @@ static size_t find_change(const uint16_t *a, const uint16_t *b)
       }
    }
    return a - a_org;
-#endif
 }
 
-static size_t find_same(const uint16_t *a, const uint16_t *b)
+static size_t find_same_c(const uint16_t *a, const uint16_t *b)
 {
    const uint16_t *a_org = a;
 #ifdef NO_UNALIGNED_MEM
@@ -182,6 +181,316 @@ static size_t find_same(const uint16_t *a, const uint16_t *b)
    return a - a_org;
 }
 
+static void copy16_c(uint16_t *out, const uint16_t *in, size_t len)
+{
+   size_t i;
+   for (i = 0; i < len; i++)
+      out[i] = in[i];
+}
+
+/* The vectorized scans below compare the same 32-bit words as
+ * find_same_c(), so they emit identical patches on x86. */
+
+#if __SSE2__
+static size_t find_change_sse2(const uint16_t *a, const uint16_t *b)
+{
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+
+   for (;;)
+   {
+      __m128i v0    = _mm_loadu_si128(a128);
+      __m128i v1    = _mm_loadu_si128(b128);
+      __m128i c     = _mm_cmpeq_epi8(v0, v1);
+      uint32_t mask = _mm_movemask_epi8(c);
+
+      if (mask != 0xffff) /* Something has changed, figure out where. */
+      {
+         /* calculate the real offset to the differing byte */
+         size_t ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(~mask)));
+
+         /* and convert that to the uint16_t offset */
+         return (ret >> 1);
+      }
+
+      a128++;
+      b128++;
+   }
+}
+
+static size_t find_same_sse2(const uint16_t *a, const uint16_t *b)
+{
+   const __m128i *a128 = (const __m128i*)a;
+   const __m128i *b128 = (const __m128i*)b;
+   size_t ret          = 0;
+
+   for (;;)
+   {
+      __m128i v0    = _mm_loadu_si128(a128);
+      __m128i v1    = _mm_loadu_si128(b128);
+      __m128i c     = _mm_cmpeq_epi32(v0, v1);
+      uint32_t mask = _mm_movemask_epi8(c);
+
+      if (mask)
+      {
+         ret = (((uint8_t*)a128 - (uint8_t*)a) |
+               (compat_ctz(mask))) >> 1;
+         break;
+      }
+
+      a128++;
+      b128++;
+   }
+
+   if (ret && a[ret - 1] == b[ret - 1])
+      ret--;
+   return ret;
+}
+
+static void copy16_sse2(uint16_t *out, const uint16_t *in, size_t len)
+{
+   size_t i;
+   for (i = 0; i + 8 <= len; i += 8)
+      _mm_storeu_si128((__m128i*)(out + i),
+            _mm_loadu_si128((const __m128i*)(in + i)));
+   for (; i < len; i++)
+      out[i] = in[i];
+}
+#endif
+
+#ifdef STATE_MANAGER_AVX2
+static AVX2_FUNC size_t find_change_avx2(const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+
+   for (;;)
+   {
+      __m256i v0    = _mm256_loadu_si256(a256);
+      __m256i v1    = _mm256_loadu_si256(b256);
+      __m256i c     = _mm256_cmpeq_epi8(v0, v1);
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(c);
+
+      if (mask != 0xffffffff)
+      {
+         size_t ret = (((uint8_t*)a256 - (uint8_t*)a) |
+               (compat_ctz(~mask)));
+         return (ret >> 1);
+      }
+
+      a256++;
+      b256++;
+   }
+}
+
+static AVX2_FUNC size_t find_same_avx2(const uint16_t *a, const uint16_t *b)
+{
+   const __m256i *a256 = (const __m256i*)a;
+   const __m256i *b256 = (const __m256i*)b;
+   size_t ret          = 0;
+
+   for (;;)
+   {
+      __m256i v0    = _mm256_loadu_si256(a256);
+      __m256i v1    = _mm256_loadu_si256(b256);
+      __m256i c     = _mm256_cmpeq_epi32(v0, v1);
+      uint32_t mask = (uint32_t)_mm256_movemask_epi8(c);
+
+      if (mask)
+      {
+         ret = (((uint8_t*)a256 - (uint8_t*)a) |
+               (compat_ctz(mask))) >> 1;
+         break;
+      }
+
+      a256++;
+      b256++;
+   }
+
+   if (ret && a[ret - 1] == b[ret - 1])
+      ret--;
+   return ret;
+}
+
+static AVX2_FUNC void copy16_avx2(uint16_t *out,
+      const uint16_t *in, size_t len)
+{
+   size_t i;
+   for (i = 0; i + 16 <= len; i += 16)
+      _mm256_storeu_si256((__m256i*)(out + i),
+            _mm256_loadu_si256((const __m256i*)(in + i)));
+   for (; i < len; i++)
+      out[i] = in[i];
+}
+#endif
+
+#ifdef STATE_MANAGER_NEON
+/* NEON has no movemask; find the block that differs with
+ * vector compares, then locate the word within it in C. */
+static size_t find_change_neon(const uint16_t *a, const uint16_t *b)
+{
+   const uint16_t *a_org = a;
+
+   for (;;)
+   {
+      uint8x16_t c  = vceqq_u8(vld1q_u8((const uint8_t*)a),
+            vld1q_u8((const uint8_t*)b));
+      uint64x2_t c2 = vreinterpretq_u64_u8(c);
+
+      if ((vgetq_lane_u64(c2, 0) & vgetq_lane_u64(c2, 1)) != ~(uint64_t)0)
+         break;
+
+      a += 8;
+      b += 8;
+   }
+
+   while (*a == *b)
+   {
+      a++;
+      b++;
+   }
+   return a - a_org;
+}
+
+static size_t find_same_neon(const uint16_t *a, const uint16_t *b)
+{
+   size_t ret = 0;
+
+   for (;;)
+   {
+      uint32x4_t c  = vceqq_u32(
+            vreinterpretq_u32_u8(vld1q_u8((const uint8_t*)(a + ret))),
+            vreinterpretq_u32_u8(vld1q_u8((const uint8_t*)(b + ret))));
+      uint64x2_t c2 = vreinterpretq_u64_u32(c);
+
+      if (vgetq_lane_u64(c2, 0) | vgetq_lane_u64(c2, 1))
+         break;
+
+      ret += 8;
+   }
+
+   /* Same 32-bit word grouping as the C version */
+   while (a[ret] != b[ret] || a[ret + 1] != b[ret + 1])
+      ret += 2;
+
+   if (ret && a[ret - 1] == b[ret - 1])
+      ret--;
+   return ret;
+}
+
+static void copy16_neon(uint16_t *out, const uint16_t *in, size_t len)
+{
+   size_t i;
+   for (i = 0; i + 8 <= len; i += 8)
+      vst1q_u16(out + i, vld1q_u16(in + i));
+   for (; i < len; i++)
+      out[i] = in[i];
+}
+#endif
+
+static size_t (*find_change)(const uint16_t *a, const uint16_t *b) =
+#if __SSE2__
+   find_change_sse2;
+#else
+   find_change_c;
+#endif
+static size_t (*find_same)(const uint16_t *a, const uint16_t *b) =
+   find_same_c;
+static void (*copy16)(uint16_t *out, const uint16_t *in, size_t len) =
+   copy16_c;
+
+/**
+ * state_manager_init_simd:
+ * @cpu                 : mask of RETRO_SIMD_* features to use
+ *
+ * Sets up the delta encoder kernels based on CPU features.
+ **/
+static void state_manager_init_simd(uint64_t cpu)
+{
+   find_change = find_change_c;
+   find_same   = find_same_c;
+   copy16      = copy16_c;
+
+#if __SSE2__
+   if (cpu & RETRO_SIMD_SSE2)
+   {
+      find_change = find_change_sse2;
+      find_same   = find_same_sse2;
+      copy16      = copy16_sse2;
+   }
+#endif
+
+#ifdef STATE_MANAGER_AVX2
+   if (cpu & RETRO_SIMD_AVX2)
+   {
+      find_change = find_change_avx2;
+      find_same   = find_same_avx2;
+      copy16      = copy16_avx2;
+   }
+#endif
+#ifdef STATE_MANAGER_NEON
+   if (cpu & RETRO_SIMD_NEON)
+   {
+      find_change = find_change_neon;
+      find_same   = find_same_neon;
+      copy16      = copy16_neon;
+   }
+#endif
+}
+
+#define STATE_MANAGER_ROTL(x, r) (((x) << (r)) | ((x) >> (64 - (r))))
+
+/**
+ * state_manager_page_hash:
+ * @data                : start of the page
+ * @len                 : length of the page in bytes
+ *
+ * Hashes a page for the coarse pass. Four independent lanes keep
+ * the multiplier busy; the rotate feeds the high bits of each
+ * product back into the low ones, or changes in the top bytes of
+ * a word would only ever reach the top bits of the lane and two
+ * of them could cancel out. It is still not collision-proof,
+ * hence the pass is optional.
+ **/
+static uint64_t state_manager_page_hash(const uint8_t *data, size_t len)
+{
+   static const uint64_t prime = 0x9e3779b97f4a7c15ULL;
+   static const uint64_t mix   = 0xc2b2ae3d27d4eb4fULL;
+   uint64_t h0                 = 0x243f6a8885a308d3ULL;
+   uint64_t h1                 = 0x13198a2e03707344ULL;
+   uint64_t h2                 = 0xa4093822299f31d0ULL;
+   uint64_t h3                 = 0x082efa98ec4e6c89ULL;
+   uint64_t w[4];
+   size_t i                    = 0;
+
+   for (; i + sizeof(w) <= len; i += sizeof(w))
+   {
+      memcpy(w, data + i, sizeof(w));
+      h0 = STATE_MANAGER_ROTL(h0 + w[0] * mix, 31) * prime;
+      h1 = STATE_MANAGER_ROTL(h1 + w[1] * mix, 31) * prime;
+      h2 = STATE_MANAGER_ROTL(h2 + w[2] * mix, 31) * prime;
+      h3 = STATE_MANAGER_ROTL(h3 + w[3] * mix, 31) * prime;
+   }
+
+   for (; i + sizeof(w[0]) <= len; i += sizeof(w[0]))
+   {
+      memcpy(w, data + i, sizeof(w[0]));
+      h0 = STATE_MANAGER_ROTL(h0 + w[0] * mix, 31) * prime;
+   }
+
+   if (i < len)
+   {
+      w[0] = 0;
+      memcpy(w, data + i, len - i);
+      h0 = STATE_MANAGER_ROTL(h0 + w[0] * mix, 31) * prime;
+   }
+
+   return h0 ^ STATE_MANAGER_ROTL(h1, 16)
+      ^ STATE_MANAGER_ROTL(h2, 32)
+      ^ STATE_MANAGER_ROTL(h3, 48);
+}
+
 /* Returns the maximum compressed size of a savestate.
  * It is very likely to compress to far less. */
 static size_t state_manager_raw_maxsize(size_t uncomp)
@@ -202,171 +511,740 @@ static size_t state_manager_raw_maxsize(size_t uncomp)
  */
 static void *state_manager_raw_alloc(size_t len, uint16_t uniq)
 {
-   size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
-   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 16, 1);
+   size_t  len16 = (len + sizeof(uint16_t) - 1) & -sizeof(uint16_t);
+   uint16_t *ret = (uint16_t*)calloc(len16 + sizeof(uint16_t) * 4 + 64, 1);
+
+   /* Force in a different byte at the end, so we don't need to check
+    * bounds in the innermost loop (it's expensive).
+    *
+    * There is also a large amount of data that's the same, to stop
+    * the other scan.
+    *
+    * There is also some padding at the end. This is so we don't
+    * read outside the buffer end if we're reading in large blocks;
+    *
+    * It doesn't make any difference to us, but sacrificing 64 bytes
+    * (two AVX2 loads, rounded up) to get Valgrind happy is worth it. */
+   ret[len16/sizeof(uint16_t) + 3] = uniq;
+
+   return ret;
+}
+
+#ifdef HAVE_THREADS
+/* Blocks are recycled in a pool when capture is threaded,
+ * so the 'uniq' guard word has to be rewritten to make sure
+ * it differs from the block it gets compressed against. */
+static INLINE uint16_t state_manager_raw_get_uniq(
+      const void *block, size_t len16)
+{
+   return ((const uint16_t*)block)[len16/sizeof(uint16_t) + 3];
+}
+
+static INLINE void state_manager_raw_set_uniq(
+      void *block, size_t len16, uint16_t uniq)
+{
+   ((uint16_t*)block)[len16/sizeof(uint16_t) + 3] = uniq;
+}
+#endif
+
+/*
+ * Takes two savestates and creates a patch that turns 'src' into 'dst'.
+ * Both 'src' and 'dst' must be returned from state_manager_raw_alloc(),
+ * with the same 'len', and different 'uniq'.
+ *
+ * If 'dirty' is non-NULL, it holds one byte per STATE_MANAGER_PAGE_SIZE
+ * page of 'dst', and pages marked clean are assumed to be unchanged.
+ * 'dst' is temporarily modified to fence off runs of dirty pages.
+ *
+ * 'patch' must be size 'state_manager_raw_maxsize(len)' or more.
+ * Returns the number of bytes actually written to 'patch'.
+ */
+static size_t state_manager_raw_compress(const void *src,
+      const void *dst, size_t len, void *patch, const uint8_t *dirty)
+{
+   const uint16_t  *old16 = (const uint16_t*)src;
+   uint16_t        *new16 = (uint16_t*)dst;
+   uint16_t *compressed16 = (uint16_t*)patch;
+   size_t          num16s = (len + sizeof(uint16_t) - 1)
+      / sizeof(uint16_t);
+   size_t        numpages = (num16s + STATE_MANAGER_PAGE16 - 1)
+      / STATE_MANAGER_PAGE16;
+   size_t             pos = 0;
+   size_t            skip = 0;
+   /* Scans stop at 'end' - the sentinel, or a fence */
+   size_t             end = dirty ? 0 : num16s;
+   uint16_t     fence_val = 0;
+   bool            fenced = false;
+
+   while (pos < num16s)
+   {
+      size_t i, changed, found;
+
+      if (pos >= end)
+      {
+         size_t page = pos / STATE_MANAGER_PAGE16;
+
+         if (fenced)
+         {
+            new16[end] = fence_val;
+            fenced     = false;
+         }
+
+         if (!dirty[page])
+         {
+            end        = MIN((page + 1) * STATE_MANAGER_PAGE16, num16s);
+            skip      += end - pos;
+            pos        = end;
+            continue;
+         }
+
+         while (page + 1 < numpages && dirty[page + 1])
+            page++;
+
+         end           = MIN((page + 1) * STATE_MANAGER_PAGE16, num16s);
+
+         /* Force a difference right after the dirty run,
+          * so find_change() can't wander into clean pages. */
+         if (end < num16s)
+         {
+            fence_val  = new16[end];
+            new16[end] = ~old16[end];
+            fenced     = true;
+         }
+      }
+
+      found = find_change(old16 + pos, new16 + pos);
+
+      if (found >= end - pos)
+      {
+         skip += end - pos;
+         pos   = end;
+         continue;
+      }
+
+      pos  += found;
+      skip += found;
+
+      while (skip > UINT16_MAX)
+      {
+         /* Anything past 8GB of unchanged data takes more than one
+          * of these, but if you're doing that, you've got bigger
+          * problems. */
+         size_t step     = MIN(skip, UINT32_MAX);
+
+         *compressed16++ = 0;
+         *compressed16++ = step;
+         *compressed16++ = step >> 16;
+         skip           -= step;
+      }
+
+      changed         = find_same(old16 + pos, new16 + pos);
+      if (changed > UINT16_MAX)
+         changed = UINT16_MAX;
+      if (changed > end - pos)
+         changed = end - pos;
+
+      *compressed16++ = changed;
+      *compressed16++ = skip;
+
+      for (i = 0; i < changed; i++)
+         compressed16[i] = old16[pos + i];
+
+      pos          += changed;
+      skip          = 0;
+      compressed16 += changed;
+   }
+
+   if (fenced)
+      new16[end]    = fence_val;
+
+   compressed16[0]  = 0;
+   compressed16[1]  = 0;
+   compressed16[2]  = 0;
+
+   return (uint8_t*)(compressed16 + 3) - (uint8_t*)patch;
+}
+
+/*
+ * Takes 'patch' from a previous call to 'state_manager_raw_compress'
+ * and applies it to 'data' ('src' from that call),
+ * yielding 'dst' in that call.
+ *
+ * If the given arguments do not match a previous call to
+ * state_manager_raw_compress(), anything at all can happen.
+ */
+static void state_manager_raw_decompress(const void *patch,
+      size_t patchlen, void *data, size_t datalen)
+{
+   uint16_t         *out16 = (uint16_t*)data;
+   const uint16_t *patch16 = (const uint16_t*)patch;
+
+   for (;;)
+   {
+      uint16_t numchanged  = *(patch16++);
+
+      if (numchanged)
+      {
+         out16       += *patch16++;
+
+         /* We could do memcpy, but it seems that memcpy has a
+          * constant-per-call overhead that actually shows up.
+          *
+          * Our average size in here seems to be 8 or something.
+          * Therefore, we do something with lower overhead, and
+          * only go through the vector kernel for longer runs. */
+         if (numchanged < 16)
+         {
+            uint16_t i;
+            for (i = 0; i < numchanged; i++)
+               out16[i] = patch16[i];
+         }
+         else
+            copy16(out16, patch16, numchanged);
+
+         patch16     += numchanged;
+         out16       += numchanged;
+      }
+      else
+      {
+         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
+
+         if (!numunchanged)
+            break;
+         patch16 += 2;
+         out16   += numunchanged;
+      }
+   }
+}
+
+/* The start offsets point to 'nextstart' of any given compressed frame.
+ * Each uint16 is stored native endian; anything that claims any other
+ * endianness refers to the endianness of this specific item.
+ * The uint32 is stored little endian.
+ *
+ * Each size value is stored native endian if alignment is not enforced;
+ * if it is, they're little endian.
+ *
+ * The start of the buffer contains a size pointing to the end of the
+ * buffer; the end points to its start.
+ *
+ * Wrapping is handled by returning to the start of the buffer if the
+ * compressed data could potentially hit the edge;
+ *
+ * if the compressed data could potentially overwrite the tail pointer,
+ * the tail retreats until it can no longer collide.
+ *
+ * This means that on average, ~2 * maxcompsize is
+ * unused at any given moment. */
+
+/* These are called very few constant times per frame,
+ * keep it as simple as possible. */
+static INLINE void write_size_t(void *ptr, size_t val)
+{
+   memcpy(ptr, &val, sizeof(val));
+}
+
+static INLINE size_t read_size_t(const void *ptr)
+{
+   size_t ret;
+
+   memcpy(&ret, ptr, sizeof(ret));
+   return ret;
+}
+
+/* Walks a patch up to its terminator, returning its size in bytes. */
+static size_t state_manager_raw_patch_size(const void *patch)
+{
+   const uint16_t *patch16 = (const uint16_t*)patch;
+
+   for (;;)
+   {
+      uint16_t numchanged  = *(patch16++);
+
+      if (numchanged)
+         patch16 += numchanged + 1;
+      else
+      {
+         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
+
+         patch16 += 2;
+         if (!numunchanged)
+            break;
+      }
+   }
+
+   return (const uint8_t*)patch16 - (const uint8_t*)patch;
+}
+
+#define TIER2_ENTRY(tier2, i) (&(tier2)->entries[((tier2)->first + (i)) % (tier2)->capacity])
+
+static void state_manager_tier2_release(state_manager_tier2_t *tier2,
+      struct state_manager_blob *blob)
+{
+   if (!blob)
+      return;
+
+   tier2->bytes -= blob->size;
+   free(blob->data);
+   free(blob);
+}
+
+static void state_manager_tier2_deflate(struct state_manager_blob *blob)
+{
+#ifdef HAVE_ZLIB
+   uint32_t rd, wn;
+   enum trans_stream_error err                = TRANS_STREAM_ERROR_NONE;
+   const struct trans_stream_backend *backend =
+      trans_stream_get_zlib_deflate_backend();
+   void *stream                               = backend->stream_new();
+   uint8_t *out                               = (uint8_t*)malloc(blob->size);
+
+   if (stream && out)
+   {
+      /* Favour speed, this runs for every entry leaving the ring */
+      backend->define(stream, "level", 1);
+      backend->set_in(stream, blob->data, (uint32_t)blob->size);
+      backend->set_out(stream, out, (uint32_t)blob->size);
+
+      /* Incompressible data fills the buffer and is kept as is */
+      if (     backend->trans(stream, true, &rd, &wn, &err)
+            && err == TRANS_STREAM_ERROR_NONE)
+      {
+         uint8_t *shrunk = (uint8_t*)realloc(out, wn);
+
+         free(blob->data);
+         blob->data      = shrunk ? shrunk : out;
+         blob->size      = wn;
+         blob->deflated  = true;
+         out             = NULL;
+      }
+   }
+
+   if (stream)
+      backend->stream_free(stream);
+   if (out)
+      free(out);
+#endif
+}
+
+/* Returns the uncompressed contents of 'blob', either in place
+ * or inflated into 'out'; NULL if it could not be inflated. */
+static const uint8_t *state_manager_tier2_inflate(
+      const struct state_manager_blob *blob, uint8_t *out, size_t len)
+{
+#ifdef HAVE_ZLIB
+   if (blob->deflated)
+   {
+      uint32_t rd, wn;
+      bool ret                                   = false;
+      enum trans_stream_error err                = TRANS_STREAM_ERROR_NONE;
+      const struct trans_stream_backend *backend =
+         trans_stream_get_zlib_inflate_backend();
+      void *stream                               = backend->stream_new();
+
+      if (!stream)
+         return NULL;
+
+      backend->set_in(stream, blob->data, (uint32_t)blob->size);
+      backend->set_out(stream, out, (uint32_t)len);
+      ret = backend->trans(stream, true, &rd, &wn, &err);
+      backend->stream_free(stream);
+
+      return ret ? out : NULL;
+   }
+#endif
+   return blob->data;
+}
+
+static void state_manager_tier2_drop_front(state_manager_tier2_t *tier2)
+{
+   struct state_manager_tier2_entry *entry = TIER2_ENTRY(tier2, 0);
+
+   state_manager_tier2_release(tier2, entry->patch);
+   state_manager_tier2_release(tier2, entry->keyframe);
+   entry->patch     = NULL;
+   entry->keyframe  = NULL;
+
+   tier2->first     = (tier2->first + 1) % tier2->capacity;
+   tier2->first_seq++;
+   tier2->count--;
+}
+
+static void state_manager_tier2_trim(state_manager_tier2_t *tier2)
+{
+   while (tier2->bytes > tier2->budget && tier2->count)
+   {
+      size_t i;
+      bool thinned                             = false;
+      struct state_manager_tier2_entry *oldest = TIER2_ENTRY(tier2, 0);
+
+      /* Thin out the patches up to the next keyframe first; the
+       * keyframes still let us rewind across the gap. */
+      if (oldest->keyframe)
+      {
+         for (i = 1; i < tier2->count; i++)
+            if (TIER2_ENTRY(tier2, i)->keyframe)
+               break;
+
+         if (i < tier2->count)
+         {
+            size_t j;
+            for (j = 0; j <= i; j++)
+            {
+               struct state_manager_tier2_entry *entry = TIER2_ENTRY(tier2, j);
+               if (entry->patch)
+               {
+                  state_manager_tier2_release(tier2, entry->patch);
+                  entry->patch = NULL;
+                  thinned      = true;
+               }
+            }
+         }
+      }
+
+      if (!thinned)
+         state_manager_tier2_drop_front(tier2);
+   }
+
+   /* Entries that are neither patch nor keyframe are
+    * unreachable without an older keyframe. */
+   while (tier2->count
+         && !TIER2_ENTRY(tier2, 0)->patch
+         && !TIER2_ENTRY(tier2, 0)->keyframe)
+      state_manager_tier2_drop_front(tier2);
+}
+
+/* Files a compressed blob - a keyframe waits for its entry to
+ * leave the ring, a patch becomes the newest second tier entry. */
+static void state_manager_tier2_insert(state_manager_tier2_t *tier2,
+      struct state_manager_blob *blob)
+{
+   struct state_manager_blob **keyframe    = NULL;
+   struct state_manager_tier2_entry *entry = NULL;
+
+   tier2->bytes += blob->size;
+
+   if (blob->keyframe)
+   {
+      /* These can't be trimmed until they leave the ring,
+       * keep them from eating up the whole budget. */
+      if (tier2->keyframe_bytes + blob->size > tier2->budget / 2)
+      {
+         state_manager_tier2_release(tier2, blob);
+         return;
+      }
+
+      tier2->keyframe_bytes += blob->size;
+      blob->next             = tier2->keyframes;
+      tier2->keyframes       = blob;
+      return;
+   }
+
+   if (tier2->count == tier2->capacity)
+   {
+      size_t i;
+      size_t capacity  = tier2->capacity ? tier2->capacity * 2 : 256;
+      struct state_manager_tier2_entry *entries =
+         (struct state_manager_tier2_entry*)
+         calloc(capacity, sizeof(*entries));
+
+      if (!entries)
+      {
+         state_manager_tier2_release(tier2, blob);
+         return;
+      }
+
+      for (i = 0; i < tier2->count; i++)
+         entries[i]    = *TIER2_ENTRY(tier2, i);
+
+      free(tier2->entries);
+      tier2->entries   = entries;
+      tier2->capacity  = capacity;
+      tier2->first     = 0;
+   }
+
+   if (!tier2->count)
+      tier2->first_seq = blob->seq;
+
+   entry               = TIER2_ENTRY(tier2, tier2->count);
+   entry->patch        = blob;
+   entry->keyframe     = NULL;
+   tier2->count++;
+
+   for (keyframe = &tier2->keyframes; *keyframe;
+         keyframe = &(*keyframe)->next)
+   {
+      if ((*keyframe)->seq == blob->seq)
+      {
+         entry->keyframe        = *keyframe;
+         *keyframe              = entry->keyframe->next;
+         entry->keyframe->next  = NULL;
+         tier2->keyframe_bytes -= entry->keyframe->size;
+         break;
+      }
+   }
+
+   state_manager_tier2_trim(tier2);
+}
+
+#ifdef HAVE_THREADS
+static void state_manager_tier2_thread(void *data)
+{
+   state_manager_tier2_t *tier2 = (state_manager_tier2_t*)data;
+
+   slock_lock(tier2->lock);
+
+   for (;;)
+   {
+      struct state_manager_blob *blob = NULL;
+
+      while (tier2->alive && !tier2->jobs)
+         scond_wait(tier2->cond, tier2->lock);
+
+      if (!tier2->jobs)
+         break;
+
+      blob             = tier2->jobs;
+      tier2->jobs      = blob->next;
+      if (!tier2->jobs)
+         tier2->jobs_last = NULL;
+      blob->next       = NULL;
+      tier2->busy      = true;
+      slock_unlock(tier2->lock);
+
+      state_manager_tier2_deflate(blob);
+
+      slock_lock(tier2->lock);
+      state_manager_tier2_insert(tier2, blob);
+      tier2->busy      = false;
+      scond_broadcast(tier2->cond);
+   }
+
+   slock_unlock(tier2->lock);
+}
+#endif
+
+/* Blocks until all queued blobs are compressed and filed;
+ * no other thread touches the second tier afterwards. */
+static void state_manager_tier2_wait_idle(state_manager_tier2_t *tier2)
+{
+#ifdef HAVE_THREADS
+   if (!tier2->thread)
+      return;
+
+   slock_lock(tier2->lock);
+   while (tier2->jobs || tier2->busy)
+      scond_wait(tier2->cond, tier2->lock);
+   slock_unlock(tier2->lock);
+#endif
+}
+
+static void state_manager_tier2_push(state_manager_tier2_t *tier2,
+      const void *data, size_t size, size_t seq, bool keyframe)
+{
+   struct state_manager_blob *blob = (struct state_manager_blob*)
+      calloc(1, sizeof(*blob));
+
+   if (!blob)
+      return;
+
+   if (!(blob->data = (uint8_t*)malloc(size)))
+   {
+      free(blob);
+      return;
+   }
+
+   memcpy(blob->data, data, size);
+   blob->size     = size;
+   blob->seq      = seq;
+   blob->keyframe = keyframe;
+
+#ifdef HAVE_THREADS
+   if (tier2->thread)
+   {
+      slock_lock(tier2->lock);
+      if (tier2->jobs_last)
+         tier2->jobs_last->next = blob;
+      else
+         tier2->jobs            = blob;
+      tier2->jobs_last          = blob;
+      scond_broadcast(tier2->cond);
+      slock_unlock(tier2->lock);
+      return;
+   }
+#endif
+
+   state_manager_tier2_deflate(blob);
+   state_manager_tier2_insert(tier2, blob);
+}
+
+/* The ring entry 'seq' was popped, its keyframe is stale now. */
+static void state_manager_tier2_discard_keyframe(
+      state_manager_tier2_t *tier2, size_t seq)
+{
+   struct state_manager_blob **keyframe = NULL;
 
-   /* Force in a different byte at the end, so we don't need to check
-    * bounds in the innermost loop (it's expensive).
-    *
-    * There is also a large amount of data that's the same, to stop
-    * the other scan.
-    *
-    * There is also some padding at the end. This is so we don't
-    * read outside the buffer end if we're reading in large blocks;
-    *
-    * It doesn't make any difference to us, but sacrificing 16 bytes to get
-    * Valgrind happy is worth it. */
-   ret[len16/sizeof(uint16_t) + 3] = uniq;
+   state_manager_tier2_wait_idle(tier2);
 
-   return ret;
+   for (keyframe = &tier2->keyframes; *keyframe;
+         keyframe = &(*keyframe)->next)
+   {
+      if ((*keyframe)->seq == seq)
+      {
+         struct state_manager_blob *blob = *keyframe;
+         *keyframe                       = blob->next;
+         tier2->keyframe_bytes          -= blob->size;
+         state_manager_tier2_release(tier2, blob);
+         break;
+      }
+   }
 }
 
-/*
- * Takes two savestates and creates a patch that turns 'src' into 'dst'.
- * Both 'src' and 'dst' must be returned from state_manager_raw_alloc(),
- * with the same 'len', and different 'uniq'.
- *
- * 'patch' must be size 'state_manager_raw_maxsize(len)' or more.
- * Returns the number of bytes actually written to 'patch'.
- */
-static size_t state_manager_raw_compress(const void *src,
-      const void *dst, size_t len, void *patch)
+static void state_manager_tier2_free(state_manager_tier2_t *tier2)
 {
-   const uint16_t  *old16 = (const uint16_t*)src;
-   const uint16_t  *new16 = (const uint16_t*)dst;
-   uint16_t *compressed16 = (uint16_t*)patch;
-   size_t          num16s = (len + sizeof(uint16_t) - 1)
-      / sizeof(uint16_t);
+   struct state_manager_blob *blob = NULL;
 
-   while (num16s)
+   if (!tier2)
+      return;
+
+#ifdef HAVE_THREADS
+   if (tier2->thread)
    {
-      size_t i, changed;
-      size_t skip = find_change(old16, new16);
+      slock_lock(tier2->lock);
+      tier2->alive = false;
+      scond_broadcast(tier2->cond);
+      slock_unlock(tier2->lock);
+      sthread_join(tier2->thread);
+   }
+   if (tier2->lock)
+      slock_free(tier2->lock);
+   if (tier2->cond)
+      scond_free(tier2->cond);
+#endif
 
-      if (skip >= num16s)
-         break;
+   while (tier2->count)
+      state_manager_tier2_drop_front(tier2);
 
-      old16  += skip;
-      new16  += skip;
-      num16s -= skip;
+   while ((blob = tier2->jobs))
+   {
+      tier2->jobs = blob->next;
+      free(blob->data);
+      free(blob);
+   }
 
-      if (skip > UINT16_MAX)
-      {
-         /* This will make it scan the entire thing again,
-          * but it only hits on 8GB unchanged data anyways,
-          * and if you're doing that, you've got bigger problems. */
-         if (skip > UINT32_MAX)
-            skip         = UINT32_MAX;
+   while ((blob = tier2->keyframes))
+   {
+      tier2->keyframes = blob->next;
+      free(blob->data);
+      free(blob);
+   }
 
-         *compressed16++ = 0;
-         *compressed16++ = skip;
-         *compressed16++ = skip >> 16;
-         continue;
-      }
+   free(tier2->entries);
+   free(tier2->scratch);
+   free(tier2);
+}
 
-      changed         = find_same(old16, new16);
-      if (changed > UINT16_MAX)
-         changed = UINT16_MAX;
+static state_manager_tier2_t *state_manager_tier2_new(
+      size_t budget, size_t maxcompsize)
+{
+   state_manager_tier2_t *tier2 = (state_manager_tier2_t*)
+      calloc(1, sizeof(*tier2));
 
-      *compressed16++ = changed;
-      *compressed16++ = skip;
+   if (!tier2)
+      return NULL;
 
-      for (i = 0; i < changed; i++)
-         compressed16[i] = old16[i];
+   tier2->budget  = budget;
+   tier2->scratch = (uint8_t*)malloc(maxcompsize);
 
-      old16        += changed;
-      new16        += changed;
-      num16s       -= changed;
-      compressed16 += changed;
-   }
+   if (!tier2->scratch)
+      goto error;
 
-   compressed16[0]  = 0;
-   compressed16[1]  = 0;
-   compressed16[2]  = 0;
+#ifdef HAVE_THREADS
+   tier2->alive   = true;
+   tier2->lock    = slock_new();
+   tier2->cond    = scond_new();
 
-   return (uint8_t*)(compressed16 + 3) - (uint8_t*)patch;
+   if (!tier2->lock || !tier2->cond)
+      goto error;
+
+   if (!(tier2->thread = sthread_create(
+               state_manager_tier2_thread, tier2)))
+      goto error;
+#endif
+
+   return tier2;
+
+error:
+   state_manager_tier2_free(tier2);
+   return NULL;
 }
 
-/*
- * Takes 'patch' from a previous call to 'state_manager_raw_compress'
- * and applies it to 'data' ('src' from that call),
- * yielding 'dst' in that call.
- *
- * If the given arguments do not match a previous call to
- * state_manager_raw_compress(), anything at all can happen.
- */
-static void state_manager_raw_decompress(const void *patch,
-      size_t patchlen, void *data, size_t datalen)
+/* Rewinds across the second tier once the ring is empty.
+ * Keyframes are loaded as is, thinned out entries skipped. */
+static bool state_manager_tier2_pop(state_manager_t *state)
 {
-   uint16_t         *out16 = (uint16_t*)data;
-   const uint16_t *patch16 = (const uint16_t*)patch;
+   state_manager_tier2_t *tier2 = state->tier2;
 
-   for (;;)
-   {
-      uint16_t numchanged  = *(patch16++);
+   state_manager_tier2_wait_idle(tier2);
 
-      if (numchanged)
-      {
-         uint16_t i;
+   while (tier2->count)
+   {
+      bool ret                               = false;
+      struct state_manager_tier2_entry entry =
+         *TIER2_ENTRY(tier2, tier2->count - 1);
 
-         out16       += *patch16++;
+      TIER2_ENTRY(tier2, tier2->count - 1)->patch    = NULL;
+      TIER2_ENTRY(tier2, tier2->count - 1)->keyframe = NULL;
+      tier2->count--;
+      state->tail_seq--;
+      state->seq--;
 
-         /* We could do memcpy, but it seems that memcpy has a
-          * constant-per-call overhead that actually shows up.
-          *
-          * Our average size in here seems to be 8 or something.
-          * Therefore, we do something with lower overhead. */
-         for (i = 0; i < numchanged; i++)
-            out16[i]  = patch16[i];
+      if (entry.keyframe)
+      {
+         const uint8_t *keyframe = state_manager_tier2_inflate(
+               entry.keyframe, state->thisblock, state->blocksize);
 
-         patch16     += numchanged;
-         out16       += numchanged;
+         if (keyframe && keyframe != state->thisblock)
+            memcpy(state->thisblock, keyframe, state->blocksize);
+         ret = keyframe != NULL;
       }
-      else
+      else if (entry.patch)
       {
-         uint32_t numunchanged = patch16[0] | (patch16[1] << 16);
-
-         if (!numunchanged)
-            break;
-         patch16 += 2;
-         out16   += numunchanged;
+         const uint8_t *patch = state_manager_tier2_inflate(
+               entry.patch, tier2->scratch, state->maxcompsize);
+
+         if (patch)
+         {
+            state_manager_raw_decompress(patch,
+                  entry.patch->size, state->thisblock, state->blocksize);
+            ret = true;
+         }
       }
-   }
-}
 
-/* The start offsets point to 'nextstart' of any given compressed frame.
- * Each uint16 is stored native endian; anything that claims any other
- * endianness refers to the endianness of this specific item.
- * The uint32 is stored little endian.
- *
- * Each size value is stored native endian if alignment is not enforced;
- * if it is, they're little endian.
- *
- * The start of the buffer contains a size pointing to the end of the
- * buffer; the end points to its start.
- *
- * Wrapping is handled by returning to the start of the buffer if the
- * compressed data could potentially hit the edge;
- *
- * if the compressed data could potentially overwrite the tail pointer,
- * the tail retreats until it can no longer collide.
- *
- * This means that on average, ~2 * maxcompsize is
- * unused at any given moment. */
+      state_manager_tier2_release(tier2, entry.patch);
+      state_manager_tier2_release(tier2, entry.keyframe);
 
-/* These are called very few constant times per frame,
- * keep it as simple as possible. */
-static INLINE void write_size_t(void *ptr, size_t val)
-{
-   memcpy(ptr, &val, sizeof(val));
+      if (ret)
+         return true;
+   }
+
+   return false;
 }
 
-static INLINE size_t read_size_t(const void *ptr)
+/* Drops the oldest entry of the ring, handing it
+ * over to the second tier if there is one. */
+static void state_manager_evict_tail(state_manager_t *state)
 {
-   size_t ret;
+   if (state->tier2)
+   {
+      const uint8_t *patch = state->tail + sizeof(size_t);
+      state_manager_tier2_push(state->tier2, patch,
+            state_manager_raw_patch_size(patch), state->tail_seq, false);
+   }
 
-   memcpy(&ret, ptr, sizeof(ret));
-   return ret;
+   state->tail = state->data + read_size_t(state->tail);
+   state->tail_seq++;
+   state->entries--;
 }
 
 static void state_manager_free(state_manager_t *state)
@@ -374,24 +1252,106 @@ static void state_manager_free(state_manager_t *state)
    if (!state)
       return;
 
+#ifdef HAVE_THREADS
+   if (state->threaded)
+   {
+      unsigned i;
+
+      if (state->thread)
+      {
+         slock_lock(state->lock);
+         state->alive = false;
+         scond_broadcast(state->cond);
+         slock_unlock(state->lock);
+         sthread_join(state->thread);
+      }
+      if (state->lock)
+         slock_free(state->lock);
+      if (state->cond)
+         scond_free(state->cond);
+
+      /* 'thisblock' and 'nextblock' are part of the pool */
+      for (i = 0; i < STATE_MANAGER_THREADED_BLOCKS; i++)
+      {
+         if (state->blocks[i])
+            free(state->blocks[i]);
+         state->blocks[i] = NULL;
+      }
+
+      state->thread    = NULL;
+      state->lock      = NULL;
+      state->cond      = NULL;
+      state->thisblock = NULL;
+      state->nextblock = NULL;
+      state->threaded  = false;
+   }
+#endif
+
    if (state->data)
       free(state->data);
    if (state->thisblock)
       free(state->thisblock);
    if (state->nextblock)
       free(state->nextblock);
+   state_manager_tier2_free(state->tier2);
+   state->tier2            = NULL;
+
+   if (state->page_hashes)
+      free(state->page_hashes);
+   if (state->page_hashes_next)
+      free(state->page_hashes_next);
+   if (state->page_dirty)
+      free(state->page_dirty);
 #if STRICT_BUF_SIZE
    if (state->debugblock)
       free(state->debugblock);
    state->debugblock = NULL;
 #endif
+   state->page_hashes      = NULL;
+   state->page_hashes_next = NULL;
+   state->page_dirty       = NULL;
    state->data       = NULL;
    state->thisblock  = NULL;
    state->nextblock  = NULL;
 }
 
+#ifdef HAVE_THREADS
+static void state_manager_thread(void *data);
+
+static bool state_manager_init_thread(state_manager_t *state,
+      size_t state_size)
+{
+   unsigned i;
+
+   state->threaded  = true;
+   state->blocks[0] = state->thisblock;
+   state->blocks[1] = state->nextblock;
+
+   for (i = 2; i < STATE_MANAGER_THREADED_BLOCKS; i++)
+      if (!(state->blocks[i] = (uint8_t*)
+               state_manager_raw_alloc(state_size, 0)))
+         return false;
+
+   /* Everything but 'thisblock' is free for capture */
+   for (i = 1; i < STATE_MANAGER_THREADED_BLOCKS; i++)
+      state->free_blocks[state->free_count++] = state->blocks[i];
+
+   state->alive     = true;
+   state->lock      = slock_new();
+   state->cond      = scond_new();
+
+   if (!state->lock || !state->cond)
+      return false;
+
+   state->thread    = sthread_create(state_manager_thread, state);
+
+   return state->thread != NULL;
+}
+#endif
+
 static state_manager_t *state_manager_new(
-      size_t state_size, size_t buffer_size)
+      size_t state_size, size_t buffer_size, bool threaded,
+      bool page_hashes, size_t tier2_size, unsigned keyframe_interval)
 {
    size_t max_comp_size, block_size;
    uint8_t *next_block    = NULL;
@@ -426,9 +1386,47 @@ static state_manager_t *state_manager_new(
    state->head        = state->data + sizeof(size_t);
    state->tail        = state->data + sizeof(size_t);
 
+   state_manager_init_simd(cpu_features_get());
+
+   if (tier2_size)
+   {
+      if (!(state->tier2 = state_manager_tier2_new(
+                  tier2_size, max_comp_size)))
+      {
+         state->data          = NULL;
+         goto error;
+      }
+      state->keyframe_interval = keyframe_interval;
+   }
+
+   if (page_hashes)
+   {
+      state->num_pages        = (block_size + STATE_MANAGER_PAGE_SIZE - 1)
+         / STATE_MANAGER_PAGE_SIZE;
+      state->page_hashes      = (uint64_t*)
+         malloc(state->num_pages * sizeof(uint64_t));
+      state->page_hashes_next = (uint64_t*)
+         malloc(state->num_pages * sizeof(uint64_t));
+      state->page_dirty       = (uint8_t*)malloc(state->num_pages);
+
+      if (  !state->page_hashes
+          || !state->page_hashes_next
+          || !state->page_dirty)
+      {
+         state->data          = NULL;
+         goto error;
+      }
+   }
+
 #if STRICT_BUF_SIZE
    state->debugsize   = state_size;
    state->debugblock  = (uint8_t*)malloc(state_size);
+#elif defined(HAVE_THREADS)
+   if (threaded && !state_manager_init_thread(state, state_size))
+   {
+      state->data     = NULL;
+      goto error;
+   }
 #endif
 
    return state;
@@ -442,6 +1440,22 @@ error:
    return NULL;
 }
 
+#ifdef HAVE_THREADS
+/* Blocks until the worker thread has compressed every
+ * queued snapshot, after which the ring may be touched
+ * from the calling thread. */
+static void state_manager_wait_idle(state_manager_t *state)
+{
+   if (!state->threaded)
+      return;
+
+   slock_lock(state->lock);
+   while (state->pending_count)
+      scond_wait(state->cond, state->lock);
+   slock_unlock(state->lock);
+}
+#endif
+
 static bool state_manager_pop(state_manager_t *state, const void **data)
 {
    size_t start;
@@ -450,6 +1464,10 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
 
    *data                        = NULL;
 
+#ifdef HAVE_THREADS
+   state_manager_wait_idle(state);
+#endif
+
    if (state->thisblock_valid)
    {
       state->thisblock_valid    = false;
@@ -460,7 +1478,14 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
 
    *data                        = state->thisblock;
    if (state->head == state->tail)
-      return false;
+   {
+      if (!state->tier2 || !state_manager_tier2_pop(state))
+         return false;
+
+      /* 'entries' only counts the ring, which is empty */
+      state->page_hashes_valid  = false;
+      return true;
+   }
 
    start                        = read_size_t(state->head - sizeof(size_t));
    state->head                  = state->data + start;
@@ -470,12 +1495,52 @@ static bool state_manager_pop(state_manager_t *state, const void **data)
    state_manager_raw_decompress(compressed,
          state->maxcompsize, out, state->blocksize);
 
+   state->seq--;
+   if (state->tier2)
+      state_manager_tier2_discard_keyframe(state->tier2, state->seq);
+
+   /* The page hashes no longer describe 'thisblock' */
+   state->page_hashes_valid     = false;
+
    state->entries--;
    return true;
 }
 
 static void state_manager_push_where(state_manager_t *state, void **data)
 {
+#ifdef HAVE_THREADS
+   if (state->threaded)
+   {
+      bool queued;
+
+      slock_lock(state->lock);
+      /* Any queued push leaves 'thisblock' valid once compressed. */
+      queued = state->pending_count != 0;
+      slock_unlock(state->lock);
+
+      if (!queued && !state->thisblock_valid)
+      {
+         const void *ignored;
+         if (state_manager_pop(state, &ignored))
+         {
+            state->thisblock_valid = true;
+            state->entries++;
+         }
+      }
+
+      /* Only stall if the worker has fallen behind
+       * and the whole pool is queued up. */
+      slock_lock(state->lock);
+      while (!state->free_count)
+         scond_wait(state->cond, state->lock);
+      state->capture_block = state->free_blocks[--state->free_count];
+      slock_unlock(state->lock);
+
+      *data = state->capture_block;
+      return;
+   }
+#endif
+
    /* We need to ensure we have an uncompressed copy of the last
     * pushed state, or we could end up applying a 'patch' to wrong
     * savestate, and that'd blow up rather quickly. */
@@ -496,7 +1561,39 @@ static void state_manager_push_where(state_manager_t *state, void **data)
 #endif
 }
 
-static void state_manager_push_do(state_manager_t *state)
+/* Hashes every page of 'block', which is about to become
+ * 'thisblock'. Returns the pages which differ from the current
+ * 'thisblock', or NULL if those have to be scanned in full. */
+static const uint8_t *state_manager_update_page_hashes(
+      state_manager_t *state, const uint8_t *block)
+{
+   size_t i;
+   uint64_t *swap      = NULL;
+   bool valid          = state->page_hashes_valid;
+
+   if (!state->page_hashes)
+      return NULL;
+
+   for (i = 0; i < state->num_pages; i++)
+   {
+      size_t offset    = i * STATE_MANAGER_PAGE_SIZE;
+      uint64_t hash    = state_manager_page_hash(block + offset,
+            MIN(STATE_MANAGER_PAGE_SIZE, state->blocksize - offset));
+
+      state->page_hashes_next[i] = hash;
+      if (valid)
+         state->page_dirty[i]    = hash != state->page_hashes[i];
+   }
+
+   swap                     = state->page_hashes;
+   state->page_hashes       = state->page_hashes_next;
+   state->page_hashes_next  = swap;
+   state->page_hashes_valid = true;
+
+   return valid ? state->page_dirty : NULL;
+}
+
+static void state_manager_push_compress(state_manager_t *state)
 {
    uint8_t *swap = NULL;
 
@@ -520,31 +1617,42 @@ recheckcapacity:;
 
       if (remaining <= state->maxcompsize)
       {
-         state->tail = state->data + read_size_t(state->tail);
-         state->entries--;
+         state_manager_evict_tail(state);
          goto recheckcapacity;
       }
 
+      /* The state this entry's patch leads back to */
+      if (     state->tier2
+            && state->keyframe_interval
+            && !(state->seq % state->keyframe_interval))
+         state_manager_tier2_push(state->tier2, state->thisblock,
+               state->blocksize, state->seq, true);
+
       oldb              = state->thisblock;
       newb              = state->nextblock;
       compressed        = state->head + sizeof(size_t);
 
       compressed       += state_manager_raw_compress(oldb, newb,
-            state->blocksize, compressed);
+            state->blocksize, compressed,
+            state_manager_update_page_hashes(state, newb));
 
       if (compressed - state->data + state->maxcompsize > state->capacity)
       {
          compressed     = state->data;
          if (state->tail == state->data + sizeof(size_t))
-            state->tail = state->data + read_size_t(state->tail);
+            state_manager_evict_tail(state);
       }
       write_size_t(compressed, state->head-state->data);
       compressed       += sizeof(size_t);
       write_size_t(state->head, compressed-state->data);
       state->head       = compressed;
+      state->seq++;
    }
    else
-      state->thisblock_valid = true;
+   {
+      state->thisblock_valid   = true;
+      state->page_hashes_valid = false;
+   }
 
    swap                      = state->thisblock;
    state->thisblock          = state->nextblock;
@@ -553,6 +1661,67 @@ recheckcapacity:;
    state->entries++;
 }
 
+#ifdef HAVE_THREADS
+static void state_manager_thread(void *data)
+{
+   state_manager_t *state = (state_manager_t*)data;
+
+   slock_lock(state->lock);
+
+   for (;;)
+   {
+      uint8_t *block = NULL;
+
+      while (state->alive && !state->pending_count)
+         scond_wait(state->cond, state->lock);
+
+      if (!state->pending_count)
+         break;
+
+      block = state->pending[state->pending_head];
+      slock_unlock(state->lock);
+
+      state_manager_raw_set_uniq(block, state->blocksize,
+            !state_manager_raw_get_uniq(state->thisblock, state->blocksize));
+
+      state->nextblock = block;
+      state_manager_push_compress(state);
+
+      slock_lock(state->lock);
+      /* Whatever ended up in 'nextblock' is no longer referenced */
+      state->free_blocks[state->free_count++] = state->nextblock;
+      state->pending_head  = (state->pending_head + 1)
+         % STATE_MANAGER_THREADED_BLOCKS;
+      state->pending_count--;
+      scond_broadcast(state->cond);
+   }
+
+   slock_unlock(state->lock);
+}
+#endif
+
+static void state_manager_push_do(state_manager_t *state)
+{
+#ifdef HAVE_THREADS
+   if (state->threaded)
+   {
+      unsigned tail;
+
+      slock_lock(state->lock);
+      tail = (state->pending_head + state->pending_count)
+         % STATE_MANAGER_THREADED_BLOCKS;
+      state->pending[tail]  = state->capture_block;
+      state->pending_count++;
+      state->capture_block  = NULL;
+      scond_broadcast(state->cond);
+      slock_unlock(state->lock);
+      return;
+   }
+#endif
+
+   state_manager_push_compress(state);
+}
+
 #if 0
 static void state_manager_capacity(state_manager_t *state,
       unsigned *entries, size_t *bytes, bool *full)
@@ -573,7 +1742,8 @@ static void state_manager_capacity(state_manager_t *state,
 
 void state_manager_event_init(
       struct state_manager_rewind_state *rewind_st,
-      unsigned rewind_buffer_size)
+      unsigned rewind_buffer_size, bool threaded, bool page_hashes,
+      size_t tier2_buffer_size, unsigned keyframe_interval)
 {
    retro_ctx_serialize_info_t serial_info;
    retro_ctx_size_info_t info;
@@ -603,11 +1773,19 @@ void state_manager_event_init(
          msg_hash_to_str(MSG_REWIND_INIT),
          (unsigned)(rewind_buffer_size / 1000000));
 
+#ifndef HAVE_THREADS
+   threaded         = false;
+#endif
+
    rewind_st->state = state_manager_new(rewind_st->size,
-         rewind_buffer_size);
+         rewind_buffer_size, threaded, page_hashes,
+         tier2_buffer_size, keyframe_interval);
 
    if (!rewind_st->state)
+   {
       RARCH_WARN("%s.\n", msg_hash_to_str(MSG_REWIND_INIT_FAILED));
+      return;
+   }
 
    state_manager_push_where(rewind_st->state, &state);
 
@@ -634,6 +1812,28 @@ void state_manager_event_deinit(
    rewind_st->size  = 0;
 }
 
+float state_manager_rewind_depth(
+      struct state_manager_rewind_state *rewind_st,
+      unsigned granularity, double fps)
+{
+   size_t entries;
+   state_manager_t *state = rewind_st ? rewind_st->state : NULL;
+
+   if (!state || fps <= 0.0)
+      return 0.0f;
+
+   entries = state->seq - state->tail_seq;
+
+   if (state->tier2)
+   {
+      state_manager_tier2_wait_idle(state->tier2);
+      if (state->tier2->count)
+         entries = state->seq - state->tier2->first_seq;
+   }
+
+   return (float)(entries * (granularity ? granularity : 1) / fps);
+}
+
 /**
  * check_rewind:
  * @pressed              : was rewind key pressed or held?
@@ -24,8 +24,73 @@
 #include <boolean.h>
 #include <retro_common_api.h>
 
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#endif
+
 RETRO_BEGIN_DECLS
 
+/* Number of uncompressed state blocks used when
+ * capture is pipelined through the worker thread.
+ * One of them always holds the last pushed state. */
+#define STATE_MANAGER_THREADED_BLOCKS 4
+
+/* A patch or a keyframe that left the ring buffer,
+ * possibly deflated by the second tier. */
+struct state_manager_blob
+{
+   struct state_manager_blob *next;
+   uint8_t *data;
+   size_t size;
+   /* Number of the ring entry this belongs to */
+   size_t seq;
+   bool keyframe;
+   bool deflated;
+};
+
+struct state_manager_tier2_entry
+{
+   /* Turns the next newer state into this one.
+    * NULL once thinned out to save space. */
+   struct state_manager_blob *patch;
+   /* Full copy of the state, on every
+    * 'keyframe_interval'th entry only. */
+   struct state_manager_blob *keyframe;
+};
+
+/* Second tier - entries that aged out of the ring are recompressed
+ * in the background and kept here, oldest first. Under pressure,
+ * patches between keyframes are dropped first, so rewinding far
+ * back gets coarser instead of shorter. */
+struct state_manager_tier2
+{
+   struct state_manager_tier2_entry *entries;
+   /* Blobs waiting to be compressed, in push order */
+   struct state_manager_blob *jobs;
+   struct state_manager_blob *jobs_last;
+   /* Compressed keyframes of entries still in the ring */
+   struct state_manager_blob *keyframes;
+   uint8_t *scratch;
+#ifdef HAVE_THREADS
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   bool alive;
+   bool busy;
+#endif
+   size_t first;
+   size_t count;
+   size_t capacity;
+   /* 'seq' of entries[first] */
+   size_t first_seq;
+   size_t bytes;
+   /* Part of 'bytes' taken by 'keyframes' */
+   size_t keyframe_bytes;
+   size_t budget;
+};
+
+typedef struct state_manager_tier2 state_manager_tier2_t;
+
 struct state_manager
 {
    uint8_t *data;
@@ -49,6 +114,40 @@ struct state_manager
     * (yes, the math is a bit ugly). */
    size_t maxcompsize;
 
+   /* Optional coarse pass - one hash per page of 'thisblock',
+    * so unchanged pages can be skipped without scanning them. */
+   uint64_t *page_hashes;
+   uint64_t *page_hashes_next;
+   uint8_t *page_dirty;
+   size_t num_pages;
+   bool page_hashes_valid;
+
+#ifdef HAVE_THREADS
+   /* Threaded capture - the main thread only serializes
+    * into a free block and queues it, the worker thread
+    * compresses it against 'thisblock' into the ring. */
+   sthread_t *thread;
+   slock_t *lock;
+   scond_t *cond;
+   uint8_t *blocks[STATE_MANAGER_THREADED_BLOCKS];
+   uint8_t *free_blocks[STATE_MANAGER_THREADED_BLOCKS];
+   uint8_t *pending[STATE_MANAGER_THREADED_BLOCKS];
+   uint8_t *capture_block;
+   unsigned free_count;
+   unsigned pending_head;
+   unsigned pending_count;
+   bool threaded;
+   bool alive;
+#endif
+
+   /* Optional second tier and keyframe spacing, in entries */
+   state_manager_tier2_t *tier2;
+   unsigned keyframe_interval;
+   /* Number of the next entry pushed to the ring,
+    * and of the oldest entry still in it. */
+   size_t seq;
+   size_t tail_seq;
+
    unsigned entries;
    bool thisblock_valid;
 };
@@ -69,7 +168,19 @@ void state_manager_event_deinit(
       struct state_manager_rewind_state *rewind_st);
 
 void state_manager_event_init(struct state_manager_rewind_state *rewind_st,
-      unsigned rewind_buffer_size);
+      unsigned rewind_buffer_size, bool threaded, bool page_hashes,
+      size_t tier2_buffer_size, unsigned keyframe_interval);
+
+/**
+ * state_manager_rewind_depth:
+ * @granularity          : frames per rewind entry
+ * @fps                  : frame rate of the running core
+ *
+ * Returns: how far back in seconds the rewind buffer currently reaches.
+ **/
+float state_manager_rewind_depth(
+      struct state_manager_rewind_state *rewind_st,
+      unsigned granularity, double fps);
 
 /**
  * check_rewind:
@@ -469,8 +469,45 @@ void task_push_cdrom_dump(const char *drive)
 }
 #endif
 
+static void content_prefetch_discard(content_state_t *p_content)
+{
+   if (p_content->prefetch)
+      filestream_read_file_async_end(p_content->prefetch, NULL, NULL);
+   p_content->prefetch = NULL;
+}
+
+void content_prefetch(const char *path, bool need_fullpath)
+{
+   content_state_t *p_content = content_state_get_ptr();
+
+   content_prefetch_discard(p_content);
+
+   /* Only plain files the core wants in memory, archives and
+    * subsystems go through their own loaders */
+   if (     need_fullpath
+         || string_is_empty(path)
+         || p_content->pending_subsystem_init
+         || path_contains_compressed_file(path)
+         || !path_is_valid(path))
+      return;
+
+   strlcpy(p_content->prefetch_path, path,
+         sizeof(p_content->prefetch_path));
+   p_content->prefetch = filestream_read_file_async_begin(path);
+}
+
 static int64_t content_file_read(const char *path, void **buf, int64_t *length)
 {
+   content_state_t *p_content = content_state_get_ptr();
+
+   if (     p_content->prefetch
+         && string_is_equal(path, p_content->prefetch_path))
+   {
+      void *prefetch      = p_content->prefetch;
+      p_content->prefetch = NULL;
+      return filestream_read_file_async_end(prefetch, buf, length);
+   }
+
 #ifdef HAVE_COMPRESSION
    if (     path_contains_compressed_file(path)
          && file_archive_compressed_read(path, buf, NULL, length))
@@ -2451,6 +2488,8 @@ void content_deinit(void)
       string_list_free(p_content->temporary_content);
    }
 
+   content_prefetch_discard(p_content);
+
    p_content->temporary_content            = NULL;
    p_content->rom_crc                      = 0;
    p_content->is_inited                    = false;
@@ -2557,6 +2596,9 @@ bool content_init(void)
       string_list_deinitialize(&content);
    }
 
+   /* Nothing loaded the prefetched file */
+   content_prefetch_discard(p_content);
+
    if (content_ctx.name_ips)
       free(content_ctx.name_ips);
    if (content_ctx.name_bps)
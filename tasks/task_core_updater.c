@@ -1523,6 +1523,7 @@ void task_push_update_installed_cores(
    task->title            = strdup(msg_hash_to_str(MSG_FETCHING_CORE_LIST));
    task->alternative_look = true;
    task->progress         = 0;
+   task->priority         = TASK_PRIORITY_BACKGROUND;
 
    /* Push task */
    task_queue_push(task);
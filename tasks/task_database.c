@@ -20,6 +20,8 @@
 #include <compat/strl.h>
 #include <retro_miscellaneous.h>
 #include <retro_endianness.h>
+#include <array/rbuf.h>
+#include <array/rhmap.h>
 #include <string/stdstring.h>
 #include <lists/dir_list.h>
 #include <file/file_path.h>
@@ -27,6 +29,10 @@
 #include <streams/file_stream.h>
 #include <streams/chd_stream.h>
 #include <streams/interface_stream.h>
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
 #include "tasks_internal.h"
 
 #include "../core_info.h"
@@ -56,6 +62,84 @@ typedef struct database_state_handle
    char serial[4096];
 } database_state_handle_t;
 
+/* How many files the thread pool may read and hash
+ * ahead of the database lookups */
+#define DATABASE_SCAN_WINDOW        64
+
+/* New scan cache entries are flushed to disk every so
+ * often, so an interrupted scan can pick up from there */
+#define DATABASE_SCAN_CACHE_FLUSH   32
+#define DATABASE_SCAN_CACHE_HEADER  "# KingStation content scan cache 1\n"
+
+/* What needs to be looked up in the databases
+ * for a file, see task_database_probe_file() */
+typedef struct database_scan_probe
+{
+   enum database_type type;
+   int ret;
+   uint32_t crc;
+   uint32_t archive_crc;
+   char serial[4096];
+} database_scan_probe_t;
+
+typedef struct database_scan_cache_entry
+{
+   char *path;
+   char *serial;
+   int64_t size;
+   int64_t mtime;
+   enum database_type type;
+   uint32_t crc;
+   uint32_t archive_crc;
+} database_scan_cache_entry_t;
+
+/* Probe results of earlier scans, keyed by path and
+ * only valid while the size and mtime still match */
+typedef struct database_scan_cache
+{
+   char *path;
+   RFILE *file;
+   database_scan_cache_entry_t *entries; /* RBUF */
+   size_t *map;                          /* RHMAP, path hash -> entries */
+   unsigned pending;
+   bool rewrite;
+} database_scan_cache_t;
+
+#ifdef HAVE_THREADS
+typedef struct database_scan_slot
+{
+   database_scan_probe_t probe;
+   struct db_handle *db;
+   char *name;
+   size_t index;
+   bool busy;
+   bool done;
+} database_scan_slot_t;
+
+/* Jobs in the frontend thread pool probing the files of the
+ * scan list in order, at most DATABASE_SCAN_WINDOW ahead of
+ * 'consumed' and at most 'max_jobs' at a time. Results land
+ * in slots[index % DATABASE_SCAN_WINDOW]. */
+typedef struct database_scan_pool
+{
+   database_scan_slot_t slots[DATABASE_SCAN_WINDOW];
+   tpool_t *tp;
+   tpool_group_t *group;
+   scond_t *cond;
+   size_t next;
+   size_t consumed;
+   unsigned jobs;
+   unsigned max_jobs;
+   bool quit;
+} database_scan_pool_t;
+
+#define DATABASE_SCAN_LOCK(db)   slock_lock((db)->scan_lock)
+#define DATABASE_SCAN_UNLOCK(db) slock_unlock((db)->scan_lock)
+#else
+#define DATABASE_SCAN_LOCK(db)   ((void)0)
+#define DATABASE_SCAN_UNLOCK(db) ((void)0)
+#endif
+
 typedef struct db_handle
 {
    char *playlist_directory;
@@ -63,7 +147,16 @@ typedef struct db_handle
    char *fullpath;
    database_info_handle_t *handle;
    database_state_handle_t state;
+   database_scan_probe_t probe;
+   database_scan_cache_t scan_cache;
+#ifdef HAVE_THREADS
+   database_scan_pool_t *scan_pool;
+   /* Guards scan_pool, scan_cache and handle->list
+    * against the scan jobs, NULL without them */
+   slock_t *scan_lock;
+#endif
    playlist_config_t playlist_config; /* size_t alignment */
+   unsigned scan_threads;
    unsigned status;
    bool is_directory;
    bool scan_started;
@@ -454,8 +547,8 @@ static bool task_database_chd_get_crc(const char *name, uint32_t *crc)
    return rv;
 }
 
-static void task_database_cue_prune(database_info_handle_t *db,
-      const char *name)
+static void task_database_cue_prune(db_handle_t *_db,
+      database_info_handle_t *db, const char *name)
 {
    size_t i;
    char path[PATH_MAX_LENGTH];
@@ -469,6 +562,7 @@ static void task_database_cue_prune(database_info_handle_t *db,
 
    while (cue_next_file(fd, name, path, sizeof(path)))
    {
+      DATABASE_SCAN_LOCK(_db);
       for (i = db->list_ptr; i < db->list->size; ++i)
       {
          if (db->list->elems[i].data
@@ -479,13 +573,15 @@ static void task_database_cue_prune(database_info_handle_t *db,
             db->list->elems[i].data = NULL;
          }
       }
+      DATABASE_SCAN_UNLOCK(_db);
    }
 
    intfstream_close(fd);
    free(fd);
 }
 
-static void gdi_prune(database_info_handle_t *db, const char *name)
+static void gdi_prune(db_handle_t *_db,
+      database_info_handle_t *db, const char *name)
 {
    size_t i;
    char path[PATH_MAX_LENGTH];
@@ -499,6 +595,7 @@ static void gdi_prune(database_info_handle_t *db, const char *name)
 
    while (gdi_next_file(fd, name, path, sizeof(path)))
    {
+      DATABASE_SCAN_LOCK(_db);
       for (i = db->list_ptr; i < db->list->size; ++i)
       {
          if (db->list->elems[i].data
@@ -509,6 +606,7 @@ static void gdi_prune(database_info_handle_t *db, const char *name)
             db->list->elems[i].data = NULL;
          }
       }
+      DATABASE_SCAN_UNLOCK(_db);
    }
 
    free(fd);
@@ -557,74 +655,594 @@ static enum msg_file_type extension_to_file_type(const char *ext)
    return FILE_TYPE_NONE;
 }
 
-static int task_database_iterate_playlist(
-      database_state_handle_t *db_state,
-      database_info_handle_t *db, const char *name)
+/* Works out how 'name' is looked up in the databases and
+ * reads its CRC or serial. Only reads 'name' and the tracks
+ * it refers to, so this can run in the scan jobs. */
+static int task_database_probe_file(const char *name,
+      database_scan_probe_t *probe)
 {
+   probe->type        = DATABASE_TYPE_CRC_LOOKUP;
+   probe->crc         = 0;
+   probe->archive_crc = 0;
+   probe->serial[0]   = '\0';
+
    switch (extension_to_file_type(path_get_extension(name)))
    {
       case FILE_TYPE_COMPRESSED:
 #ifdef HAVE_COMPRESSION
-         db->type = DATABASE_TYPE_CRC_LOOKUP;
          /* first check crc of archive itself */
          return intfstream_file_get_crc(name,
-               0, SIZE_MAX, &db_state->archive_crc);
+               0, SIZE_MAX, &probe->archive_crc);
 #else
          break;
 #endif
       case FILE_TYPE_CUE:
-         task_database_cue_prune(db, name);
-         db_state->serial[0] = '\0';
-         if (task_database_cue_get_serial(name, db_state->serial))
-            db->type = DATABASE_TYPE_SERIAL_LOOKUP;
+         if (task_database_cue_get_serial(name, probe->serial))
+            probe->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
-         {
-            db->type = DATABASE_TYPE_CRC_LOOKUP;
-            return task_database_cue_get_crc(name, &db_state->crc);
-         }
+            return task_database_cue_get_crc(name, &probe->crc);
          break;
       case FILE_TYPE_GDI:
-         gdi_prune(db, name);
-         db_state->serial[0] = '\0';
          /* There are no serial databases, so don't bother with
             serials at the moment */
-         if (0 && task_database_gdi_get_serial(name, db_state->serial))
-            db->type = DATABASE_TYPE_SERIAL_LOOKUP;
+         if (0 && task_database_gdi_get_serial(name, probe->serial))
+            probe->type = DATABASE_TYPE_SERIAL_LOOKUP;
          else
-         {
-            db->type = DATABASE_TYPE_CRC_LOOKUP;
-            return task_database_gdi_get_crc(name, &db_state->crc);
-         }
+            return task_database_gdi_get_crc(name, &probe->crc);
          break;
       /* Consider Wii WBFS files similar to ISO files. */
       case FILE_TYPE_WBFS:
       case FILE_TYPE_ISO:
-         db_state->serial[0] = '\0';
-         intfstream_file_get_serial(name, 0, SIZE_MAX, db_state->serial);
-         db->type            =  DATABASE_TYPE_SERIAL_LOOKUP;
+         intfstream_file_get_serial(name, 0, SIZE_MAX, probe->serial);
+         probe->type        = DATABASE_TYPE_SERIAL_LOOKUP;
          break;
       case FILE_TYPE_CHD:
-         db_state->serial[0] = '\0';
-         if (task_database_chd_get_serial(name, db_state->serial))
-            db->type         = DATABASE_TYPE_SERIAL_LOOKUP;
+         if (task_database_chd_get_serial(name, probe->serial))
+            probe->type     = DATABASE_TYPE_SERIAL_LOOKUP;
          else
-         {
-            db->type         = DATABASE_TYPE_CRC_LOOKUP;
-            return task_database_chd_get_crc(name, &db_state->crc);
-         }
+            return task_database_chd_get_crc(name, &probe->crc);
          break;
       case FILE_TYPE_LUTRO:
-         db->type            = DATABASE_TYPE_ITERATE_LUTRO;
+         probe->type        = DATABASE_TYPE_ITERATE_LUTRO;
          break;
       default:
-         db->type            = DATABASE_TYPE_CRC_LOOKUP;
-         return intfstream_file_get_crc(name, 0, SIZE_MAX, &db_state->crc);
+         return intfstream_file_get_crc(name, 0, SIZE_MAX, &probe->crc);
    }
 
    return 1;
 }
 
+static void task_database_cache_write_entry(RFILE *file,
+      const database_scan_cache_entry_t *entry)
+{
+   filestream_printf(file,
+         STRING_REP_INT64 "\t" STRING_REP_INT64 "\t%u\t%08X\t%08X\t%s\t%s\n",
+         entry->size, entry->mtime, (unsigned)entry->type,
+         (unsigned)entry->crc, (unsigned)entry->archive_crc,
+         entry->serial ? entry->serial : "", entry->path);
+}
+
+/* Starts the cache file over with the header and the
+ * newest entry of every path */
+static void task_database_cache_write_all(RFILE *file,
+      database_scan_cache_t *cache)
+{
+   size_t i;
+
+   filestream_write(file, DATABASE_SCAN_CACHE_HEADER,
+         STRLEN_CONST(DATABASE_SCAN_CACHE_HEADER));
+
+   for (i = 0; i < RBUF_LEN(cache->entries); i++)
+   {
+      if (RHMAP_GET_STR(cache->map, cache->entries[i].path) == i)
+         task_database_cache_write_entry(file, &cache->entries[i]);
+   }
+}
+
+static void task_database_cache_insert(database_scan_cache_t *cache,
+      const database_scan_cache_entry_t *entry)
+{
+   uint32_t hash = hash_string(entry->path);
+
+   /* A newer entry for the same path replaces the older
+    * one, which is dropped when the file is rewritten */
+   if (RHMAP_HAS(cache->map, hash))
+      cache->rewrite = true;
+
+   RBUF_PUSH(cache->entries, *entry);
+   RHMAP_SET(cache->map, hash, RBUF_LEN(cache->entries) - 1);
+}
+
+/* Parses 'size mtime type crc archive_crc serial path',
+ * separated by tabs. The path goes last as it may
+ * contain anything but a line break. */
+static bool task_database_cache_parse_line(char *line,
+      database_scan_cache_entry_t *entry)
+{
+   char *end    = NULL;
+   char *serial = NULL;
+
+   entry->size        = (int64_t)strtoll(line, &end, 10);
+   if (end == line || *end != '\t')
+      return false;
+   line               = end + 1;
+   entry->mtime       = (int64_t)strtoll(line, &end, 10);
+   if (end == line || *end != '\t')
+      return false;
+   line               = end + 1;
+   entry->type        = (enum database_type)strtoul(line, &end, 10);
+   if (end == line || *end != '\t')
+      return false;
+   line               = end + 1;
+   entry->crc         = (uint32_t)strtoul(line, &end, 16);
+   if (end == line || *end != '\t')
+      return false;
+   line               = end + 1;
+   entry->archive_crc = (uint32_t)strtoul(line, &end, 16);
+   if (end == line || *end != '\t')
+      return false;
+   serial             = end + 1;
+
+   if (!(line = strchr(serial, '\t')) || !line[1])
+      return false;
+   *line++            = '\0';
+
+   switch (entry->type)
+   {
+      case DATABASE_TYPE_ITERATE_LUTRO:
+      case DATABASE_TYPE_SERIAL_LOOKUP:
+      case DATABASE_TYPE_CRC_LOOKUP:
+         break;
+      default:
+         return false;
+   }
+
+   entry->path        = strdup(line);
+   entry->serial      = *serial ? strdup(serial) : NULL;
+   return true;
+}
+
+static void task_database_cache_init(database_scan_cache_t *cache,
+      const char *playlist_directory)
+{
+   char path[PATH_MAX_LENGTH];
+   void *buf      = NULL;
+   int64_t length = 0;
+   char *line     = NULL;
+
+   path[0]        = '\0';
+
+   if (string_is_empty(playlist_directory))
+      return;
+
+   fill_pathname_join(path, playlist_directory,
+         FILE_PATH_SCAN_CACHE, sizeof(path));
+   cache->path    = strdup(path);
+
+   if (!path_is_valid(path))
+      return;
+
+   if (!filestream_read_file(path, &buf, &length) || !buf)
+   {
+      cache->rewrite = true;
+      return;
+   }
+
+   /* Start over on anything written by another version */
+   if (!string_starts_with((const char*)buf, DATABASE_SCAN_CACHE_HEADER))
+   {
+      RARCH_WARN("[Scanner] Ignoring scan cache \"%s\".\n", path);
+      cache->rewrite = true;
+      free(buf);
+      return;
+   }
+
+   line = (char*)buf + STRLEN_CONST(DATABASE_SCAN_CACHE_HEADER);
+
+   while (*line)
+   {
+      database_scan_cache_entry_t entry;
+      char *next = strchr(line, '\n');
+      size_t len = 0;
+
+      if (next)
+         *next++ = '\0';
+      else
+         next    = line + strlen(line);
+
+      len        = strlen(line);
+      if (len && line[len - 1] == '\r')
+         line[len - 1] = '\0';
+
+      if (*line != '#' && task_database_cache_parse_line(line, &entry))
+      {
+         if (entry.path)
+            task_database_cache_insert(cache, &entry);
+         else
+            free(entry.serial);
+      }
+
+      line = next;
+   }
+
+   free(buf);
+
+   RARCH_LOG("[Scanner] Loaded %u entries from scan cache \"%s\".\n",
+         (unsigned)RHMAP_LEN(cache->map), path);
+}
+
+static const database_scan_cache_entry_t *task_database_cache_find(
+      const database_scan_cache_t *cache, const char *path,
+      int64_t size, int64_t mtime)
+{
+   const database_scan_cache_entry_t *entry = NULL;
+   ptrdiff_t idx = RHMAP_IDX_STR(cache->map, path);
+
+   if (idx < 0)
+      return NULL;
+
+   entry = &cache->entries[cache->map[idx]];
+
+   if (     entry->size  != size
+         || entry->mtime != mtime
+         || !string_is_equal(entry->path, path))
+      return NULL;
+
+   return entry;
+}
+
+static void task_database_cache_add(database_scan_cache_t *cache,
+      const char *path, int64_t size, int64_t mtime,
+      const database_scan_probe_t *probe)
+{
+   database_scan_cache_entry_t entry;
+
+   if (     !cache->path
+         || strpbrk(path, "\r\n")
+         || strpbrk(probe->serial, "\t\r\n"))
+      return;
+
+   entry.path        = strdup(path);
+   entry.serial      = probe->serial[0] ? strdup(probe->serial) : NULL;
+   entry.size        = size;
+   entry.mtime       = mtime;
+   entry.type        = probe->type;
+   entry.crc         = probe->crc;
+   entry.archive_crc = probe->archive_crc;
+
+   if (!cache->file)
+   {
+      if (cache->rewrite || !path_is_valid(cache->path))
+      {
+         cache->file = filestream_open(cache->path,
+               RETRO_VFS_FILE_ACCESS_WRITE,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE);
+         if (cache->file)
+            task_database_cache_write_all(cache->file, cache);
+      }
+      else
+      {
+         cache->file = filestream_open(cache->path,
+               RETRO_VFS_FILE_ACCESS_WRITE
+               | RETRO_VFS_FILE_ACCESS_UPDATE_EXISTING,
+               RETRO_VFS_FILE_ACCESS_HINT_NONE);
+         if (cache->file)
+            filestream_seek(cache->file, 0, RETRO_VFS_SEEK_POSITION_END);
+      }
+
+      /* The loaded entries are in the file now, minus
+       * the replaced ones, so deinit need not rewrite it */
+      if (cache->file)
+         cache->rewrite = false;
+   }
+
+   task_database_cache_insert(cache, &entry);
+
+   if (!cache->file)
+      return;
+
+   task_database_cache_write_entry(cache->file, &entry);
+
+   if (++cache->pending >= DATABASE_SCAN_CACHE_FLUSH)
+   {
+      filestream_flush(cache->file);
+      cache->pending = 0;
+   }
+}
+
+static void task_database_cache_deinit(database_scan_cache_t *cache)
+{
+   size_t i;
+
+   if (cache->file)
+      filestream_close(cache->file);
+   cache->file = NULL;
+
+   /* Drop entries that were replaced by newer ones */
+   if (cache->rewrite && cache->path)
+   {
+      RFILE *file = filestream_open(cache->path,
+            RETRO_VFS_FILE_ACCESS_WRITE,
+            RETRO_VFS_FILE_ACCESS_HINT_NONE);
+
+      if (file)
+      {
+         task_database_cache_write_all(file, cache);
+         filestream_close(file);
+      }
+   }
+
+   for (i = 0; i < RBUF_LEN(cache->entries); i++)
+   {
+      free(cache->entries[i].path);
+      free(cache->entries[i].serial);
+   }
+
+   RBUF_FREE(cache->entries);
+   RHMAP_FREE(cache->map);
+   free(cache->path);
+   cache->path = NULL;
+}
+
+/* task_database_probe_file(), unless the scan cache
+ * has the result for this file and it is unchanged */
+static void task_database_probe_file_cached(db_handle_t *_db,
+      const char *name, database_scan_probe_t *probe)
+{
+   int64_t size   = 0;
+   int64_t mtime  = 0;
+   bool cacheable = path_get_size_mtime(name, &size, &mtime);
+
+   if (cacheable)
+   {
+      const database_scan_cache_entry_t *entry = NULL;
+
+      DATABASE_SCAN_LOCK(_db);
+      entry = task_database_cache_find(&_db->scan_cache,
+            name, size, mtime);
+      if (entry)
+      {
+         probe->type        = entry->type;
+         probe->ret         = 1;
+         probe->crc         = entry->crc;
+         probe->archive_crc = entry->archive_crc;
+         strlcpy(probe->serial, entry->serial ? entry->serial : "",
+               sizeof(probe->serial));
+      }
+      DATABASE_SCAN_UNLOCK(_db);
+
+      if (entry)
+         return;
+   }
+
+   probe->ret = task_database_probe_file(name, probe);
+
+   /* Failures may be temporary, try again next time */
+   if (cacheable && probe->ret)
+   {
+      DATABASE_SCAN_LOCK(_db);
+      task_database_cache_add(&_db->scan_cache, name, size, mtime, probe);
+      DATABASE_SCAN_UNLOCK(_db);
+   }
+}
+
+#ifdef HAVE_THREADS
+static void task_database_scan_job(void *data);
+
+/* Starts jobs for the next files of the list, as far as the
+ * window and the job limit allow. Called with the scan lock */
+static void task_database_scan_pool_fill(db_handle_t *_db)
+{
+   database_scan_pool_t *pool   = _db->scan_pool;
+   database_info_handle_t *list = _db->handle;
+
+   while (   !pool->quit
+         && pool->jobs < pool->max_jobs
+         && pool->next < list->list->size
+         && pool->next < pool->consumed + DATABASE_SCAN_WINDOW
+         && !pool->slots[pool->next % DATABASE_SCAN_WINDOW].busy)
+   {
+      database_scan_slot_t *slot =
+         &pool->slots[pool->next % DATABASE_SCAN_WINDOW];
+      const char *path           = list->list->elems[pool->next].data;
+
+      slot->index = pool->next++;
+      slot->done  = false;
+
+      /* Pruned, or inside an archive, which
+       * task_database_iterate_playlist() probes itself */
+      if (!path || path_contains_compressed_file(path))
+         continue;
+
+      slot->db    = _db;
+      slot->name  = strdup(path);
+      slot->busy  = true;
+      pool->jobs++;
+
+      if (!tpool_group_add_work(pool->tp, pool->group,
+               task_database_scan_job, slot))
+      {
+         /* Probed on the task thread instead */
+         free(slot->name);
+         slot->name = NULL;
+         slot->busy = false;
+         pool->jobs--;
+         pool->next--;
+         break;
+      }
+   }
+}
+
+static void task_database_scan_job(void *data)
+{
+   database_scan_slot_t *slot = (database_scan_slot_t*)data;
+   db_handle_t *_db           = slot->db;
+
+   if (slot->name)
+      task_database_probe_file_cached(_db, slot->name, &slot->probe);
+   else
+      slot->probe.ret = 0;
+
+   DATABASE_SCAN_LOCK(_db);
+   free(slot->name);
+   slot->name  = NULL;
+   slot->busy  = false;
+   slot->done  = true;
+   _db->scan_pool->jobs--;
+   task_database_scan_pool_fill(_db);
+   scond_broadcast(_db->scan_pool->cond);
+   DATABASE_SCAN_UNLOCK(_db);
+}
+
+static void task_database_scan_pool_deinit(db_handle_t *_db)
+{
+   database_scan_pool_t *pool = _db->scan_pool;
+
+   if (!pool)
+      return;
+
+   if (pool->group)
+   {
+      DATABASE_SCAN_LOCK(_db);
+      pool->quit = true;
+      DATABASE_SCAN_UNLOCK(_db);
+
+      tpool_group_wait(pool->tp, pool->group);
+      tpool_group_free(pool->group);
+   }
+
+   if (pool->cond)
+      scond_free(pool->cond);
+   if (_db->scan_lock)
+      slock_free(_db->scan_lock);
+   free(pool);
+
+   _db->scan_pool = NULL;
+   _db->scan_lock = NULL;
+}
+
+static void task_database_scan_pool_init(db_handle_t *_db)
+{
+   database_scan_pool_t *pool = NULL;
+   tpool_t *tp                = NULL;
+
+#ifdef RARCH_INTERNAL
+   tp = KingStation_get_thread_pool();
+#endif
+
+   /* Without it files are probed on the task thread */
+   if (!tp)
+      return;
+
+   if (!(pool = (database_scan_pool_t*)calloc(1, sizeof(*pool))))
+      return;
+
+   pool->tp       = tp;
+   pool->max_jobs = _db->scan_threads;
+   if (!pool->max_jobs)
+      pool->max_jobs = (unsigned)tpool_get_num_threads(tp);
+   pool->cond     = scond_new();
+   pool->group    = tpool_group_new();
+   _db->scan_lock = slock_new();
+   _db->scan_pool = pool;
+
+   if (!pool->cond || !pool->group || !_db->scan_lock)
+   {
+      task_database_scan_pool_deinit(_db);
+      return;
+   }
+
+   RARCH_LOG("[Scanner] Reading up to %u files at once.\n",
+         pool->max_jobs);
+}
+
+/* Lets the pool read up to DATABASE_SCAN_WINDOW files
+ * past the one the lookups are at */
+static void task_database_scan_pool_advance(db_handle_t *_db,
+      size_t index)
+{
+   DATABASE_SCAN_LOCK(_db);
+   _db->scan_pool->consumed = index;
+   task_database_scan_pool_fill(_db);
+   DATABASE_SCAN_UNLOCK(_db);
+}
+
+/* Takes the result for list entry 'index' if a scan job
+ * has finished it, waiting a little if not */
+static bool task_database_scan_pool_take(db_handle_t *_db,
+      size_t index, const char *name, database_scan_probe_t *probe)
+{
+   database_scan_pool_t *pool = _db->scan_pool;
+   database_scan_slot_t *slot =
+      &pool->slots[index % DATABASE_SCAN_WINDOW];
+   bool ready                 = false;
+
+   DATABASE_SCAN_LOCK(_db);
+
+   /* Nothing in flight, the pool did not take the job */
+   if (!pool->jobs && !(slot->done && slot->index == index))
+   {
+      DATABASE_SCAN_UNLOCK(_db);
+      task_database_probe_file_cached(_db, name, probe);
+      return true;
+   }
+
+   if (!(slot->done && slot->index == index))
+      scond_wait_timeout(pool->cond, _db->scan_lock, 20000);
+
+   if ((ready = slot->done && slot->index == index))
+   {
+      memcpy(probe, &slot->probe, sizeof(*probe));
+      slot->done = false;
+   }
+
+   DATABASE_SCAN_UNLOCK(_db);
+
+   return ready;
+}
+#endif
+
+static int task_database_iterate_playlist(
+      db_handle_t *_db,
+      database_state_handle_t *db_state,
+      database_info_handle_t *db, const char *name)
+{
+   database_scan_probe_t *probe = &_db->probe;
+
+#ifdef HAVE_THREADS
+   /* The pool leaves archive members to this thread */
+   if (_db->scan_pool && !path_contains_compressed_file(name))
+   {
+      /* Not read yet, check back on the next iteration */
+      if (!task_database_scan_pool_take(_db, db->list_ptr, name, probe))
+         return 1;
+   }
+   else
+#endif
+      task_database_probe_file_cached(_db, name, probe);
+
+   switch (extension_to_file_type(path_get_extension(name)))
+   {
+      case FILE_TYPE_CUE:
+         task_database_cue_prune(_db, db, name);
+         break;
+      case FILE_TYPE_GDI:
+         gdi_prune(_db, db, name);
+         break;
+      default:
+         break;
+   }
+
+   db->type              = probe->type;
+   db_state->crc         = probe->crc;
+   db_state->archive_crc = probe->archive_crc;
+   strlcpy(db_state->serial, probe->serial, sizeof(db_state->serial));
+
+   return probe->ret;
+}
+
 static int database_info_list_iterate_end_no_match(
+      db_handle_t *_db,
       database_info_handle_t *db,
       database_state_handle_t *db_state,
       const char *path)
@@ -644,6 +1262,8 @@ static int database_info_list_iterate_end_no_match(
       {
          unsigned i;
 
+         DATABASE_SCAN_LOCK(_db);
+
          for (i = 0; i < archive_list->size; i++)
          {
             char new_path[PATH_MAX_LENGTH];
@@ -666,6 +1286,12 @@ static int database_info_list_iterate_end_no_match(
                archive_list->elems[i].attr);
          }
 
+#ifdef HAVE_THREADS
+         if (_db->scan_pool)
+            task_database_scan_pool_fill(_db);
+#endif
+         DATABASE_SCAN_UNLOCK(_db);
+
          string_list_free(archive_list);
       }
    }
@@ -863,7 +1489,7 @@ static int task_database_iterate_crc_lookup(
 {
    if (!db_state->list ||
          (unsigned)db_state->list_index == (unsigned)db_state->list->size)
-      return database_info_list_iterate_end_no_match(db, db_state, name);
+      return database_info_list_iterate_end_no_match(_db, db, db_state, name);
 
    /* Archive did not contain a CRC for this entry, 
     * or the file is empty. */
@@ -1018,7 +1644,7 @@ static int task_database_iterate_serial_lookup(
          !db_state->list ||
          (unsigned)db_state->list_index == (unsigned)db_state->list->size
       )
-      return database_info_list_iterate_end_no_match(db, db_state, name);
+      return database_info_list_iterate_end_no_match(_db, db, db_state, name);
 
    if (db_state->entry_index == 0)
    {
@@ -1083,7 +1709,7 @@ static int task_database_iterate(
    switch (db->type)
    {
       case DATABASE_TYPE_ITERATE:
-         return task_database_iterate_playlist(db_state, db, name);
+         return task_database_iterate_playlist(_db, db_state, db, name);
       case DATABASE_TYPE_ITERATE_ARCHIVE:
 #ifdef HAVE_COMPRESSION
          return task_database_iterate_crc_lookup(
@@ -1209,10 +1835,19 @@ static void task_database_handler(retro_task_t *task)
                }
             }
          }
+
+         task_database_cache_init(&db->scan_cache, db->playlist_directory);
+#ifdef HAVE_THREADS
+         task_database_scan_pool_init(db);
+#endif
          dbinfo->status = DATABASE_STATUS_ITERATE_START;
          break;
       case DATABASE_STATUS_ITERATE_START:
          name                 = database_info_get_current_element_name(dbinfo);
+#ifdef HAVE_THREADS
+         if (db->scan_pool)
+            task_database_scan_pool_advance(db, dbinfo->list_ptr);
+#endif
          task_database_cleanup_state(dbstate);
          dbstate->list_index  = 0;
          dbstate->entry_index = 0;
@@ -1281,6 +1916,11 @@ task_finished:
 
    if (db)
    {
+#ifdef HAVE_THREADS
+      task_database_scan_pool_deinit(db);
+#endif
+      task_database_cache_deinit(&db->scan_cache);
+
       if (!string_is_empty(db->playlist_directory))
          free(db->playlist_directory);
       if (!string_is_empty(db->content_database_path))
@@ -1331,19 +1971,23 @@ bool task_push_dbscan(
    t->title                                = strdup(msg_hash_to_str(
             MSG_PREPARING_FOR_CONTENT_SCAN));
    t->alternative_look                     = true;
+   t->priority                             = TASK_PRIORITY_BACKGROUND;
 
 #ifdef RARCH_INTERNAL
    t->progress_cb                          = task_database_progress_cb;
    db->scan_without_core_match             = settings->bools.scan_without_core_match;
+   db->scan_threads                        = settings->uints.scan_threads;
    db->playlist_config.capacity            = COLLECTION_SIZE;
    db->playlist_config.old_format          = settings->bools.playlist_use_old_format;
    db->playlist_config.compress            = settings->bools.playlist_compression;
+   db->playlist_config.binary              = settings->bools.playlist_use_binary_format;
    db->playlist_config.fuzzy_archive_match = settings->bools.playlist_fuzzy_archive_match;
    playlist_config_set_base_content_directory(&db->playlist_config, settings->bools.playlist_portable_paths ? settings->paths.directory_menu_content : NULL);
 #else
    db->playlist_config.capacity            = COLLECTION_SIZE;
    db->playlist_config.old_format          = false;
    db->playlist_config.compress            = false;
+   db->playlist_config.binary              = false;
    db->playlist_config.fuzzy_archive_match = false;
    playlist_config_set_base_content_directory(&db->playlist_config, NULL);
 #endif
@@ -14,13 +14,16 @@
  */
 
 #include <stdint.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <errno.h>
 
 #include <file/nbio.h>
+#include <file/file_path.h>
 #include <formats/image.h>
 #include <compat/strl.h>
+#include <streams/file_stream.h>
 #include <string/stdstring.h>
 #include <retro_miscellaneous.h>
 #include <features/features_cpu.h>
@@ -29,6 +32,51 @@
 #include "tasks_internal.h"
 
 #include "../configuration.h"
+#include "../KingStation.h"
+
+#ifdef HAVE_THREADS
+#include <rthreads/rthreads.h>
+#include <rthreads/tpool.h>
+#endif
+
+#if defined(HAVE_MMAP) && !defined(_WIN32)
+#define IMAGE_CACHE_HAVE_MMAP
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#endif
+
+/* Decoded images kept on disk, see task_push_image_load_cached().
+ * The header is followed by the source path and, at pixel_offset,
+ * by the pixels exactly as they are handed to the callback. Values
+ * are in native byte order, the files are not meant to be shared
+ * between machines. */
+#define IMAGE_CACHE_MAGIC   0x4354534bu /* "KSTC" */
+#define IMAGE_CACHE_VERSION 1
+
+/* Larger images are not what this is for */
+#define IMAGE_CACHE_MAX_PIXELS (8192 * 8192)
+
+typedef struct
+{
+   uint32_t magic;
+   uint32_t version;
+   uint32_t width;
+   uint32_t height;
+   uint32_t supports_rgba;
+   uint32_t path_len;
+   uint32_t pixel_offset;
+   uint32_t reserved;
+} image_cache_header_t;
+
+typedef struct
+{
+   char *path;
+   char *cache_path;
+   unsigned upscale_threshold;
+   bool supports_rgba;
+} image_cache_load_t;
 
 enum image_status_enum
 {
@@ -36,7 +84,8 @@ enum image_status_enum
    IMAGE_STATUS_TRANSFER,
    IMAGE_STATUS_TRANSFER_PARSE,
    IMAGE_STATUS_PROCESS_TRANSFER,
-   IMAGE_STATUS_PROCESS_TRANSFER_PARSE
+   IMAGE_STATUS_PROCESS_TRANSFER_PARSE,
+   IMAGE_STATUS_DECODE
 };
 
 struct nbio_image_handle
@@ -48,13 +97,24 @@ struct nbio_image_handle
    int processing_final_state;
    unsigned frame_duration;
    unsigned upscale_threshold;
+   char *cache_path;
    enum image_type_enum type;
    enum image_status_enum status;
    bool is_blocking;
    bool is_blocking_on_processing;
    bool is_finished;
+   bool is_decoding;
 };
 
+#ifdef HAVE_THREADS
+/* Guards 'is_decoding' of the images handed to the frontend
+ * thread pool, see task_image_decode_submit(). Created by
+ * task_image_decode_init() before the task queue starts, so
+ * image tasks running at once never race to create them */
+static slock_t *image_decode_lock = NULL;
+static scond_t *image_decode_cond = NULL;
+#endif
+
 static int cb_image_upload_generic(void *data, size_t len)
 {
    unsigned r_shift, g_shift, b_shift, a_shift;
@@ -158,6 +218,17 @@ static void task_image_cleanup(nbio_handle_t *nbio)
 {
    struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
 
+#ifdef HAVE_THREADS
+   /* Cancelled while a decode thread still works on it */
+   if (image && image_decode_lock)
+   {
+      slock_lock(image_decode_lock);
+      while (image->is_decoding)
+         scond_wait(image_decode_cond, image_decode_lock);
+      slock_unlock(image_decode_lock);
+   }
+#endif
+
    if (image)
    {
       image_transfer_free(image->handle, image->type);
@@ -167,6 +238,8 @@ static void task_image_cleanup(nbio_handle_t *nbio)
    }
    if (!string_is_empty(nbio->path))
       free(nbio->path);
+   if (image && image->cache_path)
+      free(image->cache_path);
    if (nbio->data)
       free(nbio->data);
    nbio_free(nbio->handle);
@@ -186,6 +259,105 @@ static void task_image_load_free(retro_task_t *task)
    }
 }
 
+#ifdef HAVE_THREADS
+static void task_image_decode_job(void *data)
+{
+   unsigned r_shift, g_shift, b_shift, a_shift;
+   unsigned width                  = 0;
+   unsigned height                 = 0;
+   nbio_handle_t *nbio             = (nbio_handle_t*)data;
+   struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
+   int retval;
+
+   while (image_transfer_iterate(image->handle, image->type));
+
+   do
+   {
+      retval = task_image_process(image, &width, &height);
+   } while (retval == IMAGE_PROCESS_NEXT);
+
+   if (retval == IMAGE_PROCESS_END)
+   {
+      image_texture_set_color_shifts(&r_shift, &g_shift, &b_shift,
+            &a_shift, &image->ti);
+      image_texture_color_convert(r_shift, g_shift, b_shift,
+            a_shift, &image->ti);
+   }
+
+   slock_lock(image_decode_lock);
+   image->processing_final_state = retval;
+   image->is_decoding            = false;
+   scond_broadcast(image_decode_cond);
+   slock_unlock(image_decode_lock);
+}
+
+/* Hands the rest of the decode over to the thread pool,
+ * instead of doing it a frame's worth at a time on the task
+ * thread. Returns false if there is no pool */
+static bool task_image_decode_submit(nbio_handle_t *nbio)
+{
+   struct nbio_image_handle *image = (struct nbio_image_handle*)nbio->data;
+   tpool_t *pool                   = KingStation_get_thread_pool();
+
+   if (!pool || !image_decode_lock)
+      return false;
+
+   image->is_decoding = true;
+
+   if (!tpool_add_work(pool, task_image_decode_job, nbio))
+   {
+      image->is_decoding = false;
+      return false;
+   }
+
+   image->status = IMAGE_STATUS_DECODE;
+   return true;
+}
+
+/* Returns true while a decode thread still works on 'image' */
+static bool task_image_decode_pending(struct nbio_image_handle *image)
+{
+   bool pending;
+
+   slock_lock(image_decode_lock);
+   pending = image->is_decoding;
+   slock_unlock(image_decode_lock);
+
+   return pending;
+}
+#endif
+
+bool task_image_decode_init(void)
+{
+#ifdef HAVE_THREADS
+   if (image_decode_lock)
+      return true;
+
+   image_decode_lock = slock_new();
+   image_decode_cond = scond_new();
+
+   if (!image_decode_lock || !image_decode_cond)
+   {
+      task_image_decode_deinit();
+      return false;
+   }
+#endif
+   return true;
+}
+
+void task_image_decode_deinit(void)
+{
+#ifdef HAVE_THREADS
+   if (image_decode_cond)
+      scond_free(image_decode_cond);
+   if (image_decode_lock)
+      slock_free(image_decode_lock);
+
+   image_decode_cond = NULL;
+   image_decode_lock = NULL;
+#endif
+}
+
 static int cb_nbio_image_thumbnail(void *data, size_t len)
 {
    void *ptr                       = NULL;
@@ -227,6 +399,10 @@ static int cb_nbio_image_thumbnail(void *data, size_t len)
    image->is_finished              = false;
    nbio->is_finished               = true;
 
+#ifdef HAVE_THREADS
+   task_image_decode_submit(nbio);
+#endif
+
    return 0;
 }
 
@@ -272,6 +448,227 @@ static bool upscale_image(
    return true;
 }
 
+/* Upscales @ti in place if either side is below @threshold */
+static void task_image_upscale(struct texture_image *ti, unsigned threshold)
+{
+   unsigned min_size;
+   float scale_factor;
+   unsigned scale_factor_int;
+   struct texture_image img_resampled = {
+      NULL,
+      0,
+      0,
+      false
+   };
+
+   if (     (threshold == 0)
+         || (ti->width == 0) || (ti->height == 0)
+         || ((ti->width  >= threshold) && (ti->height >= threshold)))
+      return;
+
+   min_size         = (ti->width < ti->height) ? ti->width : ti->height;
+   scale_factor     = (float)threshold / (float)min_size;
+   scale_factor_int = (unsigned)scale_factor;
+
+   if (scale_factor - (float)scale_factor_int > 0.0f)
+      scale_factor_int += 1;
+
+   if (upscale_image(scale_factor_int, ti, &img_resampled))
+   {
+      ti->width  = img_resampled.width;
+      ti->height = img_resampled.height;
+
+      if (ti->pixels)
+         free(ti->pixels);
+      ti->pixels = img_resampled.pixels;
+   }
+}
+
+/* Writes to a file of the task's own first, another image
+ * task may be writing or reading the same cache entry */
+static bool task_image_cache_write(const char *cache_path,
+      const char *path, const struct texture_image *ti,
+      uint32_t ident)
+{
+   image_cache_header_t header;
+   char dir[PATH_MAX_LENGTH];
+   char tmp_path[PATH_MAX_LENGTH];
+   static const char pad[16] = {0};
+   size_t path_len           = strlen(path);
+   size_t pixels_len         = (size_t)ti->width * ti->height * sizeof(uint32_t);
+   RFILE *file               = NULL;
+   bool success              = false;
+
+   if (     !ti->pixels
+         || (ti->width == 0) || (ti->height == 0)
+         || ((uint64_t)ti->width * ti->height > IMAGE_CACHE_MAX_PIXELS))
+      return false;
+
+   header.magic         = IMAGE_CACHE_MAGIC;
+   header.version       = IMAGE_CACHE_VERSION;
+   header.width         = ti->width;
+   header.height        = ti->height;
+   header.supports_rgba = ti->supports_rgba ? 1 : 0;
+   header.path_len      = (uint32_t)path_len;
+   /* Keep the pixels aligned in a mapped file */
+   header.pixel_offset  = (uint32_t)((sizeof(header) + path_len + 15) & ~15);
+   header.reserved      = 0;
+
+   fill_pathname_basedir(dir, cache_path, sizeof(dir));
+   if (!path_is_directory(dir) && !path_mkdir(dir))
+      return false;
+
+   snprintf(tmp_path, sizeof(tmp_path), "%s.%u.tmp",
+         cache_path, (unsigned)ident);
+
+   file = filestream_open(tmp_path,
+         RETRO_VFS_FILE_ACCESS_WRITE,
+         RETRO_VFS_FILE_ACCESS_HINT_NONE);
+   if (!file)
+      return false;
+
+   if (     filestream_write(file, &header, sizeof(header)) == sizeof(header)
+         && filestream_write(file, path, path_len) == (int64_t)path_len
+         && filestream_write(file, pad, header.pixel_offset
+            - sizeof(header) - path_len)
+            == (int64_t)(header.pixel_offset - sizeof(header) - path_len)
+         && filestream_write(file, ti->pixels, pixels_len)
+            == (int64_t)pixels_len)
+      success = true;
+
+   filestream_close(file);
+
+   if (success && filestream_rename(tmp_path, cache_path) != 0)
+      success = false;
+
+   /* A partial file would only fail to load, but
+    * there is no point in keeping it */
+   if (!success)
+      filestream_delete(tmp_path);
+
+   return success;
+}
+
+/* Copies the pixels out of a cache file, which must have
+ * been written for @path */
+static bool task_image_cache_parse(const uint8_t *data, size_t len,
+      const char *path, struct texture_image *ti)
+{
+   image_cache_header_t header;
+   size_t pixels_len;
+
+   if (len < sizeof(header))
+      return false;
+
+   memcpy(&header, data, sizeof(header));
+
+   if (     header.magic   != IMAGE_CACHE_MAGIC
+         || header.version != IMAGE_CACHE_VERSION
+         || header.width   == 0
+         || header.height  == 0
+         || (uint64_t)header.width * header.height > IMAGE_CACHE_MAX_PIXELS
+         || header.path_len != strlen(path)
+         || header.pixel_offset < sizeof(header) + header.path_len
+         || header.pixel_offset > len)
+      return false;
+
+   pixels_len = (size_t)header.width * header.height * sizeof(uint32_t);
+
+   /* The name is a hash, make sure it is the right image */
+   if (     len - header.pixel_offset != pixels_len
+         || memcmp(data + sizeof(header), path, header.path_len))
+      return false;
+
+   ti->pixels = (uint32_t*)malloc(pixels_len);
+   if (!ti->pixels)
+      return false;
+
+   memcpy(ti->pixels, data + header.pixel_offset, pixels_len);
+   ti->width         = header.width;
+   ti->height        = header.height;
+   ti->supports_rgba = header.supports_rgba != 0;
+
+   return true;
+}
+
+static bool task_image_cache_read(const char *cache_path,
+      const char *path, struct texture_image *ti)
+{
+   bool success = false;
+#ifdef IMAGE_CACHE_HAVE_MMAP
+   struct stat st;
+   void *data   = MAP_FAILED;
+   int fd       = open(cache_path, O_RDONLY);
+
+   if (fd < 0)
+      return false;
+
+   if (fstat(fd, &st) == 0 && st.st_size > 0)
+      data = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+   close(fd);
+
+   if (data == MAP_FAILED)
+      return false;
+
+   success = task_image_cache_parse((const uint8_t*)data,
+         (size_t)st.st_size, path, ti);
+   munmap(data, (size_t)st.st_size);
+#else
+   void *data   = NULL;
+   int64_t len  = 0;
+
+   if (!filestream_read_file(cache_path, &data, &len))
+      return false;
+
+   success = task_image_cache_parse((const uint8_t*)data,
+         (size_t)len, path, ti);
+   free(data);
+#endif
+
+   return success;
+}
+
+static void task_image_cache_load_handler(retro_task_t *task)
+{
+   image_cache_load_t *state = (image_cache_load_t*)task->state;
+   struct texture_image *img = (struct texture_image*)
+      calloc(1, sizeof(struct texture_image));
+
+   if (img && !task_image_cache_read(state->cache_path, state->path, img))
+   {
+      /* Stale or damaged, replace it. Decodes the same way
+       * as the regular image task */
+      img->supports_rgba = state->supports_rgba;
+
+      if (image_texture_load(img, state->path))
+      {
+         task_image_upscale(img, state->upscale_threshold);
+         task_image_cache_write(state->cache_path, state->path, img,
+               task->ident);
+      }
+      else
+      {
+         free(img);
+         img = NULL;
+      }
+   }
+
+   task_set_data(task, img);
+   task_set_finished(task, true);
+}
+
+static void task_image_cache_load_free(retro_task_t *task)
+{
+   image_cache_load_t *state = task ? (image_cache_load_t*)task->state : NULL;
+
+   if (state)
+   {
+      free(state->path);
+      free(state->cache_path);
+      free(state);
+   }
+}
+
 bool task_image_load_handler(retro_task_t *task)
 {
    nbio_handle_t            *nbio  = (nbio_handle_t*)task->state;
@@ -283,6 +680,25 @@ bool task_image_load_handler(retro_task_t *task)
       {
          case IMAGE_STATUS_WAIT:
             return true;
+         case IMAGE_STATUS_DECODE:
+#ifdef HAVE_THREADS
+            /* Look again in a millisecond, letting other
+             * tasks run in the meantime */
+            if (task_image_decode_pending(image))
+            {
+               task->when = cpu_features_get_time_usec() + 1000;
+               return true;
+            }
+
+            task->when = 0;
+
+            if (     image->processing_final_state == IMAGE_PROCESS_ERROR
+                  || image->processing_final_state == IMAGE_PROCESS_ERROR_END)
+               return false;
+
+            image->is_finished = true;
+#endif
+            break;
          case IMAGE_STATUS_PROCESS_TRANSFER:
             if (task_image_iterate_process_transfer(image) == -1)
                image->status = IMAGE_STATUS_PROCESS_TRANSFER_PARSE;
@@ -333,38 +749,11 @@ bool task_image_load_handler(retro_task_t *task)
       if (img)
       {
          /* Upscale image, if required */
-         if (image->upscale_threshold > 0)
-         {
-            if (((image->ti.width > 0) && (image->ti.height > 0)) &&
-                ((image->ti.width  < image->upscale_threshold) ||
-                 (image->ti.height < image->upscale_threshold)))
-            {
-               unsigned min_size                  = (image->ti.width < image->ti.height) ?
-                                                      image->ti.width : image->ti.height;
-               float scale_factor                 = (float)image->upscale_threshold /
-                                                      (float)min_size;
-               unsigned scale_factor_int          = (unsigned)scale_factor;
-               struct texture_image img_resampled = {
-                  NULL,
-                  0,
-                  0,
-                  false
-               };
-
-               if (scale_factor - (float)scale_factor_int > 0.0f)
-                  scale_factor_int += 1;
-
-               if (upscale_image(scale_factor_int, &image->ti, &img_resampled))
-               {
-                  image->ti.width  = img_resampled.width;
-                  image->ti.height = img_resampled.height;
+         task_image_upscale(&image->ti, image->upscale_threshold);
 
-                  if (image->ti.pixels)
-                     free(image->ti.pixels);
-                  image->ti.pixels = img_resampled.pixels;
-               }
-            }
-         }
+         if (image->cache_path)
+            task_image_cache_write(image->cache_path, nbio->path,
+                  &image->ti, task->ident);
 
          img->width         = image->ti.width;
          img->height        = image->ti.height;
@@ -383,6 +772,15 @@ bool task_image_load_handler(retro_task_t *task)
 bool task_push_image_load(const char *fullpath, 
       bool supports_rgba, unsigned upscale_threshold,
       retro_task_callback_t cb, void *user_data)
+{
+   return task_push_image_load_cached(fullpath, NULL,
+         supports_rgba, upscale_threshold, cb, user_data);
+}
+
+bool task_push_image_load_cached(const char *fullpath,
+      const char *cache_path,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *user_data)
 {
    nbio_handle_t             *nbio   = NULL;
    struct nbio_image_handle   *image = NULL;
@@ -391,6 +789,37 @@ bool task_push_image_load(const char *fullpath,
    if (!t)
       return false;
 
+   /* Already decoded once, skip the whole nbio/transfer
+    * machinery */
+   if (!string_is_empty(cache_path) && path_is_valid(cache_path))
+   {
+      image_cache_load_t *state = (image_cache_load_t*)
+         malloc(sizeof(*state));
+
+      if (!state)
+      {
+         free(t);
+         return false;
+      }
+
+      state->path              = strdup(fullpath);
+      state->cache_path        = strdup(cache_path);
+      state->upscale_threshold = upscale_threshold;
+      state->supports_rgba     = supports_rgba;
+
+      t->state                 = state;
+      t->handler               = task_image_cache_load_handler;
+      t->cleanup               = task_image_cache_load_free;
+      t->callback              = cb;
+      t->user_data             = user_data;
+      t->priority              = TASK_PRIORITY_INTERACTIVE;
+      t->reentrant             = true;
+
+      task_queue_push(t);
+
+      return true;
+   }
+
    nbio                = (nbio_handle_t*)malloc(sizeof(*nbio));
 
    if (!nbio)
@@ -431,6 +860,9 @@ bool task_push_image_load(const char *fullpath,
    image->size                       = 0;
    image->upscale_threshold          = upscale_threshold;
    image->handle                     = NULL;
+   image->is_decoding                = false;
+   image->cache_path                 = string_is_empty(cache_path)
+      ? NULL : strdup(cache_path);
 
    image->ti.width                   = 0;
    image->ti.height                  = 0;
@@ -464,6 +896,10 @@ bool task_push_image_load(const char *fullpath,
    t->cleanup         = task_image_load_free;
    t->callback        = cb;
    t->user_data       = user_data;
+   t->priority        = TASK_PRIORITY_INTERACTIVE;
+   /* Image loads keep everything in the task, several
+    * thumbnails may load at once */
+   t->reentrant       = true;
 
    task_queue_push(t);
 
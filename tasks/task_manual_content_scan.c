@@ -509,6 +509,7 @@ bool task_push_manual_content_scan(
    task->title                   = strdup(task_title);
    task->alternative_look        = true;
    task->progress                = 0;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
    task->callback                = cb_task_manual_content_scan;
    task->cleanup                 = task_manual_content_scan_free;
 
@@ -537,6 +537,7 @@ bool task_push_pl_thumbnail_download(
    task->title                   = strdup(system);
    task->alternative_look        = true;
    task->progress                = 0;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
    
    task_queue_push(task);
    
@@ -343,6 +343,7 @@ bool task_push_pl_manager_reset_cores(const playlist_config_t *playlist_config)
    task->title                   = strdup(task_title);
    task->alternative_look        = true;
    task->progress                = 0;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
    task->callback                = cb_task_pl_manager;
    task->cleanup                 = task_pl_manager_free;
    
@@ -867,6 +868,7 @@ bool task_push_pl_manager_clean_playlist(
    task->title                   = strdup(task_title);
    task->alternative_look        = true;
    task->progress                = 0;
+   task->priority                = TASK_PRIORITY_BACKGROUND;
    task->callback                = cb_task_pl_manager;
    task->cleanup                 = task_pl_manager_free;
    
@@ -154,10 +154,29 @@ bool task_push_core_restore(const char *backup_path,
 bool task_push_pl_manager_reset_cores(const playlist_config_t *playlist_config);
 bool task_push_pl_manager_clean_playlist(const playlist_config_t *playlist_config);
 
+/* Sets up what task_push_image_load() needs to decode images
+ * in the frontend thread pool. Call it before the task queue
+ * starts; without it images are decoded on the task thread */
+bool task_image_decode_init(void);
+
+/* Frees what task_push_image_load() keeps to decode images
+ * in the frontend thread pool, once no image task is left */
+void task_image_decode_deinit(void);
+
 bool task_push_image_load(const char *fullpath,
       bool supports_rgba, unsigned upscale_threshold,
       retro_task_callback_t cb, void *userdata);
 
+/* Same as task_push_image_load(), but if the file at @cache_path
+ * exists, the decoded image is read from it instead of @fullpath.
+ * Otherwise @fullpath is decoded and the result written there.
+ * @cache_path must change whenever @fullpath or @upscale_threshold
+ * does. */
+bool task_push_image_load_cached(const char *fullpath,
+      const char *cache_path,
+      bool supports_rgba, unsigned upscale_threshold,
+      retro_task_callback_t cb, void *userdata);
+
 #ifdef HAVE_LIBRETRODB
 bool task_push_dbscan(
       const char *playlist_directory,